@@ -12,13 +12,20 @@
 // ricezione dei messaggi fsp.
 // Non può essere aperta più di una connessione contemporaneamente.
 // I nomi dei file sul server sono salvati con il loro path assoluto (iniziano con il carattere '/').
+// Dopo l'apertura di un file con openFile, le richieste relative al file usano il descrittore numerico
+// restituito dal server al posto del nome del file (in modo trasparente) fino alla sua chiusura con closeFile.
 // Qualsiasi scrittura in memoria secondaria di un file prelevato dal server avviene modificando il suo nome nel modo seguente:
 // il primo carattere '/' viene omesso e qualsiasi altro carattere '/' viene sostituito con '_'.
+// Se il server supporta il protocollo binario (versione 2), allora le funzioni readFileAsync e lockFileAsync inviano
+// una richiesta senza attenderne la risposta (pipelining): più richieste possono essere in corso contemporaneamente e
+// il server può completarle in un ordine diverso (una lock non ancora disponibile non ritarda le richieste successive).
+// La risposta viene attesa con waitResponse; le risposte ricevute prima di essere attese vengono conservate.
 
 #ifndef FSP_API_H
 #define FSP_API_H
 
 #include <time.h>
+#include <stddef.h>
 
 #define O_DEFAULT 0
 #define O_CREATE 1
@@ -142,6 +149,28 @@ int readFile(const char* pathname, void** buf, size_t* size);
  */
 int readNFiles(int N, const char* dirname);
 
+/**
+ * \brief Richiede al server l'elenco dei file il cui nome inizia con prefix (tutti se prefix == NULL), senza il loro contenuto.
+ *
+ * I file vengono elencati in ordine lessicografico crescente dei nomi a partire dal primo nome strettamente maggiore
+ * di after (dal primo se after == NULL): per leggere l'elenco completo a pagine, passare come after l'ultimo nome ricevuto
+ * finché la funzione restituisce N. Se N <= 0, il server elenca al più il numero massimo di file per richiesta
+ * (FSP_PARSER_LIST_MAX_LIMIT). Per ogni file viene chiamata la funzione callback con il nome del file, la sua dimensione
+ * e arg: il nome è valido solo durante la chiamata di callback.
+ * \return un valore maggiore o uguale a 0 in caso di successo (cioè ritorna il numero dei file elencati),
+ *         -1 in caso di fallimento, errno viene settato opportunamente.
+ *
+ *         EINVAL: se callback == NULL || prefix o after contengono caratteri di fine riga || after == "".
+ *         ENOTCONN: se non è stata aperta la connessione con openConnection().
+ *         ENOBUFS: se la memoria per il buffer non è sufficiente o
+ *                  non è stato possibile allocare memoria.
+ *         EIO: se ci sono stati errori di lettura e scrittura su socket.
+ *         ECONNABORTED: se il servizio non è disponibile (codice di risposta fsp 421) e la connessione è stata chiusa.
+ *         EBADMSG: se il messaggio di richiesta fsp contiene errori sintattici (codice di risposta fsp 501), o
+ *                  li contiene il messaggio di risposta fsp (anche in caso di codice di risposta fsp non riconosciuto/inatteso).
+ */
+int listFiles(const char* prefix, int N, const char* after, void (*callback) (const char* pathname, size_t size, void* arg), void* arg);
+
 /**
  * \brief Scrive tutto il file puntato da pathname nel file server.
  *
@@ -277,4 +306,73 @@ int closeFile(const char* pathname);
  */
 int removeFile(const char* pathname);
 
+/**
+ * \brief Imposta il TTL (in secondi) dei file creati con openFile (flag O_CREATE) e scritti con writeFile
+ *        dopo la chiamata: il server rimuove un file dopo ttl secondi dalla sua creazione o dalla sua scrittura.
+ *
+ * Se ttl == 0, allora i file creati non scadono e writeFile non cambia la scadenza del file.
+ * \return 0 in caso di successo,
+ *         -1 in caso di fallimento, errno viene settato opportunamente.
+ *
+ *         EINVAL: se ttl è maggiore di FSP_PARSER_TTL_MAX (10 anni).
+ */
+int setFilesTTL(unsigned int ttl);
+
+/**
+ * \brief Imposta la scadenza del file pathname (aperto) a ttl secondi dalla richiesta (se ttl == 0, allora il file non scade più).
+ *
+ * L’operazione fallisce se il file è in stato locked da parte di un processo client diverso da chi effettua la touchFile.
+ * \return 0 in caso di successo,
+ *         -1 in caso di fallimento, errno viene settato opportunamente.
+ *
+ *         EINVAL: se pathname == NULL || ttl è maggiore di FSP_PARSER_TTL_MAX (10 anni).
+ *         ENOTCONN: se non è stata aperta la connessione con openConnection().
+ *         ENOBUFS: se la memoria per il buffer non è sufficiente.
+ *         EIO: se ci sono stati errori di lettura e scrittura su socket.
+ *         ECONNABORTED: se il servizio non è disponibile (codice di risposta fsp 421) e la connessione è stata chiusa.
+ *         EBADMSG: se il messaggio di richiesta fsp contiene errori sintattici (codice di risposta fsp 501), o
+ *                  li contiene il messaggio di risposta fsp (anche in caso di codice di risposta fsp non riconosciuto/inatteso).
+ *         ENOENT: se il file pathname non è presente sul server o è scaduto (codice di risposta fsp 550).
+ *         EPERM: se l'operazione non è consentita (codice di risposta fsp 554).
+ *         ECANCELED: se il file non è stato aperto (codice di risposta fsp 556).
+ */
+int touchFile(const char* pathname, unsigned int ttl);
+
+/**
+ * \brief Invia la richiesta di lettura del file pathname senza attenderne la risposta.
+ *
+ * Il contenuto del file viene restituito da waitResponse con l'identificativo della richiesta.
+ * \return L'identificativo della richiesta (maggiore di zero) in caso di successo,
+ *         -1 in caso di fallimento, errno viene settato opportunamente.
+ *
+ *         EINVAL: se pathname == NULL.
+ *         ENOTCONN: se non è stata aperta la connessione con openConnection().
+ *         ENOTSUP: se il server non supporta il protocollo binario (versione 2).
+ *         ENOBUFS: se la memoria per il buffer non è sufficiente.
+ *         EIO: se ci sono stati errori di scrittura su socket.
+ */
+int readFileAsync(const char* pathname);
+
+/**
+ * \brief Invia la richiesta di settare il flag O_LOCK al file pathname senza attenderne la risposta
+ *        (come lockFile, la risposta arriva quando la lock viene ottenuta).
+ *
+ * L'esito viene restituito da waitResponse con l'identificativo della richiesta.
+ * \return L'identificativo della richiesta (maggiore di zero) in caso di successo,
+ *         -1 in caso di fallimento, errno viene settato opportunamente (come readFileAsync).
+ */
+int lockFileAsync(const char* pathname);
+
+/**
+ * \brief Attende la risposta alla richiesta id inviata con readFileAsync o lockFileAsync.
+ *
+ * Per le richieste di lettura salva in *buf e *size il contenuto del file come readFile (buf e size
+ * vengono ignorati per le altre richieste). Dopo la chiamata l'identificativo id non è più valido.
+ * \return 0 in caso di successo,
+ *         -1 in caso di fallimento, errno viene settato opportunamente (come readFile e lockFile).
+ *
+ *         EINVAL: se id non è l'identificativo di una richiesta in corso || (la richiesta è di lettura && (buf == NULL || size == NULL)).
+ */
+int waitResponse(int id, void** buf, size_t* size);
+
 #endif
@@ -10,7 +10,7 @@
 #define FSP_CLIENT_REQUEST_QUEUE_H
 
 struct fsp_client_request {
-    // Tipo di richiesta: w, W, r, R, l, u, c
+    // Tipo di richiesta: w, W, r, R, l, u, c, L, T
     char opt;
     // Argomento (o argomenti separati dalla virgola)
     char* arg;
@@ -18,6 +18,8 @@ struct fsp_client_request {
     char* time;
     // Cartella in memoria secondaria in cui vengono scritti i file (NULL di default) specificata con le opzioni -D e -d
     char* dirname;
+    // Scadenza in secondi dei file scritti o aggiornati (NULL di default) specificata con l'opzione -e
+    char* ttl;
     struct fsp_client_request* prev;
     struct fsp_client_request* next;
 };
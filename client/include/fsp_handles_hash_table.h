@@ -0,0 +1,75 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+// Tabella hash contenente i descrittori dei file.
+// Struttura dati usata dall'API per associare a ogni file aperto il descrittore
+// restituito dal server, da usare nelle richieste successive al posto del nome del file.
+// Le collisioni vengono risolte mediante concatenamento.
+
+#ifndef FSP_HANDLES_HASH_TABLE_H
+#define FSP_HANDLES_HASH_TABLE_H
+
+#include <stdio.h>
+
+struct fsp_handle {
+    // Descrittore del file
+    long int handle;
+    // Nodo successivo
+    struct fsp_handle* next;
+    // Nome del file
+    char pathname[];
+};
+
+struct fsp_handles_hash_table {
+    // Dimensione della tabella
+    size_t size;
+    // Numero dei descrittori presenti nella tabella
+    unsigned int handles_num;
+    // La tabella (vettore)
+    struct fsp_handle** table;
+};
+
+/**
+ * \brief Restituisce una nuova tabella hash di dimensione size.
+ *
+ * \return Una nuova tabella hash di dimensione size,
+ *         NULL se size == 0 || non è stato possibile allocare la memoria.
+ */
+struct fsp_handles_hash_table* fsp_handles_hash_table_new(size_t size);
+
+/**
+ * \brief Libera dalla memoria hash_table e tutti i descrittori in essa contenuti.
+ */
+void fsp_handles_hash_table_free(struct fsp_handles_hash_table* hash_table);
+
+/**
+ * \brief Associa il descrittore handle al file pathname nella tabella hash_table
+ *        (sostituisce l'eventuale descrittore già presente).
+ *
+ * \return 0 in caso di successo,
+ *         -1 se hash_table == NULL || pathname == NULL,
+ *         -2 se non è stato possibile allocare la memoria.
+ */
+int fsp_handles_hash_table_insert(struct fsp_handles_hash_table* hash_table, const char* pathname, long int handle);
+
+/**
+ * \brief Cerca nella tabella hash_table il descrittore del file pathname.
+ *
+ * \return Il descrittore,
+ *         -1 se hash_table == NULL || pathname == NULL || descrittore non trovato.
+ */
+long int fsp_handles_hash_table_search(const struct fsp_handles_hash_table* hash_table, const char* pathname);
+
+/**
+ * \brief Rimuove il descrittore del file pathname dalla tabella hash_table.
+ */
+void fsp_handles_hash_table_delete(struct fsp_handles_hash_table* hash_table, const char* pathname);
+
+/**
+ * \brief Rimuove tutti i descrittori presenti nella tabella hash_table.
+ */
+void fsp_handles_hash_table_deleteAll(struct fsp_handles_hash_table* hash_table);
+
+#endif
@@ -12,7 +12,56 @@
 #define FSP_PARSER_BUF_MAX_SIZE 134217728
 
 // Comandi dei messaggi di richiesta
-enum fsp_command { APPEND, CLOSE, LOCK, OPEN, OPENC, OPENCL, OPENL, QUIT, READ, READN, REMOVE, UNLOCK, WRITE };
+enum fsp_command { APPEND, CLOSE, LIST, LOCK, OPEN, OPENC, OPENCL, OPENL, QUIT, READ, READN, REMOVE, TOUCH, UNLOCK, WRITE };
+
+// Comando LIST
+// L'argomento ha la forma "LIMIT PREFIX_LEN PREFIX[ CURSOR]": i due numeri occupano posizioni fisse, PREFIX
+// è lungo esattamente PREFIX_LEN byte (anche 0) e CURSOR, se presente, è il resto dell'argomento dopo lo spazio
+// che segue PREFIX (i nomi possono contenere spazi). Il server restituisce, in ordine lessicografico crescente,
+// i nomi e le dimensioni (senza i contenuti) di al più LIMIT file il cui nome inizia con PREFIX ed è maggiore
+// di CURSOR (l'ultimo nome ricevuto, per leggere la pagina successiva).
+// Se LIMIT è minore o uguale a zero o maggiore di FSP_PARSER_LIST_MAX_LIMIT, allora vale FSP_PARSER_LIST_MAX_LIMIT.
+// Il campo data del messaggio di risposta contiene gli elementi "PATHNAME_LEN PATHNAME SIZE " (fsp_parser_parseList).
+#define FSP_PARSER_LIST_MAX_LIMIT 10000
+
+// Scadenza dei file (TTL)
+// L'argomento dei comandi OPENC, OPENCL e WRITE può terminare con " TTL" (separato dal nome del file da uno spazio):
+// il file scade dopo TTL secondi dal comando (0: il file non scade, per WRITE: la scadenza non cambia).
+// Il comando TOUCH (argomento "PATHNAME TTL") imposta la scadenza di un file aperto dal client a TTL secondi
+// dal comando (0: il file non scade più). Un file scaduto viene rimosso dal server come con il comando REMOVE.
+// TTL non può essere maggiore di FSP_PARSER_TTL_MAX (10 anni).
+#define FSP_PARSER_TTL_MAX 315360000
+
+// Prefisso dei descrittori dei file
+// I comandi OPEN* terminati con successo aggiungono alla fine della descrizione del messaggio
+// di risposta il descrittore del file aperto (es. "... #3"); i comandi APPEND, CLOSE, LOCK, READ,
+// REMOVE, TOUCH, UNLOCK e WRITE accettano come argomento il descrittore ("#3") al posto del nome del file.
+// Il descrittore è valido fino alla chiusura del file.
+#define FSP_PARSER_HANDLE_PREFIX '#'
+
+// Protocollo binario (versione 2)
+// Il server annuncia il supporto della versione 2 aggiungendo FSP_PARSER_V2_TOKEN alla descrizione del messaggio
+// di benvenuto (codice 220, sempre in formato testuale): un client che lo riconosce può inviare le richieste
+// in formato binario. Il server riconosce il formato di ogni richiesta dal primo byte e risponde nello stesso formato.
+// Un messaggio binario inizia con un'intestazione di FSP_PARSER_V2_HEADER_LEN byte (interi in network byte order):
+// - magic (1 byte): FSP_PARSER_V2_MAGIC (un messaggio testuale non può iniziare con questo byte);
+// - versione (1 byte): FSP_PARSER_V2;
+// - opcode (2 byte): codice del comando (richieste, vedi sotto) o codice di risposta (risposte);
+// - flags (4 byte): riservati, devono valere 0;
+// - identificativo della richiesta (4 byte): scelto dal client, il server lo ripete nella risposta (un client può
+//   inviare più richieste senza attendere le risposte e il server può completarle in un ordine diverso);
+// - lunghezza dell'argomento (o della descrizione) compreso il carattere '\0' finale (4 byte, almeno 1);
+// - lunghezza dei dati (4 byte).
+// Seguono l'argomento (o la descrizione) terminato da '\0' e i dati, senza separatori: la lunghezza del messaggio
+// è nota dopo aver letto l'intestazione e il parsing non modifica il buffer. Il campo dati ha lo stesso contenuto
+// della versione testuale (fsp_parser_parseData, fsp_parser_parseList).
+// Codici dei comandi: APPEND 1, CLOSE 2, LIST 3, LOCK 4, OPEN 5, OPENC 6, OPENCL 7, OPENL 8, QUIT 9, READ 10,
+// READN 11, REMOVE 12, TOUCH 13, UNLOCK 14, WRITE 15 (i nuovi comandi ricevono i codici successivi).
+#define FSP_PARSER_V1 1
+#define FSP_PARSER_V2 2
+#define FSP_PARSER_V2_TOKEN "FSP/2"
+#define FSP_PARSER_V2_MAGIC 0xF5
+#define FSP_PARSER_V2_HEADER_LEN 20
 
 // Messaggio di richiesta
 struct fsp_request {
@@ -20,6 +69,9 @@ struct fsp_request {
     char* arg;
     size_t data_len;
     void* data;
+    // Versione del protocollo (FSP_PARSER_V1 o FSP_PARSER_V2) e identificativo della richiesta (0 nella versione 1)
+    int version;
+    unsigned int id;
 };
 
 // Messaggio di risposta
@@ -28,6 +80,9 @@ struct fsp_response {
     char* description;
     size_t data_len;
     void* data;
+    // Versione del protocollo (FSP_PARSER_V1 o FSP_PARSER_V2) e identificativo della richiesta (0 nella versione 1)
+    int version;
+    unsigned int id;
 };
 
 // Il campo dati contenuto in un messaggio fsp di risposta (lista di dati)
@@ -98,13 +153,74 @@ int fsp_parser_parseResponse(void* buf, size_t size, struct fsp_response* resp);
  */
 long int fsp_parser_makeResponse(void** buf, size_t* size, int code, const char* description, size_t data_len, void* data);
 
+/**
+ * \brief Restituisce la lunghezza totale del messaggio binario (versione 2) che inizia in buf,
+ *        leggendo l'intestazione contenuta nei primi size byte.
+ *
+ * \return La lunghezza del messaggio (intestazione compresa) in caso di successo,
+ *         -1 se buf == NULL,
+ *         -2 se l'intestazione è incompleta (size < FSP_PARSER_V2_HEADER_LEN),
+ *         -3 se l'intestazione non è valida (magic, versione, flags o lunghezze errati, messaggio più lungo
+ *            di FSP_PARSER_BUF_MAX_SIZE).
+ */
+long int fsp_parser_binaryLength(const void* buf, size_t size);
+
+/**
+ * \brief Restituisce l'identificativo contenuto nell'intestazione del messaggio binario (versione 2) che inizia in buf,
+ *        anche se l'intestazione non è valida (la risposta a un messaggio errato usa l'identificativo della richiesta).
+ *
+ * \return L'identificativo del messaggio,
+ *         0 se buf == NULL || l'intestazione è incompleta (size < FSP_PARSER_V2_HEADER_LEN).
+ */
+unsigned int fsp_parser_binaryId(const void* buf, size_t size);
+
+/**
+ * \brief Scrive in buf (almeno FSP_PARSER_V2_HEADER_LEN byte) l'intestazione di un messaggio binario (versione 2)
+ *        con codice opcode, identificativo id, lunghezza dell'argomento arg_len ('\0' compreso) e dei dati data_len.
+ */
+void fsp_parser_makeBinaryHeader(void* buf, unsigned int opcode, unsigned int id, size_t arg_len, size_t data_len);
+
+/**
+ * \brief Come fsp_parser_parseRequest() per i messaggi di richiesta binari (versione 2).
+ *
+ * La funzione non modifica il contenuto di buf. Se l'intestazione è completa, allora req->version e req->id
+ * sono significativi anche se la funzione restituisce -3 (il server può rispondere con lo stesso identificativo).
+ * \return 0 in caso di successo,
+ *         -1 se buf == NULL || req == NULL,
+ *         -2 se il messaggio è incompleto,
+ *         -3 se il messaggio contiene errori sintattici.
+ */
+int fsp_parser_parseBinaryRequest(void* buf, size_t size, struct fsp_request* req);
+
+/**
+ * \brief Come fsp_parser_makeRequest() per i messaggi di richiesta binari (versione 2) con identificativo id.
+ */
+long int fsp_parser_makeBinaryRequest(void** buf, size_t* size, enum fsp_command cmd, unsigned int id, const char* arg, size_t data_len, void* data);
+
+/**
+ * \brief Come fsp_parser_parseResponse() per i messaggi di risposta binari (versione 2).
+ *
+ * La funzione non modifica il contenuto di buf.
+ * \return 0 in caso di successo,
+ *         -1 se buf == NULL || resp == NULL,
+ *         -2 se il messaggio è incompleto,
+ *         -3 se il messaggio contiene errori sintattici.
+ */
+int fsp_parser_parseBinaryResponse(void* buf, size_t size, struct fsp_response* resp);
+
+/**
+ * \brief Come fsp_parser_makeResponse() per i messaggi di risposta binari (versione 2) con identificativo id.
+ */
+long int fsp_parser_makeBinaryResponse(void** buf, size_t* size, int code, unsigned int id, const char* description, size_t data_len, void* data);
+
 /**
  * \brief Fa il parse dei dati data (campo DATA dei messaggi fsp) di lunghezza data_len e salva nella lista *parsed_data il loro contenuto.
  *
  * La funzione modifica il contenuto di data. Dopo la chiamata della funzione qualsiasi modifica a data può comportare cambiamenti
  * anche al contenuto dei dati nella lista *parsed_data. Usare il campo next in *parsed_data per passare da un dato al successivo.
  * La lista *parsed_data è vuota (*parsed_data == NULL) se la funzione non termina con successo.
- * Alloca memoria nello heap per costruire la lista *parsed_data: invocare il metodo fsp_parser_freeData() su *parsed_data per liberarla.
+ * Tutti i nodi della lista *parsed_data vengono allocati nello heap con una sola allocazione:
+ * invocare il metodo fsp_parser_freeData() su *parsed_data (e non su un nodo successivo) per liberarla.
  * \return 0 in caso di successo,
  *         -1 se data_len <= 0 || data == NULL || parsed_data == NULL,
  *         -2 se il campo data del messaggio è incompleto,
@@ -118,18 +234,44 @@ int fsp_parser_parseData(size_t data_len, void* data, struct fsp_data** parsed_d
  *
  * *buf deve essere allocato nello heap. Se necessario rialloca la memoria di *buf nello heap
  * (*buf e *size vengono modificati di conseguenza). La massima dimensione del buffer è definita in FSP_PARSER_BUF_MAX_SIZE.
- * Aggiunge a *buf i campi pathname (PATHNAME), data_size (SIZE) e data (data). Se data == NULL, allora il campo relativo
- * al dato sarà vuoto (data_size deve essere uguale a zero).
+ * Aggiunge a *buf i campi pathname (PATHNAME), data_size (SIZE) e data (data). Se data == NULL, allora lo spazio per il
+ * campo relativo al dato (data_size byte, che precedono l'ultimo byte scritto) viene riservato ma non scritto:
+ * il chiamante può scrivervi il dato direttamente (ad esempio decomprimendolo).
  * Inizia a scrivere a partire da (*buf)[offset].
  * Il comportamento è indefinito se la dimensione del dato data_size è superiore a quella effettiva in data.
  * \return valore maggiore o uguale a 0 in caso di successo (tale valore indica il numero di byte scritti in *buf),
- *         -1 se buf == NULL || *buf == NULL || size == NULL || offset < 0 || pathname == NULL || data_size < 0 || (data_size > 0 && data == NULL) || *size > FSP_PARSER_BUF_MAX_SIZE,
+ *         -1 se buf == NULL || *buf == NULL || size == NULL || offset < 0 || pathname == NULL || data_size < 0 || *size > FSP_PARSER_BUF_MAX_SIZE,
  *         -2 se non è stato possibile riallocare la memoria per *buf.
  */
 long int fsp_parser_makeData(void** buf, size_t* size, unsigned long int offset, const char* pathname, size_t data_size, void* data);
 
 /**
- * \brief Libera dalla memoria i nodi della lista *parsed_data.
+ * \brief Fa il parse dell'elenco data (campo DATA della risposta al comando LIST) di lunghezza data_len e salva
+ *        nella lista *parsed_data i nomi e le dimensioni dei file elencati (il campo data dei nodi è NULL).
+ *
+ * Valgono le stesse regole di fsp_parser_parseData() (usare fsp_parser_freeData() per liberare la lista).
+ * \return 0 in caso di successo,
+ *         -1 se data_len <= 0 || data == NULL || parsed_data == NULL,
+ *         -2 se il campo data del messaggio è incompleto,
+ *         -3 se il campo data del messaggio contiene errori sintattici,
+ *         -4 se è stato impossibile allocare memoria nello heap.
+ */
+int fsp_parser_parseList(size_t data_len, void* data, struct fsp_data** parsed_data);
+
+/**
+ * \brief Aggiunge a *buf, a partire da (*buf)[offset], un elemento dell'elenco restituito dal comando LIST
+ *        con il nome pathname e la dimensione file_size (PATHNAME_LEN PATHNAME SIZE).
+ *
+ * *buf deve essere allocato nello heap. Se necessario rialloca la memoria di *buf nello heap (raddoppiandone, se possibile, la
+ * dimensione, *buf e *size vengono modificati di conseguenza). La massima dimensione del buffer è definita in FSP_PARSER_BUF_MAX_SIZE.
+ * \return valore maggiore o uguale a 0 in caso di successo (tale valore indica il numero di byte scritti in *buf),
+ *         -1 se buf == NULL || *buf == NULL || size == NULL || pathname == NULL || *size > FSP_PARSER_BUF_MAX_SIZE,
+ *         -2 se non è stato possibile riallocare la memoria per *buf.
+ */
+long int fsp_parser_makeListItem(void** buf, size_t* size, unsigned long int offset, const char* pathname, size_t file_size);
+
+/**
+ * \brief Libera dalla memoria i nodi della lista parsed_data restituita da fsp_parser_parseData() o fsp_parser_parseList().
  */
 void fsp_parser_freeData(struct fsp_data* parsed_data);
 
@@ -16,7 +16,9 @@
  *        messaggio in req.
  *
  * Il comportamento della funzione è indefinito se il messaggio da leggere non è un messaggio di
- * richiesta fsp. Fa uso di un buffer *buf di lunghezza *size per la lettura dei byte da sfd che in
+ * richiesta fsp. Il formato del messaggio (testuale o binario, vedi FSP_PARSER_V2) viene riconosciuto dal
+ * primo byte: di un messaggio binario vengono letti l'intestazione e poi i byte indicati dalle lunghezze,
+ * senza cercare i delimitatori e senza leggere i byte successivi (i messaggi inviati in pipeline restano in sfd). Fa uso di un buffer *buf di lunghezza *size per la lettura dei byte da sfd che in
  * caso di necessità può riallocare (il puntatore a *buf e il valore di *size vengono aggiornati di
  * conseguenza). La massima dimensione del buffer è definita in FSP_READER_BUF_MAX_SIZE.
  * Se la funzione termina con successo, successive modifiche a *buf rendono i campi in
@@ -36,7 +38,9 @@ int fsp_reader_readRequest(int sfd, void** buf, size_t* size, struct fsp_request
  *        messaggio in resp.
  *
  * Il comportamento della funzione è indefinito se il messaggio da leggere non è un messaggio di
- * risposta fsp. Fa uso di un buffer *buf di lunghezza *size per la lettura dei byte da sfd che in
+ * risposta fsp. Il formato del messaggio (testuale o binario, vedi FSP_PARSER_V2) viene riconosciuto dal
+ * primo byte: di un messaggio binario vengono letti l'intestazione e poi i byte indicati dalle lunghezze,
+ * senza cercare i delimitatori e senza leggere i byte successivi (i messaggi inviati in pipeline restano in sfd). Fa uso di un buffer *buf di lunghezza *size per la lettura dei byte da sfd che in
  * caso di necessità può riallocare (il puntatore a *buf e il valore di *size vengono aggiornati di
  * conseguenza). La massima dimensione del buffer è definita in FSP_READER_BUF_MAX_SIZE.
  * Se la funzione termina con successo, successive modifiche a *buf rendono i campi in
@@ -24,6 +24,10 @@
 
 // Dimensione della tabella hash per i file aperti
 #define FSP_OPENED_FILES_HASH_TABLE_SIZE 97
+// Numero massimo dei file elencati da una singola richiesta listFiles (opzione -L)
+#define FSP_CLIENT_LIST_PAGE_LEN 1000
+// Numero massimo delle richieste di lettura in corso contemporaneamente (opzione -r senza attesa, pipelining)
+#define FSP_CLIENT_READ_PIPELINE_LEN 16
 
 // Ogni richiesta Request viene inserita in una coda RequestQueue
 typedef struct fsp_client_request Request;
@@ -53,6 +57,9 @@ static int Write_opt(char* arg, char* dirname, const struct timespec time, int p
 // 0 altrimenti.
 static int read_opt(char* arg, char* dirname, const struct timespec time, int p, OpenedFiles* opened_files);
 static void Read_opt(char* arg, char* dirname, const struct timespec time, int p);
+// Restituisce -1 se non è stato possibile allocare memoria,
+// 0 altrimenti.
+static int List_opt(char* arg, const struct timespec time, int p);
 // Restituisce -1 se non è stato possibile aggiungere il file appena aperto nella tabella hash,
 // 0 altrimenti.
 static int lock_opt(char* arg, const struct timespec time, int p, OpenedFiles* opened_files);
@@ -60,6 +67,9 @@ static void unlock_opt(char* arg, const struct timespec time, int p);
 // Restituisce -1 se non è stato possibile aggiungere il file appena aperto nella tabella hash,
 // 0 altrimenti.
 static int cancel_opt(char* arg, const struct timespec time, int p, OpenedFiles* opened_files);
+// Restituisce -1 se non è stato possibile aggiungere il file appena aperto nella tabella hash,
+// 0 altrimenti.
+static int touch_opt(char* arg, unsigned int ttl, const struct timespec time, int p, OpenedFiles* opened_files);
 
 // Funzioni per l'apertura e la chiusura dei file.
 // Viene fatta richiesta automatica di apertura di un file
@@ -67,7 +77,8 @@ static int cancel_opt(char* arg, const struct timespec time, int p, OpenedFiles*
 // - prima di una operazione di scrittura (-w, -W) con flags O_CREATE | O_LOCK se il file non è stato precedentemente aperto e non esiste sul server,
 // - prima di una operazione di lettura (-r) con flag O_DEFAULT se il file non è stato precedentemente aperto,
 // - al posto dell'operazione di lock (-l) con flag O_LOCK se il file non è stato precedentemente aperto,
-// - prima di una operazione di cancellazione (-c) con flag O_LOCK se il file non è già aperto con flag O_LOCK.
+// - prima di una operazione di cancellazione (-c) con flag O_LOCK se il file non è già aperto con flag O_LOCK,
+// - prima di una operazione di aggiornamento della scadenza (-T) con flag O_DEFAULT se il file non è stato precedentemente aperto.
 // Viene fatta richiesta automatica di chiusura di un file
 // - al termine di una operazione di scrittura se il file è stato aperto con flags O_CREATE | O_LOCK,
 // - prima di una operazione di cancellazione se il file è aperto, ma non ha il flag O_LOCK settato,
@@ -80,6 +91,18 @@ static int cancel_opt(char* arg, const struct timespec time, int p, OpenedFiles*
 static int open_file(const char* pathname, int flags, const char* dirname, int p);
 static void close_file(const char* pathname);
 
+// Ultimo nome ricevuto con l'opzione -L (cursore per la richiesta successiva)
+struct list_cursor {
+    char* pathname;
+    size_t size;
+    // Indica se non è stato possibile salvare il nome
+    int err;
+};
+
+// Stampa sullo standard output il nome e la dimensione di un file elencato dal server e
+// salva il nome nel cursore arg (struct list_cursor)
+static void print_listed_file(const char* pathname, size_t size, void* arg);
+
 int main(int argc, char* argv[]) {
     char* socket_filename = NULL;
     int p = 0;
@@ -105,7 +128,7 @@ int main(int argc, char* argv[]) {
     
     char c;
     char* arg;
-    while((c = getopt(argc, argv, ":w:W:D:r:R:d:t:l:u:c:")) != -1) {
+    while((c = getopt(argc, argv, ":w:W:D:r:R:d:t:l:u:c:L:T:e:")) != -1) {
         switch(c) {
             case 'w':
             case 'W':
@@ -114,6 +137,8 @@ int main(int argc, char* argv[]) {
             case 'l':
             case 'u':
             case 'c':
+            case 'L':
+            case 'T':
                 if(c == 'R' && optarg[0] == '-') {
                     optind--;
                     arg = NULL;
@@ -146,6 +171,15 @@ int main(int argc, char* argv[]) {
                 }
                 queue.tail->dirname = optarg;
                 break;
+            case 'e':
+                // Controlla se l'opzione -e è eseguita congiuntamente a -w, -W o -T
+                if(queue.tail == NULL || (queue.tail->opt != 'w' && queue.tail->opt != 'W' && queue.tail->opt != 'T')) {
+                    fprintf(stderr, "Errore: l'opzione -e può essere usata solo congiuntamente alle opzioni -w, -W o -T.\n");
+                    fsp_client_request_queue_freeAllRequests(&queue);
+                    return -1;
+                }
+                queue.tail->ttl = optarg;
+                break;
             case 't':
                 if(queue.tail == NULL) {
                     fprintf(stderr, "Errore: non è stata specificata la richiesta prima dell'opzione -t.\n");
@@ -245,6 +279,13 @@ int main(int argc, char* argv[]) {
         }
         abstime.tv_sec = time/1000;
         abstime.tv_nsec = (time%1000)*1000000;
+        long int ttl = 0;
+        if(req->ttl != NULL && (!isNumber(req->ttl, &ttl) || ttl < 0 || setFilesTTL(ttl) != 0)) {
+            // L'argomento dell'opzione -e non è valido
+            fprintf(stderr, "Errore richiesta -%c: l'argomento dell'opzione -e non è valido.\n", req->opt);
+            fsp_client_request_queue_freeRequest(req);
+            continue;
+        }
         
         int retVal = 0;
         switch(req->opt) {
@@ -252,6 +293,7 @@ int main(int argc, char* argv[]) {
                 if(p) {
                     printf("-w %s", req->arg);
                     if(req->dirname != NULL) printf(" -D %s", req->dirname);
+                    if(req->ttl != NULL) printf(" -e %lu", ttl);
                     printf(" -t %lu", time);
                     printf("\n");
                 }
@@ -274,6 +316,7 @@ int main(int argc, char* argv[]) {
                 if(p) {
                     printf("-W %s", req->arg);
                     if(req->dirname != NULL) printf(" -D %s", req->dirname);
+                    if(req->ttl != NULL) printf(" -e %lu", ttl);
                     printf(" -t %lu", time);
                     printf("\n");
                 }
@@ -342,12 +385,33 @@ int main(int argc, char* argv[]) {
                 retVal = cancel_opt(req->arg, abstime, p, opened_files);
                 if(retVal != 0) fprintf(stderr, "Errore richiesta -c: impossibile aggiornare la tabella hash.\n");
                 break;
+            case 'L':
+                if(p) {
+                    printf("-L %s", req->arg);
+                    printf(" -t %lu", time);
+                    printf("\n");
+                }
+                retVal = List_opt(req->arg, abstime, p);
+                if(retVal != 0) fprintf(stderr, "Errore richiesta -L: impossibile allocare memoria.\n");
+                break;
+            case 'T':
+                if(p) {
+                    printf("-T %s", req->arg);
+                    if(req->ttl != NULL) printf(" -e %lu", ttl);
+                    printf(" -t %lu", time);
+                    printf("\n");
+                }
+                retVal = touch_opt(req->arg, ttl, abstime, p, opened_files);
+                if(retVal != 0) fprintf(stderr, "Errore richiesta -T: impossibile aggiornare la tabella hash.\n");
+                break;
             default:
                 // Non viene mai eseguito
                 fprintf(stderr, "Errore: richiesta -%c non riconosciuta.\n", req->opt);
                 retVal = -1;
                 break;
         }
+        // Le scritture successive non hanno una scadenza se non specificata
+        if(req->ttl != NULL) setFilesTTL(0);
         fsp_client_request_queue_freeRequest(req);
         if(retVal != 0) {
             fsp_client_request_queue_freeRequest(req);
@@ -410,12 +474,14 @@ int main(int argc, char* argv[]) {
 static void printUsage() {
     printf("fsp -h\n");
     printf("fsp -f filename [-p] request_1 ... request_n\n");
-    printf("\trequest_m (1 <= m <= n) := write_req | read_req | lock_req | unlock_req | cancel_req\n");
-    printf("\twrite_req := -w dirname[,n_val] [-D dirname] [-t time] | -W file_1[,file_2,...] [-D dirname] [-t time]\n");
+    printf("\trequest_m (1 <= m <= n) := write_req | read_req | lock_req | unlock_req | cancel_req | list_req | touch_req\n");
+    printf("\twrite_req := -w dirname[,n_val] [-D dirname] [-e ttl] [-t time] | -W file_1[,file_2,...] [-D dirname] [-e ttl] [-t time]\n");
     printf("\tread_req := -r file_1[,file_2,...] [-d dirname] [-t time] | -R [n_val] [-d dirname] [-t time]\n");
     printf("\tlock_req := -l file_1[,file_2,...] [-t time]\n");
     printf("\tunlock_req := -u file_1[,file_2,...] [-t time]\n");
     printf("\tcancel_req := -c file_1[,file_2,...] [-t time]\n");
+    printf("\tlist_req := -L prefix[,n_val] [-t time]\n");
+    printf("\ttouch_req := -T file_1[,file_2,...] [-e ttl] [-t time]\n");
 }
 
 static int write_opt(char* arg, char* dirname, const struct timespec time, int p, OpenedFiles* opened_files) {
@@ -989,9 +1055,55 @@ static int read_opt(char* arg, char* dirname, const struct timespec time, int p,
     size_t buf_size;
     int retVal;
     
-    file = strtok(arg, ",");
+    // Nomi dei file da leggere e identificativi delle richieste inviate in pipeline
+    // (0: richiesta non inviata, -1: apertura del file non riuscita)
+    size_t files_num = 1;
+    for(char* c = arg; *c != '\0'; c++) if(*c == ',') files_num++;
+    char** names;
+    int* ids;
+    if((names = calloc(files_num, sizeof(char*))) == NULL) {
+        return -2;
+    }
+    if((ids = calloc(files_num, sizeof(int))) == NULL) {
+        free(names);
+        return -2;
+    }
+    files_num = 0;
+    for(file = strtok(arg, ","); file != NULL; file = strtok(NULL, ",")) {
+        names[files_num++] = file;
+    }
+    // Senza attesa tra le operazioni le letture vengono inviate in pipeline (protocollo versione 2)
+    int pipeline = time.tv_sec == 0 && time.tv_nsec == 0;
+    size_t sent = 0;
     
-    do {
+    for(size_t i = 0; i < files_num; i++) {
+        // Invia le richieste di lettura dei file successivi senza attenderne la risposta
+        while(pipeline && sent < files_num && sent < i + FSP_CLIENT_READ_PIPELINE_LEN) {
+            file = names[sent];
+            if(fsp_opened_files_hash_table_search(files, file) == NULL) {
+                if(open_file(file, O_DEFAULT, NULL, 1) != 0) {
+                    if(p) printf("Errore: lettura del file %s dal server non eseguita (apertura del file non riuscita).\n", file);
+                    ids[sent++] = -1;
+                    continue;
+                }
+                if(fsp_opened_files_hash_table_insert(files, file, O_DEFAULT) != 0) {
+                    close_file(file);
+                    free(names);
+                    free(ids);
+                    return -1;
+                }
+            }
+            if((ids[sent] = readFileAsync(file)) == -1) {
+                // Il server non supporta il pipelining: le letture rimanenti vengono eseguite una alla volta
+                ids[sent] = 0;
+                pipeline = 0;
+                break;
+            }
+            sent++;
+        }
+        file = names[i];
+        if(ids[i] == -1) continue;
+        
         // Controlla se il file è già stato aperto
         OpenedFile* opened_file = fsp_opened_files_hash_table_search(files, file);
         if(opened_file == NULL) {
@@ -1004,12 +1116,15 @@ static int read_opt(char* arg, char* dirname, const struct timespec time, int p,
             // Aggiunge il file nella tabella hash
             if(fsp_opened_files_hash_table_insert(files, file, O_DEFAULT) != 0) {
                 close_file(file);
+                free(names);
+                free(ids);
                 return -1;
             }
         }
         
-        // Legge il file
-        if((retVal = readFile(file, (void**) &buf, &buf_size)) != 0) {
+        // Legge il file (o attende la risposta alla richiesta inviata in pipeline)
+        retVal = ids[i] > 0 ? waitResponse(ids[i], (void**) &buf, &buf_size) : readFile(file, (void**) &buf, &buf_size);
+        if(retVal != 0) {
             switch(errno) {
                 case EINVAL:
                     // Se pathname == NULL || buf == NULL || size == NULL
@@ -1073,6 +1188,8 @@ static int read_opt(char* arg, char* dirname, const struct timespec time, int p,
             if((file_cpy = calloc(file_len+1, sizeof(char))) == NULL) {
                 // Memoria non allocata
                 free(buf);
+                free(names);
+                free(ids);
                 return -2;
             }
             memcpy(file_cpy, file, file_len);
@@ -1098,6 +1215,8 @@ static int read_opt(char* arg, char* dirname, const struct timespec time, int p,
                 // Memoria non allocata
                 free(file_cpy);
                 free(buf);
+                free(names);
+                free(ids);
                 return -2;
             }
             memcpy(filename, dirname, dirname_len);
@@ -1140,8 +1259,10 @@ static int read_opt(char* arg, char* dirname, const struct timespec time, int p,
             buf = NULL;
         }
         nanosleep(&time, NULL);
-    } while((file = strtok(NULL, ",")) != NULL);
+    }
     
+    free(names);
+    free(ids);
     return 0;
 }
 
@@ -1209,6 +1330,104 @@ static void Read_opt(char* arg, char* dirname, const struct timespec time, int p
     nanosleep(&time, NULL);
 }
 
+static int List_opt(char* arg, const struct timespec time, int p) {
+    char* prefix = arg;
+    long int n = 0;
+    
+    while(*arg != ',' && *arg != '\0') arg++;
+    if(*arg == ',') {
+        *arg = '\0';
+        arg++;
+        if(!isNumber(arg, &n) || n < 0 || n > INT_MAX) {
+            fprintf(stderr, "Errore richiesta -L: il valore n specificato non è valido.\n");
+            if(p) {
+                printf("Errore: elenco dei file con prefisso %s non eseguito (valore n non valido).\n", prefix);
+            }
+            return 0;
+        }
+    }
+    
+    // Richiede l'elenco a pagine: ogni richiesta riparte dall'ultimo nome ricevuto
+    struct list_cursor cursor = {NULL, 0, 0};
+    long int listed = 0;
+    int page_len;
+    int retVal;
+    do {
+        page_len = FSP_CLIENT_LIST_PAGE_LEN;
+        if(n > 0 && n - listed < page_len) page_len = (int) (n - listed);
+        if((retVal = listFiles(prefix, page_len, cursor.pathname, print_listed_file, &cursor)) == -1) {
+            switch(errno) {
+                case EINVAL:
+                    // Se il prefisso contiene caratteri di fine riga
+                    fprintf(stderr, "Errore listFiles: il prefisso %s non è valido.\n", prefix);
+                    break;
+                case ENOTCONN:
+                    // Se non è stata aperta la connessione con openConnection()
+                    fprintf(stderr, "Errore listFiles: la connessione non è stata precedentemente aperta con openConnection.\n");
+                    break;
+                case ENOBUFS:
+                    // Se la memoria per il buffer non è sufficiente o non è stato possibile allocare memoria
+                    fprintf(stderr, "Errore listFiles: la memoria per il buffer non è sufficiente o non è stato possibile allocare memoria.\n");
+                    break;
+                case EIO:
+                    // Se ci sono stati errori di lettura e scrittura su socket
+                    fprintf(stderr, "Errore listFiles: si è verificato un errore di lettura o scrittura su socket.\n");
+                    break;
+                case ECONNABORTED:
+                    // Se il servizio non è disponibile e la connessione è stata chiusa
+                    fprintf(stderr, "Errore listFiles: il servizio non è disponibile e la connessione è stata chiusa.\n");
+                    break;
+                case EBADMSG:
+                    // Se uno dei messaggi di richiesta o risposta fsp contiene errori sintattici
+                    fprintf(stderr, "Errore listFiles: il messaggio di richiesta o risposta fsp contiene errori sintattici.\n");
+                    break;
+                default:
+                    break;
+            }
+            break;
+        }
+        listed += retVal;
+        if(cursor.err) {
+            // Non è stato possibile salvare il cursore
+            free(cursor.pathname);
+            if(p) printf("Errore: elenco dei file con prefisso %s non completato (memoria insufficiente).\n", prefix);
+            return -1;
+        }
+    } while(retVal == page_len && (n == 0 || listed < n));
+    free(cursor.pathname);
+    
+    // Stampa l'esito sullo standard output
+    if(p) {
+        if(retVal >= 0) {
+            printf("Sono stati elencati %ld file con prefisso %s.\n", listed, prefix);
+        } else {
+            printf("Errore: elenco dei file con prefisso %s non eseguito (operazione non riuscita).\n", prefix);
+        }
+    }
+    
+    // Attende time secondi prima di eseguire la prossima operazione
+    nanosleep(&time, NULL);
+    
+    return 0;
+}
+
+static void print_listed_file(const char* pathname, size_t size, void* arg) {
+    struct list_cursor* cursor = arg;
+    printf("%s %lu\n", pathname, (unsigned long int) size);
+    
+    size_t len = strlen(pathname);
+    if(len + 1 > cursor->size) {
+        char* tmp;
+        if((tmp = realloc(cursor->pathname, len + 1)) == NULL) {
+            cursor->err = 1;
+            return;
+        }
+        cursor->pathname = tmp;
+        cursor->size = len + 1;
+    }
+    memcpy(cursor->pathname, pathname, len + 1);
+}
+
 static int lock_opt(char* arg, const struct timespec time, int p, OpenedFiles* files) {
     char* file = NULL;
     int retVal;
@@ -1453,6 +1672,92 @@ static int cancel_opt(char* arg, const struct timespec time, int p, OpenedFiles*
     return 0;
 }
 
+static int touch_opt(char* arg, unsigned int ttl, const struct timespec time, int p, OpenedFiles* files) {
+    char* file = NULL;
+    int retVal;
+    
+    file = strtok(arg, ",");
+    
+    do {
+        // Controlla se il file è già stato aperto
+        OpenedFile* opened_file = fsp_opened_files_hash_table_search(files, file);
+        if(opened_file == NULL) {
+            // Il file non è ancora stato aperto
+            // Apre il file
+            if(open_file(file, O_DEFAULT, NULL, 1) != 0) {
+                if(p) printf("Errore: scadenza del file %s non aggiornata (apertura del file non riuscita).\n", file);
+                continue;
+            }
+            // Aggiunge il file nella tabella hash
+            if(fsp_opened_files_hash_table_insert(files, file, O_DEFAULT) != 0) {
+                close_file(file);
+                return -1;
+            }
+        }
+        
+        // Aggiorna la scadenza
+        if((retVal = touchFile(file, ttl)) != 0) {
+            switch(errno) {
+                case EINVAL:
+                    // Se pathname == NULL || ttl non è valido
+                    fprintf(stderr, "Errore touchFile: uno o più argomenti passati alla funzione non sono validi.\n");
+                    break;
+                case ENOTCONN:
+                    // Se non è stata aperta la connessione con openConnection()
+                    fprintf(stderr, "Errore touchFile: la connessione non è stata precedentemente aperta con openConnection.\n");
+                    break;
+                case ENOBUFS:
+                    // Se la memoria per il buffer non è sufficiente
+                    fprintf(stderr, "Errore touchFile: la memoria per il buffer non è sufficiente.\n");
+                    break;
+                case EIO:
+                    // Se ci sono stati errori di lettura e scrittura su socket
+                    fprintf(stderr, "Errore touchFile: si è verificato un errore di lettura o scrittura su socket.\n");
+                    break;
+                case ECONNABORTED:
+                    // Se il servizio non è disponibile e la connessione è stata chiusa
+                    fprintf(stderr, "Errore touchFile: il servizio non è disponibile e la connessione è stata chiusa.\n");
+                    break;
+                case EBADMSG:
+                    // Se uno dei messaggi di richiesta o risposta fsp contiene errori sintattici
+                    fprintf(stderr, "Errore touchFile: il messaggio di richiesta o risposta fsp contiene errori sintattici.\n");
+                    break;
+                case ENOENT:
+                    // Se il file pathname non è presente sul server o è scaduto
+                    fprintf(stderr, "Errore touchFile: il file %s non è presente sul server.\n", file);
+                    break;
+                case EPERM:
+                    // Se l'operazione non è consentita
+                    fprintf(stderr, "Errore touchFile: operazione non consentita sul file %s.\n", file);
+                    break;
+                case ECANCELED:
+                    // Se il file non è stato aperto
+                    fprintf(stderr, "Errore touchFile: il file %s non è stato aperto.\n", file);
+                    break;
+                default:
+                    break;
+            }
+        }
+        
+        // Stampa l'esito sullo standard output
+        if(p) {
+            if(retVal == 0) {
+                // Operazione terminata con successo
+                if(ttl == 0) printf("La scadenza del file %s è stata rimossa con successo.\n", file);
+                else printf("La scadenza del file %s è stata fissata a %u secondi con successo.\n", file, ttl);
+            } else {
+                // Operazione non terminata con successo
+                printf("Errore: non è stato possibile aggiornare la scadenza del file %s.\n", file);
+            }
+        }
+        
+        // Attende time secondi prima di eseguire la prossima operazione
+        nanosleep(&time, NULL);
+    } while((file = strtok(NULL, ",")) != NULL);
+    
+    return 0;
+}
+
 static int open_file(const char* pathname, int flags, const char* dirname, int p) {
     if(openFile(pathname, flags, dirname) != 0) {
         switch(errno) {
@@ -8,9 +8,11 @@
 #include <fsp_api.h>
 #include <fsp_parser.h>
 #include <fsp_reader.h>
+#include <fsp_handles_hash_table.h>
 #include <utils.h>
 
 #include <stdio.h>
+#include <limits.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <sys/stat.h>
@@ -21,6 +23,12 @@
 
 // Dimensione del buffer di default (4MB)
 #define FSP_API_BUF_DEF_SIZE 4194304
+// Dimensione della tabella hash dei descrittori dei file
+#define FSP_API_HANDLES_HASH_TABLE_SIZE 4099
+// Lunghezza massima dell'argomento contenente un descrittore
+#define FSP_API_HANDLE_ARG_LEN 24
+// Lunghezza massima del TTL aggiunto all'argomento (spazio, TTL e '\0')
+#define FSP_API_TTL_ARG_LEN 12
 
 // Nome socket
 static char sname[UNIX_PATH_MAX];
@@ -29,6 +37,36 @@ static int sfd = -1;
 // Buffer
 static void* fsp_buf = NULL;
 static size_t fsp_buf_size = 0;
+// Descrittori dei file aperti (restituiti dal server)
+static struct fsp_handles_hash_table* handles = NULL;
+// TTL (in secondi) dei file creati e scritti (0 se i file non scadono)
+static unsigned int files_ttl = 0;
+// Versione del protocollo usata per le richieste (FSP_PARSER_V2 se annunciata dal server nel messaggio di benvenuto)
+static int protocol = FSP_PARSER_V1;
+// Identificativo dell'ultima richiesta inviata (versione 2, mai 0)
+static unsigned int req_id = 0;
+
+// Richiesta inviata senza attenderne la risposta (readFileAsync, lockFileAsync)
+struct fsp_api_request {
+    unsigned int id;
+    enum fsp_command cmd;
+    struct fsp_api_request* next;
+};
+
+// Risposta ricevuta prima di essere attesa (copia del messaggio)
+struct fsp_api_response {
+    struct fsp_response resp;
+    struct fsp_api_response* next;
+    // Descrizione e dati
+    char mem[];
+};
+
+// Richieste in corso inviate senza attenderne la risposta (lista)
+static struct fsp_api_request* requests = NULL;
+// Risposte ricevute prima di essere attese (lista)
+static struct fsp_api_response* responses = NULL;
+// Risposta restituita dall'ultima chiamata a receiveFspResp (liberata alla chiamata successiva)
+static struct fsp_api_response* last_response = NULL;
 
 /**
  * \brief Invia un messaggio di richiesta fsp con comando cmd, argomento pathname e campo dato di lunghezza data_len.
@@ -36,10 +74,65 @@ static size_t fsp_buf_size = 0;
 static int sendFspReq(enum fsp_command cmd, const char* pathname, size_t data_len, void* data);
 
 /**
- * \brief Riceve un messaggio di risposta fsp e lo salva in resp.
+ * \brief Riceve il messaggio di risposta fsp all'ultima richiesta inviata e lo salva in resp.
  */
 static int receiveFspResp(struct fsp_response* resp);
 
+/**
+ * \brief Riceve il messaggio di risposta fsp alla richiesta id e lo salva in resp: conserva le risposte
+ *        alle altre richieste ricevute nel frattempo (protocollo versione 2).
+ */
+static int receiveFspRespTo(unsigned int id, struct fsp_response* resp);
+
+/**
+ * \brief Conserva una copia della risposta resp (ricevuta prima di essere attesa).
+ *
+ * \return 0 in caso di successo,
+ *         -1 se non è stato possibile allocare la memoria.
+ */
+static int keepResponse(const struct fsp_response* resp);
+
+/**
+ * \brief Restituisce 1 se ci sono richieste in corso (oltre a quella attesa) la cui risposta non è ancora stata ricevuta,
+ *        0 altrimenti.
+ */
+static int hasPendingRequests(void);
+
+/**
+ * \brief Libera le richieste in corso e le risposte conservate (chiusura della connessione).
+ */
+static void freePipeline(void);
+
+/**
+ * \brief Invia una richiesta con comando cmd per il file pathname senza attenderne la risposta (readFileAsync, lockFileAsync).
+ */
+static int sendFspReqAsync(enum fsp_command cmd, const char* pathname);
+
+/**
+ * \brief Salva in *buf e *size il contenuto del file restituito da una richiesta READ con risposta resp.
+ */
+static int readData(const struct fsp_response* resp, void** buf, size_t* size);
+
+/**
+ * \brief Restituisce l'argomento da usare nei messaggi di richiesta per il file pathname:
+ *        il descrittore del file (scritto in arg di lunghezza FSP_API_HANDLE_ARG_LEN) se noto, altrimenti pathname.
+ */
+static const char* fileArg(const char* pathname, char* arg);
+
+/**
+ * \brief Restituisce l'argomento file_arg seguito dal TTL dei file (" TTL", scritto in arg di lunghezza
+ *        strlen(file_arg) + FSP_API_TTL_ARG_LEN) se impostato con setFilesTTL o se file_arg contiene spazi
+ *        (il server non scambia l'ultimo campo del nome per un TTL), altrimenti file_arg.
+ */
+static const char* ttlArg(const char* file_arg, char* arg);
+
+/**
+ * \brief Associa al file pathname il descrittore contenuto nella descrizione del messaggio
+ *        di risposta a un comando OPEN* (description). Se la descrizione non contiene
+ *        un descrittore, rimuove l'eventuale descrittore associato al file.
+ */
+static void saveHandle(const char* pathname, const char* description);
+
 /**
  * \brief Salva nella directory dirname i dati contenuti in data (campo DATA dei messaggi fsp)
  *        di lunghezza totale data_len.
@@ -103,26 +196,40 @@ int openConnection(const char* sockname, int msec, const struct timespec abstime
         }
     }
     
-    // Alloca memoria per il buffer
+    // Alloca memoria per il buffer e per la tabella dei descrittori
     fsp_buf_size = FSP_API_BUF_DEF_SIZE;
     if((fsp_buf = malloc(fsp_buf_size)) == NULL) {
         errno = ENOBUFS;
         return -1;
     }
+    if((handles = fsp_handles_hash_table_new(FSP_API_HANDLES_HASH_TABLE_SIZE)) == NULL) {
+        free(fsp_buf);
+        fsp_buf = NULL;
+        errno = ENOBUFS;
+        return -1;
+    }
     
     struct fsp_response resp;
     if(receiveFspResp(&resp) != 0 || resp.code == 421) {
         free(fsp_buf);
         fsp_buf = NULL;
+        fsp_handles_hash_table_free(handles);
+        handles = NULL;
         errno = ECONNREFUSED;
         return -1;
     }
     if(resp.code != 220) {
         free(fsp_buf);
         fsp_buf = NULL;
+        fsp_handles_hash_table_free(handles);
+        handles = NULL;
         errno = EBADMSG;
         return -1;
     }
+    
+    // Usa il protocollo binario se il server lo supporta
+    protocol = strstr(resp.description, FSP_PARSER_V2_TOKEN) != NULL ? FSP_PARSER_V2 : FSP_PARSER_V1;
+    req_id = 0;
 
     return 0;
 }
@@ -153,6 +260,9 @@ int closeConnection(const char* sockname) {
     free(fsp_buf);
     fsp_buf = NULL;
     fsp_buf_size = 0;
+    fsp_handles_hash_table_free(handles);
+    handles = NULL;
+    freePipeline();
     
     return 0;
 }
@@ -196,20 +306,28 @@ int openFile(const char* pathname, int flags, const char* dirname) {
             return -1;
     }
     
-    if(sendFspReq(cmd, pathname, 0, NULL) != 0) {
+    // Il TTL dei file viene inviato solo alla creazione
+    char arg[strlen(pathname) + FSP_API_TTL_ARG_LEN];
+    if(sendFspReq(cmd, (flags & O_CREATE) ? ttlArg(pathname, arg) : pathname, 0, NULL) != 0) {
         return -1;
     }
     
     struct fsp_response resp;
     if(receiveFspResp(&resp) != 0) {
+        // Il server potrebbe aver chiuso il file (es. lock non ottenuta)
+        fsp_handles_hash_table_delete(handles, pathname);
         if(errno == EPERM) errno = EBADMSG;
         return -1;
     }
     if(resp.code != 200) {
+        fsp_handles_hash_table_delete(handles, pathname);
         errno = EBADMSG;
         return -1;
     }
     
+    // Salva il descrittore del file
+    saveHandle(pathname, resp.description);
+    
     if(resp.data_len > 0 && dirname != NULL) {
         // Salva i dati espulsi dal server nella cartella dirname
         return saveData(dirname, resp.data_len, resp.data) >= 0 ? 0 : -1;
@@ -224,7 +342,8 @@ int readFile(const char* pathname, void** buf, size_t* size) {
         return -1;
     }
     
-    if(sendFspReq(READ, pathname, 0, NULL) != 0) {
+    char arg[FSP_API_HANDLE_ARG_LEN];
+    if(sendFspReq(READ, fileArg(pathname, arg), 0, NULL) != 0) {
         return -1;
     }
     struct fsp_response resp;
@@ -232,51 +351,8 @@ int readFile(const char* pathname, void** buf, size_t* size) {
         if(errno == ENOMEM || errno == EEXIST) errno = EBADMSG;
         return -1;
     }
-    if(resp.code != 200) {
-        errno = EBADMSG;
-        return -1;
-    }
-    
-    // Legge i dati
-    struct fsp_data* parsed_data = NULL;
-    switch (fsp_parser_parseData(resp.data_len, resp.data, &parsed_data)) {
-        case -1:
-            // data_len <= 0 || data == NULL || parsed_data == NULL
-        case -2:
-            // Il campo data del messaggio è incompleto
-        case -3:
-            // Il campo data del messaggio contiene errori sintattici
-            errno = EBADMSG;
-            return -1;
-        case -4:
-            // Impossibile allocare memoria nello heap
-            errno = ENOBUFS;
-            return -1;
-        default:
-            // Successo
-            break;
-    }
-    if(parsed_data->next != NULL) {
-        fsp_parser_freeData(parsed_data);
-        errno = EBADMSG;
-        return -1;
-    }
     
-    if(parsed_data->size > 0) {
-        if((*buf = malloc(parsed_data->size)) == NULL) {
-            fsp_parser_freeData(parsed_data);
-            errno = ENOBUFS;
-            return -1;
-        }
-        memcpy(*buf, parsed_data->data, parsed_data->size);
-    } else {
-        *buf = NULL;
-    }
-    *size = parsed_data->size;
-    
-    fsp_parser_freeData(parsed_data);
-    
-    return 0;
+    return readData(&resp, buf, size);
 }
 
 int readNFiles(int N, const char* dirname) {
@@ -321,6 +397,76 @@ int readNFiles(int N, const char* dirname) {
     return 0;
 }
 
+int listFiles(const char* prefix, int N, const char* after, void (*callback) (const char* pathname, size_t size, void* arg), void* arg) {
+    if(prefix == NULL) prefix = "";
+    if(callback == NULL || strpbrk(prefix, "\r\n") != NULL ||
+       (after != NULL && (*after == '\0' || strpbrk(after, "\r\n") != NULL))) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    // Argomento: LIMIT PREFIX_LEN PREFIX[ CURSOR] (il prefisso e il cursore possono contenere spazi)
+    size_t arg_size = strlen(prefix) + (after == NULL ? 0 : strlen(after)) + 48;
+    char* list_arg;
+    if((list_arg = malloc(arg_size)) == NULL) {
+        errno = ENOBUFS;
+        return -1;
+    }
+    if(after == NULL) {
+        snprintf(list_arg, arg_size, "%d %lu %s", N, (unsigned long int) strlen(prefix), prefix);
+    } else {
+        snprintf(list_arg, arg_size, "%d %lu %s %s", N, (unsigned long int) strlen(prefix), prefix, after);
+    }
+    
+    int err = sendFspReq(LIST, list_arg, 0, NULL);
+    free(list_arg);
+    if(err != 0) {
+        return -1;
+    }
+    struct fsp_response resp;
+    if(receiveFspResp(&resp) != 0) {
+        if(errno == ENOENT || errno == ENOMEM || errno == EPERM || errno == EEXIST || errno == ECANCELED) errno = EBADMSG;
+        return -1;
+    }
+    
+    if(resp.code != 200) {
+        errno = EBADMSG;
+        return -1;
+    }
+    if(resp.data_len == 0) {
+        return 0;
+    }
+    
+    // Legge l'elenco
+    struct fsp_data* parsed_data = NULL;
+    switch (fsp_parser_parseList(resp.data_len, resp.data, &parsed_data)) {
+        case -1:
+            // data_len <= 0 || data == NULL || parsed_data == NULL
+        case -2:
+            // Il campo data del messaggio è incompleto
+        case -3:
+            // Il campo data del messaggio contiene errori sintattici
+            errno = EBADMSG;
+            return -1;
+        case -4:
+            // Impossibile allocare memoria nello heap
+            errno = ENOBUFS;
+            return -1;
+        default:
+            // Successo
+            break;
+    }
+    
+    int listed = 0;
+    for(struct fsp_data* item = parsed_data; item != NULL; item = item->next) {
+        callback(item->pathname, item->size, arg);
+        listed++;
+    }
+    fsp_parser_freeData(parsed_data);
+    
+    return listed;
+}
+
 int writeFile(const char* pathname, const char* dirname) {
     if(pathname == NULL) {
         errno = EINVAL;
@@ -400,7 +546,10 @@ int writeFile(const char* pathname, const char* dirname) {
             break;
     }
     
-    if(sendFspReq(WRITE, pathname, bytes, data_buf) != 0) {
+    char arg[FSP_API_HANDLE_ARG_LEN];
+    const char* file_arg = fileArg(pathname, arg);
+    char ttl_arg[strlen(file_arg) + FSP_API_TTL_ARG_LEN];
+    if(sendFspReq(WRITE, ttlArg(file_arg, ttl_arg), bytes, data_buf) != 0) {
         int err = errno;
         free(buf);
         free(data_buf);
@@ -469,7 +618,8 @@ int appendToFile(const char* pathname, void* buf, size_t size, const char* dirna
             break;
     }
     
-    if(sendFspReq(APPEND, pathname, bytes, data_buf) != 0) {
+    char arg[FSP_API_HANDLE_ARG_LEN];
+    if(sendFspReq(APPEND, fileArg(pathname, arg), bytes, data_buf) != 0) {
         return -1;
     }
     free(data_buf);
@@ -498,7 +648,8 @@ int lockFile(const char* pathname) {
         return -1;
     }
     
-    if(sendFspReq(LOCK, pathname, 0, NULL) != 0) {
+    char arg[FSP_API_HANDLE_ARG_LEN];
+    if(sendFspReq(LOCK, fileArg(pathname, arg), 0, NULL) != 0) {
         return -1;
     }
     
@@ -521,7 +672,8 @@ int unlockFile(const char* pathname) {
         return -1;
     }
     
-    if(sendFspReq(UNLOCK, pathname, 0, NULL) != 0) {
+    char arg[FSP_API_HANDLE_ARG_LEN];
+    if(sendFspReq(UNLOCK, fileArg(pathname, arg), 0, NULL) != 0) {
         return -1;
     }
     
@@ -544,9 +696,12 @@ int closeFile(const char* pathname) {
         return -1;
     }
     
-    if(sendFspReq(CLOSE, pathname, 0, NULL) != 0) {
+    char arg[FSP_API_HANDLE_ARG_LEN];
+    if(sendFspReq(CLOSE, fileArg(pathname, arg), 0, NULL) != 0) {
         return -1;
     }
+    // Il descrittore non è più valido (anche se la chiusura non termina con successo)
+    fsp_handles_hash_table_delete(handles, pathname);
     
     struct fsp_response resp;
     if(receiveFspResp(&resp) != 0) {
@@ -567,7 +722,45 @@ int removeFile(const char* pathname) {
         return -1;
     }
     
-    if(sendFspReq(REMOVE, pathname, 0, NULL) != 0) {
+    char arg[FSP_API_HANDLE_ARG_LEN];
+    if(sendFspReq(REMOVE, fileArg(pathname, arg), 0, NULL) != 0) {
+        return -1;
+    }
+    
+    struct fsp_response resp;
+    if(receiveFspResp(&resp) != 0) {
+        if(errno == ENOMEM || errno == EEXIST) errno = EBADMSG;
+        return -1;
+    }
+    if(resp.code != 200) {
+        errno = EBADMSG;
+        return -1;
+    }
+    
+    return 0;
+}
+
+int setFilesTTL(unsigned int ttl) {
+    if(ttl > FSP_PARSER_TTL_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    files_ttl = ttl;
+    return 0;
+}
+
+int touchFile(const char* pathname, unsigned int ttl) {
+    if(pathname == NULL || ttl > FSP_PARSER_TTL_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    char arg[FSP_API_HANDLE_ARG_LEN];
+    const char* file_arg = fileArg(pathname, arg);
+    char touch_arg[strlen(file_arg) + FSP_API_TTL_ARG_LEN];
+    snprintf(touch_arg, sizeof(touch_arg), "%s %u", file_arg, ttl);
+    if(sendFspReq(TOUCH, touch_arg, 0, NULL) != 0) {
         return -1;
     }
     
@@ -584,10 +777,79 @@ int removeFile(const char* pathname) {
     return 0;
 }
 
+int readFileAsync(const char* pathname) {
+    return sendFspReqAsync(READ, pathname);
+}
+
+int lockFileAsync(const char* pathname) {
+    return sendFspReqAsync(LOCK, pathname);
+}
+
+int waitResponse(int id, void** buf, size_t* size) {
+    // Cerca la richiesta in corso
+    struct fsp_api_request** pending = &requests;
+    while(*pending != NULL && (*pending)->id != (unsigned int) id) pending = &((*pending)->next);
+    if(id <= 0 || *pending == NULL || ((*pending)->cmd == READ && (buf == NULL || size == NULL))) {
+        errno = EINVAL;
+        return -1;
+    }
+    struct fsp_api_request* req = *pending;
+    *pending = req->next;
+    enum fsp_command cmd = req->cmd;
+    free(req);
+    
+    struct fsp_response resp;
+    if(receiveFspRespTo((unsigned int) id, &resp) != 0) {
+        if(errno == ENOMEM || errno == EEXIST || (cmd == LOCK && errno == EPERM)) errno = EBADMSG;
+        return -1;
+    }
+    if(cmd == READ) {
+        return readData(&resp, buf, size);
+    }
+    if(resp.code != 200) {
+        errno = EBADMSG;
+        return -1;
+    }
+    
+    return 0;
+}
+
+static const char* fileArg(const char* pathname, char* arg) {
+    long int handle = fsp_handles_hash_table_search(handles, pathname);
+    if(handle < 0) return pathname;
+    
+    snprintf(arg, FSP_API_HANDLE_ARG_LEN, "%c%ld", FSP_PARSER_HANDLE_PREFIX, handle);
+    return arg;
+}
+
+static const char* ttlArg(const char* file_arg, char* arg) {
+    if(files_ttl == 0 && strchr(file_arg, ' ') == NULL) return file_arg;
+    
+    snprintf(arg, strlen(file_arg) + FSP_API_TTL_ARG_LEN, "%s %u", file_arg, files_ttl);
+    return arg;
+}
+
+static void saveHandle(const char* pathname, const char* description) {
+    long int handle;
+    const char* prefix = description == NULL ? NULL : strrchr(description, FSP_PARSER_HANDLE_PREFIX);
+    if(prefix == NULL || !isNumber(prefix+1, &handle) || handle < 0 ||
+       fsp_handles_hash_table_insert(handles, pathname, handle) != 0) {
+        // Le richieste successive useranno il nome del file
+        fsp_handles_hash_table_delete(handles, pathname);
+    }
+}
+
 static int sendFspReq(enum fsp_command cmd, const char* pathname, size_t data_len, void* data) {
     // Genera il messaggio di richiesta
     long int bytes;
-    switch(bytes = fsp_parser_makeRequest(&fsp_buf, &fsp_buf_size, cmd, pathname, data_len, data)) {
+    if(protocol == FSP_PARSER_V2) {
+        // Gli identificativi restituiti da readFileAsync e lockFileAsync sono int positivi
+        if(++req_id == 0 || req_id > INT_MAX) req_id = 1;
+        bytes = fsp_parser_makeBinaryRequest(&fsp_buf, &fsp_buf_size, cmd, req_id, pathname, data_len, data);
+    } else {
+        bytes = fsp_parser_makeRequest(&fsp_buf, &fsp_buf_size, cmd, pathname, data_len, data);
+    }
+    switch(bytes) {
         case -1:
             // fsp_buf == NULL || *fsp_buf_size > FSP_PARSER_BUF_MAX_SIZE
             // Se fsp_buf == NULL, allora openConnection non è stata invocata
@@ -619,39 +881,112 @@ static int sendFspReq(enum fsp_command cmd, const char* pathname, size_t data_le
     return 0;
 }
 
+static int sendFspReqAsync(enum fsp_command cmd, const char* pathname) {
+    if(pathname == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    if(fsp_buf == NULL) {
+        errno = ENOTCONN;
+        return -1;
+    }
+    // Con il protocollo testuale le risposte non contengono l'identificativo della richiesta
+    if(protocol != FSP_PARSER_V2) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    
+    struct fsp_api_request* req;
+    if((req = malloc(sizeof(struct fsp_api_request))) == NULL) {
+        errno = ENOBUFS;
+        return -1;
+    }
+    char arg[FSP_API_HANDLE_ARG_LEN];
+    if(sendFspReq(cmd, fileArg(pathname, arg), 0, NULL) != 0) {
+        free(req);
+        return -1;
+    }
+    req->id = req_id;
+    req->cmd = cmd;
+    req->next = requests;
+    requests = req;
+    
+    return (int) req_id;
+}
+
 static int receiveFspResp(struct fsp_response* resp) {
+    return receiveFspRespTo(req_id, resp);
+}
+
+static int receiveFspRespTo(unsigned int id, struct fsp_response* resp) {
     struct fsp_response _resp;
     
-    switch (fsp_reader_readResponse(sfd, &fsp_buf, &fsp_buf_size, &_resp)) {
-        case -1:
-            // fsp_buf == NULL || *size > FSP_READER_BUF_MAX_SIZE
-            errno = fsp_buf == NULL ? ENOTCONN : ENOBUFS;
-            return -1;
-        case -2:
-            // Errori durante la lettura
-            errno = EIO;
-            return -1;
-        case -3:
-            // sfd ha raggiunto EOF senza aver letto un messaggio di risposta
-            close(sfd);
-            sfd = -1;
-            sname[0] = '\0';
-            free(fsp_buf);
-            fsp_buf = NULL;
-            fsp_buf_size = 0;
-            errno = ECONNABORTED;
-            return -1;
-        case -4:
-            // Il messaggio di risposta contiene errori sintattici
+    // La risposta restituita dalla chiamata precedente non è più usata
+    if(last_response != NULL) {
+        free(last_response);
+        last_response = NULL;
+    }
+    
+    // Cerca la risposta tra quelle ricevute prima di essere attese
+    struct fsp_api_response** kept = &responses;
+    while(*kept != NULL && (*kept)->resp.id != id) kept = &((*kept)->next);
+    if(*kept != NULL) {
+        last_response = *kept;
+        *kept = last_response->next;
+        _resp = last_response->resp;
+    }
+    
+    while(last_response == NULL) {
+        switch (fsp_reader_readResponse(sfd, &fsp_buf, &fsp_buf_size, &_resp)) {
+            case -1:
+                // fsp_buf == NULL || *size > FSP_READER_BUF_MAX_SIZE
+                errno = fsp_buf == NULL ? ENOTCONN : ENOBUFS;
+                return -1;
+            case -2:
+                // Errori durante la lettura
+                errno = EIO;
+                return -1;
+            case -3:
+                // sfd ha raggiunto EOF senza aver letto un messaggio di risposta
+                close(sfd);
+                sfd = -1;
+                sname[0] = '\0';
+                free(fsp_buf);
+                fsp_buf = NULL;
+                fsp_buf_size = 0;
+                fsp_handles_hash_table_free(handles);
+                handles = NULL;
+                freePipeline();
+                errno = ECONNABORTED;
+                return -1;
+            case -4:
+                // Il messaggio di risposta contiene errori sintattici
+                errno = EBADMSG;
+                return -1;
+            case -5:
+                // Impossibile riallocare il buffer (memoria insufficiente)
+                errno = ENOBUFS;
+                return -1;
+            default:
+                // Successo
+                break;
+        }
+        
+        // Conserva la risposta a un'altra richiesta in corso
+        if(_resp.version == FSP_PARSER_V2 && _resp.id != 0 && _resp.id != id) {
+            if(keepResponse(&_resp) != 0) {
+                errno = ENOBUFS;
+                return -1;
+            }
+            continue;
+        }
+        // Una risposta senza identificativo (0) è attribuita alla richiesta id solo se è l'unica in corso
+        // (la chiusura della connessione riguarda tutte le richieste)
+        if(_resp.version == FSP_PARSER_V2 && _resp.id == 0 && _resp.code != 421 && hasPendingRequests()) {
             errno = EBADMSG;
             return -1;
-        case -5:
-            // Impossibile riallocare il buffer (memoria insufficiente)
-            errno = ENOBUFS;
-            return -1;
-        default:
-            // Successo
-            break;
+        }
+        break;
     }
     
     switch (_resp.code) {
@@ -668,6 +1003,9 @@ static int receiveFspResp(struct fsp_response* resp) {
             free(fsp_buf);
             fsp_buf = NULL;
             fsp_buf_size = 0;
+            fsp_handles_hash_table_free(handles);
+            handles = NULL;
+            freePipeline();
             errno = ECONNABORTED;
             return -1;
         case 501:
@@ -706,6 +1044,104 @@ static int receiveFspResp(struct fsp_response* resp) {
     return 0;
 }
 
+static int keepResponse(const struct fsp_response* resp) {
+    size_t description_len = resp->description != NULL ? strlen(resp->description) + 1 : 0;
+    struct fsp_api_response* kept;
+    if((kept = malloc(sizeof(struct fsp_api_response) + description_len + resp->data_len)) == NULL) {
+        return -1;
+    }
+    
+    // Copia la descrizione e i dati (il buffer di lettura viene riusato dalla prossima risposta)
+    kept->resp = *resp;
+    kept->resp.description = NULL;
+    kept->resp.data = NULL;
+    if(resp->description != NULL) {
+        kept->resp.description = kept->mem;
+        memcpy(kept->mem, resp->description, description_len);
+    }
+    if(resp->data_len > 0 && resp->data != NULL) {
+        kept->resp.data = kept->mem + description_len;
+        memcpy(kept->mem + description_len, resp->data, resp->data_len);
+    }
+    kept->next = responses;
+    responses = kept;
+    
+    return 0;
+}
+
+static int hasPendingRequests(void) {
+    for(struct fsp_api_request* req = requests; req != NULL; req = req->next) {
+        struct fsp_api_response* kept = responses;
+        while(kept != NULL && kept->resp.id != req->id) kept = kept->next;
+        if(kept == NULL) return 1;
+    }
+    
+    return 0;
+}
+
+static void freePipeline(void) {
+    while(requests != NULL) {
+        struct fsp_api_request* next = requests->next;
+        free(requests);
+        requests = next;
+    }
+    while(responses != NULL) {
+        struct fsp_api_response* next = responses->next;
+        free(responses);
+        responses = next;
+    }
+    free(last_response);
+    last_response = NULL;
+}
+
+static int readData(const struct fsp_response* resp, void** buf, size_t* size) {
+    if(resp->code != 200) {
+        errno = EBADMSG;
+        return -1;
+    }
+    
+    // Legge i dati
+    struct fsp_data* parsed_data = NULL;
+    switch (fsp_parser_parseData(resp->data_len, resp->data, &parsed_data)) {
+        case -1:
+            // data_len <= 0 || data == NULL || parsed_data == NULL
+        case -2:
+            // Il campo data del messaggio è incompleto
+        case -3:
+            // Il campo data del messaggio contiene errori sintattici
+            errno = EBADMSG;
+            return -1;
+        case -4:
+            // Impossibile allocare memoria nello heap
+            errno = ENOBUFS;
+            return -1;
+        default:
+            // Successo
+            break;
+    }
+    if(parsed_data->next != NULL) {
+        fsp_parser_freeData(parsed_data);
+        errno = EBADMSG;
+        return -1;
+    }
+    
+    if(parsed_data->size > 0) {
+        if((*buf = malloc(parsed_data->size)) == NULL) {
+            fsp_parser_freeData(parsed_data);
+            errno = ENOBUFS;
+            return -1;
+        }
+        memcpy(*buf, parsed_data->data, parsed_data->size);
+    } else {
+        *buf = NULL;
+    }
+    *size = parsed_data->size;
+    
+    fsp_parser_freeData(parsed_data);
+    
+    return 0;
+}
+
 static int saveData(const char* dirname, size_t data_len, void* data) {
     // Legge i dati
     struct fsp_data* parsed_data = NULL;
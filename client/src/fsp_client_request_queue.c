@@ -45,6 +45,7 @@ struct fsp_client_request* fsp_client_request_queue_newRequest(char opt, char* a
         req->arg = arg;
         req->time = NULL;
         req->dirname = NULL;
+        req->ttl = NULL;
         req->prev = NULL;
         req->next = NULL;
     }
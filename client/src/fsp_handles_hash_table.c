@@ -0,0 +1,124 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <fsp_handles_hash_table.h>
+
+/**
+ * \brief Funzione hash (FNV-1a) che, data una chiave key, restituisce l'indice all'interno
+ *        della tabella di dimensione size.
+ *
+ * \return L'indice all'interno della tabella.
+ */
+static inline unsigned long int hash_function(size_t size, const char* key);
+
+static inline unsigned long int hash_function(size_t size, const char* key) {
+    unsigned int hash = 2166136261u;
+    while(*key != '\0') {
+        hash ^= (unsigned char) *key;
+        hash *= 16777619u;
+        key++;
+    }
+    return hash%size;
+}
+
+struct fsp_handles_hash_table* fsp_handles_hash_table_new(size_t size) {
+    if(size == 0) return NULL;
+    
+    struct fsp_handles_hash_table* hash_table = NULL;
+    if((hash_table = malloc(sizeof(struct fsp_handles_hash_table))) == NULL) return NULL;
+    if((hash_table->table = calloc(size, sizeof(struct fsp_handle*))) == NULL) {
+        free(hash_table);
+        return NULL;
+    }
+    
+    hash_table->size = size;
+    hash_table->handles_num = 0;
+    
+    return hash_table;
+}
+
+void fsp_handles_hash_table_free(struct fsp_handles_hash_table* hash_table) {
+    if(hash_table == NULL) return;
+    fsp_handles_hash_table_deleteAll(hash_table);
+    free(hash_table->table);
+    free(hash_table);
+}
+
+int fsp_handles_hash_table_insert(struct fsp_handles_hash_table* hash_table, const char* pathname, long int handle) {
+    if(hash_table == NULL || pathname == NULL) return -1;
+    unsigned long int index = hash_function(hash_table->size, pathname);
+    
+    struct fsp_handle* _handle = (hash_table->table)[index];
+    while(_handle != NULL) {
+        if(strcmp(_handle->pathname, pathname) == 0) {
+            _handle->handle = handle;
+            return 0;
+        }
+        _handle = _handle->next;
+    }
+    
+    size_t pathname_len = strlen(pathname);
+    if((_handle = malloc(sizeof(struct fsp_handle) + pathname_len + 1)) == NULL) return -2;
+    memcpy(_handle->pathname, pathname, pathname_len + 1);
+    _handle->handle = handle;
+    _handle->next = (hash_table->table)[index];
+    (hash_table->table)[index] = _handle;
+    (hash_table->handles_num)++;
+    
+    return 0;
+}
+
+long int fsp_handles_hash_table_search(const struct fsp_handles_hash_table* hash_table, const char* pathname) {
+    if(hash_table == NULL || pathname == NULL || hash_table->handles_num == 0) return -1;
+    
+    struct fsp_handle* _handle = (hash_table->table)[hash_function(hash_table->size, pathname)];
+    while(_handle != NULL) {
+        if(strcmp(_handle->pathname, pathname) == 0) return _handle->handle;
+        _handle = _handle->next;
+    }
+    
+    return -1;
+}
+
+void fsp_handles_hash_table_delete(struct fsp_handles_hash_table* hash_table, const char* pathname) {
+    if(hash_table == NULL || pathname == NULL || hash_table->handles_num == 0) return;
+    unsigned long int index = hash_function(hash_table->size, pathname);
+    
+    struct fsp_handle* _handle = (hash_table->table)[index];
+    struct fsp_handle* _handle_prev = NULL;
+    while(_handle != NULL && strcmp(_handle->pathname, pathname) != 0) {
+        _handle_prev = _handle;
+        _handle = _handle->next;
+    }
+    if(_handle == NULL) return;
+    
+    if(_handle_prev == NULL) {
+        (hash_table->table)[index] = _handle->next;
+    } else {
+        _handle_prev->next = _handle->next;
+    }
+    free(_handle);
+    (hash_table->handles_num)--;
+}
+
+void fsp_handles_hash_table_deleteAll(struct fsp_handles_hash_table* hash_table) {
+    if(hash_table == NULL) return;
+    
+    struct fsp_handle* _handle;
+    struct fsp_handle* _handle_prev;
+    for(size_t i = 0; i < hash_table->size && hash_table->handles_num > 0; i++) {
+        _handle = (hash_table->table)[i];
+        while(_handle != NULL) {
+            _handle_prev = _handle;
+            _handle = _handle->next;
+            free(_handle_prev);
+            (hash_table->handles_num)--;
+        }
+        (hash_table->table)[i] = NULL;
+    }
+}
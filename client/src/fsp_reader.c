@@ -10,11 +10,17 @@
 #include <sys/uio.h>
 #include <unistd.h>
 
-int fsp_reader_readRequest(int sfd, void** buf, size_t* size, struct fsp_request* req) {
-    if(buf == NULL || *buf == NULL || size == NULL || req == NULL || *size > FSP_READER_BUF_MAX_SIZE) {
+/**
+ * \brief Implementa fsp_reader_readRequest (request != 0, msg di tipo struct fsp_request*)
+ *        e fsp_reader_readResponse (request == 0, msg di tipo struct fsp_response*).
+ */
+static int readMessage(int sfd, void** buf, size_t* size, int request, void* msg);
+
+static int readMessage(int sfd, void** buf, size_t* size, int request, void* msg) {
+    if(buf == NULL || *buf == NULL || size == NULL || msg == NULL || *size > FSP_READER_BUF_MAX_SIZE) {
         return -1;
     }
-    
+
     // Buffer
     char* _buf = (char*) *buf;
     // Numero totale dei byte letti
@@ -23,74 +29,57 @@ int fsp_reader_readRequest(int sfd, void** buf, size_t* size, struct fsp_request
     ssize_t ret_val;
     // Spazio disponibile del buffer
     size_t len = *size;
-    
-    while((ret_val = read(sfd, _buf+bytes, len)) > 0) {
+    // Numero dei byte da leggere con la prossima read: la prima legge al più l'intestazione di un messaggio binario,
+    // di un messaggio binario vengono letti esattamente i byte del messaggio (i byte di un messaggio successivo,
+    // inviato in pipeline, restano in sfd)
+    size_t r_len = len < FSP_PARSER_V2_HEADER_LEN ? len : FSP_PARSER_V2_HEADER_LEN;
+
+    while((ret_val = read(sfd, _buf+bytes, r_len)) > 0) {
         bytes += ret_val;
         len -= ret_val;
-        
-        // Controlla se il messaggio termina con "\r\n"
-        if(bytes >= 2 && _buf[bytes-2] == '\r' && _buf[bytes-1] == '\n') {
-            // Controlla se il messaggio contiene la prima riga che termina con "\r\n"
-            int r_pos = 0;
-            while(_buf[r_pos] != '\r' && _buf[r_pos+1] != '\n') r_pos++;
-            if(r_pos != bytes-2) {
-                // parsa la stringa
-                switch (fsp_parser_parseRequest(_buf, bytes, req)) {
+        r_len = len;
+
+        if((unsigned char) _buf[0] == FSP_PARSER_V2_MAGIC) {
+            // Messaggio binario: la lunghezza totale è nota dopo aver letto l'intestazione
+            // (l'identificativo viene salvato anche se l'intestazione o il messaggio non sono validi)
+            if(request) {
+                ((struct fsp_request*) msg)->version = FSP_PARSER_V2;
+                ((struct fsp_request*) msg)->id = fsp_parser_binaryId(_buf, bytes);
+            } else {
+                ((struct fsp_response*) msg)->version = FSP_PARSER_V2;
+                ((struct fsp_response*) msg)->id = fsp_parser_binaryId(_buf, bytes);
+            }
+            long int msg_len = fsp_parser_binaryLength(_buf, bytes);
+            if(msg_len == -3) {
+                // Intestazione non valida
+                return -4;
+            } else if(msg_len > 0 && bytes >= msg_len) {
+                // parsa il messaggio (senza modificare il buffer)
+                switch (request ? fsp_parser_parseBinaryRequest(_buf, bytes, msg) : fsp_parser_parseBinaryResponse(_buf, bytes, msg)) {
                     case -1:
-                        // _buf == NULL || resp == NULL
                         return -1;
-                    case -2:
-                        // Messaggio incompleto
-                        break;
-                    case -3:
+                    case 0:
+                        return 0;
+                    default:
                         // Il messaggio contiene errori sintattici
                         return -4;
-                    default:
-                        // Successo
-                        return 0;
                 }
+            } else if(msg_len > 0 && msg_len > *size) {
+                // Rialloca il buffer per contenere l'intero messaggio
+                char* buf_tmp;
+                if((buf_tmp = realloc(_buf, msg_len)) == NULL) {
+                    return -5;
+                } else {
+                    _buf = buf_tmp;
+                    *buf = buf_tmp;
+                }
+                len += msg_len - *size;
+                (*size) = msg_len;
             }
+            r_len = (msg_len > 0 ? msg_len : FSP_PARSER_V2_HEADER_LEN) - bytes;
+            continue;
         }
-        // rialloca la memoria se insufficiente
-        if(len == 0) {
-            if(*size == FSP_READER_BUF_MAX_SIZE) {
-                return -5;
-            }
-            size_t _size = (*size)*2 < FSP_READER_BUF_MAX_SIZE ? (*size)*2 : FSP_READER_BUF_MAX_SIZE;
-            char* buf_tmp;
-            if((buf_tmp = realloc(_buf, _size)) == NULL) {
-                return -5;
-            } else {
-                _buf = buf_tmp;
-                *buf = buf_tmp;
-            }
-            len = _size != FSP_READER_BUF_MAX_SIZE ? (*size) : FSP_READER_BUF_MAX_SIZE - (*size);
-            (*size) = _size;
-        }
-    }
-    // Se ret_val == 0, allora sfd ha raggiunto EOF,
-    // altrimenti c'è stato un errore di lettura (ret_val == -1)
-    return ret_val == 0 ? -3 : -2;
-}
 
-int fsp_reader_readResponse(int sfd, void** buf, size_t* size, struct fsp_response* resp) {
-    if(buf == NULL || *buf == NULL || size == NULL || resp == NULL || *size > FSP_READER_BUF_MAX_SIZE) {
-        return -1;
-    }
-    
-    // Buffer
-    char* _buf = (char*) *buf;
-    // Numero totale dei byte letti
-    ssize_t bytes = 0;
-    // Valore di ritorno della funzione read
-    ssize_t ret_val;
-    // Spazio disponibile del buffer
-    size_t len = *size;
-    
-    while((ret_val = read(sfd, _buf+bytes, len)) > 0) {
-        bytes += ret_val;
-        len -= ret_val;
-        
         // Controlla se il messaggio termina con "\r\n"
         if(bytes >= 2 && _buf[bytes-2] == '\r' && _buf[bytes-1] == '\n') {
             // Controlla se il messaggio contiene la prima riga che termina con "\r\n"
@@ -98,9 +87,9 @@ int fsp_reader_readResponse(int sfd, void** buf, size_t* size, struct fsp_respon
             while(_buf[r_pos] != '\r' && _buf[r_pos+1] != '\n') r_pos++;
             if(r_pos != bytes-2) {
                 // parsa la stringa
-                switch (fsp_parser_parseResponse(_buf, bytes, resp)) {
+                switch (request ? fsp_parser_parseRequest(_buf, bytes, msg) : fsp_parser_parseResponse(_buf, bytes, msg)) {
                     case -1:
-                        // _buf == NULL || resp == NULL
+                        // _buf == NULL || msg == NULL
                         return -1;
                     case -2:
                         // Messaggio incompleto
@@ -120,7 +109,6 @@ int fsp_reader_readResponse(int sfd, void** buf, size_t* size, struct fsp_respon
                 return -5;
             }
             size_t _size = (*size)*2 < FSP_READER_BUF_MAX_SIZE ? (*size)*2 : FSP_READER_BUF_MAX_SIZE;
-            
             char* buf_tmp;
             if((buf_tmp = realloc(_buf, _size)) == NULL) {
                 return -5;
@@ -130,9 +118,18 @@ int fsp_reader_readResponse(int sfd, void** buf, size_t* size, struct fsp_respon
             }
             len = _size != FSP_READER_BUF_MAX_SIZE ? (*size) : FSP_READER_BUF_MAX_SIZE - (*size);
             (*size) = _size;
+            r_len = len;
         }
     }
     // Se ret_val == 0, allora sfd ha raggiunto EOF,
     // altrimenti c'è stato un errore di lettura (ret_val == -1)
     return ret_val == 0 ? -3 : -2;
 }
+
+int fsp_reader_readRequest(int sfd, void** buf, size_t* size, struct fsp_request* req) {
+    return readMessage(sfd, buf, size, 1, req);
+}
+
+int fsp_reader_readResponse(int sfd, void** buf, size_t* size, struct fsp_response* resp) {
+    return readMessage(sfd, buf, size, 0, resp);
+}
@@ -0,0 +1,472 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+// Benchmark delle strutture dati del server.
+// Confronta il costo per operazione delle allocazioni con malloc()/free()
+// e di quelle effettuate mediante i pool (fsp_pool) e il costo dei file con il contenuto
+// allocato separatamente o incorporato nel file (fsp_file_embed).
+// Confronta inoltre la hit ratio delle politiche di rimpiazzamento (fsp_eviction) su una sequenza
+// di accessi con distribuzione di Zipf interrotta periodicamente da scansioni sequenziali di altri file.
+// Uso: ./fsp_bench [numero di operazioni]
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#include <fsp_pool.h>
+#include <fsp_blob.h>
+#include <fsp_file.h>
+#include <fsp_files_hash_table.h>
+#include <fsp_files_set.h>
+#include <fsp_eviction.h>
+#include <fsp_parser.h>
+#include <fsp_lz.h>
+
+// Numero di operazioni di default
+#define BENCH_DEF_OPS 1000000
+// Numero di oggetti mantenuti contemporaneamente in memoria
+#define BENCH_LIVE_OBJS 4096
+// Numero di file inseriti nella tabella hash
+#define BENCH_HASH_TABLE_FILES 1000000
+// Dimensione della tabella hash (come nel server)
+#define BENCH_HASH_TABLE_SIZE 49157
+// Numero di elementi nel campo data usato per il benchmark del parser
+#define BENCH_DATA_ITEMS 64
+// Dimensione del testo usato per il benchmark della compressione
+#define BENCH_LZ_TEXT_SIZE 65536
+// Numero e dimensione dei file piccoli (contenuto separato o incorporato)
+#define BENCH_SMALL_FILES 1000000
+#define BENCH_SMALL_FILE_SIZE 100
+// Numero dei file, capacità della cache (in file di dimensione media) e parametro della distribuzione di Zipf
+// usati per il confronto delle politiche di rimpiazzamento
+#define BENCH_EVICTION_FILES 100000
+#define BENCH_EVICTION_CACHE_SIZE 10000
+// La dimensione dei file è una potenza di 2 tra BENCH_EVICTION_MIN_SIZE e BENCH_EVICTION_MIN_SIZE*2^(BENCH_EVICTION_SIZES-1)
+// (scelta in modo indipendente dalla popolarità del file)
+#define BENCH_EVICTION_MIN_SIZE 1024
+#define BENCH_EVICTION_SIZES 8
+#define BENCH_EVICTION_ZIPF 0.9
+// Ogni BENCH_EVICTION_SCAN_PERIOD accessi vengono letti in sequenza BENCH_EVICTION_SCAN_LEN file
+// che non fanno parte della distribuzione di Zipf
+#define BENCH_EVICTION_SCAN_PERIOD 100000
+#define BENCH_EVICTION_SCAN_LEN 20000
+
+/**
+ * \brief Restituisce il tempo corrente in nanosecondi.
+ */
+static double now(void);
+
+/**
+ * \brief Stampa il risultato di un benchmark.
+ */
+static void report(const char* name, double start, double end, unsigned long int ops);
+
+/**
+ * \brief Restituisce la memoria residente del processo in byte (0 se non è possibile leggerla).
+ */
+static size_t residentSize(void);
+
+static void bench_alloc(unsigned long int ops);
+static void bench_file(unsigned long int ops);
+static void bench_small_files(unsigned long int ops);
+static void bench_files_set(unsigned long int ops);
+static void bench_hash_table(unsigned long int ops);
+static void bench_parser(unsigned long int ops);
+static void bench_lz(unsigned long int ops);
+static void bench_eviction(unsigned long int ops);
+
+int main(int argc, char* argv[]) {
+    unsigned long int ops = BENCH_DEF_OPS;
+    if(argc > 1) ops = strtoul(argv[1], NULL, 10);
+    if(ops == 0) ops = BENCH_DEF_OPS;
+
+    printf("%-40s %12s %10s\n", "benchmark", "operazioni", "ns/op");
+    bench_alloc(ops);
+    bench_file(ops);
+    bench_small_files(ops);
+    bench_files_set(ops);
+    bench_hash_table(ops);
+    bench_parser(ops/BENCH_DATA_ITEMS);
+    bench_lz(ops/4096);
+    bench_eviction(ops);
+
+    return 0;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+static void report(const char* name, double start, double end, unsigned long int ops) {
+    printf("%-40s %12lu %10.1f\n", name, ops, (end - start)/ops);
+}
+
+static size_t residentSize(void) {
+    unsigned long int size, resident;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if(statm == NULL) return 0;
+    if(fscanf(statm, "%lu %lu", &size, &resident) != 2) resident = 0;
+    fclose(statm);
+    return resident*4096;
+}
+
+static void bench_alloc(unsigned long int ops) {
+    void* objs[BENCH_LIVE_OBJS] = {NULL};
+    double start, end;
+
+    start = now();
+    for(unsigned long int i = 0; i < ops; i++) {
+        unsigned int j = (i*7919)%BENCH_LIVE_OBJS;
+        free(objs[j]);
+        objs[j] = malloc(sizeof(struct fsp_file));
+    }
+    end = now();
+    for(int j = 0; j < BENCH_LIVE_OBJS; j++) free(objs[j]);
+    report("malloc/free (struct fsp_file)", start, end, ops);
+
+    struct fsp_pool* pool = fsp_pool_new(sizeof(struct fsp_file), 1024);
+    memset(objs, 0, sizeof(objs));
+    start = now();
+    for(unsigned long int i = 0; i < ops; i++) {
+        unsigned int j = (i*7919)%BENCH_LIVE_OBJS;
+        fsp_pool_release(pool, objs[j]);
+        objs[j] = fsp_pool_alloc(pool, sizeof(struct fsp_file));
+    }
+    end = now();
+    fsp_pool_free(pool);
+    report("fsp_pool (struct fsp_file)", start, end, ops);
+}
+
+static void bench_file(unsigned long int ops) {
+    struct fsp_file* files[BENCH_LIVE_OBJS] = {NULL};
+    char pathname[64];
+    double start, end;
+
+    for(int with_pool = 0; with_pool <= 1; with_pool++) {
+        struct fsp_pools* pools = with_pool ? fsp_pools_new(1024) : NULL;
+        memset(files, 0, sizeof(files));
+        start = now();
+        for(unsigned long int i = 0; i < ops; i++) {
+            unsigned int j = (i*7919)%BENCH_LIVE_OBJS;
+            snprintf(pathname, sizeof(pathname), "/bench/dir_%02u/file_%08lu.txt", j%16, i);
+            fsp_file_free(pools, files[j]);
+            files[j] = fsp_file_new(pools, pathname, NULL, 0, 1, -1, 0);
+        }
+        end = now();
+        for(int j = 0; j < BENCH_LIVE_OBJS; j++) fsp_file_free(pools, files[j]);
+        fsp_pools_free(pools);
+        report(with_pool ? "fsp_file_new/free (pool)" : "fsp_file_new/free (malloc)", start, end, ops);
+    }
+}
+
+static void bench_small_files(unsigned long int ops) {
+    // BENCH_SMALL_FILES file da BENCH_SMALL_FILE_SIZE byte creati come nel server (il contenuto viene preparato
+    // prima di essere associato al file) e letti in ordine casuale
+    struct fsp_file** files = malloc(sizeof(struct fsp_file*)*BENCH_SMALL_FILES);
+    unsigned char payload[BENCH_SMALL_FILE_SIZE];
+    unsigned char buf[BENCH_SMALL_FILE_SIZE];
+    char pathname[64];
+    char name[64];
+    double start, end;
+    if(files == NULL) return;
+    memset(payload, 'x', sizeof(payload));
+    
+    // Il contenuto incorporato viene misurato per primo: la memoria dei pool viene restituita al sistema
+    // da fsp_pools_free, quella dei contenuti separati potrebbe non esserlo
+    for(int embed = 1; embed >= 0; embed--) {
+        const char* kind = embed ? "incorporato" : "separato";
+        struct fsp_pools* pools = fsp_pools_new(1024);
+        size_t resident = residentSize();
+        start = now();
+        for(unsigned long int i = 0; i < BENCH_SMALL_FILES; i++) {
+            snprintf(pathname, sizeof(pathname), "/bench/dir_%02lu/file_%08lu.txt", i%16, i);
+            struct fsp_file* file = fsp_file_new(pools, pathname, NULL, 0, 0, -1, 0);
+            struct fsp_blob* data = fsp_blob_new(NULL, payload, sizeof(payload), 0);
+            if(embed) {
+                files[i] = fsp_file_embed(pools, file, data);
+                fsp_file_free(pools, file);
+                fsp_blob_free(data);
+            } else {
+                file->data = data;
+                file->size = data->size;
+                files[i] = file;
+            }
+        }
+        end = now();
+        snprintf(name, sizeof(name), "file da 100 B, creazione (%s)", kind);
+        report(name, start, end, BENCH_SMALL_FILES);
+        printf("memoria per file (%s): %lu byte\n", kind, (unsigned long int) ((residentSize() - resident)/BENCH_SMALL_FILES));
+        
+        unsigned long int errors = 0;
+        start = now();
+        for(unsigned long int i = 0; i < ops; i++) {
+            struct fsp_file* file = files[(i*7919)%BENCH_SMALL_FILES];
+            if(fsp_blob_read(file->data, buf) != 0 || buf[0] != 'x') errors++;
+        }
+        end = now();
+        snprintf(name, sizeof(name), "file da 100 B, lettura (%s)", kind);
+        report(name, start, end, ops);
+        if(errors > 0) fprintf(stderr, "Errore: %lu letture errate.\n", errors);
+        
+        for(unsigned long int i = 0; i < BENCH_SMALL_FILES; i++) fsp_file_free(pools, files[i]);
+        fsp_pools_free(pools);
+    }
+    
+    free(files);
+}
+
+static void bench_files_set(unsigned long int ops) {
+    // Simula un client che apre e chiude continuamente file mentre ne mantiene aperti molti altri
+    const int opened[] = {16, 4096};
+    struct fsp_file* files[BENCH_LIVE_OBJS];
+    char pathname[64];
+    char name[64];
+    double start, end;
+    
+    for(int i = 0; i < BENCH_LIVE_OBJS; i++) {
+        snprintf(pathname, sizeof(pathname), "/bench/file_%04d.txt", i);
+        files[i] = fsp_file_new(NULL, pathname, NULL, 0, 1, -1, 0);
+    }
+    
+    for(int k = 0; k < sizeof(opened)/sizeof(opened[0]); k++) {
+        struct fsp_files_set* set = fsp_files_set_new();
+        for(int i = 1; i < opened[k]; i++) fsp_files_set_add(set, files[i]);
+        start = now();
+        for(unsigned long int i = 0; i < ops; i++) {
+            struct fsp_file* file = files[i%opened[k]];
+            if(fsp_files_set_contains(set, file)) {
+                fsp_files_set_remove(set, file);
+            } else {
+                fsp_files_set_add(set, file);
+            }
+        }
+        end = now();
+        fsp_files_set_free(set);
+        snprintf(name, sizeof(name), "fsp_files_set contains+add/remove (%d)", opened[k]);
+        report(name, start, end, ops);
+    }
+    
+    for(int i = 0; i < BENCH_LIVE_OBJS; i++) fsp_file_free(NULL, files[i]);
+}
+
+static void bench_hash_table(unsigned long int ops) {
+    // Ricerca casuale tra BENCH_HASH_TABLE_FILES file (dimensione della tabella come nel server)
+    struct fsp_pools* pools = fsp_pools_new(1024);
+    struct fsp_files_hash_table* files = fsp_files_hash_table_new(BENCH_HASH_TABLE_SIZE);
+    char pathname[64];
+    double start, end;
+    
+    for(unsigned long int i = 0; i < BENCH_HASH_TABLE_FILES; i++) {
+        snprintf(pathname, sizeof(pathname), "/bench/dir_%02lu/file_%08lu.txt", i%16, i);
+        fsp_files_hash_table_insert(files, fsp_file_new(pools, pathname, NULL, 0, 0, -1, 0));
+    }
+    
+    unsigned long int found = 0;
+    start = now();
+    for(unsigned long int i = 0; i < ops; i++) {
+        unsigned long int j = (i*7919)%BENCH_HASH_TABLE_FILES;
+        snprintf(pathname, sizeof(pathname), "/bench/dir_%02lu/file_%08lu.txt", j%16, j);
+        if(fsp_files_hash_table_search(files, pathname) != NULL) found++;
+    }
+    end = now();
+    report("fsp_files_hash_table_search (1M file)", start, end, ops);
+    if(found != ops) fprintf(stderr, "Errore: %lu file non trovati.\n", ops - found);
+    
+    fsp_files_hash_table_deleteAll(files, NULL);
+    fsp_files_hash_table_free(files);
+    fsp_pools_free(pools);
+}
+
+static void bench_parser(unsigned long int ops) {
+    // Campo data con BENCH_DATA_ITEMS elementi
+    size_t size = 1024;
+    void* data = malloc(size);
+    void* copy = NULL;
+    long int len = 0;
+    char pathname[64];
+    const char payload[] = "0123456789abcdef";
+    for(int i = 0; i < BENCH_DATA_ITEMS; i++) {
+        snprintf(pathname, sizeof(pathname), "/bench/file_%02d.txt", i);
+        len += fsp_parser_makeData(&data, &size, len, pathname, sizeof(payload)-1, (void*) payload);
+    }
+    copy = malloc(size);
+
+    struct fsp_data* parsed_data;
+    double start, end;
+    if(ops == 0) ops = 1;
+
+    start = now();
+    for(unsigned long int i = 0; i < ops; i++) {
+        memcpy(copy, data, len);
+        fsp_parser_parseData(len, copy, &parsed_data);
+        fsp_parser_freeData(parsed_data);
+    }
+    end = now();
+    report("fsp_parser_parseData (64 elementi)", start, end, ops);
+
+    // Costo delle sole allocazioni di un nodo per elemento (comportamento precedente)
+    struct fsp_data* nodes[BENCH_DATA_ITEMS];
+    start = now();
+    for(unsigned long int i = 0; i < ops; i++) {
+        for(int j = 0; j < BENCH_DATA_ITEMS; j++) nodes[j] = malloc(sizeof(struct fsp_data));
+        for(int j = 0; j < BENCH_DATA_ITEMS; j++) free(nodes[j]);
+    }
+    end = now();
+    report("malloc/free di 64 nodi fsp_data", start, end, ops);
+
+    free(data);
+    free(copy);
+}
+
+static void bench_lz(unsigned long int ops) {
+    // Testo simile a un file di log
+    const char* words[] = {"INFO", "WARN", "request", "completed", "client", "file", "/tmp/file_storage.sk",
+                           "bytes", "open", "read", "write", "\n", "{\"id\": ", "\"size\": ", "}", "error"};
+    unsigned char* text = malloc(BENCH_LZ_TEXT_SIZE);
+    unsigned char* compressed = malloc(BENCH_LZ_TEXT_SIZE*2);
+    unsigned char* decompressed = malloc(BENCH_LZ_TEXT_SIZE);
+    size_t len = 0;
+    unsigned int seed = 1;
+    while(len < BENCH_LZ_TEXT_SIZE) {
+        seed = seed*1103515245 + 12345;
+        char word[32];
+        int word_len = snprintf(word, sizeof(word), "%s %u ", words[(seed >> 16)%16], (seed >> 8)%1000);
+        if(word_len > BENCH_LZ_TEXT_SIZE - len) word_len = BENCH_LZ_TEXT_SIZE - len;
+        memcpy(text + len, word, word_len);
+        len += word_len;
+    }
+    
+    long int compressed_len = 0;
+    double start, end;
+    if(ops == 0) ops = 1;
+    
+    start = now();
+    for(unsigned long int i = 0; i < ops; i++) {
+        compressed_len = fsp_lz_compress(text, BENCH_LZ_TEXT_SIZE, compressed, BENCH_LZ_TEXT_SIZE*2);
+    }
+    end = now();
+    report("fsp_lz_compress (64 KB di testo)", start, end, ops);
+    
+    start = now();
+    for(unsigned long int i = 0; i < ops; i++) {
+        fsp_lz_decompress(compressed, compressed_len, decompressed, BENCH_LZ_TEXT_SIZE);
+    }
+    end = now();
+    report("fsp_lz_decompress (64 KB di testo)", start, end, ops);
+    printf("rapporto di compressione: %.2f\n", (double) BENCH_LZ_TEXT_SIZE/compressed_len);
+    if(memcmp(text, decompressed, BENCH_LZ_TEXT_SIZE) != 0) fprintf(stderr, "Errore: decompressione errata.\n");
+    
+    free(text);
+    free(compressed);
+    free(decompressed);
+}
+
+static void bench_eviction(unsigned long int ops) {
+    // I primi BENCH_EVICTION_FILES file vengono scelti con distribuzione di Zipf (il file i ha probabilità
+    // proporzionale a 1/(i+1)^BENCH_EVICTION_ZIPF), gli ultimi BENCH_EVICTION_SCAN_LEN vengono letti dalle scansioni
+    const int files_num = BENCH_EVICTION_FILES + BENCH_EVICTION_SCAN_LEN;
+    double* cdf = malloc(sizeof(double)*BENCH_EVICTION_FILES);
+    struct fsp_file** files = malloc(sizeof(struct fsp_file*)*files_num);
+    // Indica se il file si trova nella cache
+    unsigned char* cached = malloc(files_num);
+    char pathname[64];
+    char name[64];
+    double start, end;
+    if(cdf == NULL || files == NULL || cached == NULL) {
+        free(cdf);
+        free(files);
+        free(cached);
+        return;
+    }
+    double sum = 0;
+    for(int i = 0; i < BENCH_EVICTION_FILES; i++) {
+        sum += 1/pow(i + 1, BENCH_EVICTION_ZIPF);
+        cdf[i] = sum;
+    }
+    for(int i = 0; i < BENCH_EVICTION_FILES; i++) cdf[i] /= sum;
+    size_t total_size = 0;
+    for(int i = 0; i < files_num; i++) {
+        snprintf(pathname, sizeof(pathname), "/bench/dir_%02d/file_%08d.txt", i%16, i);
+        // I file non hanno contenuto (la politica usa la dimensione), il campo locked contiene l'indice del file
+        size_t size = (size_t) BENCH_EVICTION_MIN_SIZE << (((unsigned int) i*2654435761u >> 16)%BENCH_EVICTION_SIZES);
+        files[i] = fsp_file_new(NULL, pathname, NULL, size, 0, i, 0);
+        total_size += size;
+    }
+    size_t cache_size = total_size/files_num*BENCH_EVICTION_CACHE_SIZE;
+    
+    for(int policy = 0; policy < FSP_EVICTION_POLICIES_NUM; policy++) {
+        struct fsp_eviction* eviction = fsp_eviction_new(policy, BENCH_EVICTION_CACHE_SIZE + 1);
+        memset(cached, 0, files_num);
+        unsigned long int hits = 0;
+        unsigned long int accesses = 0;
+        unsigned long int hit_bytes = 0;
+        unsigned long int accessed_bytes = 0;
+        size_t used_size = 0;
+        unsigned int seed = 1;
+        int scan = 0;
+        start = now();
+        for(unsigned long int i = 0; i < ops; i++) {
+            int j;
+            if(i%BENCH_EVICTION_SCAN_PERIOD < BENCH_EVICTION_SCAN_LEN && i >= BENCH_EVICTION_SCAN_PERIOD) {
+                // Scansione
+                j = BENCH_EVICTION_FILES + (scan++)%BENCH_EVICTION_SCAN_LEN;
+            } else {
+                seed = seed*1103515245 + 12345;
+                double u = (double) ((seed >> 1) & 0x3FFFFFFF)/0x40000000;
+                int lo = 0, hi = BENCH_EVICTION_FILES - 1;
+                while(lo < hi) {
+                    int mid = (lo + hi)/2;
+                    if(cdf[mid] < u) lo = mid + 1;
+                    else hi = mid;
+                }
+                j = lo;
+            }
+            accesses++;
+            accessed_bytes += files[j]->size;
+            if(cached[j]) {
+                hits++;
+                hit_bytes += files[j]->size;
+                fsp_eviction_access(eviction, files[j]);
+                continue;
+            }
+            cached[j] = 1;
+            used_size += files[j]->size;
+            fsp_eviction_insert(eviction, files[j]);
+            while(used_size > cache_size) {
+                struct fsp_file* victim = fsp_eviction_victim(eviction);
+                cached[victim->locked] = 0;
+                used_size -= victim->size;
+            }
+        }
+        end = now();
+        snprintf(name, sizeof(name), "fsp_eviction %s (accesso)", fsp_eviction_name(policy));
+        report(name, start, end, ops);
+        printf("hit ratio %s: %.2f%%, byte hit ratio: %.2f%%\n", fsp_eviction_name(policy), (double) hits*100/accesses,
+               (double) hit_bytes*100/accessed_bytes);
+        if(eviction->rejections > 0) printf("file non ammessi %s: %lu su %lu vittime\n", fsp_eviction_name(policy), eviction->rejections, eviction->victims);
+        fsp_eviction_free(eviction);
+        
+        // Rimozione di tutti i file (CLOSE, REMOVE) a partire dal più recente
+        eviction = fsp_eviction_new(policy, files_num);
+        for(int i = 0; i < files_num; i++) fsp_eviction_insert(eviction, files[i]);
+        start = now();
+        for(int i = files_num - 1; i >= 0; i--) fsp_eviction_remove(eviction, files[i]);
+        end = now();
+        snprintf(name, sizeof(name), "fsp_eviction %s (rimozione)", fsp_eviction_name(policy));
+        report(name, start, end, files_num);
+        fsp_eviction_free(eviction);
+    }
+    
+    for(int i = 0; i < files_num; i++) fsp_file_free(NULL, files[i]);
+    free(cdf);
+    free(files);
+    free(cached);
+}
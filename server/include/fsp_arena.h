@@ -0,0 +1,145 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+// Arena di memoria mappata su file (mmap condivisa).
+// Struttura dati usata per mantenere i contenuti dei file e i relativi metadati in un file,
+// in modo che al riavvio il server possa rimappare l'arena e ricostruire i propri indici
+// invece di ricevere nuovamente i file dai client.
+//
+// L'arena è composta da un'intestazione seguita da una successione di blocchi contigui.
+// Ogni blocco ha un'intestazione (tipo e classe di dimensione) seguita dall'oggetto:
+// la dimensione di un blocco viene arrotondata alla sua classe (4 classi per ogni potenza di 2,
+// spreco massimo del 25%) e i blocchi liberati vengono riutilizzati per oggetti della stessa classe.
+// Le liste dei blocchi liberi sono mantenute solo in memoria e vengono ricostruite all'apertura
+// scandendo le intestazioni dei blocchi.
+// Il tipo di un blocco viene scelto dal chiamante (0 indica un blocco libero) e permette di
+// distinguere gli oggetti durante la scansione (fsp_arena_scan).
+// La mappatura può trovarsi a un indirizzo diverso dopo la riapertura: i riferimenti tra gli oggetti
+// devono essere memorizzati come offset (fsp_arena_offset), mentre gli eventuali puntatori contenuti negli
+// oggetti non sono validi dopo la riapertura e devono essere ricostruiti dal chiamante. Il contenuto
+// di un'arena riaperta non va considerato affidabile: fsp_arena_pointer verifica che un offset sia
+// preceduto dall'intestazione di un blocco del tipo atteso.
+//
+// Se il file si trova su un file system hugetlbfs (o tmpfs con le huge page trasparenti abilitate),
+// l'arena viene mappata con pagine di grandi dimensioni: la capacità è un multiplo di FSP_ARENA_ALIGNMENT.
+// Un'arena non chiusa correttamente (fsp_arena_detach non invocata) viene reinizializzata all'apertura.
+//
+// Un'arena può anche essere anonima (fsp_arena_new): non è associata ad alcun file e il suo contenuto
+// non sopravvive al riavvio. Viene usata come pool per gli oggetti di grandi dimensioni: la mappatura
+// è allineata a FSP_ARENA_ALIGNMENT e può usare huge page trasparenti (madvise) o riservate (hugetlbfs),
+// riducendo i TLB miss e il numero dei page fault; se richiesto, tutte le pagine vengono caricate alla
+// creazione (prefault), in modo che le allocazioni successive non causino page fault.
+// Un'arena anonima è privata: un processo figlio creato con fork() ne vede il contenuto al momento della fork().
+// Le funzioni sono thread-safe.
+
+#ifndef FSP_ARENA_H
+#define FSP_ARENA_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+// Allineamento della capacità dell'arena (dimensione di una huge page)
+#define FSP_ARENA_ALIGNMENT 2097152
+// Numero delle classi di dimensione dei blocchi
+#define FSP_ARENA_CLASSES_NUM 256
+// Tipo di un blocco libero
+#define FSP_ARENA_FREE 0
+// Opzioni delle arene anonime (fsp_arena_new)
+// Huge page trasparenti (madvise)
+#define FSP_ARENA_THP 1
+// Huge page riservate (hugetlbfs), se non disponibili vengono usate le huge page trasparenti
+#define FSP_ARENA_HUGETLB 2
+// Caricamento di tutte le pagine alla creazione
+#define FSP_ARENA_PREFAULT 4
+
+struct fsp_arena {
+    // Descrittore del file (-1 se l'arena è anonima)
+    int fd;
+    // Inizio della mappatura (intestazione dell'arena)
+    struct fsp_arena_header* header;
+    // Capacità dell'arena in byte
+    size_t capacity;
+    // Indica se l'arena è stata staccata dal file (le liberazioni non la modificano più)
+    int detached;
+    // Liste dei blocchi liberi (offset del primo blocco libero di ogni classe, 0 se la lista è vuota)
+    size_t free_lists[FSP_ARENA_CLASSES_NUM];
+    // Mutex per l'accesso all'arena
+    pthread_mutex_t mutex;
+};
+
+/**
+ * \brief Apre (o crea) l'arena contenuta nel file path con capacità di almeno capacity byte.
+ *        Se il file contiene un'arena valida chiusa correttamente, allora il suo contenuto viene
+ *        mantenuto e *restored viene posto a 1, altrimenti l'arena viene inizializzata e *restored viene posto a 0.
+ *
+ * \return L'arena,
+ *         NULL se path == NULL || restored == NULL || non è stato possibile aprire o mappare il file ||
+ *         il file è già in uso da un altro processo.
+ */
+struct fsp_arena* fsp_arena_open(const char* path, size_t capacity, int* restored);
+
+/**
+ * \brief Crea un'arena anonima con capacità di almeno capacity byte. flags è una combinazione di
+ *        FSP_ARENA_THP, FSP_ARENA_HUGETLB e FSP_ARENA_PREFAULT.
+ *
+ * \return L'arena,
+ *         NULL se capacity == 0 || non è stato possibile allocare la memoria o mappare l'arena.
+ */
+struct fsp_arena* fsp_arena_new(size_t capacity, int flags);
+
+/**
+ * \brief Stacca arena dal file: sincronizza il contenuto sul file e lo marca come chiuso correttamente.
+ *        Dopo la chiamata le liberazioni (fsp_arena_free) non modificano più l'arena, in modo che gli
+ *        oggetti possano essere liberati dalla memoria senza perdere il loro contenuto persistente.
+ */
+void fsp_arena_detach(struct fsp_arena* arena);
+
+/**
+ * \brief Rimuove la mappatura di arena, chiude il file (se presente) e libera arena dalla memoria.
+ *        Gli oggetti contenuti nell'arena non sono più validi dopo la chiamata.
+ */
+void fsp_arena_close(struct fsp_arena* arena);
+
+/**
+ * \brief Restituisce un oggetto (non inizializzato) di almeno size byte preso da arena con tipo type (type != FSP_ARENA_FREE).
+ *        L'oggetto è allineato a 8 byte.
+ *
+ * \return L'oggetto,
+ *         NULL se arena == NULL || type == FSP_ARENA_FREE || arena è piena.
+ */
+void* fsp_arena_alloc(struct fsp_arena* arena, size_t size, unsigned int type);
+
+/**
+ * \brief Restituisce obj, ottenuto da fsp_arena_alloc, ad arena.
+ */
+void fsp_arena_free(struct fsp_arena* arena, void* obj);
+
+/**
+ * \brief Restituisce il numero di byte utilizzabili di obj (almeno quelli richiesti a fsp_arena_alloc).
+ */
+size_t fsp_arena_capacity(const struct fsp_arena* arena, const void* obj);
+
+/**
+ * \brief Restituisce l'offset di obj all'interno di arena (valido anche dopo la riapertura).
+ */
+size_t fsp_arena_offset(const struct fsp_arena* arena, const void* obj);
+
+/**
+ * \brief Restituisce l'oggetto di tipo type di arena che si trova all'offset offset.
+ *
+ * \return L'oggetto,
+ *         NULL se offset non è l'offset di un oggetto di tipo type.
+ */
+void* fsp_arena_pointer(const struct fsp_arena* arena, size_t offset, unsigned int type);
+
+/**
+ * \brief Invoca f su tutti gli oggetti di tipo type contenuti in arena (passando arg come secondo argomento).
+ *        f può liberare l'oggetto che riceve.
+ *
+ * \return Il numero di oggetti visitati.
+ */
+unsigned long int fsp_arena_scan(struct fsp_arena* arena, unsigned int type, void (*f)(void*, void*), void* arg);
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+// Contenuto di un file memorizzato sul server.
+// Se richiesto, il contenuto viene compresso (fsp_lz) e memorizzato in forma compressa solo se
+// la compressione fa risparmiare almeno 1/FSP_BLOB_MIN_SAVING della dimensione originale:
+// i contenuti già compressi (immagini JPEG/PNG, archivi, ...) o troppo piccoli vengono
+// memorizzati così come sono. Il contenuto viene decompresso solo quando viene letto.
+// I dati aggiunti in coda a un contenuto compresso vengono memorizzati come letterali (fsp_lz_appendLiterals)
+// senza decomprimere il contenuto: il contenuto viene compresso di nuovo (e un contenuto non compresso viene
+// valutato di nuovo) solo quando la sua dimensione raddoppia rispetto all'ultima compressione, quindi
+// una successione di aggiunte costa in media un tempo proporzionale ai byte aggiunti.
+//
+// Un contenuto può essere condiviso da più file con lo stesso contenuto (deduplicazione):
+// il campo refs conta i file che lo referenziano e il campo hash (calcolato sul contenuto non
+// compresso) permette di trovare i contenuti uguali (tabella fsp_blobs_hash_table).
+// Un contenuto condiviso non viene mai modificato.
+//
+// Se viene indicata un'arena (fsp_arena), allora i contenuti vengono allocati nell'arena
+// (blocchi di tipo FSP_BLOB_ARENA_TYPE) e sopravvivono al riavvio del server; se l'arena è piena,
+// allora vengono allocati con malloc(). I campi hash_table_next e arena sono puntatori validi solo nel
+// processo che ha allocato il contenuto: alla riapertura dell'arena il server li riscrive (insieme a refs)
+// prima di usare il contenuto e scarta i contenuti con dimensioni non coerenti.
+//
+// Un contenuto piccolo può essere incorporato nell'allocazione del file a cui appartiene
+// (fsp_file_embed): un contenuto incorporato non viene mai condiviso né modificato e la sua memoria
+// viene liberata insieme al file (fsp_blob_free si limita a rilasciare il riferimento).
+
+#ifndef FSP_BLOB_H
+#define FSP_BLOB_H
+
+#include <stdio.h>
+
+#include <fsp_arena.h>
+
+// Dimensione minima di un contenuto da comprimere
+#define FSP_BLOB_COMPRESSION_MIN_SIZE 64
+// Risparmio minimo richiesto per memorizzare un contenuto in forma compressa (1/8 della dimensione)
+#define FSP_BLOB_MIN_SAVING 8
+// Tipo dei blocchi dell'arena che contengono un contenuto
+#define FSP_BLOB_ARENA_TYPE 1
+
+struct fsp_blob {
+    // Nodo successivo (usato per la gestione della tabella hash)
+    struct fsp_blob* hash_table_next;
+    // Arena in cui è allocato il contenuto (NULL se è allocato con malloc())
+    struct fsp_arena* arena;
+    // Dimensione del contenuto (non compresso)
+    size_t size;
+    // Dimensione dei dati memorizzati in data
+    size_t stored_size;
+    // Dimensione del contenuto all'ultima compressione (o all'ultimo tentativo di compressione)
+    size_t base_size;
+    // Valore hash del contenuto (non compresso)
+    unsigned int hash;
+    // Numero dei riferimenti al contenuto
+    unsigned int refs;
+    // Indica se i dati sono compressi
+    unsigned char compressed;
+    // Indica se il contenuto è incorporato nell'allocazione di un file
+    unsigned char embedded;
+    // Dati
+    unsigned char data[];
+};
+
+/**
+ * \brief Restituisce un nuovo contenuto (con un riferimento) con una copia dei size byte di data.
+ *        Se compress != 0, allora prova a comprimerlo. Il contenuto viene allocato in arena (se arena != NULL).
+ *
+ * \return Il nuovo contenuto,
+ *         NULL se data == NULL || non è stato possibile allocare la memoria.
+ */
+struct fsp_blob* fsp_blob_new(struct fsp_arena* arena, const void* data, size_t size, int compress);
+
+/**
+ * \brief Restituisce un nuovo contenuto (con un riferimento) con spazio per stored_size byte di dati non inizializzati
+ *        e con i campi size, compressed e hash inizializzati con i valori degli argomenti (usata per ricostruire un contenuto
+ *        memorizzato altrove). Il contenuto viene allocato in arena (se arena != NULL).
+ *
+ * \return Il nuovo contenuto,
+ *         NULL se non è stato possibile allocare la memoria.
+ */
+struct fsp_blob* fsp_blob_alloc(struct fsp_arena* arena, size_t size, size_t stored_size, int compressed, unsigned int hash);
+
+/**
+ * \brief Aggiunge i size byte di data in coda al contenuto di blob (se blob == NULL, crea un nuovo contenuto).
+ *        Se blob è compresso, allora i dati vengono aggiunti come letterali. Se compress != 0 e la dimensione
+ *        del nuovo contenuto è almeno il doppio di blob->base_size, allora prova a comprimere l'intero contenuto
+ *        (anche se blob non è compresso). In caso di successo il riferimento a blob viene rilasciato:
+ *        se blob è condiviso (blob->refs > 1) o incorporato, allora rimane invariato per gli altri riferimenti,
+ *        altrimenti non è più valido. Il nuovo contenuto ha un solo riferimento e, se deve essere
+ *        allocato nuovamente, viene allocato in arena (se arena != NULL).
+ *
+ * \return Il nuovo contenuto,
+ *         NULL se data == NULL || non è stato possibile allocare la memoria (blob rimane invariato).
+ */
+struct fsp_blob* fsp_blob_append(struct fsp_arena* arena, struct fsp_blob* blob, const void* data, size_t size, int compress);
+
+/**
+ * \brief Scrive in buf il contenuto (non compresso) di blob (blob->size byte).
+ *
+ * \return 0 in caso di successo,
+ *         -1 se blob == NULL || buf == NULL || i dati compressi non sono validi.
+ */
+int fsp_blob_read(const struct fsp_blob* blob, void* buf);
+
+/**
+ * \brief Restituisce 1 se blob1 e blob2 hanno lo stesso contenuto, 0 altrimenti.
+ *        Il confronto avviene sui dati memorizzati: contenuti uguali memorizzati in modo
+ *        diverso (uno compresso e l'altro no) risultano diversi.
+ */
+int fsp_blob_equals(const struct fsp_blob* blob1, const struct fsp_blob* blob2);
+
+/**
+ * \brief Rilascia un riferimento a blob e lo libera dalla memoria se non ci sono altri riferimenti.
+ */
+void fsp_blob_free(struct fsp_blob* blob);
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+// Tabella hash contenente i contenuti dei file (deduplicazione).
+// Struttura dati usata per trovare un contenuto già memorizzato sul server uguale a un nuovo
+// contenuto, in modo da condividerlo tra i file invece di memorizzarlo più volte.
+// I contenuti sono indicizzati dal valore hash del loro contenuto (campo hash) e le collisioni
+// vengono risolte mediante concatenamento. La tabella non libera i contenuti.
+
+#ifndef FSP_BLOBS_HASH_TABLE_H
+#define FSP_BLOBS_HASH_TABLE_H
+
+#include <stdio.h>
+
+#include <fsp_blob.h>
+
+struct fsp_blobs_hash_table {
+    // Dimensione della tabella
+    size_t size;
+    // Numero dei contenuti presenti nella tabella
+    unsigned int blobs_num;
+    // La tabella (vettore)
+    struct fsp_blob** table;
+};
+
+/**
+ * \brief Restituisce una nuova tabella hash di dimensione size.
+ *
+ * \return Una nuova tabella hash di dimensione size,
+ *         NULL se non è stato possibile allocare la memoria.
+ */
+struct fsp_blobs_hash_table* fsp_blobs_hash_table_new(size_t size);
+
+/**
+ * \brief Libera hash_table dalla memoria (i contenuti presenti nella tabella non vengono liberati).
+ */
+void fsp_blobs_hash_table_free(struct fsp_blobs_hash_table* hash_table);
+
+/**
+ * \brief Aggiunge blob nella tabella hash_table.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se hash_table == NULL || blob == NULL.
+ */
+int fsp_blobs_hash_table_insert(struct fsp_blobs_hash_table* hash_table, struct fsp_blob* blob);
+
+/**
+ * \brief Cerca nella tabella hash_table un contenuto uguale a blob (fsp_blob_equals) e lo restituisce.
+ *
+ * \return Il contenuto,
+ *         NULL se hash_table == NULL || blob == NULL || contenuto non trovato.
+ */
+struct fsp_blob* fsp_blobs_hash_table_search(const struct fsp_blobs_hash_table* hash_table, const struct fsp_blob* blob);
+
+/**
+ * \brief Rimuove blob dalla tabella hash_table e lo restituisce.
+ *
+ * \return Il contenuto rimosso,
+ *         NULL se hash_table == NULL || blob == NULL || blob non è presente nella tabella.
+ */
+struct fsp_blob* fsp_blobs_hash_table_delete(struct fsp_blobs_hash_table* hash_table, struct fsp_blob* blob);
+
+#endif
@@ -6,7 +6,43 @@
 #ifndef FSP_CLIENT_H
 #define FSP_CLIENT_H
 
-#include <fsp_files_list.h>
+#include <time.h>
+
+#include <fsp_files_set.h>
+#include <fsp_blob.h>
+
+// Parte del campo data di un messaggio di risposta inviata senza essere copiata in buf (writev)
+struct fsp_client_part {
+    // Dati da inviare (NULL se devono essere ancora decompressi da blob)
+    const void* data;
+    // Numero dei byte da inviare
+    size_t len;
+    // Buffer da liberare con free() dopo l'invio (NULL se assente)
+    void* buf;
+    // Contenuto di cui rilasciare il riferimento dopo l'invio (NULL se assente)
+    struct fsp_blob* blob;
+};
+
+struct fsp_client;
+
+// Richiesta LOCK differita (protocollo versione 2): il client attende la lock senza occupare un thread worker
+// e la risposta viene inviata, con l'identificativo della richiesta, quando la lock viene ottenuta o l'attesa termina
+struct fsp_client_deferred {
+    // Client che ha inviato la richiesta
+    struct fsp_client* client;
+    // File di cui il client attende la lock
+    struct fsp_file* file;
+    // Identificativo della richiesta
+    unsigned int id;
+    // Codice di risposta (significativo quando la richiesta è completata)
+    int code;
+    // Istante in cui la richiesta è stata differita
+    time_t start;
+    // Nodo successivo
+    struct fsp_client_deferred* next;
+    // Nome del file (per il file di log)
+    char arg[];
+};
 
 struct fsp_client {
     // Socket file descriptor
@@ -15,8 +51,23 @@ struct fsp_client {
     void* buf;
     // Dimensione del buffer buf
     size_t size;
-    // Lista dei file aperti
-    struct fsp_files_list* openedFiles;
+    // Parti del campo data della risposta in corso (file espulsi dalla memoria, vettore)
+    struct fsp_client_part* parts;
+    // Numero delle parti presenti e dimensione del vettore parts
+    size_t parts_num;
+    size_t parts_size;
+    // Versione del protocollo (FSP_PARSER_V1 o FSP_PARSER_V2) e identificativo dell'ultima richiesta ricevuta
+    // (la risposta viene inviata nello stesso formato e con lo stesso identificativo)
+    int version;
+    unsigned int req_id;
+    // Numero delle richieste differite in attesa o completate ma non ancora inviate
+    // (usato solo dal thread che gestisce il client)
+    size_t deferred_num;
+    // Richieste differite completate e non ancora inviate, in ordine di completamento (lista)
+    struct fsp_client_deferred* completed;
+    struct fsp_client_deferred* completed_tail;
+    // Insieme dei file aperti
+    struct fsp_files_set* openedFiles;
     // Nodo successivo
     struct fsp_client* next;
 };
@@ -33,7 +84,8 @@ struct fsp_client {
 struct fsp_client* fsp_client_new(int sfd, size_t buf_size);
 
 /**
- * \brief Libera client dalla memoria.
+ * \brief Libera client dalla memoria (compresi i buffer delle parti presenti e le richieste differite completate,
+ *        i riferimenti ai contenuti devono essere già stati rilasciati).
  */
 void fsp_client_free(struct fsp_client* client);
 
@@ -0,0 +1,254 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+// Politica di rimpiazzamento dei file.
+// Struttura dati che sceglie i file da espellere dalla memoria in seguito a capacity miss.
+// Il server notifica alla politica l'inserimento di un file con contenuto (fsp_eviction_insert),
+// ogni accesso al file (fsp_eviction_access) e la sua rimozione (fsp_eviction_remove); la politica
+// sceglie e rimuove il file vittima (fsp_eviction_victim). Se il file vittima non può essere espulso, allora
+// il server lo restituisce alla politica (fsp_eviction_restore) che torna nello stato precedente alla scelta.
+// Politiche disponibili:
+// - FIFO: espelle il file inserito per primo (gli accessi non cambiano l'ordine);
+// - LRU: espelle il file usato meno recentemente (coda dei file in cui ogni accesso sposta il file in fondo,
+//   O(1) per operazione);
+// - LFU: espelle il file con il minor numero di accessi (heap minimo, O(log n) per operazione);
+// - CLOCK: approssimazione di LRU (seconda possibilità): ogni accesso setta il bit di riferimento
+//   del file, la scelta della vittima scorre la coda reinserendo in fondo i file con il bit settato
+//   (dopo averlo azzerato) ed espelle il primo file con il bit azzerato;
+// - ARC (Adaptive Replacement Cache, Megiddo e Modha): divide i file in T1 (usati una sola volta dall'inserimento)
+//   e T2 (usati almeno due volte), entrambe in ordine LRU, e ricorda i nomi dei file espulsi da T1 e da T2
+//   nelle liste fantasma B1 e B2. Un file reinserito mentre il suo nome si trova in B1 (o B2) entra direttamente
+//   in T2 e aumenta (o diminuisce) il parametro di adattamento p, la dimensione obiettivo di T1: la vittima
+//   viene presa da T1 se |T1| > p, da T2 altrimenti. Una scansione di file letti una sola volta occupa solo T1
+//   e non espelle i file di T2.
+//   La capacità c della cache (in file) usata da ARC è il numero dei file presenti alla prima scelta di una vittima
+//   dopo un inserimento, escluso il file di troppo (la capacità del server può essere limitata dalla dimensione
+//   dei file); le liste
+//   fantasma sono limitate a |T1| + |B1| <= c e |T1| + |T2| + |B1| + |B2| <= 2c;
+// - TINYLFU (W-TinyLFU, Einziger, Friedman e Manes): i file inseriti entrano in una piccola finestra LRU
+//   (1% della capacità c, calcolata come per ARC) e passano poi nella parte principale (LRU).
+//   Le frequenze di accesso di tutti i file (anche di quelli non più presenti) sono stimate da un count-min
+//   sketch con contatori da 4 bit, dimezzati periodicamente (invecchiamento). Quando la cache è piena, il file meno
+//   recente della finestra (candidato) viene ammesso nella parte principale solo se la sua frequenza stimata
+//   è maggiore di quella del file meno recente della parte principale, che viene espulso al suo posto;
+//   altrimenti viene espulso il candidato (file non ammesso). Una raffica di file nuovi usati una sola volta
+//   non espelle i file usati frequentemente.
+// - GDSF (GreedyDual-Size-Frequency, Cherkasova): espelle il file con la priorità minore, calcolata a ogni
+//   inserimento e accesso come H = L + n*costo/dimensione, con n numero degli accessi dall'inserimento, dimensione
+//   lo spazio occupato in memoria dal contenuto (eventualmente compresso) e L valore di invecchiamento (la priorità
+//   dell'ultima vittima, i file non usati da tempo vengono superati dai file inseriti o usati dopo di loro).
+//   Con costo 1 (GDSF) vengono espulsi prima i file grandi e la politica massimizza la hit ratio dei file;
+//   con costo uguale alla dimensione del file non compresso (GDSF_BYTES) la dimensione conta solo attraverso
+//   la compressione e la politica massimizza la byte hit ratio (i byte letti serviti dalla memoria).
+//   La priorità è un valore in virgola fissa (32 bit frazionari) memorizzato in fsp_file.eviction_key.
+// Le politiche FIFO, LRU, CLOCK, ARC e TINYLFU usano le code dei file (fsp_files_queue, O(1) per operazione),
+// le politiche LFU e GDSF uno heap ordinato per la chiave dei file (fsp_file.eviction_key, O(log n) per operazione).
+// Le funzioni non sono thread-safe.
+
+#ifndef FSP_EVICTION_H
+#define FSP_EVICTION_H
+
+#include <stdio.h>
+
+#include <fsp_file.h>
+#include <fsp_files_queue.h>
+
+// Politiche di rimpiazzamento
+#define FSP_EVICTION_FIFO 0
+#define FSP_EVICTION_LRU 1
+#define FSP_EVICTION_LFU 2
+#define FSP_EVICTION_CLOCK 3
+#define FSP_EVICTION_ARC 4
+#define FSP_EVICTION_TINYLFU 5
+#define FSP_EVICTION_GDSF 6
+#define FSP_EVICTION_GDSF_BYTES 7
+// Numero delle politiche di rimpiazzamento
+#define FSP_EVICTION_POLICIES_NUM 8
+// Numero delle righe del count-min sketch di TINYLFU
+#define FSP_EVICTION_SKETCH_DEPTH 4
+
+struct fsp_eviction;
+
+// Operazioni di una politica di rimpiazzamento
+struct fsp_eviction_policy {
+    // Nome della politica (come in config.txt)
+    const char* name;
+    // Inserimento di un file (restituisce 0 in caso di successo, -1 se non è stato possibile allocare la memoria)
+    int (*insert) (struct fsp_eviction*, struct fsp_file*);
+    // Accesso a un file
+    void (*access) (struct fsp_eviction*, struct fsp_file*);
+    // Rimozione di un file
+    void (*remove) (struct fsp_eviction*, struct fsp_file*);
+    // Scelta e rimozione del file vittima (NULL se non ci sono file)
+    struct fsp_file* (*victim) (struct fsp_eviction*);
+    // Reinserimento dell'ultimo file vittima nella posizione da cui è stato scelto
+    void (*restore) (struct fsp_eviction*, struct fsp_file*);
+};
+
+// Heap minimo dei file ordinato per chiave
+struct fsp_eviction_heap {
+    // I file (vettore)
+    struct fsp_file** files;
+    // Numero dei file presenti e dimensione del vettore
+    size_t files_num;
+    size_t size;
+};
+
+// Nome di un file espulso (lista fantasma di ARC)
+struct fsp_eviction_ghost {
+    // Nodo successivo (usato per la gestione della tabella hash)
+    struct fsp_eviction_ghost* hash_table_next;
+    // Nodi precedente e successivo nella lista fantasma (dal meno recente al più recente)
+    struct fsp_eviction_ghost* prev;
+    struct fsp_eviction_ghost* next;
+    // Valore hash del nome
+    unsigned int hash;
+    // Lista fantasma in cui si trova il nome (0: B1, 1: B2)
+    unsigned char list;
+    // Nome del file
+    char pathname[];
+};
+
+// Stato modificato dall'ultima scelta di una vittima (usato da fsp_eviction_restore)
+struct fsp_eviction_undo {
+    // Capacità, parametro di adattamento e indicatore evicting precedenti (ARC, TINYLFU)
+    size_t capacity;
+    size_t p;
+    int evicting;
+    // Nome aggiunto alle liste fantasma (ARC, NULL se non è stato aggiunto o è già stato rimosso)
+    struct fsp_eviction_ghost* ghost;
+    // File spostato dal fondo dello heap al posto della vittima (LFU, GDSF, NULL se la vittima era l'ultimo)
+    struct fsp_file* moved;
+    // Numero dei file spostati in fondo alla coda con il bit di riferimento azzerato (CLOCK)
+    size_t rotated;
+    // Candidato ammesso nella parte principale al posto della vittima (TINYLFU, NULL se non c'è)
+    struct fsp_file* admitted;
+    // Indica se la vittima è un candidato non ammesso (TINYLFU)
+    int rejected;
+    // Valore di invecchiamento precedente (GDSF)
+    unsigned long int inflation;
+};
+
+struct fsp_eviction {
+    // Politica di rimpiazzamento
+    const struct fsp_eviction_policy* policy;
+    // Numero dei file presenti
+    size_t files_num;
+    // Code dei file (FIFO, LRU e CLOCK usano solo la prima, ARC usa la prima per T1 e la seconda per T2,
+    // TINYLFU la prima per la finestra e la seconda per la parte principale; dal meno recente al più recente)
+    struct fsp_files_queue* queues[2];
+    // Heap dei file (LFU, GDSF)
+    struct fsp_eviction_heap heap;
+    // Numero dei file scelti come vittima
+    unsigned long int victims;
+    
+    // Stato delle politiche ARC e TINYLFU
+    // Capacità della cache in numero di file (c)
+    size_t capacity;
+    // Indica se è già stata scelta una vittima dopo l'ultimo inserimento
+    int evicting;
+    
+    // Stato della politica ARC
+    // Parametro di adattamento (dimensione obiettivo di T1, 0 <= p <= c)
+    size_t p;
+    // Indica se il nome dell'ultimo file inserito si trovava in B2
+    int ghost_b2;
+    // Liste fantasma B1 e B2 (testa: nome meno recente)
+    struct fsp_eviction_ghost* ghosts_head[2];
+    struct fsp_eviction_ghost* ghosts_tail[2];
+    size_t ghosts_num[2];
+    // Tabella hash dei nomi delle liste fantasma (dimensione potenza di 2)
+    struct fsp_eviction_ghost** ghosts_table;
+    size_t ghosts_table_size;
+    // Numero dei file reinseriti mentre il loro nome si trovava in B1 e in B2
+    unsigned long int ghost_hits[2];
+    
+    // Stato della politica TINYLFU
+    // Count-min sketch: FSP_EVICTION_SKETCH_DEPTH righe di sketch_width contatori (potenza di 2)
+    unsigned char* sketch;
+    size_t sketch_width;
+    // Incrementi dall'ultimo invecchiamento (i contatori vengono dimezzati ogni 10*sketch_width incrementi)
+    size_t sketch_additions;
+    // Numero dei candidati non ammessi nella parte principale (compresi in victims)
+    unsigned long int rejections;
+    
+    // Stato delle politiche GDSF e GDSF_BYTES
+    // Valore di invecchiamento L (priorità dell'ultima vittima)
+    unsigned long int inflation;
+    
+    // Stato precedente all'ultima scelta di una vittima
+    struct fsp_eviction_undo undo;
+};
+
+/**
+ * \brief Restituisce l'identificativo della politica di rimpiazzamento con nome name (ad esempio "LRU").
+ *
+ * \return L'identificativo della politica (FSP_EVICTION_*),
+ *         -1 se name == NULL || la politica non esiste.
+ */
+int fsp_eviction_parsePolicy(const char* name);
+
+/**
+ * \brief Restituisce il nome della politica di rimpiazzamento policy (FSP_EVICTION_*).
+ *
+ * \return Il nome della politica,
+ *         NULL se policy non è valida.
+ */
+const char* fsp_eviction_name(int policy);
+
+/**
+ * \brief Restituisce una nuova struttura vuota con la politica di rimpiazzamento policy (FSP_EVICTION_*).
+ *        Lo spazio per files_num_hint file viene allocato subito (lo heap delle politiche LFU e GDSF
+ *        viene ingrandito se necessario); files_num_hint è anche la capacità iniziale di ARC e TINYLFU
+ *        e determina la larghezza del count-min sketch di TINYLFU.
+ *
+ * \return La nuova struttura,
+ *         NULL se policy non è valida || non è stato possibile allocare la memoria.
+ */
+struct fsp_eviction* fsp_eviction_new(int policy, size_t files_num_hint);
+
+/**
+ * \brief Libera eviction dalla memoria (i file contenuti non vengono liberati, i nomi delle liste fantasma sì).
+ */
+void fsp_eviction_free(struct fsp_eviction* eviction);
+
+/**
+ * \brief Aggiunge file (che non deve essere già presente) a eviction.
+ *        Se non è stato possibile allocare la memoria (solo per le politiche LFU e GDSF), allora il file
+ *        non viene aggiunto (e non verrà mai scelto come vittima).
+ *
+ * \return 0 in caso di successo,
+ *         -1 se eviction == NULL || file == NULL || non è stato possibile allocare la memoria.
+ */
+int fsp_eviction_insert(struct fsp_eviction* eviction, struct fsp_file* file);
+
+/**
+ * \brief Notifica a eviction un accesso a file (se file non è presente, allora non fa niente).
+ */
+void fsp_eviction_access(struct fsp_eviction* eviction, struct fsp_file* file);
+
+/**
+ * \brief Rimuove file da eviction (se file non è presente, allora non fa niente).
+ */
+void fsp_eviction_remove(struct fsp_eviction* eviction, struct fsp_file* file);
+
+/**
+ * \brief Sceglie secondo la politica di eviction il file da espellere, lo rimuove da eviction e lo restituisce.
+ *
+ * \return Il file vittima,
+ *         NULL se eviction == NULL || eviction è vuota.
+ */
+struct fsp_file* fsp_eviction_victim(struct fsp_eviction* eviction);
+
+/**
+ * \brief Reinserisce in eviction file, l'ultimo file restituito da fsp_eviction_victim (senza altre operazioni
+ *        su eviction nel frattempo), e riporta la politica nello stato precedente alla scelta della vittima:
+ *        il reinserimento non conta come inserimento né come accesso (posizione del file, liste fantasma
+ *        e parametro p di ARC, count-min sketch di TINYLFU, numero degli accessi di LFU e GDSF, valore
+ *        di invecchiamento e numero delle vittime restano quelli precedenti alla scelta).
+ */
+void fsp_eviction_restore(struct fsp_eviction* eviction, struct fsp_file* file);
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+// Insieme dei file con una scadenza.
+// Struttura dati usata per rimuovere i file scaduti che non vengono più usati dai client: il server
+// sceglie periodicamente a caso alcuni file dell'insieme (fsp_expiry_sample) e rimuove quelli scaduti.
+// L'insieme è un vettore denso dei file: ogni file memorizza la propria posizione (fsp_file.expiry_pos),
+// l'aggiunta, la rimozione e la scelta casuale di un file costano O(1).
+// Le funzioni non sono thread-safe.
+
+#ifndef FSP_EXPIRY_H
+#define FSP_EXPIRY_H
+
+#include <stdio.h>
+
+#include <fsp_file.h>
+
+struct fsp_expiry {
+    // I file (vettore)
+    struct fsp_file** files;
+    // Numero dei file presenti e dimensione del vettore
+    size_t files_num;
+    size_t size;
+    // Stato del generatore di numeri pseudocasuali (xorshift)
+    unsigned long int seed;
+};
+
+/**
+ * \brief Restituisce un nuovo insieme vuoto con lo spazio per files_num_hint file
+ *        (il vettore viene ingrandito se necessario).
+ *
+ * \return Il nuovo insieme,
+ *         NULL se non è stato possibile allocare la memoria.
+ */
+struct fsp_expiry* fsp_expiry_new(size_t files_num_hint);
+
+/**
+ * \brief Libera expiry dalla memoria (i file contenuti non vengono liberati).
+ */
+void fsp_expiry_free(struct fsp_expiry* expiry);
+
+/**
+ * \brief Aggiunge file a expiry (se file è già presente, allora non fa niente).
+ *
+ * \return 0 in caso di successo,
+ *         -1 se expiry == NULL || file == NULL || non è stato possibile allocare la memoria.
+ */
+int fsp_expiry_insert(struct fsp_expiry* expiry, struct fsp_file* file);
+
+/**
+ * \brief Rimuove file da expiry (se file non è presente, allora non fa niente).
+ */
+void fsp_expiry_remove(struct fsp_expiry* expiry, struct fsp_file* file);
+
+/**
+ * \brief Restituisce 1 se file si trova in expiry, 0 altrimenti.
+ */
+int fsp_expiry_contains(const struct fsp_expiry* expiry, const struct fsp_file* file);
+
+/**
+ * \brief Sostituisce in expiry file con new_file (se file non è presente, allora non fa niente).
+ */
+void fsp_expiry_replace(struct fsp_expiry* expiry, struct fsp_file* file, struct fsp_file* new_file);
+
+/**
+ * \brief Restituisce un file di expiry scelto a caso (il file non viene rimosso).
+ *
+ * \return Il file,
+ *         NULL se expiry == NULL || expiry è vuoto.
+ */
+struct fsp_file* fsp_expiry_sample(struct fsp_expiry* expiry);
+
+#endif
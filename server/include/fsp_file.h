@@ -3,47 +3,144 @@
  * Matricola: 579131
  */
 
+// File memorizzato sul server.
+// Il nome del file è memorizzato nella stessa allocazione della struttura (subito dopo i campi)
+// e la struttura è allocata da un insieme di pool (fsp_pools) allineati alla linea di cache:
+// i campi usati durante la ricerca di un file e dalle operazioni più frequenti sono raggruppati
+// all'inizio della struttura, in modo da occupare una sola linea di cache (64 byte), seguita
+// da quella che contiene l'inizio del nome del file; i campi usati raramente sono posti dopo di essi.
+//
+// Memoria usata da ogni file (escluso il contenuto, architettura a 64 bit, glibc malloc),
+// con L lunghezza del nome del file:
+// - prima: struttura di 56 byte + nome allocato separatamente (3 allocazioni, 3 linee di cache
+//   distinte durante la ricerca): 64 + max(32, arrotondamento a 16 di L+9) byte,
+//   ad esempio 128 byte per L = 40 e 144 byte per L = 60;
+// - ora: 88 + L + 1 byte arrotondati al multiplo di 64 (1 allocazione, i campi usati durante
+//   la ricerca occupano una sola linea di cache), ad esempio 128 byte per L <= 39.
+//
+// Il contenuto di un file piccolo può essere incorporato nella stessa allocazione della struttura
+// (fsp_file_embed), subito dopo il nome del file (allineato a 8 byte): la lettura del file non richiede
+// l'accesso a un'altra allocazione e il file occupa una sola allocazione invece di due.
+// Ad esempio, per L = 20 e un contenuto di 90 byte (architettura a 64 bit, glibc malloc):
+// - contenuto separato: 128 byte (struttura e nome) + 160 byte (contenuto con intestazione) = 288 byte;
+// - contenuto incorporato: 112 + 48 (intestazione del contenuto) + 90 byte arrotondati al multiplo di 64 = 256 byte.
+// Se il contenuto cambia, allora il nuovo contenuto viene allocato separatamente e lo spazio del contenuto
+// incorporato rimane inutilizzato fino alla liberazione del file.
+//
+// Se il server usa un'arena persistente (fsp_arena), allora per ogni file con un contenuto
+// viene allocato nell'arena un record (fsp_file_record) con il nome del file e l'offset del suo
+// contenuto, usato per ricostruire il file al riavvio del server.
+
 #ifndef FSP_FILE_H
 #define FSP_FILE_H
 
-struct fsp_file {
+#include <fsp_pool.h>
+#include <fsp_blob.h>
+
+// Lunghezza massima del nome di un file
+#define FSP_FILE_PATHNAME_MAX_LEN 65535
+// Tipo dei blocchi dell'arena che contengono il record di un file
+#define FSP_FILE_ARENA_TYPE 2
+// Dimensione massima (memorizzata) di un contenuto incorporato
+#define FSP_FILE_EMBED_MAX_SIZE 4096
+
+struct fsp_file_record {
+    // Offset nell'arena del contenuto del file
+    size_t data;
+    // Scadenza del file (fsp_file.expires)
+    unsigned int expires;
     // Nome del file
-    char* pathname;
-    // File
-    // Se data == NULL, allora il file non è ancora stato creato
+    char pathname[];
+};
+
+struct fsp_file {
+    // Campi usati frequentemente
+    
+    // Nodo successivo (usato per la gestione della tabella hash)
+    struct fsp_file* hash_table_next;
+    // Contenuto del file (eventualmente compresso)
+    // Se data == NULL e spilled == 0, allora il file non è ancora stato creato
     // e verrà rimosso se links == 0
-    void* data;
-    // Dimensione del file
+    struct fsp_blob* data;
+    // Dimensione del file (non compresso)
     size_t size;
+    // Valore hash del nome del file (calcolato dalla tabella hash)
+    unsigned int hash;
     // Numero degli utenti che hanno aperto il file
     unsigned int links;
     // sfd del client che ha la lock sul file
     // locked < 0 se la lock non è stata settata
     int locked;
+    // Lunghezza del nome del file
+    unsigned short int pathname_len;
     // Indica se il file deve essere rimosso quando links == 0
     // Se remove == 1 non sarà possibile eseguire operazioni su di esso tranne la chiusura
-    unsigned short int remove;
+    unsigned char remove;
+    // Indica se il contenuto del file è stato espulso nel tier su disco (data == NULL)
+    unsigned int spilled : 1;
+    // Indica se il contenuto del file viene riportato in memoria dal tier su disco (senza mutua esclusione)
+    unsigned int promoting : 1;
+    // Indica se l'allocazione del file contiene un contenuto incorporato (non necessariamente uguale a data)
+    unsigned int embedded : 1;
+    // Scadenza del file (secondi dall'epoch, 0 se il file non scade)
+    unsigned int expires;
+    // Posizione del file nell'insieme dei file con una scadenza (fsp_expiry)
+    unsigned int expiry_pos;
     
-    // Nodo successivo (usato per la gestione della tabella hash)
-    struct fsp_file* hash_table_next;
+    // Campi usati raramente
     
-    // Nodo successivo (usato per la gestione della coda FIFO)
+    // Nodi precedente e successivo (usati per la gestione delle code dei file, fsp_files_queue)
+    struct fsp_file* queue_prev;
     struct fsp_file* queue_next;
+    // Stato del file per la politica di rimpiazzamento (fsp_eviction): numero degli accessi (LFU),
+    // bit di riferimento (CLOCK), coda in cui si trova il file (ARC, TINYLFU) o priorità (GDSF)
+    unsigned long int eviction_key;
+    // Posizione del file nello heap (LFU, GDSF)
+    unsigned int eviction_pos;
+    // Numero degli accessi dall'inserimento nella politica di rimpiazzamento (GDSF)
+    unsigned int eviction_count;
+    // Record del file nell'arena (NULL se il file non ha un record)
+    struct fsp_file_record* record;
+    
+    // Nome del file
+    char pathname[];
 };
 
 /**
  * \brief Alloca memoria per un nuovo file e lo restituisce.
  *        I campi della struttura fsp_file conterranno i rispettivi valori degli argomenti
- *        passati alla funzione. Usare la funzione fsp_file_free per liberare il file dalla memoria.
+ *        passati alla funzione (il contenuto data, se diverso da NULL, viene copiato senza compressione).
+ *        La struttura viene presa da pools (se pools != NULL).
+ *        Usare la funzione fsp_file_free con lo stesso pools per liberare il file dalla memoria.
  *
  * \return Il nuovo file,
- *         NULL se non è stato possibile allocare la memoria.
+ *         NULL se strlen(pathname) > FSP_FILE_PATHNAME_MAX_LEN || non è stato possibile allocare la memoria.
+ */
+struct fsp_file* fsp_file_new(struct fsp_pools* pools, const char* pathname, const void* data, size_t size, int links, int locked, int remove);
+
+/**
+ * \brief Restituisce una copia di file (presa da pools) con una copia del contenuto data incorporata
+ *        nella propria allocazione. La copia ha gli stessi campi di file, tranne data (il contenuto incorporato,
+ *        con un riferimento), size (data->size), hash_table_next, queue_prev e queue_next (NULL).
+ *        file deve essere privo di contenuto e non viene modificato: dopo aver sostituito file con la copia
+ *        nelle strutture dati che lo contengono, il chiamante deve liberarlo con fsp_file_free.
+ *
+ * \return La copia di file,
+ *         NULL se file == NULL || data == NULL || file->data != NULL || file->embedded ||
+ *              data->stored_size > FSP_FILE_EMBED_MAX_SIZE || non è stato possibile allocare la memoria.
+ */
+struct fsp_file* fsp_file_embed(struct fsp_pools* pools, const struct fsp_file* file, const struct fsp_blob* data);
+
+/**
+ * \brief Restituisce la dimensione in byte (dopo l'eventuale compressione) del contenuto incorporato
+ *        nell'allocazione di file, che resta allocato fino a fsp_file_free anche dopo che il file ha rilasciato
+ *        o cambiato contenuto; 0 se file == NULL || il file non ha un contenuto incorporato.
  */
-struct fsp_file* fsp_file_new(const char* pathname, const void* data, size_t size, int links, int locked, int remove);
+size_t fsp_file_embeddedSize(const struct fsp_file* file);
 
 /**
- * \brief Libera file dalla memoria.
+ * \brief Libera file dalla memoria restituendo la sua struttura a pools.
  */
-void fsp_file_free(struct fsp_file* file);
+void fsp_file_free(struct fsp_pools* pools, struct fsp_file* file);
 
 #endif
@@ -6,7 +6,10 @@
 // Tabella hash contenente i file.
 // Struttura dati usata per mantenere in memoria tutti i file salvati sul server.
 // Le collisioni vengono risolte mediante concatenamento.
-// Le liste sono ordinate lessicograficamente in ordine crescente dei nomi dei file.
+// Il valore hash del nome di ogni file viene memorizzato nel file stesso (campo hash):
+// le liste sono ordinate in ordine crescente dei valori hash e, a parità di valore hash,
+// lessicograficamente in ordine crescente dei nomi dei file. Durante la ricerca i nomi
+// vengono quindi confrontati solo con i file aventi lo stesso valore hash.
 
 #ifndef FSP_FILES_HASH_TABLE_H
 #define FSP_FILES_HASH_TABLE_H
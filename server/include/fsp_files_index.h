@@ -0,0 +1,98 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+// Indice ordinato dei nomi dei file (radix tree compresso).
+// Struttura dati mantenuta accanto alla tabella hash dei file per visitarli in ordine lessicografico
+// dei nomi a partire da un prefisso (ad esempio una directory) senza scorrere tutta la tabella.
+// Ogni nodo contiene un'etichetta (una sequenza non vuota di caratteri, tranne che nella radice),
+// il file il cui nome è la concatenazione delle etichette dalla radice al nodo (se presente) e i figli,
+// ordinati per il primo carattere dell'etichetta (nessuna coppia di figli ha lo stesso primo carattere).
+// Un nodo senza file ha almeno due figli (tranne la radice): le catene di nodi con un solo figlio
+// vengono compresse in un unico nodo.
+// La ricerca, l'inserimento e la rimozione costano O(L log A) con L lunghezza del nome e A numero dei
+// caratteri distinti; la visita di k file a partire da un prefisso costa O(L + k) (a meno dei nodi interni).
+// Le funzioni non sono thread-safe.
+
+#ifndef FSP_FILES_INDEX_H
+#define FSP_FILES_INDEX_H
+
+#include <stdio.h>
+
+#include <fsp_file.h>
+
+struct fsp_files_index_node {
+    // File il cui nome termina nel nodo (NULL se assente)
+    struct fsp_file* file;
+    // Figli (vettore ordinato per il primo carattere dell'etichetta)
+    struct fsp_files_index_node** children;
+    unsigned short int children_num;
+    unsigned short int children_size;
+    // Lunghezza dell'etichetta
+    unsigned short int label_len;
+    // Etichetta (non terminata da '\0')
+    char label[];
+};
+
+struct fsp_files_index {
+    // Radice (etichetta vuota)
+    struct fsp_files_index_node* root;
+    // Numero dei file presenti nell'indice
+    unsigned int files_num;
+    // Numero dei nodi
+    unsigned long int nodes_num;
+};
+
+/**
+ * \brief Restituisce un nuovo indice vuoto.
+ *
+ * \return Il nuovo indice,
+ *         NULL se non è stato possibile allocare la memoria.
+ */
+struct fsp_files_index* fsp_files_index_new(void);
+
+/**
+ * \brief Libera index dalla memoria (i file contenuti non vengono liberati).
+ */
+void fsp_files_index_free(struct fsp_files_index* index);
+
+/**
+ * \brief Aggiunge file (con chiave file->pathname) a index.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se index == NULL || file == NULL || non è stato possibile allocare la memoria,
+ *         -2 se un file con lo stesso nome è già presente nell'indice.
+ */
+int fsp_files_index_insert(struct fsp_files_index* index, struct fsp_file* file);
+
+/**
+ * \brief Rimuove da index il file con nome pathname e lo restituisce.
+ *
+ * \return Il file rimosso,
+ *         NULL se index == NULL || pathname == NULL || file non trovato.
+ */
+struct fsp_file* fsp_files_index_delete(struct fsp_files_index* index, const char* pathname);
+
+/**
+ * \brief Sostituisce in index il file con lo stesso nome di file con file e lo restituisce.
+ *
+ * \return Il file sostituito,
+ *         NULL se index == NULL || file == NULL || file non trovato.
+ */
+struct fsp_file* fsp_files_index_replace(struct fsp_files_index* index, struct fsp_file* file);
+
+/**
+ * \brief Visita in ordine lessicografico crescente dei nomi (confrontati come con strcmp) i file di index il cui nome
+ *        inizia con prefix (tutti se prefix == NULL) ed è strettamente maggiore di after (se after != NULL),
+ *        passando ogni file alla funzione visit insieme ad arg. La visita termina quando visit restituisce
+ *        un valore diverso da zero o quando non ci sono altri file.
+ *        index non deve essere modificato durante la visita.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se index == NULL || visit == NULL || non è stato possibile allocare la memoria.
+ */
+int fsp_files_index_scan(const struct fsp_files_index* index, const char* prefix, const char* after,
+                         int (*visit) (struct fsp_file*, void*), void* arg);
+
+#endif
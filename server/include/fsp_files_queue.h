@@ -4,7 +4,10 @@
  */
 
 // Coda FIFO contenente i file.
-// Struttura dati che tiene traccia dell'ordine cronologico con il quale i file vengono salvati sul server.
+// Struttura dati che tiene traccia dell'ordine cronologico con il quale i file vengono salvati sul server
+// (o vengono usati, se ogni accesso sposta il file in fondo alla coda).
+// La coda è una lista doppiamente concatenata intrusiva (campi queue_prev e queue_next dei file): tutte le operazioni
+// costano O(1). Un file può trovarsi in una sola coda alla volta.
 
 #ifndef FSP_FILES_QUEUE_H
 #define FSP_FILES_QUEUE_H
@@ -18,6 +21,8 @@ struct fsp_files_queue {
     struct fsp_file* head;
     // Coda
     struct fsp_file* tail;
+    // Numero dei file nella coda
+    size_t files_num;
 };
 
 /**
@@ -41,6 +46,14 @@ void fsp_files_queue_free(struct fsp_files_queue* queue);
  */
 int fsp_files_queue_enqueue(struct fsp_files_queue* queue, struct fsp_file* file);
 
+/**
+ * \brief Aggiunge file in testa alla coda queue.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se queue == NULL || file == NULL.
+ */
+int fsp_files_queue_push(struct fsp_files_queue* queue, struct fsp_file* file);
+
 /**
  * \brief Rimuove il file in testa alla coda queue e lo restituisce.
  *
@@ -50,11 +63,24 @@ int fsp_files_queue_enqueue(struct fsp_files_queue* queue, struct fsp_file* file
 struct fsp_file* fsp_files_queue_dequeue(struct fsp_files_queue* queue);
 
 /**
- * \brief Rimuove e restituisce il primo file di nome pathname che trova a partire dalla testa della coda queue.
+ * \brief Restituisce 1 se file si trova nella coda queue, 0 altrimenti.
+ */
+int fsp_files_queue_contains(const struct fsp_files_queue* queue, const struct fsp_file* file);
+
+/**
+ * \brief Rimuove file dalla coda queue e lo restituisce.
  *
  * \return Il file rimosso,
- *         NULL se queue == NULL || pathname == NULL || file non trovato.
+ *         NULL se queue == NULL || file == NULL || file non si trova nella coda.
+ */
+struct fsp_file* fsp_files_queue_remove(struct fsp_files_queue* queue, struct fsp_file* file);
+
+/**
+ * \brief Sposta file (che deve trovarsi nella coda queue) in fondo alla coda queue.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se queue == NULL || file == NULL || file non si trova nella coda.
  */
-struct fsp_file* fsp_files_queue_remove(struct fsp_files_queue* queue, const char* pathname);
+int fsp_files_queue_moveToTail(struct fsp_files_queue* queue, struct fsp_file* file);
 
 #endif
@@ -0,0 +1,124 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+// Insieme di file.
+// Struttura dati che tiene traccia dei file aperti da ogni client.
+// Tabella hash ad indirizzamento aperto (scansione lineare) indicizzata dal puntatore al file:
+// l'aggiunta, la ricerca e la rimozione di un file richiedono tempo costante in media
+// e non confrontano i nomi dei file.
+// La tabella viene allocata alla prima aggiunta e raddoppiata quando è piena per metà.
+//
+// Ad ogni file dell'insieme è associato un descrittore numerico (handle) non in uso al momento
+// dell'aggiunta, che rimane valido fino alla rimozione del file (i descrittori dei file rimossi
+// vengono riutilizzati).
+// Il file associato a un descrittore viene restituito in tempo costante (vettore dei descrittori).
+
+#ifndef FSP_FILES_SET_H
+#define FSP_FILES_SET_H
+
+#include <stdio.h>
+
+#include <fsp_file.h>
+
+// Dimensione iniziale della tabella (potenza di 2)
+#define FSP_FILES_SET_INITIAL_SIZE 16
+
+struct fsp_files_set_entry {
+    // File
+    struct fsp_file* file;
+    // Descrittore associato al file
+    unsigned int handle;
+};
+
+struct fsp_files_set {
+    // Dimensione della tabella (0 oppure potenza di 2)
+    size_t size;
+    // Numero dei file presenti nell'insieme
+    size_t files_num;
+    // La tabella (vettore)
+    // Le posizioni libere contengono file == NULL
+    struct fsp_files_set_entry* table;
+    // Vettore dei descrittori di dimensione size/2
+    // handles[h] è il file associato al descrittore h (NULL se h non è in uso)
+    struct fsp_file** handles;
+    // Descrittori liberi minori di handles_next (pila di dimensione size/2)
+    unsigned int* free_handles;
+    size_t free_handles_num;
+    // Il più piccolo descrittore mai usato
+    unsigned int handles_next;
+};
+
+/**
+ * \brief Restituisce un nuovo insieme vuoto.
+ *
+ * \return Un nuovo insieme,
+ *         NULL se non è stato possibile allocare la memoria.
+ */
+struct fsp_files_set* fsp_files_set_new(void);
+
+/**
+ * \brief Libera set dalla memoria (non libera i file contenuti).
+ */
+void fsp_files_set_free(struct fsp_files_set* set);
+
+/**
+ * \brief Aggiunge file all'insieme set e gli associa un descrittore.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se set == NULL || file == NULL,
+ *         -2 se non è stato possibile allocare la memoria,
+ *         -3 se file è già presente nell'insieme.
+ */
+int fsp_files_set_add(struct fsp_files_set* set, struct fsp_file* file);
+
+/**
+ * \brief Controlla se l'insieme set contiene o meno file.
+ *
+ * \return 0 se set == NULL || file == NULL || il file non è presente,
+ *         1 se il file è presente.
+ */
+int fsp_files_set_contains(const struct fsp_files_set* set, const struct fsp_file* file);
+
+/**
+ * \brief Restituisce il descrittore associato a file nell'insieme set.
+ *
+ * \return Il descrittore (>= 0),
+ *         -1 se set == NULL || file == NULL || il file non è presente.
+ */
+long int fsp_files_set_getHandle(const struct fsp_files_set* set, const struct fsp_file* file);
+
+/**
+ * \brief Restituisce il file associato al descrittore handle nell'insieme set.
+ *
+ * \return Il file,
+ *         NULL se set == NULL || il descrittore non è in uso.
+ */
+struct fsp_file* fsp_files_set_getFile(const struct fsp_files_set* set, unsigned long int handle);
+
+/**
+ * \brief Rimuove file dall'insieme set (il suo descrittore potrà essere riutilizzato).
+ *
+ * \return Il file,
+ *         NULL se set == NULL || file == NULL || il file non è presente.
+ */
+struct fsp_file* fsp_files_set_remove(struct fsp_files_set* set, struct fsp_file* file);
+
+/**
+ * \brief Sostituisce file con new_file nell'insieme set: new_file riceve il descrittore di file.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se set == NULL || file == NULL || new_file == NULL || file non è presente,
+ *         -3 se new_file è già presente nell'insieme.
+ */
+int fsp_files_set_replace(struct fsp_files_set* set, struct fsp_file* file, struct fsp_file* new_file);
+
+/**
+ * \brief Rimuove tutti i file presenti nell'insieme set.
+ *        Se completionHandler != NULL, passa come argomenti alla funzione completionHandler
+ *        ogni file dopo averlo rimosso e arg.
+ */
+void fsp_files_set_removeAll(struct fsp_files_set* set, void (*completionHandler) (struct fsp_file*, void*), void* arg);
+
+#endif
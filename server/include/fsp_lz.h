@@ -0,0 +1,67 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+// Compressore della famiglia LZ77 (formato a sequenze simile a quello di LZ4).
+// Privilegia la velocità rispetto al rapporto di compressione: le corrispondenze vengono
+// cercate con una tabella hash di sequenze di FSP_LZ_MIN_MATCH byte e, nelle regioni in cui
+// non vengono trovate corrispondenze, la ricerca avanza con passo crescente (i dati non
+// comprimibili vengono scanditi rapidamente).
+//
+// Il risultato è una successione di sequenze, ognuna composta da:
+// - un byte (token): i 4 bit alti indicano il numero di letterali, i 4 bit bassi la lunghezza
+//   della corrispondenza meno FSP_LZ_MIN_MATCH (il valore 15 indica che la lunghezza continua nei
+//   byte successivi, sommati fino al primo byte diverso da 255);
+// - i letterali;
+// - la distanza della corrispondenza (2 byte, little endian) e l'eventuale estensione della sua lunghezza.
+// L'ultima sequenza contiene solo i letterali. Una sequenza con distanza 0 non ha corrispondenza
+// (i 4 bit bassi del token sono 0): permette di aggiungere dati in coda a un risultato già prodotto
+// senza comprimerli di nuovo (fsp_lz_appendLiterals).
+
+#ifndef FSP_LZ_H
+#define FSP_LZ_H
+
+#include <stdio.h>
+
+// Lunghezza minima di una corrispondenza
+#define FSP_LZ_MIN_MATCH 4
+// Distanza massima di una corrispondenza
+#define FSP_LZ_MAX_OFFSET 65535
+// Numero di bit dell'indice della tabella hash del compressore
+#define FSP_LZ_HASH_BITS 12
+
+/**
+ * \brief Comprime i src_len byte di src e scrive il risultato in dst (al più dst_cap byte).
+ *
+ * \return Il numero di byte scritti in dst,
+ *         -1 se src == NULL || dst == NULL || il risultato non entra in dst_cap byte.
+ */
+long int fsp_lz_compress(const void* src, size_t src_len, void* dst, size_t dst_cap);
+
+/**
+ * \brief Decomprime i src_len byte di src (generati da fsp_lz_compress) e scrive il risultato in dst
+ *        (al più dst_len byte).
+ *
+ * \return Il numero di byte scritti in dst,
+ *         -1 se src == NULL || dst == NULL || src non è valido || il risultato non entra in dst_len byte.
+ */
+long int fsp_lz_decompress(const void* src, size_t src_len, void* dst, size_t dst_len);
+
+/**
+ * \brief Restituisce il numero massimo di byte scritti da fsp_lz_appendLiterals per src_len byte.
+ */
+size_t fsp_lz_appendBound(size_t src_len);
+
+/**
+ * \brief Aggiunge i src_len byte di src come letterali (non compressi) in coda a un risultato di fsp_lz_compress
+ *        (o di fsp_lz_appendLiterals) e scrive le nuove sequenze in dst (al più dst_cap byte), che deve
+ *        seguire immediatamente il risultato precedente: il risultato complessivo viene decompresso
+ *        nei dati originali seguiti da src.
+ *
+ * \return Il numero di byte scritti in dst,
+ *         -1 se src == NULL || dst == NULL || le sequenze non entrano in dst_cap byte.
+ */
+long int fsp_lz_appendLiterals(const void* src, size_t src_len, void* dst, size_t dst_cap);
+
+#endif
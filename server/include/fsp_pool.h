@@ -0,0 +1,111 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+// Pool di oggetti di dimensione fissa.
+// Struttura dati usata per evitare una malloc() e una free() per ogni piccolo oggetto
+// (file, nodi delle liste, ...). Gli oggetti vengono ricavati da blocchi allocati
+// una sola volta e, quando vengono rilasciati, sono inseriti in una lista di oggetti liberi
+// per essere riutilizzati dalle allocazioni successive.
+// La memoria dei blocchi viene restituita al sistema solo con fsp_pool_free.
+// I blocchi sono allineati a FSP_POOL_ALIGNMENT byte (linea di cache): gli oggetti la cui
+// dimensione è un multiplo di FSP_POOL_ALIGNMENT risultano quindi allineati alla linea di cache.
+// Il pool non è thread-safe: l'accesso deve avvenire in mutua esclusione.
+//
+// La struttura fsp_pools raggruppa più pool per allocare oggetti di dimensione variabile:
+// ogni dimensione viene arrotondata al multiplo di FSP_POOL_ALIGNMENT (classe di dimensione)
+// e l'oggetto viene preso dal pool della relativa classe. Gli oggetti più grandi di
+// FSP_POOLS_OBJ_MAX_SIZE vengono allocati con malloc().
+
+#ifndef FSP_POOL_H
+#define FSP_POOL_H
+
+#include <stdio.h>
+
+// Allineamento dei blocchi (dimensione di una linea di cache)
+#define FSP_POOL_ALIGNMENT 64
+// Dimensione massima degli oggetti allocati da fsp_pools
+#define FSP_POOLS_OBJ_MAX_SIZE 512
+// Numero delle classi di dimensione di fsp_pools
+#define FSP_POOLS_CLASSES_NUM (FSP_POOLS_OBJ_MAX_SIZE/FSP_POOL_ALIGNMENT)
+
+struct fsp_pool {
+    // Dimensione di un oggetto (arrotondata al multiplo di sizeof(void*))
+    size_t obj_size;
+    // Numero di oggetti contenuti in un blocco
+    size_t block_len;
+    // Lista degli oggetti liberi
+    void* free_list;
+    // Lista dei blocchi allocati
+    void* blocks;
+    // Numero degli oggetti in uso
+    unsigned long int used;
+};
+
+struct fsp_pools {
+    // Numero di oggetti contenuti in un blocco
+    size_t block_len;
+    // Un pool per ogni classe di dimensione (creato al primo utilizzo)
+    struct fsp_pool* classes[FSP_POOLS_CLASSES_NUM];
+};
+
+/**
+ * \brief Restituisce un nuovo pool di oggetti di dimensione obj_size.
+ *        La memoria viene allocata in blocchi da block_len oggetti.
+ *
+ * \return Un nuovo pool,
+ *         NULL se obj_size == 0 || block_len == 0 || non è stato possibile allocare la memoria.
+ */
+struct fsp_pool* fsp_pool_new(size_t obj_size, size_t block_len);
+
+/**
+ * \brief Libera pool dalla memoria assieme a tutti i suoi blocchi.
+ *        Gli oggetti ottenuti da pool non sono più validi dopo la chiamata.
+ */
+void fsp_pool_free(struct fsp_pool* pool);
+
+/**
+ * \brief Restituisce un oggetto (non inizializzato) preso da pool.
+ *        Se pool == NULL, alloca obj_size byte con malloc() (altrimenti obj_size viene ignorato).
+ *
+ * \return L'oggetto,
+ *         NULL se non è stato possibile allocare la memoria.
+ */
+void* fsp_pool_alloc(struct fsp_pool* pool, size_t obj_size);
+
+/**
+ * \brief Restituisce obj a pool affinché possa essere riutilizzato.
+ *        Se pool == NULL, libera obj con free().
+ */
+void fsp_pool_release(struct fsp_pool* pool, void* obj);
+
+/**
+ * \brief Restituisce un nuovo insieme di pool per oggetti di dimensione variabile.
+ *        La memoria viene allocata in blocchi da block_len oggetti.
+ *
+ * \return Un nuovo insieme di pool,
+ *         NULL se block_len == 0 || non è stato possibile allocare la memoria.
+ */
+struct fsp_pools* fsp_pools_new(size_t block_len);
+
+/**
+ * \brief Libera pools dalla memoria assieme a tutti i suoi pool.
+ */
+void fsp_pools_free(struct fsp_pools* pools);
+
+/**
+ * \brief Restituisce un oggetto (non inizializzato) di almeno size byte preso da pools.
+ *        Se pools == NULL || size > FSP_POOLS_OBJ_MAX_SIZE, alloca l'oggetto con malloc().
+ *
+ * \return L'oggetto,
+ *         NULL se non è stato possibile allocare la memoria.
+ */
+void* fsp_pools_alloc(struct fsp_pools* pools, size_t size);
+
+/**
+ * \brief Restituisce obj, allocato con fsp_pools_alloc(pools, size), a pools.
+ */
+void fsp_pools_release(struct fsp_pools* pools, void* obj, size_t size);
+
+#endif
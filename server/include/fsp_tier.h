@@ -0,0 +1,183 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+// Tier su disco per i contenuti dei file espulsi dalla memoria.
+// Struttura dati usata per mantenere sul server i file espulsi in seguito a capacity miss:
+// invece di essere restituito al client, il contenuto di un file viene affidato al tier
+// (fsp_tier_spill) e scritto in un file della directory del tier da un thread dedicato,
+// senza rallentare il thread che ha causato il capacity miss. Quando il file viene nuovamente
+// richiesto, il suo contenuto viene riportato in memoria (fsp_tier_promote).
+//
+// Ogni contenuto è identificato da una chiave (il file a cui appartiene) e viene memorizzato
+// così come si trova in memoria (eventualmente compresso) nel file <id>.tier della directory.
+// Finché non è stato scritto su disco, il contenuto rimane in memoria e può essere promosso
+// senza alcuna lettura; se la scrittura fallisce, allora il contenuto rimane in memoria.
+// Il numero di byte in attesa di essere scritti è limitato da FSP_TIER_MAX_PENDING_SIZE:
+// fsp_tier_spill non attende il thread di scrittura, ma rifiuta il contenuto (il chiamante può attendere
+// con fsp_tier_wait dopo aver rilasciato i propri lock).
+// Le letture da disco (fsp_tier_promote, fsp_tier_read) avvengono senza il mutex del tier:
+// un contenuto rimosso durante la lettura viene liberato al termine della lettura.
+//
+// Il contenuto del tier non sopravvive al riavvio del server: i file della directory vengono
+// rimossi all'apertura e alla chiusura del tier.
+// Un processo figlio creato con fork() può leggere i contenuti del tier (fsp_tier_forkOpen) così come si trovavano
+// al momento della fork() se questa viene eseguita tra fsp_tier_forkPrepare e fsp_tier_forkParent:
+// fino a fsp_tier_forkDone i file dei contenuti rimossi non vengono rimossi dal disco.
+// Le funzioni sono thread-safe.
+
+#ifndef FSP_TIER_H
+#define FSP_TIER_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+#include <fsp_blob.h>
+#include <fsp_arena.h>
+
+// Numero di bit dell'indice della tabella hash dei contenuti
+#define FSP_TIER_HASH_BITS 16
+// Numero massimo di byte in attesa di essere scritti su disco (64 MB)
+#define FSP_TIER_MAX_PENDING_SIZE 67108864
+
+struct fsp_tier {
+    // Directory in cui vengono scritti i contenuti
+    char* dir;
+    // Capacità massima del tier in byte
+    size_t max_size;
+    // Byte memorizzati nel tier (su disco o in attesa di essere scritti)
+    size_t size;
+    // Byte in attesa di essere scritti su disco
+    size_t pending_size;
+    // Numero dei contenuti memorizzati nel tier
+    unsigned long int entries_num;
+    // Identificativo del prossimo contenuto
+    unsigned long int next_id;
+    // Tabella hash dei contenuti (indicizzata per chiave)
+    struct fsp_tier_entry** table;
+    // Coda dei contenuti in attesa di essere scritti
+    struct fsp_tier_entry* queue_head;
+    struct fsp_tier_entry* queue_tail;
+    // Numero dei processi figli che condividono il tier (fsp_tier_forkPrepare)
+    unsigned int pins;
+    // Contenuti rimossi i cui file non possono ancora essere rimossi dal disco
+    struct fsp_tier_entry* deferred;
+    // Thread che scrive i contenuti su disco
+    pthread_t writer;
+    // Indica se il thread di scrittura deve terminare
+    int quit;
+    // Mutex per l'accesso al tier
+    pthread_mutex_t mutex;
+    // Variabili di condizione (nuovo contenuto da scrivere, contenuto scritto)
+    pthread_cond_t queue_isNotEmpty;
+    pthread_cond_t written;
+};
+
+/**
+ * \brief Restituisce un nuovo tier con capacità max_size byte che memorizza i contenuti nella directory dir
+ *        (creata se non esiste) e avvia il thread di scrittura. I file lasciati nella directory da un tier
+ *        precedente vengono rimossi.
+ *
+ * \return Il nuovo tier,
+ *         NULL se dir == NULL || non è stato possibile creare la directory, allocare la memoria o creare il thread.
+ */
+struct fsp_tier* fsp_tier_new(const char* dir, size_t max_size);
+
+/**
+ * \brief Termina il thread di scrittura, rimuove i file del tier dalla directory e libera tier dalla memoria
+ *        assieme ai contenuti che contiene.
+ */
+void fsp_tier_free(struct fsp_tier* tier);
+
+/**
+ * \brief Affida a tier il contenuto blob con chiave key: in caso di successo il tier diventa l'unico proprietario
+ *        di blob (che non deve essere condiviso né modificato) e lo scrive su disco in modo asincrono.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se tier == NULL || key == NULL || blob == NULL || il tier non ha spazio sufficiente ||
+ *               non è stato possibile allocare la memoria,
+ *         -2 se i byte in attesa di essere scritti supererebbero FSP_TIER_MAX_PENDING_SIZE
+ *         (in caso di errore blob rimane al chiamante).
+ */
+int fsp_tier_spill(struct fsp_tier* tier, const void* key, struct fsp_blob* blob);
+
+/**
+ * \brief Attende che il thread di scrittura di tier riduca i byte in attesa di essere scritti
+ *        alla metà di FSP_TIER_MAX_PENDING_SIZE.
+ */
+void fsp_tier_wait(struct fsp_tier* tier);
+
+/**
+ * \brief Rimuove da tier il contenuto con chiave key e lo restituisce (con un riferimento).
+ *        Se il contenuto deve essere letto da disco, allora viene allocato in arena (se arena != NULL).
+ *        Attende il termine della scrittura del contenuto se è in corso.
+ *
+ * \return Il contenuto,
+ *         NULL se tier == NULL || il contenuto non è presente || non è stato possibile leggerlo
+ *              (in tal caso rimane nel tier) || il contenuto è stato rimosso o promosso da un altro
+ *              thread durante la lettura.
+ */
+struct fsp_blob* fsp_tier_promote(struct fsp_tier* tier, const void* key, struct fsp_arena* arena);
+
+/**
+ * \brief Scrive in buf il contenuto (non compresso) di size byte con chiave key senza rimuoverlo da tier.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se tier == NULL || buf == NULL || il contenuto non è presente || la sua dimensione non è size ||
+ *               non è stato possibile leggerlo.
+ */
+int fsp_tier_read(struct fsp_tier* tier, const void* key, void* buf, size_t size);
+
+/**
+ * \brief Rimuove da tier (e dal disco) il contenuto con chiave key, se presente.
+ */
+void fsp_tier_remove(struct fsp_tier* tier, const void* key);
+
+// Contenuto del tier visto da un processo figlio (fsp_tier_forkOpen)
+struct fsp_tier_view {
+    // Contenuto in memoria (NULL se si trova solo su disco)
+    const struct fsp_blob* blob;
+    // Descrittore del file del contenuto su disco (-1 se blob != NULL)
+    int fd;
+    // Campi del contenuto (i dati memorizzati sono stored_size byte, compressi se compressed)
+    size_t size;
+    size_t stored_size;
+    unsigned int hash;
+    int compressed;
+};
+
+/**
+ * \brief Prepara tier per una fork(): acquisisce il mutex del tier (lo stato del tier non cambia fino a
+ *        fsp_tier_forkParent) e rimanda la rimozione dei file dal disco fino a fsp_tier_forkDone.
+ */
+void fsp_tier_forkPrepare(struct fsp_tier* tier);
+
+/**
+ * \brief Rilascia il mutex di tier nel processo padre dopo la fork().
+ */
+void fsp_tier_forkParent(struct fsp_tier* tier);
+
+/**
+ * \brief Reinizializza il mutex di tier nel processo figlio dopo la fork(): il processo figlio può
+ *        leggere i contenuti con fsp_tier_read ma non deve modificare il tier.
+ */
+void fsp_tier_forkChild(struct fsp_tier* tier);
+
+/**
+ * \brief Cerca in tier, nel processo figlio dopo fsp_tier_forkChild, il contenuto con chiave key e ne scrive
+ *        i campi in view, assieme al contenuto in memoria o al descrittore del suo file su disco aperto in lettura
+ *        (da chiudere con close()). Non alloca memoria e non usa il mutex di tier.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se tier == NULL || view == NULL || il contenuto non è presente || non è stato possibile aprire il file.
+ */
+int fsp_tier_forkOpen(struct fsp_tier* tier, const void* key, struct fsp_tier_view* view);
+
+/**
+ * \brief Indica a tier (nel processo padre) che il processo figlio ha terminato di leggerne i contenuti:
+ *        rimuove i file dei contenuti rimossi nel frattempo.
+ */
+void fsp_tier_forkDone(struct fsp_tier* tier);
+
+#endif
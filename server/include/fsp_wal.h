@@ -0,0 +1,259 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+// Log delle modifiche (write-ahead log) e snapshot dei file.
+// Struttura dati usata per rendere persistenti i file del server: ogni modifica (creazione,
+// scrittura, aggiunta in coda, cambio della scadenza e rimozione di un file) viene aggiunta al log come record e,
+// periodicamente, il server scrive uno snapshot di tutti i file. Al riavvio il server
+// ricostruisce i file dallo snapshot e dai record del log successivi (fsp_wal_load).
+//
+// I record vengono accumulati in memoria e scritti da un thread dedicato in gruppi (group commit):
+// i record aggiunti durante la scrittura di un gruppo formano il gruppo successivo, in modo che
+// più modifiche concorrenti condividano una sola scrittura (e una sola sincronizzazione).
+// Il livello di durabilità determina quando una modifica è persistente:
+// - FSP_WAL_DURABILITY_NONE: i record vengono scritti senza sincronizzazione (sopravvivono alla
+//   terminazione del server ma non a quella del sistema);
+// - FSP_WAL_DURABILITY_ASYNC: ogni gruppo viene sincronizzato (fdatasync) senza far attendere i client;
+// - FSP_WAL_DURABILITY_FSYNC: fsp_wal_commit attende la sincronizzazione del gruppo che contiene
+//   le modifiche già aggiunte al log.
+//
+// Il log è diviso in segmenti (file wal.<n> della directory del log): uno snapshot viene associato
+// al primo segmento che non contiene (fsp_wal_rotate) e, una volta scritto, i segmenti precedenti
+// vengono rimossi. Lo snapshot viene scritto a blocchi in un file temporaneo che sostituisce quello
+// precedente solo al termine della scrittura (fsp_wal_commitSnapshot). La scrittura può avvenire in un processo
+// figlio creato con fork() da un processo multithread: lo snapshot viene allocato dal processo padre prima
+// della fork() (fsp_wal_beginSnapshot) e liberato dal processo padre al termine (fsp_wal_endSnapshot),
+// le funzioni intermedie non allocano memoria e non usano stdio né i mutex di wal. Ogni record è protetto da un CRC-32: al caricamento i record successivi a un record
+// non valido (scrittura interrotta) dello stesso segmento vengono ignorati.
+// Le funzioni sono thread-safe.
+
+#ifndef FSP_WAL_H
+#define FSP_WAL_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+// Tipi dei record
+#define FSP_WAL_CREATE 1
+#define FSP_WAL_WRITE 2
+#define FSP_WAL_APPEND 3
+#define FSP_WAL_REMOVE 4
+#define FSP_WAL_EXPIRE 5
+
+// Livelli di durabilità
+#define FSP_WAL_DURABILITY_NONE 0
+#define FSP_WAL_DURABILITY_ASYNC 1
+#define FSP_WAL_DURABILITY_FSYNC 2
+
+// Dimensione dei blocchi in cui viene scritto uno snapshot (1 MB)
+#define FSP_WAL_SNAPSHOT_BLOCK_SIZE 1048576
+
+// Record del log (i puntatori si riferiscono al buffer da cui il record è stato letto)
+struct fsp_wal_record {
+    // Tipo del record
+    unsigned int type;
+    // Nome del file (terminato da '\0')
+    const char* pathname;
+    // Dimensione del contenuto (non compresso) del file (FSP_WAL_WRITE)
+    size_t size;
+    // Valore hash del contenuto del file (FSP_WAL_WRITE)
+    unsigned int hash;
+    // Indica se i dati sono compressi (FSP_WAL_WRITE)
+    unsigned char compressed;
+    // Dati del record (contenuto memorizzato del file per FSP_WAL_WRITE, dati aggiunti per FSP_WAL_APPEND,
+    // scadenza del file, unsigned int, per FSP_WAL_EXPIRE)
+    const void* data;
+    // Dimensione dei dati del record
+    size_t data_len;
+};
+
+struct fsp_wal {
+    // Directory del log
+    char* dir;
+    // Livello di durabilità
+    int durability;
+    // Descrittore del segmento corrente
+    int fd;
+    // Numero del segmento corrente
+    unsigned long int segment;
+    // Numero del primo segmento presente all'apertura del log
+    unsigned long int first_segment;
+    // Gruppo di record in fase di riempimento
+    void* buf;
+    size_t len;
+    size_t size;
+    // Gruppo di record in fase di scrittura
+    void* spare;
+    size_t spare_size;
+    // Byte aggiunti al log
+    unsigned long long int appended;
+    // Byte scritti (e sincronizzati, se richiesto dal livello di durabilità)
+    unsigned long long int written;
+    // Indica se il thread di scrittura sta scrivendo un gruppo
+    int writing;
+    // Indica se una scrittura o un'aggiunta è fallita
+    int error;
+    // Indica se il thread di scrittura deve terminare
+    int quit;
+    // Statistiche: record aggiunti e gruppi scritti
+    unsigned long int records;
+    unsigned long int batches;
+    // Thread che scrive i gruppi di record
+    pthread_t writer;
+    // Mutex per l'accesso al log
+    pthread_mutex_t mutex;
+    // Variabili di condizione (gruppo non vuoto, gruppo scritto)
+    pthread_cond_t batch_isNotEmpty;
+    pthread_cond_t batch_written;
+};
+
+// Snapshot in fase di scrittura
+struct fsp_wal_snapshot {
+    // Directory del log
+    const char* dir;
+    // Percorsi del file temporaneo e dello snapshot
+    char* tmp_path;
+    char* path;
+    // Descrittore del file temporaneo
+    int fd;
+    // Primo segmento non contenuto nello snapshot
+    unsigned long int segment;
+    // Record non ancora scritti nel file temporaneo
+    void* buf;
+    size_t len;
+    size_t size;
+    // Indica se la scrittura di un record è fallita
+    int error;
+};
+
+/**
+ * \brief Apre il log contenuto nella directory dir (creata se non esiste) con livello di durabilità durability:
+ *        crea un nuovo segmento (successivo a quelli presenti) e avvia il thread di scrittura.
+ *        I segmenti e lo snapshot già presenti possono essere letti con fsp_wal_load.
+ *
+ * \return Il log,
+ *         NULL se dir == NULL || durability non è valido || non è stato possibile creare la directory o il segmento,
+ *              allocare la memoria o creare il thread.
+ */
+struct fsp_wal* fsp_wal_open(const char* dir, int durability);
+
+/**
+ * \brief Scrive i record in sospeso, termina il thread di scrittura, chiude il log e lo libera dalla memoria.
+ */
+void fsp_wal_close(struct fsp_wal* wal);
+
+/**
+ * \brief Legge lo snapshot e i segmenti presenti all'apertura di wal e salva in *buf (allocato con malloc())
+ *        i record validi (prima quelli dello snapshot, poi quelli dei segmenti successivi) e in *len la loro lunghezza.
+ *
+ * \return 0 in caso di successo (*buf == NULL se non ci sono record),
+ *         -1 se wal == NULL || buf == NULL || len == NULL || non è stato possibile leggere i file o allocare la memoria.
+ */
+int fsp_wal_load(struct fsp_wal* wal, void** buf, size_t* len);
+
+/**
+ * \brief Scrive in *buf (di dimensione *size, allocato o riallocato se necessario) a partire da offset un record
+ *        con i valori degli argomenti (file_size, hash e compressed vengono ignorati se type != FSP_WAL_WRITE).
+ *
+ * \return Il numero di byte scritti,
+ *         -1 se buf == NULL || size == NULL || pathname == NULL || (data_len > 0 && data == NULL),
+ *         -2 se non è stato possibile riallocare *buf.
+ */
+long int fsp_wal_makeRecord(void** buf, size_t* size, size_t offset, unsigned int type, const char* pathname,
+                            size_t file_size, unsigned int hash, int compressed, const void* data, size_t data_len);
+
+/**
+ * \brief Legge da buf (di len byte) un record e lo salva in *record.
+ *
+ * \return La lunghezza del record,
+ *         0 se buf non contiene un record completo e valido.
+ */
+size_t fsp_wal_parseRecord(const void* buf, size_t len, struct fsp_wal_record* record);
+
+/**
+ * \brief Aggiunge a wal un record con i valori degli argomenti (come fsp_wal_makeRecord).
+ *        Il record viene scritto dal thread di scrittura.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se wal == NULL || gli argomenti non sono validi || non è stato possibile allocare la memoria.
+ */
+int fsp_wal_append(struct fsp_wal* wal, unsigned int type, const char* pathname,
+                   size_t file_size, unsigned int hash, int compressed, const void* data, size_t data_len);
+
+/**
+ * \brief Se il livello di durabilità è FSP_WAL_DURABILITY_FSYNC, attende che i record aggiunti a wal
+ *        prima della chiamata siano stati scritti e sincronizzati.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se wal == NULL || la scrittura di un record è fallita.
+ */
+int fsp_wal_commit(struct fsp_wal* wal);
+
+/**
+ * \brief Scrive i record in sospeso e passa a un nuovo segmento: i record aggiunti dopo la chiamata
+ *        vengono scritti nel nuovo segmento, il cui numero viene salvato in *segment.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se wal == NULL || segment == NULL || non è stato possibile creare il nuovo segmento.
+ */
+int fsp_wal_rotate(struct fsp_wal* wal, unsigned long int* segment);
+
+/**
+ * \brief Inizia la scrittura di uno snapshot di wal associato al segmento segment (ottenuto da fsp_wal_rotate):
+ *        alloca lo snapshot e crea il file temporaneo. I record vengono aggiunti con fsp_wal_addToSnapshot
+ *        e fsp_wal_addFileToSnapshot, lo snapshot sostituisce quello precedente solo con fsp_wal_commitSnapshot
+ *        e deve essere liberato con fsp_wal_endSnapshot.
+ *        Deve essere chiamata prima della fork() se lo snapshot viene scritto da un processo figlio.
+ *
+ * \return Lo snapshot in fase di scrittura,
+ *         NULL se wal == NULL || non è stato possibile creare il file temporaneo o allocare la memoria.
+ */
+struct fsp_wal_snapshot* fsp_wal_beginSnapshot(struct fsp_wal* wal, unsigned long int segment);
+
+/**
+ * \brief Aggiunge a snapshot un record di tipo type (FSP_WAL_WRITE o FSP_WAL_EXPIRE) con i valori degli argomenti
+ *        (come fsp_wal_makeRecord). Un record più grande del buffer dello snapshot viene scritto direttamente.
+ *        Non alloca memoria.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se snapshot == NULL || gli argomenti non sono validi || non è stato possibile scrivere il record.
+ */
+int fsp_wal_addToSnapshot(struct fsp_wal_snapshot* snapshot, unsigned int type, const char* pathname,
+                          size_t file_size, unsigned int hash, int compressed, const void* data, size_t data_len);
+
+/**
+ * \brief Aggiunge a snapshot un record FSP_WAL_WRITE come fsp_wal_addToSnapshot, ma i data_len byte di dati
+ *        vengono letti dall'inizio del file con descrittore fd (due volte: per il CRC e per la scrittura)
+ *        attraverso il buffer dello snapshot. Non alloca memoria.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se snapshot == NULL || gli argomenti non sono validi || non è stato possibile leggere i dati
+ *               o scrivere il record.
+ */
+int fsp_wal_addFileToSnapshot(struct fsp_wal_snapshot* snapshot, const char* pathname, size_t file_size,
+                              unsigned int hash, int compressed, int fd, size_t data_len);
+
+/**
+ * \brief Termina la scrittura di snapshot: lo sincronizza su disco e lo sostituisce in modo atomico a quello
+ *        precedente (se non è stato possibile, allora rimuove il file temporaneo). Non alloca memoria.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se snapshot == NULL || non è stato possibile scrivere lo snapshot.
+ */
+int fsp_wal_commitSnapshot(struct fsp_wal_snapshot* snapshot);
+
+/**
+ * \brief Annulla la scrittura di snapshot: rimuove il file temporaneo (lo snapshot precedente rimane valido).
+ *        Non alloca memoria.
+ */
+void fsp_wal_abortSnapshot(struct fsp_wal_snapshot* snapshot);
+
+/**
+ * \brief Libera snapshot dalla memoria (nel processo che lo ha creato con fsp_wal_beginSnapshot) e, se committed,
+ *        rimuove i segmenti contenuti nello snapshot, altrimenti il file temporaneo (se presente).
+ */
+void fsp_wal_endSnapshot(struct fsp_wal_snapshot* snapshot, int committed);
+
+#endif
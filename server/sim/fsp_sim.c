@@ -0,0 +1,492 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+// Simulatore della cache dei file.
+// Legge uno o più file di log del server (LOG_FILE_NAME) e riesegue gli accessi ai file con le politiche
+// di rimpiazzamento (fsp_eviction) e le capacità indicate, stampando per ogni coppia la hit ratio
+// (accessi serviti dalla cache) e la byte hit ratio (byte letti serviti dalla cache): le curve al variare
+// della capacità permettono di scegliere STORAGE_MAX_SIZE ed EVICTION_POLICY senza provarli sul server.
+//
+// Vengono considerati solo i comandi terminati con successo:
+// - OPEN, OPENL e READ sono accessi al file (come nel sunto del server), READ ne aggiorna la dimensione;
+// - APPEND è un accesso al file e ne aumenta la dimensione;
+// - WRITE inserisce il file nella cache con la dimensione scritta (non è un accesso);
+// - REMOVE ed EXPIRED_FILE rimuovono il file.
+// Un file non presente nella cache al momento di un accesso (miss) viene inserito nella cache (come la
+// promozione dal tier su disco); se la cache supera la capacità, allora vengono espulse le vittime scelte
+// dalla politica. La dimensione dei file è quella non compressa; READN e le decisioni di rimpiazzamento del
+// server (REJECTED_FILE, SPILLED_FILE) non vengono considerate.
+//
+// Uso: ./fsp_sim [-p politica_1[,politica_2,...]] [-s capacità_1[,capacità_2,...]] [-n numero_file] file_di_log_1 [file_di_log_2 ...]
+// -p: politiche da simulare (nomi come in config.txt, tutte di default);
+// -s: capacità della cache in Mbytes (come STORAGE_MAX_SIZE, anche con decimali); di default vengono usate
+//     le percentuali SIM_DEF_CAPACITIES della somma delle dimensioni massime raggiunte dai file;
+// -n: numero massimo di file nella cache (come FILES_MAX_NUM, illimitato di default).
+// L'output (una riga per politica e capacità, una riga vuota tra due politiche) può essere usato direttamente da gnuplot.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#include <fsp_file.h>
+#include <fsp_files_hash_table.h>
+#include <fsp_eviction.h>
+#include <utils.h>
+
+// Dimensione della tabella hash dei nomi dei file (come nel server)
+#define SIM_HASH_TABLE_SIZE 49157
+// Lunghezza massima di una riga del file di log
+#define SIM_LINE_MAX_LEN 4096
+// Numero delle capacità di default e percentuali (in millesimi) della somma delle dimensioni dei file
+#define SIM_DEF_CAPACITIES_NUM 9
+#define SIM_DEF_CAPACITIES {10, 20, 50, 100, 200, 300, 500, 700, 1000}
+
+// Tipi di evento
+#define SIM_ACCESS 0
+#define SIM_APPEND 1
+#define SIM_WRITE 2
+#define SIM_REMOVE 3
+
+// Evento del log
+struct sim_event {
+    // Tipo di evento (SIM_*)
+    unsigned char type;
+    // Indica se bytes è la nuova dimensione del file (SIM_ACCESS)
+    unsigned char sized;
+    // Identificativo del file (indice nel vettore dei file)
+    unsigned int id;
+    // Byte letti, scritti o aggiunti
+    size_t bytes;
+};
+
+// Stato della lettura dei log
+struct sim_trace {
+    // Eventi (vettore)
+    struct sim_event* events;
+    size_t events_num;
+    size_t events_size;
+    // File (vettore, l'identificativo di un file è la sua posizione), tabella hash dei nomi
+    struct fsp_file** files;
+    unsigned int files_num;
+    size_t files_size;
+    struct fsp_files_hash_table* names;
+    // Dimensione massima raggiunta da ogni file (vettore di files_size elementi)
+    size_t* max_sizes;
+};
+
+// Risultato di una simulazione
+struct sim_result {
+    unsigned long int accesses;
+    unsigned long int hits;
+    unsigned long int accessed_bytes;
+    unsigned long int hit_bytes;
+    unsigned long int victims;
+};
+
+/**
+ * \brief Stampa il messaggio di utilizzo.
+ */
+static void printUsage(void);
+
+/**
+ * \brief Legge il file di log filename e aggiunge i suoi eventi a trace.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se non è stato possibile aprire il file,
+ *         -2 se non è stato possibile allocare la memoria.
+ */
+static int readLog(struct sim_trace* trace, const char* filename);
+
+/**
+ * \brief Interpreta una riga del file di log e aggiunge a trace l'evento corrispondente (se presente).
+ *
+ * \return 0 in caso di successo,
+ *         -1 se non è stato possibile allocare la memoria.
+ */
+static int parseLine(struct sim_trace* trace, char* line);
+
+/**
+ * \brief Restituisce l'identificativo del file con nome pathname, aggiungendo il file a trace se non è presente.
+ *
+ * \return L'identificativo del file,
+ *         -1 se non è stato possibile allocare la memoria.
+ */
+static long int fileId(struct sim_trace* trace, const char* pathname);
+
+/**
+ * \brief Aggiunge a trace l'evento type sul file id con bytes byte e aggiorna la dimensione massima del file.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se non è stato possibile allocare la memoria.
+ */
+static int addEvent(struct sim_trace* trace, unsigned char type, unsigned char sized, long int id, size_t bytes);
+
+/**
+ * \brief Riesegue gli eventi di trace con la politica policy, la capacità capacity (in byte) e al più
+ *        files_max file nella cache (0 se illimitato) e salva il risultato in result.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se non è stato possibile allocare la memoria.
+ */
+static int simulate(const struct sim_trace* trace, int policy, size_t capacity, unsigned int files_max, struct sim_result* result);
+
+/**
+ * \brief Libera trace dalla memoria.
+ */
+static void freeTrace(struct sim_trace* trace);
+
+int main(int argc, char* argv[]) {
+    // Politiche da simulare
+    int policies[FSP_EVICTION_POLICIES_NUM];
+    int policies_num = 0;
+    // Capacità in byte (di default calcolate dopo la lettura dei log)
+    size_t* capacities = NULL;
+    int capacities_num = 0;
+    long int files_max = 0;
+    char* token = NULL;
+    int c;
+
+    while((c = getopt(argc, argv, ":p:s:n:h")) != -1) {
+        switch(c) {
+            case 'p':
+                for(token = strtok(optarg, ","); token != NULL; token = strtok(NULL, ",")) {
+                    int policy = fsp_eviction_parsePolicy(token);
+                    if(policy < 0) {
+                        fprintf(stderr, "Errore: politica di rimpiazzamento %s non riconosciuta.\n", token);
+                        free(capacities);
+                        return -1;
+                    }
+                    if(policies_num < FSP_EVICTION_POLICIES_NUM) policies[policies_num++] = policy;
+                }
+                break;
+            case 's':
+                for(token = strtok(optarg, ","); token != NULL; token = strtok(NULL, ",")) {
+                    char* end = NULL;
+                    double mbytes = strtod(token, &end);
+                    if(end == token || *end != '\0' || mbytes <= 0) {
+                        fprintf(stderr, "Errore: capacità %s non valida.\n", token);
+                        free(capacities);
+                        return -1;
+                    }
+                    size_t* capacities_tmp = NULL;
+                    if((capacities_tmp = realloc(capacities, sizeof(size_t)*(capacities_num + 1))) == NULL) {
+                        fprintf(stderr, "Errore: memoria insufficiente.\n");
+                        free(capacities);
+                        return -1;
+                    }
+                    capacities = capacities_tmp;
+                    capacities[capacities_num++] = (size_t) (mbytes*1048576);
+                }
+                break;
+            case 'n':
+                if(!isNumber(optarg, &files_max) || files_max <= 0 || files_max > 100000000) {
+                    fprintf(stderr, "Errore: numero massimo di file %s non valido.\n", optarg);
+                    free(capacities);
+                    return -1;
+                }
+                break;
+            case 'h':
+                printUsage();
+                free(capacities);
+                return 0;
+            case ':':
+                fprintf(stderr, "Errore: manca l'argomento per l'opzione -%c.\n", optopt);
+                free(capacities);
+                return -1;
+            default:
+                fprintf(stderr, "Errore: opzione -%c non riconosciuta.\n", optopt);
+                free(capacities);
+                return -1;
+        }
+    }
+    if(optind >= argc) {
+        printUsage();
+        free(capacities);
+        return -1;
+    }
+    if(policies_num == 0) {
+        for(int i = 0; i < FSP_EVICTION_POLICIES_NUM; i++) policies[policies_num++] = i;
+    }
+
+    // Legge i file di log
+    struct sim_trace trace;
+    memset(&trace, 0, sizeof(trace));
+    if((trace.names = fsp_files_hash_table_new(SIM_HASH_TABLE_SIZE)) == NULL) {
+        fprintf(stderr, "Errore: memoria insufficiente.\n");
+        free(capacities);
+        return -1;
+    }
+    for(int i = optind; i < argc; i++) {
+        switch(readLog(&trace, argv[i])) {
+            case -1:
+                perror(argv[i]);
+                freeTrace(&trace);
+                free(capacities);
+                return -1;
+            case -2:
+                fprintf(stderr, "Errore: memoria insufficiente.\n");
+                freeTrace(&trace);
+                free(capacities);
+                return -1;
+            default:
+                break;
+        }
+    }
+
+    // Capacità di default
+    unsigned long int total_size = 0;
+    for(unsigned int i = 0; i < trace.files_num; i++) total_size += trace.max_sizes[i];
+    if(capacities_num == 0) {
+        const unsigned int permilles[SIM_DEF_CAPACITIES_NUM] = SIM_DEF_CAPACITIES;
+        if((capacities = malloc(sizeof(size_t)*SIM_DEF_CAPACITIES_NUM)) == NULL) {
+            fprintf(stderr, "Errore: memoria insufficiente.\n");
+            freeTrace(&trace);
+            return -1;
+        }
+        for(int i = 0; i < SIM_DEF_CAPACITIES_NUM; i++) capacities[i] = total_size/1000*permilles[i] + (total_size%1000)*permilles[i]/1000;
+        capacities_num = SIM_DEF_CAPACITIES_NUM;
+    }
+
+    printf("# Eventi: %lu, file: %u, somma delle dimensioni massime dei file: %lu bytes\n", trace.events_num, trace.files_num, total_size);
+    printf("# %-10s %14s %10s %15s %10s\n", "politica", "capacità(MB)", "hit(%)", "byte_hit(%)", "vittime");
+    for(int i = 0; i < policies_num; i++) {
+        if(i > 0) printf("\n");
+        for(int j = 0; j < capacities_num; j++) {
+            struct sim_result result;
+            if(simulate(&trace, policies[i], capacities[j], (unsigned int) files_max, &result) != 0) {
+                fprintf(stderr, "Errore: memoria insufficiente.\n");
+                freeTrace(&trace);
+                free(capacities);
+                return -1;
+            }
+            printf("%-12s %14.3f %10.2f %15.2f %10lu\n", fsp_eviction_name(policies[i]), (double) capacities[j]/1048576,
+                   result.accesses > 0 ? (double) result.hits*100/result.accesses : 0,
+                   result.accessed_bytes > 0 ? (double) result.hit_bytes*100/result.accessed_bytes : 0, result.victims);
+        }
+    }
+
+    freeTrace(&trace);
+    free(capacities);
+
+    return 0;
+}
+
+static void printUsage(void) {
+    printf("fsp_sim [-p politica_1[,politica_2,...]] [-s capacità_1[,capacità_2,...]] [-n numero_file] file_di_log_1 [file_di_log_2 ...]\n");
+    printf("\t-p: politiche di rimpiazzamento da simulare (tutte di default)\n");
+    printf("\t-s: capacità della cache in Mbytes (di default percentuali della dimensione dei file)\n");
+    printf("\t-n: numero massimo di file nella cache (illimitato di default)\n");
+}
+
+static int readLog(struct sim_trace* trace, const char* filename) {
+    FILE* log = NULL;
+    if((log = fopen(filename, "r")) == NULL) return -1;
+
+    char line[SIM_LINE_MAX_LEN];
+    while(fgets(line, SIM_LINE_MAX_LEN, log) != NULL) {
+        size_t len = strlen(line);
+        if(len > 0 && line[len-1] == '\n') line[len-1] = '\0';
+        if(parseLine(trace, line) != 0) {
+            fclose(log);
+            return -2;
+        }
+    }
+    fclose(log);
+
+    return 0;
+}
+
+static int parseLine(struct sim_trace* trace, char* line) {
+    int hours, minutes, seconds, thread_id, sfd, n = 0;
+
+    // Messaggi del server: "H:M:S MESSAGGIO: argomento"
+    if(sscanf(line, "%d:%d:%d EXPIRED_FILE: %n", &hours, &minutes, &seconds, &n) == 3 && n > 0) {
+        // Il nome è seguito dalla dimensione tra parentesi
+        char* size = strrchr(line + n, '(');
+        if(size == NULL || size == line + n) return 0;
+        *(size - 1) = '\0';
+        return addEvent(trace, SIM_REMOVE, 0, fileId(trace, line + n), 0);
+    }
+
+    // Comandi: "H:M:S thread_id: sfd COMANDO argomento ESITO"
+    char cmd[8];
+    n = 0;
+    if(sscanf(line, "%d:%d:%d %d: %d %7s %n", &hours, &minutes, &seconds, &thread_id, &sfd, cmd, &n) != 6 || n == 0) return 0;
+    char* arg = line + n;
+    // Solo i comandi terminati con successo
+    char* outcome = NULL;
+    for(char* s = arg; (s = strstr(s, " SUCCESS")) != NULL; s++) outcome = s;
+    if(outcome == NULL) return 0;
+    *outcome = '\0';
+    outcome += strlen(" SUCCESS");
+    size_t bytes = 0;
+    if(sscanf(outcome, " (%zu)", &bytes) != 1) bytes = 0;
+
+    // Rimuove il TTL che può seguire il nome del file ("argomento ttl")
+    int open = strncmp(cmd, "OPEN", 4) == 0;
+    if(open || strcmp(cmd, "WRITE") == 0) {
+        char* ttl = strrchr(arg, ' ');
+        if(ttl != NULL && ttl[1] != '\0') {
+            char* digit = ttl + 1;
+            while(isdigit((unsigned char) *digit)) digit++;
+            if(*digit == '\0') *ttl = '\0';
+        }
+    }
+
+    long int id = fileId(trace, arg);
+    if(id == -1) return -1;
+
+    if(open) {
+        // Solo l'apertura di un file esistente è un accesso
+        if(strcmp(cmd, "OPEN") == 0 || strcmp(cmd, "OPENL") == 0) return addEvent(trace, SIM_ACCESS, 0, id, 0);
+        return 0;
+    }
+    if(strcmp(cmd, "READ") == 0) return addEvent(trace, SIM_ACCESS, 1, id, bytes);
+    if(strcmp(cmd, "APPEND") == 0) return addEvent(trace, SIM_APPEND, 0, id, bytes);
+    if(strcmp(cmd, "WRITE") == 0) return addEvent(trace, SIM_WRITE, 1, id, bytes);
+    if(strcmp(cmd, "REMOVE") == 0) return addEvent(trace, SIM_REMOVE, 0, id, 0);
+
+    return 0;
+}
+
+static long int fileId(struct sim_trace* trace, const char* pathname) {
+    struct fsp_file* file = fsp_files_hash_table_search(trace->names, pathname);
+    // Il campo locked contiene l'identificativo del file
+    if(file != NULL) return file->locked;
+
+    if(trace->files_num == trace->files_size) {
+        size_t files_size = trace->files_size > 0 ? trace->files_size*2 : 1024;
+        struct fsp_file** files_tmp = NULL;
+        size_t* max_sizes_tmp = NULL;
+        if((files_tmp = realloc(trace->files, sizeof(struct fsp_file*)*files_size)) == NULL) return -1;
+        trace->files = files_tmp;
+        if((max_sizes_tmp = realloc(trace->max_sizes, sizeof(size_t)*files_size)) == NULL) return -1;
+        trace->max_sizes = max_sizes_tmp;
+        trace->files_size = files_size;
+    }
+    if((file = fsp_file_new(NULL, pathname, NULL, 0, 0, trace->files_num, 0)) == NULL) return -1;
+    if(fsp_files_hash_table_insert(trace->names, file) != 0) {
+        fsp_file_free(NULL, file);
+        return -1;
+    }
+    trace->files[trace->files_num] = file;
+    trace->max_sizes[trace->files_num] = 0;
+
+    return (trace->files_num)++;
+}
+
+static int addEvent(struct sim_trace* trace, unsigned char type, unsigned char sized, long int id, size_t bytes) {
+    if(id < 0) return -1;
+
+    if(trace->events_num == trace->events_size) {
+        size_t events_size = trace->events_size > 0 ? trace->events_size*2 : 4096;
+        struct sim_event* events_tmp = NULL;
+        if((events_tmp = realloc(trace->events, sizeof(struct sim_event)*events_size)) == NULL) return -1;
+        trace->events = events_tmp;
+        trace->events_size = events_size;
+    }
+    struct sim_event* event = &(trace->events[(trace->events_num)++]);
+    event->type = type;
+    event->sized = sized;
+    event->id = id;
+    event->bytes = bytes;
+
+    // La dimensione del file durante la lettura dei log (campo size) serve a stimare la dimensione massima
+    struct fsp_file* file = trace->files[id];
+    if(type == SIM_REMOVE) file->size = 0;
+    else if(sized) file->size = bytes;
+    else if(type == SIM_APPEND) file->size += bytes;
+    if(file->size > trace->max_sizes[id]) trace->max_sizes[id] = file->size;
+
+    return 0;
+}
+
+static int simulate(const struct sim_trace* trace, int policy, size_t capacity, unsigned int files_max, struct sim_result* result) {
+    memset(result, 0, sizeof(struct sim_result));
+
+    struct fsp_eviction* eviction = NULL;
+    size_t files_num_hint = files_max > 0 && files_max < trace->files_num ? files_max : trace->files_num;
+    if((eviction = fsp_eviction_new(policy, files_num_hint + 1)) == NULL) return -1;
+    // Il campo links indica se il file si trova nella cache
+    for(unsigned int i = 0; i < trace->files_num; i++) {
+        trace->files[i]->size = 0;
+        trace->files[i]->links = 0;
+    }
+    size_t used_size = 0;
+    unsigned int cached_num = 0;
+
+    for(size_t i = 0; i < trace->events_num; i++) {
+        const struct sim_event* event = &(trace->events[i]);
+        struct fsp_file* file = trace->files[event->id];
+        int cached = file->links;
+
+        // Nuova dimensione del file
+        size_t size = file->size;
+        if(event->sized) size = event->bytes;
+        else if(event->type == SIM_APPEND) size += event->bytes;
+
+        if(event->type == SIM_REMOVE) {
+            if(cached) {
+                fsp_eviction_remove(eviction, file);
+                used_size -= file->size;
+                cached_num--;
+                file->links = 0;
+            }
+            file->size = 0;
+            continue;
+        }
+
+        if(event->type != SIM_WRITE) {
+            // Accesso (i byte letti da APPEND sono quelli aggiunti)
+            size_t accessed_bytes = event->type == SIM_APPEND ? event->bytes : size;
+            result->accesses++;
+            result->accessed_bytes += accessed_bytes;
+            if(cached) {
+                result->hits++;
+                result->hit_bytes += accessed_bytes;
+            }
+        }
+
+        if(cached) {
+            used_size = used_size - file->size + size;
+            file->size = size;
+            fsp_eviction_access(eviction, file);
+        } else {
+            file->size = size;
+            if(fsp_eviction_insert(eviction, file) != 0) {
+                fsp_eviction_free(eviction);
+                return -1;
+            }
+            file->links = 1;
+            used_size += size;
+            cached_num++;
+        }
+
+        // Espelle le vittime (eventualmente il file appena inserito)
+        while((used_size > capacity || (files_max > 0 && cached_num > files_max)) && eviction->files_num > 0) {
+            struct fsp_file* victim = fsp_eviction_victim(eviction);
+            victim->links = 0;
+            used_size -= victim->size;
+            cached_num--;
+            result->victims++;
+        }
+    }
+
+    fsp_eviction_free(eviction);
+
+    return 0;
+}
+
+static void freeTrace(struct sim_trace* trace) {
+    for(unsigned int i = 0; i < trace->files_num; i++) fsp_file_free(NULL, trace->files[i]);
+    free(trace->files);
+    free(trace->max_sizes);
+    fsp_files_hash_table_free(trace->names);
+    free(trace->events);
+}
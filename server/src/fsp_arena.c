@@ -0,0 +1,337 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+#include <fsp_arena.h>
+
+// Identificativo del formato dell'arena
+#define FSP_ARENA_MAGIC "FSPARENA"
+#define FSP_ARENA_VERSION 2
+// Dimensione dell'intestazione dell'arena
+#define FSP_ARENA_HEADER_SIZE 64
+// Dimensione minima di un blocco (esclusa l'intestazione)
+#define FSP_ARENA_MIN_BLOCK 48
+
+struct fsp_arena_header {
+    // Identificativo del formato
+    char magic[8];
+    // Versione del formato
+    uint32_t version;
+    // Indica se l'arena è stata chiusa correttamente
+    uint32_t clean;
+    // Capacità dell'arena
+    uint64_t capacity;
+    // Offset della fine dell'ultimo blocco
+    uint64_t used;
+};
+
+struct fsp_arena_block {
+    // Tipo del blocco (FSP_ARENA_FREE se il blocco è libero)
+    uint32_t type;
+    // Classe di dimensione del blocco
+    uint32_t size_class;
+    // Offset del blocco libero successivo della stessa classe (solo per i blocchi liberi)
+    uint64_t next;
+};
+
+/**
+ * \brief Restituisce la classe di dimensione degli oggetti di size byte.
+ */
+static unsigned int classOf(size_t size);
+
+/**
+ * \brief Restituisce la dimensione degli oggetti della classe size_class.
+ */
+static size_t classSize(unsigned int size_class);
+
+/**
+ * \brief Restituisce il blocco all'offset offset.
+ */
+static struct fsp_arena_block* blockAt(const struct fsp_arena* arena, size_t offset);
+
+/**
+ * \brief Inizializza l'intestazione di arena (arena vuota).
+ */
+static void init(struct fsp_arena* arena);
+
+static unsigned int classOf(size_t size) {
+    if(size <= FSP_ARENA_MIN_BLOCK) return 0;
+
+    // size è compresa in (2^e, 2^(e+1)]
+    unsigned int e = 0;
+    while(((size - 1) >> (e + 1)) != 0) e++;
+    size_t step = ((size_t) 1) << (e - 2);
+    size_t len = (size + step - 1) & ~(step - 1);
+
+    return 1 + (e - 5)*4 + (len/step - 5);
+}
+
+static size_t classSize(unsigned int size_class) {
+    if(size_class == 0) return FSP_ARENA_MIN_BLOCK;
+
+    unsigned int c = size_class - 1;
+    unsigned int e = 5 + c/4;
+
+    return ((size_t) (5 + c%4)) << (e - 2);
+}
+
+static struct fsp_arena_block* blockAt(const struct fsp_arena* arena, size_t offset) {
+    return (struct fsp_arena_block*) ((char*) arena->header + offset);
+}
+
+static void init(struct fsp_arena* arena) {
+    memset(arena->header, 0, FSP_ARENA_HEADER_SIZE);
+    memcpy(arena->header->magic, FSP_ARENA_MAGIC, sizeof(arena->header->magic));
+    arena->header->version = FSP_ARENA_VERSION;
+    arena->header->capacity = arena->capacity;
+    arena->header->used = FSP_ARENA_HEADER_SIZE;
+}
+
+struct fsp_arena* fsp_arena_open(const char* path, size_t capacity, int* restored) {
+    if(path == NULL || restored == NULL) return NULL;
+
+    struct fsp_arena* arena = NULL;
+    if((arena = malloc(sizeof(struct fsp_arena))) == NULL) return NULL;
+    if((arena->fd = open(path, O_RDWR | O_CREAT, 0600)) == -1) {
+        free(arena);
+        return NULL;
+    }
+    // L'arena non può essere usata da più processi contemporaneamente
+    if(flock(arena->fd, LOCK_EX | LOCK_NB) == -1) {
+        close(arena->fd);
+        free(arena);
+        return NULL;
+    }
+
+    // Determina la capacità (non riduce quella di un'arena esistente)
+    struct stat info;
+    if(fstat(arena->fd, &info) == -1) {
+        close(arena->fd);
+        free(arena);
+        return NULL;
+    }
+    if(info.st_size > capacity) capacity = info.st_size;
+    capacity = (capacity + FSP_ARENA_ALIGNMENT - 1) & ~((size_t) FSP_ARENA_ALIGNMENT - 1);
+    if(capacity > info.st_size && ftruncate(arena->fd, capacity) == -1) {
+        close(arena->fd);
+        free(arena);
+        return NULL;
+    }
+
+    void* addr = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, arena->fd, 0);
+    if(addr == MAP_FAILED) {
+        close(arena->fd);
+        free(arena);
+        return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(addr, capacity, MADV_HUGEPAGE);
+#endif
+    arena->header = addr;
+    arena->capacity = capacity;
+    arena->detached = 0;
+    memset(arena->free_lists, 0, sizeof(arena->free_lists));
+    pthread_mutex_init(&(arena->mutex), NULL);
+
+    struct fsp_arena_header* header = arena->header;
+    *restored = info.st_size >= FSP_ARENA_HEADER_SIZE &&
+                memcmp(header->magic, FSP_ARENA_MAGIC, sizeof(header->magic)) == 0 &&
+                header->version == FSP_ARENA_VERSION && header->clean &&
+                header->used >= FSP_ARENA_HEADER_SIZE && header->used <= info.st_size &&
+                header->used % sizeof(uint64_t) == 0;
+
+    if(*restored) {
+        // Ricostruisce le liste dei blocchi liberi
+        size_t offset = FSP_ARENA_HEADER_SIZE;
+        while(offset < header->used) {
+            struct fsp_arena_block* block = blockAt(arena, offset);
+            if(block->size_class >= FSP_ARENA_CLASSES_NUM || block->size_class > classOf(header->used) ||
+               header->used - offset < sizeof(struct fsp_arena_block) + classSize(block->size_class)) {
+                // Intestazione non valida o blocco oltre la parte usata dell'arena (file troncato)
+                *restored = 0;
+                break;
+            }
+            if(block->type == FSP_ARENA_FREE) {
+                block->next = (arena->free_lists)[block->size_class];
+                (arena->free_lists)[block->size_class] = offset;
+            }
+            offset += sizeof(struct fsp_arena_block) + classSize(block->size_class);
+        }
+    }
+    if(!(*restored)) {
+        memset(arena->free_lists, 0, sizeof(arena->free_lists));
+        init(arena);
+    }
+    header->capacity = capacity;
+
+    // L'arena è in uso
+    header->clean = 0;
+
+    return arena;
+}
+
+struct fsp_arena* fsp_arena_new(size_t capacity, int flags) {
+    if(capacity == 0) return NULL;
+
+    struct fsp_arena* arena = NULL;
+    if((arena = malloc(sizeof(struct fsp_arena))) == NULL) return NULL;
+    capacity = (capacity + FSP_ARENA_ALIGNMENT - 1) & ~((size_t) FSP_ARENA_ALIGNMENT - 1);
+
+    void* addr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if(flags & FSP_ARENA_HUGETLB) {
+        // Richiede che siano state riservate huge page sufficienti (vm.nr_hugepages)
+        addr = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+#endif
+    if(addr == MAP_FAILED) {
+        // Mappa FSP_ARENA_ALIGNMENT byte in più per allineare l'arena alle huge page
+        char* raw = mmap(NULL, capacity + FSP_ARENA_ALIGNMENT, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(raw == MAP_FAILED) {
+            free(arena);
+            return NULL;
+        }
+        char* aligned = (char*) (((uintptr_t) raw + FSP_ARENA_ALIGNMENT - 1) & ~((uintptr_t) FSP_ARENA_ALIGNMENT - 1));
+        if(aligned > raw) munmap(raw, aligned - raw);
+        if(raw + FSP_ARENA_ALIGNMENT > aligned) munmap(aligned + capacity, raw + FSP_ARENA_ALIGNMENT - aligned);
+        addr = aligned;
+#ifdef MADV_HUGEPAGE
+        if(flags & (FSP_ARENA_THP | FSP_ARENA_HUGETLB)) madvise(addr, capacity, MADV_HUGEPAGE);
+#endif
+    }
+    if(flags & FSP_ARENA_PREFAULT) {
+        // Scrive un byte per pagina: i page fault avvengono ora e non durante le allocazioni
+        long int page_size = sysconf(_SC_PAGESIZE);
+        if(page_size <= 0) page_size = 4096;
+        for(size_t offset = 0; offset < capacity; offset += page_size) {
+            ((volatile char*) addr)[offset] = 0;
+        }
+    }
+
+    arena->fd = -1;
+    arena->header = addr;
+    arena->capacity = capacity;
+    arena->detached = 0;
+    memset(arena->free_lists, 0, sizeof(arena->free_lists));
+    pthread_mutex_init(&(arena->mutex), NULL);
+    init(arena);
+
+    return arena;
+}
+
+void fsp_arena_detach(struct fsp_arena* arena) {
+    if(arena == NULL) return;
+
+    pthread_mutex_lock(&(arena->mutex));
+    arena->detached = 1;
+    msync(arena->header, arena->header->used, MS_SYNC);
+    arena->header->clean = 1;
+    msync(arena->header, FSP_ARENA_HEADER_SIZE, MS_SYNC);
+    pthread_mutex_unlock(&(arena->mutex));
+}
+
+void fsp_arena_close(struct fsp_arena* arena) {
+    if(arena == NULL) return;
+
+    munmap(arena->header, arena->capacity);
+    if(arena->fd >= 0) close(arena->fd);
+    pthread_mutex_destroy(&(arena->mutex));
+    free(arena);
+}
+
+void* fsp_arena_alloc(struct fsp_arena* arena, size_t size, unsigned int type) {
+    if(arena == NULL || type == FSP_ARENA_FREE) return NULL;
+
+    unsigned int size_class = classOf(size);
+    if(size_class >= FSP_ARENA_CLASSES_NUM) return NULL;
+
+    pthread_mutex_lock(&(arena->mutex));
+    struct fsp_arena_block* block = NULL;
+    size_t offset = (arena->free_lists)[size_class];
+    if(offset != 0) {
+        // Riutilizza un blocco libero
+        block = blockAt(arena, offset);
+        (arena->free_lists)[size_class] = block->next;
+    } else {
+        // Nuovo blocco in coda all'arena
+        size_t len = sizeof(struct fsp_arena_block) + classSize(size_class);
+        offset = arena->header->used;
+        if(len > arena->capacity - offset) {
+            pthread_mutex_unlock(&(arena->mutex));
+            return NULL;
+        }
+        block = blockAt(arena, offset);
+        block->size_class = size_class;
+        arena->header->used += len;
+    }
+    block->type = type;
+    block->next = 0;
+    pthread_mutex_unlock(&(arena->mutex));
+
+    return block + 1;
+}
+
+void fsp_arena_free(struct fsp_arena* arena, void* obj) {
+    if(arena == NULL || obj == NULL) return;
+
+    pthread_mutex_lock(&(arena->mutex));
+    if(!arena->detached) {
+        struct fsp_arena_block* block = ((struct fsp_arena_block*) obj) - 1;
+        block->type = FSP_ARENA_FREE;
+        block->next = (arena->free_lists)[block->size_class];
+        (arena->free_lists)[block->size_class] = (char*) block - (char*) arena->header;
+    }
+    pthread_mutex_unlock(&(arena->mutex));
+}
+
+size_t fsp_arena_capacity(const struct fsp_arena* arena, const void* obj) {
+    if(arena == NULL || obj == NULL) return 0;
+
+    return classSize((((const struct fsp_arena_block*) obj) - 1)->size_class);
+}
+
+size_t fsp_arena_offset(const struct fsp_arena* arena, const void* obj) {
+    return (const char*) obj - (const char*) arena->header;
+}
+
+void* fsp_arena_pointer(const struct fsp_arena* arena, size_t offset, unsigned int type) {
+    if(arena == NULL || type == FSP_ARENA_FREE || offset % sizeof(uint64_t) != 0 ||
+       offset < FSP_ARENA_HEADER_SIZE + sizeof(struct fsp_arena_block) || offset >= arena->header->used) return NULL;
+
+    // L'intestazione del blocco deve indicare un oggetto del tipo atteso contenuto nella parte usata dell'arena
+    struct fsp_arena_block* block = blockAt(arena, offset - sizeof(struct fsp_arena_block));
+    if(block->type != type || block->size_class >= FSP_ARENA_CLASSES_NUM || block->size_class > classOf(arena->header->used) ||
+       classSize(block->size_class) > arena->header->used - offset) return NULL;
+
+    return block + 1;
+}
+
+unsigned long int fsp_arena_scan(struct fsp_arena* arena, unsigned int type, void (*f)(void*, void*), void* arg) {
+    if(arena == NULL || f == NULL) return 0;
+
+    unsigned long int n = 0;
+    size_t offset = FSP_ARENA_HEADER_SIZE;
+    while(offset < arena->header->used) {
+        struct fsp_arena_block* block = blockAt(arena, offset);
+        // La dimensione del blocco non cambia se f libera l'oggetto
+        offset += sizeof(struct fsp_arena_block) + classSize(block->size_class);
+        if(block->type == type && type != FSP_ARENA_FREE) {
+            f(block + 1, arg);
+            n++;
+        }
+    }
+
+    return n;
+}
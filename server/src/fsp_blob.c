@@ -0,0 +1,202 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <fsp_blob.h>
+#include <fsp_lz.h>
+
+// Valore iniziale della funzione hash
+#define FSP_BLOB_HASH_INIT 2166136261u
+
+/**
+ * \brief Funzione hash (FNV-1a a 32 bit) che aggiorna il valore hash h con i size byte di data.
+ *
+ * \return Il valore hash aggiornato.
+ */
+static unsigned int hash_function(unsigned int h, const void* data, size_t size);
+
+/**
+ * \brief Alloca un contenuto con spazio per size byte di dati in arena (con malloc() se arena == NULL
+ *        o se arena è piena) e inizializza i campi arena, hash_table_next, refs ed embedded.
+ *
+ * \return Il contenuto,
+ *         NULL se non è stato possibile allocare la memoria.
+ */
+static struct fsp_blob* blobAlloc(struct fsp_arena* arena, size_t size);
+
+/**
+ * \brief Libera la memoria di blob (indipendentemente dal numero dei riferimenti).
+ */
+static void blobFree(struct fsp_blob* blob);
+
+static unsigned int hash_function(unsigned int h, const void* data, size_t size) {
+    const unsigned char* p = data;
+    for(size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static struct fsp_blob* blobAlloc(struct fsp_arena* arena, size_t size) {
+    struct fsp_blob* blob = NULL;
+    if(arena != NULL && (blob = fsp_arena_alloc(arena, sizeof(struct fsp_blob) + size, FSP_BLOB_ARENA_TYPE)) != NULL) {
+        blob->arena = arena;
+    } else if((blob = malloc(sizeof(struct fsp_blob) + size)) != NULL) {
+        blob->arena = NULL;
+    } else {
+        return NULL;
+    }
+    blob->hash_table_next = NULL;
+    blob->refs = 1;
+    blob->embedded = 0;
+
+    return blob;
+}
+
+static void blobFree(struct fsp_blob* blob) {
+    blob->arena != NULL ? fsp_arena_free(blob->arena, blob) : free(blob);
+}
+
+struct fsp_blob* fsp_blob_new(struct fsp_arena* arena, const void* data, size_t size, int compress) {
+    if(data == NULL) return NULL;
+
+    struct fsp_blob* blob = NULL;
+    unsigned int hash = hash_function(FSP_BLOB_HASH_INIT, data, size);
+
+    if(compress && size >= FSP_BLOB_COMPRESSION_MIN_SIZE) {
+        // Comprime in un buffer temporaneo: se il risultato supera la dimensione massima
+        // consentita, allora la compressione non conviene
+        size_t cap = size - size/FSP_BLOB_MIN_SAVING;
+        void* buf = NULL;
+        if((buf = malloc(cap)) == NULL) return NULL;
+        long int stored_size = fsp_lz_compress(data, size, buf, cap);
+        if(stored_size >= 0) {
+            if((blob = blobAlloc(arena, stored_size)) == NULL) {
+                free(buf);
+                return NULL;
+            }
+            memcpy(blob->data, buf, stored_size);
+            free(buf);
+            blob->size = size;
+            blob->stored_size = stored_size;
+            blob->base_size = size;
+            blob->compressed = 1;
+            blob->hash = hash;
+            return blob;
+        }
+        free(buf);
+    }
+
+    if((blob = blobAlloc(arena, size)) == NULL) return NULL;
+    memcpy(blob->data, data, size);
+    blob->size = size;
+    blob->stored_size = size;
+    blob->base_size = size;
+    blob->compressed = 0;
+    blob->hash = hash;
+
+    return blob;
+}
+
+struct fsp_blob* fsp_blob_alloc(struct fsp_arena* arena, size_t size, size_t stored_size, int compressed, unsigned int hash) {
+    struct fsp_blob* blob = NULL;
+    if((blob = blobAlloc(arena, stored_size)) == NULL) return NULL;
+    blob->size = size;
+    blob->stored_size = stored_size;
+    blob->compressed = compressed;
+    blob->hash = hash;
+
+    return blob;
+}
+
+struct fsp_blob* fsp_blob_append(struct fsp_arena* arena, struct fsp_blob* blob, const void* data, size_t size, int compress) {
+    if(data == NULL) return NULL;
+    if(blob == NULL) return fsp_blob_new(arena, data, size, compress);
+
+    struct fsp_blob* _blob = NULL;
+    size_t new_size = blob->size + size;
+
+    if(!compress || new_size < FSP_BLOB_COMPRESSION_MIN_SIZE || new_size - blob->base_size < blob->base_size) {
+        // Aggiunge i dati in coda ai dati memorizzati (come letterali se il contenuto è compresso)
+        size_t max_size = blob->stored_size + (blob->compressed ? fsp_lz_appendBound(size) : size);
+        if(blob->refs > 1 || blob->embedded) {
+            // Il contenuto rimane invariato per gli altri riferimenti
+            if((_blob = blobAlloc(arena, max_size)) == NULL) return NULL;
+            memcpy(_blob->data, blob->data, blob->stored_size);
+        } else if(blob->arena == NULL) {
+            if((_blob = realloc(blob, sizeof(struct fsp_blob) + max_size)) == NULL) return NULL;
+            blob = NULL;
+        } else if(fsp_arena_capacity(blob->arena, blob) >= sizeof(struct fsp_blob) + max_size) {
+            // Il blocco dell'arena ha spazio sufficiente
+            _blob = blob;
+            blob = NULL;
+        } else {
+            if((_blob = blobAlloc(arena, max_size)) == NULL) return NULL;
+            memcpy(_blob->data, blob->data, blob->stored_size);
+        }
+        if(blob != NULL) {
+            _blob->size = blob->size;
+            _blob->stored_size = blob->stored_size;
+            _blob->base_size = blob->base_size;
+            _blob->compressed = blob->compressed;
+            _blob->hash = blob->hash;
+            fsp_blob_free(blob);
+        }
+        if(_blob->compressed) {
+            _blob->stored_size += fsp_lz_appendLiterals(data, size, _blob->data + _blob->stored_size, max_size - _blob->stored_size);
+        } else {
+            memcpy(_blob->data + _blob->stored_size, data, size);
+            _blob->stored_size += size;
+        }
+        _blob->size = new_size;
+        _blob->hash = hash_function(_blob->hash, data, size);
+        return _blob;
+    }
+
+    // Ricostruisce il contenuto e lo comprime nuovamente
+    void* buf = NULL;
+    if((buf = malloc(new_size)) == NULL) return NULL;
+    if(fsp_blob_read(blob, buf) != 0) {
+        free(buf);
+        return NULL;
+    }
+    memcpy((char*) buf + blob->size, data, size);
+    _blob = fsp_blob_new(arena, buf, new_size, compress);
+    free(buf);
+    if(_blob != NULL) fsp_blob_free(blob);
+
+    return _blob;
+}
+
+int fsp_blob_read(const struct fsp_blob* blob, void* buf) {
+    if(blob == NULL || buf == NULL) return -1;
+
+    if(!blob->compressed) {
+        memcpy(buf, blob->data, blob->size);
+        return 0;
+    }
+
+    if(fsp_lz_decompress(blob->data, blob->stored_size, buf, blob->size) != blob->size) return -1;
+
+    return 0;
+}
+
+int fsp_blob_equals(const struct fsp_blob* blob1, const struct fsp_blob* blob2) {
+    if(blob1 == blob2) return 1;
+    if(blob1 == NULL || blob2 == NULL) return 0;
+
+    return blob1->hash == blob2->hash && blob1->size == blob2->size &&
+           blob1->compressed == blob2->compressed && blob1->stored_size == blob2->stored_size &&
+           memcmp(blob1->data, blob2->data, blob1->stored_size) == 0;
+}
+
+void fsp_blob_free(struct fsp_blob* blob) {
+    if(blob == NULL) return;
+    // Un contenuto incorporato viene liberato insieme al file
+    if(--(blob->refs) == 0 && !blob->embedded) blobFree(blob);
+}
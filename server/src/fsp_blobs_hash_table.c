@@ -0,0 +1,69 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+#include <stdlib.h>
+
+#include <fsp_blobs_hash_table.h>
+
+struct fsp_blobs_hash_table* fsp_blobs_hash_table_new(size_t size) {
+    struct fsp_blobs_hash_table* hash_table = NULL;
+    if((hash_table = malloc(sizeof(struct fsp_blobs_hash_table))) == NULL) return NULL;
+    if((hash_table->table = malloc(sizeof(struct fsp_blob*)*size)) == NULL) {
+        free(hash_table);
+        return NULL;
+    }
+    
+    for(int i = 0; i < size; i++) {
+        (hash_table->table)[i] = NULL;
+    }
+    hash_table->size = size;
+    hash_table->blobs_num = 0;
+    
+    return hash_table;
+}
+
+void fsp_blobs_hash_table_free(struct fsp_blobs_hash_table* hash_table) {
+    if(hash_table == NULL) return;
+    if(hash_table->table != NULL) free(hash_table->table);
+    free(hash_table);
+}
+
+int fsp_blobs_hash_table_insert(struct fsp_blobs_hash_table* hash_table, struct fsp_blob* blob) {
+    if(hash_table == NULL || blob == NULL) return -1;
+    unsigned long int index = blob->hash%hash_table->size;
+    
+    blob->hash_table_next = (hash_table->table)[index];
+    (hash_table->table)[index] = blob;
+    (hash_table->blobs_num)++;
+    
+    return 0;
+}
+
+struct fsp_blob* fsp_blobs_hash_table_search(const struct fsp_blobs_hash_table* hash_table, const struct fsp_blob* blob) {
+    if(hash_table == NULL || blob == NULL) return NULL;
+    struct fsp_blob* _blob = (hash_table->table)[blob->hash%hash_table->size];
+    
+    while(_blob != NULL && (_blob == blob || !fsp_blob_equals(_blob, blob))) {
+        _blob = _blob->hash_table_next;
+    }
+    
+    return _blob;
+}
+
+struct fsp_blob* fsp_blobs_hash_table_delete(struct fsp_blobs_hash_table* hash_table, struct fsp_blob* blob) {
+    if(hash_table == NULL || blob == NULL) return NULL;
+    struct fsp_blob** _blob = &((hash_table->table)[blob->hash%hash_table->size]);
+    
+    while(*_blob != NULL && *_blob != blob) {
+        _blob = &((*_blob)->hash_table_next);
+    }
+    if(*_blob == NULL) return NULL;
+    
+    *_blob = blob->hash_table_next;
+    blob->hash_table_next = NULL;
+    (hash_table->blobs_num)--;
+    
+    return blob;
+}
@@ -6,6 +6,7 @@
 #include <stdlib.h>
 
 #include <fsp_client.h>
+#include <fsp_parser.h>
 
 struct fsp_client* fsp_client_new(int sfd, size_t buf_size) {
     struct fsp_client* client = NULL;
@@ -14,10 +15,22 @@ struct fsp_client* fsp_client_new(int sfd, size_t buf_size) {
         free(client);
         return NULL;
     }
+    if((client->openedFiles = fsp_files_set_new()) == NULL) {
+        free(client->buf);
+        free(client);
+        return NULL;
+    }
     
     client->sfd = sfd;
     client->size = buf_size;
-    client->openedFiles = NULL;
+    client->parts = NULL;
+    client->parts_num = 0;
+    client->parts_size = 0;
+    client->version = FSP_PARSER_V1;
+    client->req_id = 0;
+    client->deferred_num = 0;
+    client->completed = NULL;
+    client->completed_tail = NULL;
     client->next = NULL;
     
     return client;
@@ -26,5 +39,15 @@ struct fsp_client* fsp_client_new(int sfd, size_t buf_size) {
 void fsp_client_free(struct fsp_client* client) {
     if(client == NULL) return;
     if(client->buf != NULL) free(client->buf);
+    for(size_t i = 0; i < client->parts_num; i++) {
+        if(client->parts[i].buf != NULL) free(client->parts[i].buf);
+    }
+    if(client->parts != NULL) free(client->parts);
+    while(client->completed != NULL) {
+        struct fsp_client_deferred* next = client->completed->next;
+        free(client->completed);
+        client->completed = next;
+    }
+    fsp_files_set_free(client->openedFiles);
     free(client);
 }
@@ -0,0 +1,748 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include <fsp_eviction.h>
+
+// Dimensione minima dello heap, della tabella hash dei nomi delle liste fantasma e del count-min sketch
+#define HEAP_MIN_SIZE 64
+// Code usate da ARC
+#define T1 0
+#define T2 1
+// Liste fantasma
+#define B1 0
+#define B2 1
+// Code usate da TINYLFU
+#define WINDOW 0
+#define MAIN 1
+// Valore massimo dei contatori del count-min sketch (4 bit)
+#define SKETCH_MAX 15
+// Fattore di scala della priorità di GDSF (32 bit frazionari)
+#define GDSF_SCALE 4294967296.0
+
+static int queueInsert(struct fsp_eviction* eviction, struct fsp_file* file);
+static void queueRemove(struct fsp_eviction* eviction, struct fsp_file* file);
+static struct fsp_file* queueVictim(struct fsp_eviction* eviction);
+static void queueRestore(struct fsp_eviction* eviction, struct fsp_file* file);
+static int heapInsert(struct fsp_eviction* eviction, struct fsp_file* file);
+static void heapRemove(struct fsp_eviction* eviction, struct fsp_file* file);
+static struct fsp_file* heapVictim(struct fsp_eviction* eviction);
+static void heapRestore(struct fsp_eviction* eviction, struct fsp_file* file);
+static void fifoAccess(struct fsp_eviction* eviction, struct fsp_file* file);
+static void lruAccess(struct fsp_eviction* eviction, struct fsp_file* file);
+static int lfuInsert(struct fsp_eviction* eviction, struct fsp_file* file);
+static void lfuAccess(struct fsp_eviction* eviction, struct fsp_file* file);
+static void clockAccess(struct fsp_eviction* eviction, struct fsp_file* file);
+static struct fsp_file* clockVictim(struct fsp_eviction* eviction);
+static void clockRestore(struct fsp_eviction* eviction, struct fsp_file* file);
+static int arcInsert(struct fsp_eviction* eviction, struct fsp_file* file);
+static void arcAccess(struct fsp_eviction* eviction, struct fsp_file* file);
+static void arcRemove(struct fsp_eviction* eviction, struct fsp_file* file);
+static struct fsp_file* arcVictim(struct fsp_eviction* eviction);
+static void arcRestore(struct fsp_eviction* eviction, struct fsp_file* file);
+static int tinylfuInsert(struct fsp_eviction* eviction, struct fsp_file* file);
+static void tinylfuAccess(struct fsp_eviction* eviction, struct fsp_file* file);
+static void tinylfuRemove(struct fsp_eviction* eviction, struct fsp_file* file);
+static struct fsp_file* tinylfuVictim(struct fsp_eviction* eviction);
+static void tinylfuRestore(struct fsp_eviction* eviction, struct fsp_file* file);
+static int gdsfInsert(struct fsp_eviction* eviction, struct fsp_file* file);
+static void gdsfAccess(struct fsp_eviction* eviction, struct fsp_file* file);
+static struct fsp_file* gdsfVictim(struct fsp_eviction* eviction);
+
+/**
+ * \brief Restituisce 1 se file si trova nella coda di eviction indicata dalla sua chiave (ARC, TINYLFU), 0 altrimenti.
+ */
+static int queuesContain(const struct fsp_eviction* eviction, const struct fsp_file* file);
+
+/**
+ * \brief Ingrandisce heap (se necessario) in modo che possa contenere files_num file.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se non è stato possibile allocare la memoria.
+ */
+static int reserve(struct fsp_eviction_heap* heap, size_t files_num);
+
+/**
+ * \brief Aggiunge file a heap (che deve avere spazio sufficiente).
+ */
+static void push(struct fsp_eviction_heap* heap, struct fsp_file* file);
+
+/**
+ * \brief Rimuove file da heap (se presente).
+ */
+static void erase(struct fsp_eviction_heap* heap, struct fsp_file* file);
+
+/**
+ * \brief Restituisce 1 se file si trova in heap, 0 altrimenti.
+ */
+static int contains(const struct fsp_eviction_heap* heap, const struct fsp_file* file);
+
+/**
+ * \brief Sposta verso la radice di heap il file in posizione pos finché necessario.
+ */
+static void siftUp(struct fsp_eviction_heap* heap, size_t pos);
+
+/**
+ * \brief Sposta verso le foglie di heap il file in posizione pos finché necessario.
+ */
+static void siftDown(struct fsp_eviction_heap* heap, size_t pos);
+
+/**
+ * \brief Funzione hash (FNV-1a a 32 bit) che restituisce il valore hash di pathname.
+ */
+static unsigned int hash_function(const char* pathname);
+
+/**
+ * \brief Cerca nelle liste fantasma di eviction il nome pathname (con valore hash hash).
+ *
+ * \return Il nome trovato,
+ *         NULL se il nome non è presente.
+ */
+static struct fsp_eviction_ghost* ghostSearch(const struct fsp_eviction* eviction, unsigned int hash, const char* pathname);
+
+/**
+ * \brief Aggiunge il nome di file in fondo alla lista fantasma list di eviction.
+ *
+ * \return Il nome aggiunto,
+ *         NULL se non è stato possibile allocare la memoria (il nome non viene aggiunto).
+ */
+static struct fsp_eviction_ghost* ghostAdd(struct fsp_eviction* eviction, int list, const struct fsp_file* file);
+
+/**
+ * \brief Rimuove ghost dalle liste fantasma di eviction e lo libera dalla memoria.
+ */
+static void ghostRemove(struct fsp_eviction* eviction, struct fsp_eviction_ghost* ghost);
+
+/**
+ * \brief Rimuove da eviction i nomi meno recenti delle liste fantasma che superano i limiti di ARC.
+ */
+static void ghostsTrim(struct fsp_eviction* eviction);
+
+/**
+ * \brief Restituisce la dimensione della finestra di TINYLFU (1% della capacità, almeno un file).
+ */
+static size_t windowSize(const struct fsp_eviction* eviction);
+
+/**
+ * \brief Restituisce l'indice nel count-min sketch di eviction del contatore della riga row
+ *        per il valore hash hash.
+ */
+static size_t sketchIndex(const struct fsp_eviction* eviction, unsigned int hash, int row);
+
+/**
+ * \brief Incrementa nel count-min sketch di eviction la frequenza di file e, se necessario,
+ *        dimezza tutti i contatori.
+ */
+static void sketchIncrement(struct fsp_eviction* eviction, const struct fsp_file* file);
+
+/**
+ * \brief Restituisce la frequenza di file stimata dal count-min sketch di eviction.
+ */
+static unsigned int sketchEstimate(const struct fsp_eviction* eviction, const struct fsp_file* file);
+
+/**
+ * \brief Restituisce la priorità di file per la politica GDSF (o GDSF_BYTES) di eviction
+ *        (satura a ULONG_MAX).
+ */
+static unsigned long int gdsfPriority(const struct fsp_eviction* eviction, const struct fsp_file* file);
+
+// Politiche di rimpiazzamento (indicizzate per identificativo)
+static const struct fsp_eviction_policy policies[FSP_EVICTION_POLICIES_NUM] = {
+    {"FIFO", queueInsert, fifoAccess, queueRemove, queueVictim, queueRestore},
+    {"LRU", queueInsert, lruAccess, queueRemove, queueVictim, queueRestore},
+    {"LFU", lfuInsert, lfuAccess, heapRemove, heapVictim, heapRestore},
+    {"CLOCK", queueInsert, clockAccess, queueRemove, clockVictim, clockRestore},
+    {"ARC", arcInsert, arcAccess, arcRemove, arcVictim, arcRestore},
+    {"TINYLFU", tinylfuInsert, tinylfuAccess, tinylfuRemove, tinylfuVictim, tinylfuRestore},
+    {"GDSF", gdsfInsert, gdsfAccess, heapRemove, gdsfVictim, heapRestore},
+    {"GDSF_BYTES", gdsfInsert, gdsfAccess, heapRemove, gdsfVictim, heapRestore}
+};
+
+int fsp_eviction_parsePolicy(const char* name) {
+    if(name == NULL) return -1;
+    for(int i = 0; i < FSP_EVICTION_POLICIES_NUM; i++) {
+        if(strcmp(name, policies[i].name) == 0) return i;
+    }
+    return -1;
+}
+
+const char* fsp_eviction_name(int policy) {
+    if(policy < 0 || policy >= FSP_EVICTION_POLICIES_NUM) return NULL;
+    return policies[policy].name;
+}
+
+struct fsp_eviction* fsp_eviction_new(int policy, size_t files_num_hint) {
+    if(policy < 0 || policy >= FSP_EVICTION_POLICIES_NUM) return NULL;
+
+    struct fsp_eviction* eviction = NULL;
+    if((eviction = calloc(1, sizeof(struct fsp_eviction))) == NULL) return NULL;
+
+    eviction->policy = &policies[policy];
+    eviction->capacity = files_num_hint;
+
+    if(policy == FSP_EVICTION_LFU || policy == FSP_EVICTION_GDSF || policy == FSP_EVICTION_GDSF_BYTES) {
+        eviction->heap.size = files_num_hint > HEAP_MIN_SIZE ? files_num_hint : HEAP_MIN_SIZE;
+        if((eviction->heap.files = malloc(sizeof(struct fsp_file*)*eviction->heap.size)) == NULL) {
+            fsp_eviction_free(eviction);
+            return NULL;
+        }
+        return eviction;
+    }
+
+    for(int i = 0; i < (policy == FSP_EVICTION_ARC || policy == FSP_EVICTION_TINYLFU ? 2 : 1); i++) {
+        if((eviction->queues[i] = fsp_files_queue_new()) == NULL) {
+            fsp_eviction_free(eviction);
+            return NULL;
+        }
+    }
+    if(policy == FSP_EVICTION_ARC) {
+        // Le liste fantasma contengono al più 2c nomi
+        eviction->ghosts_table_size = HEAP_MIN_SIZE;
+        while(eviction->ghosts_table_size < 2*files_num_hint) eviction->ghosts_table_size *= 2;
+        if((eviction->ghosts_table = calloc(eviction->ghosts_table_size, sizeof(struct fsp_eviction_ghost*))) == NULL) {
+            fsp_eviction_free(eviction);
+            return NULL;
+        }
+    }
+    if(policy == FSP_EVICTION_TINYLFU) {
+        // Un contatore per riga per ogni file che la cache può contenere
+        eviction->sketch_width = HEAP_MIN_SIZE;
+        while(eviction->sketch_width < files_num_hint) eviction->sketch_width *= 2;
+        if((eviction->sketch = calloc(FSP_EVICTION_SKETCH_DEPTH*eviction->sketch_width, 1)) == NULL) {
+            fsp_eviction_free(eviction);
+            return NULL;
+        }
+    }
+
+    return eviction;
+}
+
+void fsp_eviction_free(struct fsp_eviction* eviction) {
+    if(eviction == NULL) return;
+    free(eviction->heap.files);
+    for(int i = 0; i < 2; i++) {
+        if(eviction->queues[i] != NULL) fsp_files_queue_free(eviction->queues[i]);
+        while(eviction->ghosts_head[i] != NULL) {
+            struct fsp_eviction_ghost* ghost = eviction->ghosts_head[i];
+            eviction->ghosts_head[i] = ghost->next;
+            free(ghost);
+        }
+    }
+    free(eviction->ghosts_table);
+    free(eviction->sketch);
+    free(eviction);
+}
+
+int fsp_eviction_insert(struct fsp_eviction* eviction, struct fsp_file* file) {
+    if(eviction == NULL || file == NULL) return -1;
+    return eviction->policy->insert(eviction, file);
+}
+
+void fsp_eviction_access(struct fsp_eviction* eviction, struct fsp_file* file) {
+    if(eviction == NULL || file == NULL) return;
+    eviction->policy->access(eviction, file);
+}
+
+void fsp_eviction_remove(struct fsp_eviction* eviction, struct fsp_file* file) {
+    if(eviction == NULL || file == NULL) return;
+    eviction->policy->remove(eviction, file);
+}
+
+struct fsp_file* fsp_eviction_victim(struct fsp_eviction* eviction) {
+    if(eviction == NULL || eviction->files_num == 0) return NULL;
+    eviction->victims++;
+    
+    // Stato da ripristinare se la vittima viene reinserita
+    eviction->undo.capacity = eviction->capacity;
+    eviction->undo.p = eviction->p;
+    eviction->undo.evicting = eviction->evicting;
+    eviction->undo.ghost = NULL;
+    eviction->undo.moved = NULL;
+    eviction->undo.rotated = 0;
+    eviction->undo.admitted = NULL;
+    eviction->undo.rejected = 0;
+    eviction->undo.inflation = eviction->inflation;
+    
+    return eviction->policy->victim(eviction);
+}
+
+void fsp_eviction_restore(struct fsp_eviction* eviction, struct fsp_file* file) {
+    if(eviction == NULL || file == NULL) return;
+    eviction->policy->restore(eviction, file);
+    
+    eviction->capacity = eviction->undo.capacity;
+    eviction->p = eviction->undo.p;
+    eviction->evicting = eviction->undo.evicting;
+    eviction->inflation = eviction->undo.inflation;
+    eviction->victims--;
+}
+
+static int queueInsert(struct fsp_eviction* eviction, struct fsp_file* file) {
+    file->eviction_key = 0;
+    fsp_files_queue_enqueue(eviction->queues[0], file);
+    eviction->files_num++;
+    return 0;
+}
+
+static void queueRemove(struct fsp_eviction* eviction, struct fsp_file* file) {
+    if(fsp_files_queue_remove(eviction->queues[0], file) != NULL) eviction->files_num--;
+}
+
+static struct fsp_file* queueVictim(struct fsp_eviction* eviction) {
+    eviction->files_num--;
+    return fsp_files_queue_dequeue(eviction->queues[0]);
+}
+
+static void queueRestore(struct fsp_eviction* eviction, struct fsp_file* file) {
+    // La vittima si trovava in testa alla coda
+    fsp_files_queue_push(eviction->queues[0], file);
+    eviction->files_num++;
+}
+
+static int heapInsert(struct fsp_eviction* eviction, struct fsp_file* file) {
+    if(reserve(&(eviction->heap), eviction->files_num + 1) != 0) return -1;
+    push(&(eviction->heap), file);
+    eviction->files_num++;
+    return 0;
+}
+
+static void heapRemove(struct fsp_eviction* eviction, struct fsp_file* file) {
+    if(!contains(&(eviction->heap), file)) return;
+    erase(&(eviction->heap), file);
+    eviction->files_num--;
+}
+
+static struct fsp_file* heapVictim(struct fsp_eviction* eviction) {
+    struct fsp_file* file = eviction->heap.files[0];
+    if(eviction->heap.files_num > 1) eviction->undo.moved = eviction->heap.files[eviction->heap.files_num - 1];
+    heapRemove(eviction, file);
+    return file;
+}
+
+static void heapRestore(struct fsp_eviction* eviction, struct fsp_file* file) {
+    // Annulla erase (lo spazio nello heap è già allocato): i file sul cammino dalla radice alla posizione
+    // del file spostato scendono di un livello e il file spostato torna in fondo: lo heap torna identico
+    // a prima della scelta (anche l'ordine dei file con la stessa chiave)
+    struct fsp_eviction_heap* heap = &(eviction->heap);
+    struct fsp_file* moved = eviction->undo.moved;
+    if(moved != NULL) {
+        size_t pos = moved->eviction_pos;
+        while(pos > 0) {
+            heap->files[pos] = heap->files[(pos - 1)/2];
+            heap->files[pos]->eviction_pos = pos;
+            pos = (pos - 1)/2;
+        }
+        heap->files[heap->files_num] = moved;
+        moved->eviction_pos = heap->files_num;
+    }
+    heap->files[0] = file;
+    file->eviction_pos = 0;
+    heap->files_num++;
+    eviction->files_num++;
+}
+
+static void fifoAccess(struct fsp_eviction* eviction, struct fsp_file* file) {
+    // L'ordine della coda non dipende dagli accessi
+}
+
+static void lruAccess(struct fsp_eviction* eviction, struct fsp_file* file) {
+    // Il file usato più recentemente si trova in fondo alla coda (se file non è presente non fa niente)
+    fsp_files_queue_moveToTail(eviction->queues[0], file);
+}
+
+static int lfuInsert(struct fsp_eviction* eviction, struct fsp_file* file) {
+    // L'inserimento conta come primo accesso
+    file->eviction_key = 1;
+    return heapInsert(eviction, file);
+}
+
+static void lfuAccess(struct fsp_eviction* eviction, struct fsp_file* file) {
+    if(!contains(&(eviction->heap), file)) return;
+    file->eviction_key++;
+    siftDown(&(eviction->heap), file->eviction_pos);
+}
+
+static void clockAccess(struct fsp_eviction* eviction, struct fsp_file* file) {
+    // Setta il bit di riferimento
+    file->eviction_key = 1;
+}
+
+static struct fsp_file* clockVictim(struct fsp_eviction* eviction) {
+    // Termina dopo al più un giro completo (i bit di riferimento vengono azzerati)
+    struct fsp_file* file = NULL;
+    while((file = fsp_files_queue_dequeue(eviction->queues[0]))->eviction_key) {
+        file->eviction_key = 0;
+        fsp_files_queue_enqueue(eviction->queues[0], file);
+        eviction->undo.rotated++;
+    }
+    eviction->files_num--;
+    return file;
+}
+
+static void clockRestore(struct fsp_eviction* eviction, struct fsp_file* file) {
+    // Riporta in testa (nell'ordine inverso) i file spostati in fondo alla coda e ne setta il bit di riferimento
+    // (se la scelta ha fatto un giro completo, allora anche la vittima riprende il proprio bit)
+    struct fsp_files_queue* queue = eviction->queues[0];
+    fsp_files_queue_push(queue, file);
+    for(size_t i = 0; i < eviction->undo.rotated; i++) {
+        struct fsp_file* rotated = fsp_files_queue_remove(queue, queue->tail);
+        rotated->eviction_key = 1;
+        fsp_files_queue_push(queue, rotated);
+    }
+    eviction->files_num++;
+}
+
+static int arcInsert(struct fsp_eviction* eviction, struct fsp_file* file) {
+    unsigned int hash = hash_function(file->pathname);
+    struct fsp_eviction_ghost* ghost = ghostSearch(eviction, hash, file->pathname);
+    int list = T1;
+    eviction->ghost_b2 = 0;
+    if(ghost != NULL) {
+        // Il file è stato espulso di recente: T1 (ghost->list == B1) o T2 (ghost->list == B2) avrebbe dovuto essere più grande
+        size_t b1 = eviction->ghosts_num[B1];
+        size_t b2 = eviction->ghosts_num[B2];
+        if(ghost->list == B1) {
+            size_t delta = b1 >= b2 ? 1 : b2/b1;
+            eviction->p = eviction->p + delta < eviction->capacity ? eviction->p + delta : eviction->capacity;
+        } else {
+            size_t delta = b2 >= b1 ? 1 : b1/b2;
+            eviction->p = eviction->p > delta ? eviction->p - delta : 0;
+            eviction->ghost_b2 = 1;
+        }
+        eviction->ghost_hits[ghost->list]++;
+        ghostRemove(eviction, ghost);
+        list = T2;
+    }
+
+    file->eviction_key = list;
+    fsp_files_queue_enqueue(eviction->queues[list], file);
+    eviction->files_num++;
+    eviction->evicting = 0;
+    ghostsTrim(eviction);
+
+    return 0;
+}
+
+static void arcAccess(struct fsp_eviction* eviction, struct fsp_file* file) {
+    if(!queuesContain(eviction, file)) return;
+    if(file->eviction_key == T1) {
+        // Secondo accesso: il file passa da T1 a T2
+        fsp_files_queue_remove(eviction->queues[T1], file);
+        file->eviction_key = T2;
+        fsp_files_queue_enqueue(eviction->queues[T2], file);
+    } else {
+        fsp_files_queue_moveToTail(eviction->queues[T2], file);
+    }
+}
+
+static void arcRemove(struct fsp_eviction* eviction, struct fsp_file* file) {
+    // Un file rimosso (non espulso) non viene ricordato nelle liste fantasma
+    if(!queuesContain(eviction, file)) return;
+    fsp_files_queue_remove(eviction->queues[file->eviction_key], file);
+    eviction->files_num--;
+}
+
+static struct fsp_file* arcVictim(struct fsp_eviction* eviction) {
+    // La capacità è il numero dei file presenti quando la cache si riempie (la cache contiene un file di troppo)
+    if(!eviction->evicting) {
+        eviction->capacity = eviction->files_num > 1 ? eviction->files_num - 1 : 1;
+        if(eviction->p > eviction->capacity) eviction->p = eviction->capacity;
+        eviction->evicting = 1;
+    }
+
+    size_t t1 = eviction->queues[T1]->files_num;
+    int list = T2;
+    if(t1 > 0 && (t1 > eviction->p || (eviction->ghost_b2 && t1 == eviction->p) || eviction->queues[T2]->files_num == 0)) list = T1;
+
+    struct fsp_file* file = fsp_files_queue_dequeue(eviction->queues[list]);
+    eviction->files_num--;
+    eviction->undo.ghost = ghostAdd(eviction, list == T1 ? B1 : B2, file);
+    ghostsTrim(eviction);
+
+    return file;
+}
+
+static void arcRestore(struct fsp_eviction* eviction, struct fsp_file* file) {
+    // Il nome della vittima non deve restare nelle liste fantasma (il reinserimento non è un ghost hit)
+    if(eviction->undo.ghost != NULL) ghostRemove(eviction, eviction->undo.ghost);
+    fsp_files_queue_push(eviction->queues[file->eviction_key], file);
+    eviction->files_num++;
+}
+
+static int tinylfuInsert(struct fsp_eviction* eviction, struct fsp_file* file) {
+    struct fsp_files_queue* window = eviction->queues[WINDOW];
+    struct fsp_files_queue* main = eviction->queues[MAIN];
+
+    sketchIncrement(eviction, file);
+    file->eviction_key = WINDOW;
+    fsp_files_queue_enqueue(window, file);
+    eviction->files_num++;
+    eviction->evicting = 0;
+
+    // Finché la parte principale non è piena i file vi passano dalla finestra senza confronti
+    size_t window_size = windowSize(eviction);
+    while(window->files_num > window_size && main->files_num + window_size < eviction->capacity) {
+        struct fsp_file* candidate = fsp_files_queue_dequeue(window);
+        candidate->eviction_key = MAIN;
+        fsp_files_queue_enqueue(main, candidate);
+    }
+
+    return 0;
+}
+
+static void tinylfuAccess(struct fsp_eviction* eviction, struct fsp_file* file) {
+    if(!queuesContain(eviction, file)) return;
+    sketchIncrement(eviction, file);
+    fsp_files_queue_moveToTail(eviction->queues[file->eviction_key], file);
+}
+
+static void tinylfuRemove(struct fsp_eviction* eviction, struct fsp_file* file) {
+    if(!queuesContain(eviction, file)) return;
+    fsp_files_queue_remove(eviction->queues[file->eviction_key], file);
+    eviction->files_num--;
+}
+
+static struct fsp_file* tinylfuVictim(struct fsp_eviction* eviction) {
+    // La capacità è il numero dei file presenti quando la cache si riempie (la cache contiene un file di troppo)
+    if(!eviction->evicting) {
+        eviction->capacity = eviction->files_num > 1 ? eviction->files_num - 1 : 1;
+        eviction->evicting = 1;
+    }
+
+    struct fsp_files_queue* window = eviction->queues[WINDOW];
+    struct fsp_files_queue* main = eviction->queues[MAIN];
+    struct fsp_file* file = NULL;
+    if(window->files_num > 0) {
+        // Il candidato lascia la finestra: viene ammesso nella parte principale solo se è usato più spesso della vittima
+        // (anche se la finestra non supera la propria dimensione: l'inserimento di un file grande può richiedere
+        // più vittime e nessuna deve evitare il confronto)
+        struct fsp_file* candidate = fsp_files_queue_dequeue(window);
+        file = candidate;
+        if(main->files_num > 0) {
+            struct fsp_file* victim = main->head;
+            if(sketchEstimate(eviction, candidate) > sketchEstimate(eviction, victim)) {
+                fsp_files_queue_remove(main, victim);
+                candidate->eviction_key = MAIN;
+                fsp_files_queue_enqueue(main, candidate);
+                file = victim;
+                eviction->undo.admitted = candidate;
+            } else {
+                eviction->rejections++;
+                eviction->undo.rejected = 1;
+            }
+        }
+    } else {
+        file = fsp_files_queue_dequeue(main);
+    }
+    eviction->files_num--;
+
+    return file;
+}
+
+static void tinylfuRestore(struct fsp_eviction* eviction, struct fsp_file* file) {
+    // Il candidato ammesso al posto della vittima torna in testa alla finestra (le frequenze non cambiano)
+    struct fsp_file* candidate = eviction->undo.admitted;
+    if(candidate != NULL) {
+        fsp_files_queue_remove(eviction->queues[MAIN], candidate);
+        candidate->eviction_key = WINDOW;
+        fsp_files_queue_push(eviction->queues[WINDOW], candidate);
+    }
+    if(eviction->undo.rejected) eviction->rejections--;
+    fsp_files_queue_push(eviction->queues[file->eviction_key], file);
+    eviction->files_num++;
+}
+
+static int gdsfInsert(struct fsp_eviction* eviction, struct fsp_file* file) {
+    // L'inserimento conta come primo accesso
+    file->eviction_count = 1;
+    file->eviction_key = gdsfPriority(eviction, file);
+    return heapInsert(eviction, file);
+}
+
+static void gdsfAccess(struct fsp_eviction* eviction, struct fsp_file* file) {
+    if(!contains(&(eviction->heap), file)) return;
+    file->eviction_count++;
+    // La dimensione del file può essere cambiata dall'ultimo accesso: la priorità può anche diminuire
+    file->eviction_key = gdsfPriority(eviction, file);
+    siftUp(&(eviction->heap), file->eviction_pos);
+    siftDown(&(eviction->heap), file->eviction_pos);
+}
+
+static struct fsp_file* gdsfVictim(struct fsp_eviction* eviction) {
+    struct fsp_file* file = eviction->heap.files[0];
+    // Le priorità dei file inseriti o usati d'ora in poi partono da quella della vittima
+    eviction->inflation = file->eviction_key;
+    return heapVictim(eviction);
+}
+
+static int queuesContain(const struct fsp_eviction* eviction, const struct fsp_file* file) {
+    return file->eviction_key < 2 && fsp_files_queue_contains(eviction->queues[file->eviction_key], file);
+}
+
+static int reserve(struct fsp_eviction_heap* heap, size_t files_num) {
+    if(files_num <= heap->size) return 0;
+
+    struct fsp_file** files = NULL;
+    if((files = realloc(heap->files, sizeof(struct fsp_file*)*heap->size*2)) == NULL) return -1;
+    heap->files = files;
+    heap->size *= 2;
+
+    return 0;
+}
+
+static void push(struct fsp_eviction_heap* heap, struct fsp_file* file) {
+    heap->files[heap->files_num] = file;
+    siftUp(heap, heap->files_num++);
+}
+
+static void erase(struct fsp_eviction_heap* heap, struct fsp_file* file) {
+    // Sostituisce il file con l'ultimo dello heap
+    size_t pos = file->eviction_pos;
+    struct fsp_file* last = heap->files[--(heap->files_num)];
+    if(last != file) {
+        heap->files[pos] = last;
+        siftUp(heap, pos);
+        siftDown(heap, last->eviction_pos);
+    }
+}
+
+static int contains(const struct fsp_eviction_heap* heap, const struct fsp_file* file) {
+    return file->eviction_pos < heap->files_num && heap->files[file->eviction_pos] == file;
+}
+
+static void siftUp(struct fsp_eviction_heap* heap, size_t pos) {
+    struct fsp_file** files = heap->files;
+    struct fsp_file* file = files[pos];
+    while(pos > 0 && files[(pos - 1)/2]->eviction_key > file->eviction_key) {
+        files[pos] = files[(pos - 1)/2];
+        files[pos]->eviction_pos = pos;
+        pos = (pos - 1)/2;
+    }
+    files[pos] = file;
+    file->eviction_pos = pos;
+}
+
+static void siftDown(struct fsp_eviction_heap* heap, size_t pos) {
+    struct fsp_file** files = heap->files;
+    struct fsp_file* file = files[pos];
+    size_t child;
+    while((child = 2*pos + 1) < heap->files_num) {
+        if(child + 1 < heap->files_num && files[child + 1]->eviction_key < files[child]->eviction_key) child++;
+        if(files[child]->eviction_key >= file->eviction_key) break;
+        files[pos] = files[child];
+        files[pos]->eviction_pos = pos;
+        pos = child;
+    }
+    files[pos] = file;
+    file->eviction_pos = pos;
+}
+
+static unsigned int hash_function(const char* pathname) {
+    unsigned int hash = 2166136261u;
+    while(*pathname != '\0') {
+        hash ^= (unsigned char) *pathname;
+        hash *= 16777619u;
+        pathname++;
+    }
+    return hash;
+}
+
+static struct fsp_eviction_ghost* ghostSearch(const struct fsp_eviction* eviction, unsigned int hash, const char* pathname) {
+    struct fsp_eviction_ghost* ghost = eviction->ghosts_table[hash & (eviction->ghosts_table_size - 1)];
+    while(ghost != NULL && (ghost->hash != hash || strcmp(ghost->pathname, pathname) != 0)) ghost = ghost->hash_table_next;
+    return ghost;
+}
+
+static struct fsp_eviction_ghost* ghostAdd(struct fsp_eviction* eviction, int list, const struct fsp_file* file) {
+    struct fsp_eviction_ghost* ghost = NULL;
+    if((ghost = malloc(sizeof(struct fsp_eviction_ghost) + file->pathname_len + 1)) == NULL) return NULL;
+    memcpy(ghost->pathname, file->pathname, file->pathname_len + 1);
+    ghost->hash = hash_function(file->pathname);
+    ghost->list = list;
+
+    size_t index = ghost->hash & (eviction->ghosts_table_size - 1);
+    ghost->hash_table_next = eviction->ghosts_table[index];
+    eviction->ghosts_table[index] = ghost;
+
+    ghost->next = NULL;
+    ghost->prev = eviction->ghosts_tail[list];
+    if(ghost->prev != NULL) ghost->prev->next = ghost;
+    else eviction->ghosts_head[list] = ghost;
+    eviction->ghosts_tail[list] = ghost;
+    eviction->ghosts_num[list]++;
+
+    return ghost;
+}
+
+static void ghostRemove(struct fsp_eviction* eviction, struct fsp_eviction_ghost* ghost) {
+    struct fsp_eviction_ghost** curr = &(eviction->ghosts_table[ghost->hash & (eviction->ghosts_table_size - 1)]);
+    while(*curr != ghost) curr = &((*curr)->hash_table_next);
+    *curr = ghost->hash_table_next;
+
+    if(ghost->prev != NULL) ghost->prev->next = ghost->next;
+    else eviction->ghosts_head[ghost->list] = ghost->next;
+    if(ghost->next != NULL) ghost->next->prev = ghost->prev;
+    else eviction->ghosts_tail[ghost->list] = ghost->prev;
+    eviction->ghosts_num[ghost->list]--;
+
+    if(eviction->undo.ghost == ghost) eviction->undo.ghost = NULL;
+    free(ghost);
+}
+
+static void ghostsTrim(struct fsp_eviction* eviction) {
+    size_t c = eviction->capacity;
+    while(eviction->ghosts_num[B1] > 0 && eviction->queues[T1]->files_num + eviction->ghosts_num[B1] > c) {
+        ghostRemove(eviction, eviction->ghosts_head[B1]);
+    }
+    while(eviction->ghosts_num[B2] > 0 && eviction->files_num + eviction->ghosts_num[B1] + eviction->ghosts_num[B2] > 2*c) {
+        ghostRemove(eviction, eviction->ghosts_head[B2]);
+    }
+}
+
+static size_t windowSize(const struct fsp_eviction* eviction) {
+    return eviction->capacity >= 100 ? eviction->capacity/100 : 1;
+}
+
+static size_t sketchIndex(const struct fsp_eviction* eviction, unsigned int hash, int row) {
+    // Doppio hashing: il secondo valore hash (dispari) è ottenuto rimescolando il primo
+    unsigned int hash2 = ((hash >> 16) | (hash << 16))*2654435761u | 1;
+    return row*eviction->sketch_width + ((hash + row*hash2) & (eviction->sketch_width - 1));
+}
+
+static void sketchIncrement(struct fsp_eviction* eviction, const struct fsp_file* file) {
+    unsigned int hash = hash_function(file->pathname);
+    for(int row = 0; row < FSP_EVICTION_SKETCH_DEPTH; row++) {
+        unsigned char* counter = &(eviction->sketch[sketchIndex(eviction, hash, row)]);
+        if(*counter < SKETCH_MAX) (*counter)++;
+    }
+
+    // Invecchiamento: le frequenze passate contano la metà
+    if(++(eviction->sketch_additions) >= 10*eviction->sketch_width) {
+        for(size_t i = 0; i < FSP_EVICTION_SKETCH_DEPTH*eviction->sketch_width; i++) eviction->sketch[i] >>= 1;
+        eviction->sketch_additions /= 2;
+    }
+}
+
+static unsigned int sketchEstimate(const struct fsp_eviction* eviction, const struct fsp_file* file) {
+    unsigned int hash = hash_function(file->pathname);
+    unsigned int estimate = SKETCH_MAX;
+    for(int row = 0; row < FSP_EVICTION_SKETCH_DEPTH; row++) {
+        unsigned char counter = eviction->sketch[sketchIndex(eviction, hash, row)];
+        if(counter < estimate) estimate = counter;
+    }
+    return estimate;
+}
+
+static unsigned long int gdsfPriority(const struct fsp_eviction* eviction, const struct fsp_file* file) {
+    // Spazio occupato in memoria (la dimensione del file se non ha un contenuto)
+    size_t size = file->data != NULL ? file->data->stored_size : file->size;
+    double cost = eviction->policy == &policies[FSP_EVICTION_GDSF_BYTES] ? (double) file->size : 1;
+    double value = file->eviction_count*cost/(size > 0 ? size : 1)*GDSF_SCALE;
+    if(value >= (double) (ULONG_MAX - eviction->inflation)) return ULONG_MAX;
+    return eviction->inflation + (unsigned long int) value;
+}
@@ -0,0 +1,84 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+#include <stdlib.h>
+
+#include <fsp_expiry.h>
+
+// Dimensione minima del vettore dei file
+#define FSP_EXPIRY_MIN_SIZE 16
+
+struct fsp_expiry* fsp_expiry_new(size_t files_num_hint) {
+    struct fsp_expiry* expiry = NULL;
+    if((expiry = malloc(sizeof(struct fsp_expiry))) == NULL) return NULL;
+    
+    expiry->size = files_num_hint < FSP_EXPIRY_MIN_SIZE ? FSP_EXPIRY_MIN_SIZE : files_num_hint;
+    if((expiry->files = malloc(expiry->size * sizeof(struct fsp_file*))) == NULL) {
+        free(expiry);
+        return NULL;
+    }
+    expiry->files_num = 0;
+    expiry->seed = 88172645463325252UL;
+    
+    return expiry;
+}
+
+void fsp_expiry_free(struct fsp_expiry* expiry) {
+    if(expiry == NULL) return;
+    
+    free(expiry->files);
+    free(expiry);
+}
+
+int fsp_expiry_insert(struct fsp_expiry* expiry, struct fsp_file* file) {
+    if(expiry == NULL || file == NULL) return -1;
+    if(fsp_expiry_contains(expiry, file)) return 0;
+    
+    if(expiry->files_num == expiry->size) {
+        struct fsp_file** files = NULL;
+        if((files = realloc(expiry->files, 2 * expiry->size * sizeof(struct fsp_file*))) == NULL) return -1;
+        expiry->files = files;
+        expiry->size *= 2;
+    }
+    
+    file->expiry_pos = expiry->files_num;
+    expiry->files[expiry->files_num++] = file;
+    
+    return 0;
+}
+
+void fsp_expiry_remove(struct fsp_expiry* expiry, struct fsp_file* file) {
+    if(!fsp_expiry_contains(expiry, file)) return;
+    
+    // Sposta l'ultimo file nella posizione del file rimosso
+    struct fsp_file* last = expiry->files[--expiry->files_num];
+    expiry->files[file->expiry_pos] = last;
+    last->expiry_pos = file->expiry_pos;
+    file->expiry_pos = 0;
+}
+
+int fsp_expiry_contains(const struct fsp_expiry* expiry, const struct fsp_file* file) {
+    if(expiry == NULL || file == NULL) return 0;
+    
+    return file->expiry_pos < expiry->files_num && expiry->files[file->expiry_pos] == file;
+}
+
+void fsp_expiry_replace(struct fsp_expiry* expiry, struct fsp_file* file, struct fsp_file* new_file) {
+    if(new_file == NULL || !fsp_expiry_contains(expiry, file)) return;
+    
+    new_file->expiry_pos = file->expiry_pos;
+    expiry->files[file->expiry_pos] = new_file;
+}
+
+struct fsp_file* fsp_expiry_sample(struct fsp_expiry* expiry) {
+    if(expiry == NULL || expiry->files_num == 0) return NULL;
+    
+    // xorshift64
+    expiry->seed ^= expiry->seed << 13;
+    expiry->seed ^= expiry->seed >> 7;
+    expiry->seed ^= expiry->seed << 17;
+    
+    return expiry->files[expiry->seed % expiry->files_num];
+}
@@ -8,33 +8,100 @@
 
 #include <fsp_file.h>
 
-struct fsp_file* fsp_file_new(const char* pathname, const void* data, size_t size, int links, int locked, int remove) {
+/**
+ * \brief Restituisce l'offset del contenuto incorporato nell'allocazione di un file
+ *        il cui nome è lungo pathname_len (allineato a 8 byte).
+ */
+static inline size_t embeddedOffset(size_t pathname_len);
+
+/**
+ * \brief Restituisce la dimensione dell'allocazione di file.
+ */
+static size_t fileSize(const struct fsp_file* file);
+
+static inline size_t embeddedOffset(size_t pathname_len) {
+    return (sizeof(struct fsp_file) + pathname_len + 1 + 7) & ~((size_t) 7);
+}
+
+static size_t fileSize(const struct fsp_file* file) {
+    if(!file->embedded) return sizeof(struct fsp_file) + file->pathname_len + 1;
+    
+    // L'intestazione del contenuto incorporato rimane valida anche dopo che il file ha cambiato contenuto
+    size_t offset = embeddedOffset(file->pathname_len);
+    const struct fsp_blob* blob = (const struct fsp_blob*) ((const char*) file + offset);
+    return offset + sizeof(struct fsp_blob) + blob->stored_size;
+}
+
+struct fsp_file* fsp_file_new(struct fsp_pools* pools, const char* pathname, const void* data, size_t size, int links, int locked, int remove) {
+    size_t pathname_len = pathname == NULL ? 0 : strlen(pathname);
+    if(pathname_len > FSP_FILE_PATHNAME_MAX_LEN) return NULL;
+    
     struct fsp_file* file = NULL;
-    if((file = malloc(sizeof(struct fsp_file))) == NULL) return NULL;
-    if(pathname != NULL && (file->pathname = calloc(strlen(pathname)+1, sizeof(char))) == NULL) {
-        free(file);
+    if((file = fsp_pools_alloc(pools, sizeof(struct fsp_file) + pathname_len + 1)) == NULL) return NULL;
+    if(data != NULL && (file->data = fsp_blob_new(NULL, data, size, 0)) == NULL) {
+        fsp_pools_release(pools, file, sizeof(struct fsp_file) + pathname_len + 1);
         return NULL;
     }
-    if(data != NULL && (file->data = malloc(size)) == NULL) {
-        free(file->pathname);
-        free(file);
-    }
     
-    pathname == NULL ? file->pathname = NULL : strcpy(file->pathname, pathname);
-    data == NULL ? file->data = NULL : memcpy(file->data, data, size);
+    if(pathname != NULL) memcpy(file->pathname, pathname, pathname_len);
+    (file->pathname)[pathname_len] = '\0';
+    file->pathname_len = pathname_len;
+    if(data == NULL) file->data = NULL;
     file->size = size;
+    file->hash = 0;
     file->links = links;
     file->locked = locked;
     file->remove = remove;
+    file->spilled = 0;
+    file->promoting = 0;
+    file->embedded = 0;
+    file->expires = 0;
+    file->expiry_pos = 0;
     file->hash_table_next = NULL;
+    file->queue_prev = NULL;
     file->queue_next = NULL;
+    file->eviction_key = 0;
+    file->eviction_pos = 0;
+    file->eviction_count = 0;
+    file->record = NULL;
     
     return file;
 }
 
-void fsp_file_free(struct fsp_file* file) {
+struct fsp_file* fsp_file_embed(struct fsp_pools* pools, const struct fsp_file* file, const struct fsp_blob* data) {
+    if(file == NULL || data == NULL || file->data != NULL || file->embedded || data->stored_size > FSP_FILE_EMBED_MAX_SIZE) return NULL;
+    
+    size_t offset = embeddedOffset(file->pathname_len);
+    struct fsp_file* _file = NULL;
+    if((_file = fsp_pools_alloc(pools, offset + sizeof(struct fsp_blob) + data->stored_size)) == NULL) return NULL;
+    
+    memcpy(_file, file, sizeof(struct fsp_file) + file->pathname_len + 1);
+    struct fsp_blob* blob = (struct fsp_blob*) ((char*) _file + offset);
+    memcpy(blob, data, sizeof(struct fsp_blob) + data->stored_size);
+    blob->hash_table_next = NULL;
+    blob->arena = NULL;
+    blob->refs = 1;
+    blob->embedded = 1;
+    
+    _file->data = blob;
+    _file->size = blob->size;
+    _file->embedded = 1;
+    _file->hash_table_next = NULL;
+    _file->queue_prev = NULL;
+    _file->queue_next = NULL;
+    
+    return _file;
+}
+
+size_t fsp_file_embeddedSize(const struct fsp_file* file) {
+    if(file == NULL || !file->embedded) return 0;
+    
+    const struct fsp_blob* blob = (const struct fsp_blob*) ((const char*) file + embeddedOffset(file->pathname_len));
+    return blob->stored_size;
+}
+
+void fsp_file_free(struct fsp_pools* pools, struct fsp_file* file) {
     if(file == NULL) return;
-    if(file->pathname != NULL) free(file->pathname);
-    if(file->data != NULL) free(file->data);
-    free(file);
+    fsp_blob_free(file->data);
+    fsp_pools_release(pools, file, fileSize(file));
 }
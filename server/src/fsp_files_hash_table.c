@@ -9,25 +9,35 @@
 #include <fsp_files_hash_table.h>
 
 /**
- * \brief Funzione hash che, data una chiave key, restituisce l'indice all'interno
- *        della tabella di dimensione size.
+ * \brief Funzione hash (FNV-1a a 32 bit) che restituisce il valore hash della chiave key.
+ *        L'indice all'interno della tabella di dimensione size è hash%size.
  *
- * \return L'indice all'interno della tabella.
+ * \return Il valore hash di key.
  */
-static inline unsigned long int hash_function(size_t size, const char* key);
+static inline unsigned int hash_function(const char* key);
 
-static inline unsigned long int hash_function(size_t size, const char* key) {
-    if(key == NULL || *key == '\0') return 0;
+/**
+ * \brief Confronta file con la chiave (hash, pathname).
+ *
+ * \return Un valore < 0, 0 o > 0 se file precede, coincide o segue la chiave nelle liste della tabella.
+ */
+static inline int compare(const struct fsp_file* file, unsigned int hash, const char* pathname);
+
+static inline unsigned int hash_function(const char* key) {
+    unsigned int hash = 2166136261u;
+    if(key == NULL) return hash;
     
-    unsigned long int index = *key;
-    unsigned long int pow = size;
-    key++;
     while(*key != '\0') {
-        index += (*key)*pow;
-        pow *= size;
+        hash ^= (unsigned char) *key;
+        hash *= 16777619u;
         key++;
     }
-    return index%size;
+    return hash;
+}
+
+static inline int compare(const struct fsp_file* file, unsigned int hash, const char* pathname) {
+    if(file->hash != hash) return file->hash < hash ? -1 : 1;
+    return strcmp(file->pathname, pathname);
 }
 
 struct fsp_files_hash_table* fsp_files_hash_table_new(size_t size) {
@@ -55,18 +65,19 @@ void fsp_files_hash_table_free(struct fsp_files_hash_table* hash_table) {
 
 int fsp_files_hash_table_insert(struct fsp_files_hash_table* hash_table, struct fsp_file* file) {
     if(hash_table == NULL || file == NULL) return -1;
-    unsigned long int index = hash_function(hash_table->size, file->pathname);
+    file->hash = hash_function(file->pathname);
+    unsigned long int index = file->hash%hash_table->size;
     struct fsp_file* _file = (hash_table->table)[index];
     
     int cmp;
-    if(_file == NULL || (cmp = strcmp(_file->pathname, file->pathname)) > 0) {
+    if(_file == NULL || (cmp = compare(_file, file->hash, file->pathname)) > 0) {
         (hash_table->table)[index] = file;
         file->hash_table_next = _file;
     } else if(cmp == 0) {
         return -2;
     } else {
         struct fsp_file* _file_prev = NULL;
-        while(_file != NULL && (cmp = strcmp(_file->pathname, file->pathname)) < 0) {
+        while(_file != NULL && (cmp = compare(_file, file->hash, file->pathname)) < 0) {
             _file_prev = _file;
             _file = _file->hash_table_next;
         }
@@ -88,11 +99,12 @@ int fsp_files_hash_table_insert(struct fsp_files_hash_table* hash_table, struct
 
 struct fsp_file* fsp_files_hash_table_search(const struct fsp_files_hash_table* hash_table, const char* pathname) {
     if(hash_table == NULL || pathname == NULL) return NULL;
-    unsigned long int index = hash_function(hash_table->size, pathname);
+    unsigned int hash = hash_function(pathname);
+    unsigned long int index = hash%hash_table->size;
     struct fsp_file* _file = (hash_table->table)[index];
     
     int cmp = -1;
-    while(_file != NULL && (cmp = strcmp(_file->pathname, pathname)) < 0) {
+    while(_file != NULL && (cmp = compare(_file, hash, pathname)) < 0) {
         _file = _file->hash_table_next;
     }
     if(_file == NULL || cmp != 0) return NULL;
@@ -102,12 +114,13 @@ struct fsp_file* fsp_files_hash_table_search(const struct fsp_files_hash_table*
 
 struct fsp_file* fsp_files_hash_table_delete(struct fsp_files_hash_table* hash_table, const char* pathname) {
     if(hash_table == NULL || pathname == NULL) return NULL;
-    unsigned long int index = hash_function(hash_table->size, pathname);
+    unsigned int hash = hash_function(pathname);
+    unsigned long int index = hash%hash_table->size;
     struct fsp_file* _file = (hash_table->table)[index];
     
     int cmp = -1;
     struct fsp_file* _file_prev = NULL;
-    while(_file != NULL && (cmp = strcmp(_file->pathname, pathname)) < 0) {
+    while(_file != NULL && (cmp = compare(_file, hash, pathname)) < 0) {
         _file_prev = _file;
         _file = _file->hash_table_next;
     }
@@ -0,0 +1,451 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <fsp_files_index.h>
+
+// Dimensione iniziale dei vettori dei figli e della pila usata durante la visita
+#define FSP_FILES_INDEX_CHILDREN_DEF_SIZE 4
+#define FSP_FILES_INDEX_STACK_DEF_SIZE 32
+
+// Elemento della pila usata durante la visita: nodo e indice del prossimo figlio da visitare
+struct fsp_files_index_frame {
+    const struct fsp_files_index_node* node;
+    unsigned int next;
+};
+
+struct fsp_files_index_stack {
+    struct fsp_files_index_frame* frames;
+    size_t num;
+    size_t size;
+};
+
+/**
+ * \brief Restituisce un nuovo nodo senza file e senza figli con etichetta label di lunghezza len.
+ *
+ * \return Il nuovo nodo,
+ *         NULL se non è stato possibile allocare la memoria.
+ */
+static struct fsp_files_index_node* newNode(const char* label, size_t len);
+
+/**
+ * \brief Libera node dalla memoria (non i figli).
+ */
+static void freeNode(struct fsp_files_index_node* node);
+
+/**
+ * \brief Cerca tra i figli di node quello la cui etichetta inizia con il carattere c.
+ *        Se pos != NULL, salva in *pos la posizione in cui il figlio è (o andrebbe) inserito.
+ *
+ * \return L'indice del figlio,
+ *         -1 se il figlio non è presente.
+ */
+static int findChild(const struct fsp_files_index_node* node, char c, unsigned int* pos);
+
+/**
+ * \brief Inserisce child tra i figli di node in posizione pos.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se non è stato possibile allocare la memoria.
+ */
+static int addChild(struct fsp_files_index_node* node, struct fsp_files_index_node* child, unsigned int pos);
+
+/**
+ * \brief Se il nodo *slot non ha un file e ha un solo figlio, allora lo unisce al figlio
+ *        (il figlio, con l'etichetta estesa, prende il suo posto in *slot).
+ */
+static void compress(struct fsp_files_index* index, struct fsp_files_index_node** slot);
+
+/**
+ * \brief Restituisce la lunghezza del prefisso comune alle sequenze a (di lunghezza a_len) e b (di lunghezza b_len).
+ */
+static size_t commonPrefix(const char* a, size_t a_len, const char* b, size_t b_len);
+
+/**
+ * \brief Aggiunge a stack il nodo node con indice del prossimo figlio next.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se non è stato possibile allocare la memoria.
+ */
+static int push(struct fsp_files_index_stack* stack, const struct fsp_files_index_node* node, unsigned int next);
+
+static struct fsp_files_index_node* newNode(const char* label, size_t len) {
+    struct fsp_files_index_node* node;
+    if((node = malloc(sizeof(struct fsp_files_index_node) + len)) == NULL) return NULL;
+    
+    node->file = NULL;
+    node->children = NULL;
+    node->children_num = 0;
+    node->children_size = 0;
+    node->label_len = (unsigned short int) len;
+    if(len > 0) memcpy(node->label, label, len);
+    
+    return node;
+}
+
+static void freeNode(struct fsp_files_index_node* node) {
+    free(node->children);
+    free(node);
+}
+
+static int findChild(const struct fsp_files_index_node* node, char c, unsigned int* pos) {
+    // Ricerca binaria (i caratteri vengono confrontati come unsigned char, come in strcmp)
+    unsigned char key = (unsigned char) c;
+    unsigned int low = 0;
+    unsigned int high = node->children_num;
+    while(low < high) {
+        unsigned int mid = (low + high)/2;
+        unsigned char first = (unsigned char) node->children[mid]->label[0];
+        if(first == key) {
+            if(pos != NULL) *pos = mid;
+            return (int) mid;
+        } else if(first < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if(pos != NULL) *pos = low;
+    return -1;
+}
+
+static int addChild(struct fsp_files_index_node* node, struct fsp_files_index_node* child, unsigned int pos) {
+    if(node->children_num == node->children_size) {
+        unsigned short int size = node->children_size == 0 ? FSP_FILES_INDEX_CHILDREN_DEF_SIZE : node->children_size*2;
+        struct fsp_files_index_node** children;
+        if((children = realloc(node->children, sizeof(struct fsp_files_index_node*)*size)) == NULL) return -1;
+        node->children = children;
+        node->children_size = size;
+    }
+    memmove(node->children + pos + 1, node->children + pos, sizeof(struct fsp_files_index_node*)*(node->children_num - pos));
+    node->children[pos] = child;
+    node->children_num++;
+    
+    return 0;
+}
+
+static void compress(struct fsp_files_index* index, struct fsp_files_index_node** slot) {
+    struct fsp_files_index_node* node = *slot;
+    if(node->file != NULL || node->children_num != 1) return;
+    
+    struct fsp_files_index_node* child = node->children[0];
+    struct fsp_files_index_node* merged;
+    if((merged = realloc(child, sizeof(struct fsp_files_index_node) + node->label_len + child->label_len)) == NULL) {
+        // L'indice rimane corretto anche senza unire i nodi
+        return;
+    }
+    memmove(merged->label + node->label_len, merged->label, merged->label_len);
+    memcpy(merged->label, node->label, node->label_len);
+    merged->label_len += node->label_len;
+    
+    *slot = merged;
+    freeNode(node);
+    index->nodes_num--;
+}
+
+static size_t commonPrefix(const char* a, size_t a_len, const char* b, size_t b_len) {
+    size_t len = a_len < b_len ? a_len : b_len;
+    size_t i = 0;
+    while(i < len && a[i] == b[i]) i++;
+    return i;
+}
+
+static int push(struct fsp_files_index_stack* stack, const struct fsp_files_index_node* node, unsigned int next) {
+    if(stack->num == stack->size) {
+        size_t size = stack->size == 0 ? FSP_FILES_INDEX_STACK_DEF_SIZE : stack->size*2;
+        struct fsp_files_index_frame* frames;
+        if((frames = realloc(stack->frames, sizeof(struct fsp_files_index_frame)*size)) == NULL) return -1;
+        stack->frames = frames;
+        stack->size = size;
+    }
+    stack->frames[stack->num].node = node;
+    stack->frames[stack->num].next = next;
+    stack->num++;
+    
+    return 0;
+}
+
+struct fsp_files_index* fsp_files_index_new() {
+    struct fsp_files_index* index;
+    if((index = malloc(sizeof(struct fsp_files_index))) == NULL) return NULL;
+    if((index->root = newNode(NULL, 0)) == NULL) {
+        free(index);
+        return NULL;
+    }
+    index->files_num = 0;
+    index->nodes_num = 1;
+    
+    return index;
+}
+
+void fsp_files_index_free(struct fsp_files_index* index) {
+    if(index == NULL) return;
+    
+    // Libera i nodi senza ricorsione: ogni nodo viene liberato dopo aver spostato i figli nella pila
+    struct fsp_files_index_node** stack = NULL;
+    size_t num = 0;
+    size_t size = 0;
+    struct fsp_files_index_node* node = index->root;
+    while(node != NULL) {
+        if(num + node->children_num > size) {
+            size_t new_size = size == 0 ? FSP_FILES_INDEX_STACK_DEF_SIZE : size;
+            while(new_size < num + node->children_num) new_size *= 2;
+            struct fsp_files_index_node** new_stack;
+            if((new_stack = realloc(stack, sizeof(struct fsp_files_index_node*)*new_size)) == NULL) {
+                // Memoria insufficiente: i nodi rimanenti non vengono liberati
+                break;
+            }
+            stack = new_stack;
+            size = new_size;
+        }
+        if(node->children_num > 0) {
+            memcpy(stack + num, node->children, sizeof(struct fsp_files_index_node*)*node->children_num);
+            num += node->children_num;
+        }
+        freeNode(node);
+        node = num > 0 ? stack[--num] : NULL;
+    }
+    free(stack);
+    free(index);
+}
+
+int fsp_files_index_insert(struct fsp_files_index* index, struct fsp_file* file) {
+    if(index == NULL || file == NULL) return -1;
+    
+    struct fsp_files_index_node* node = index->root;
+    const char* rest = file->pathname;
+    size_t rest_len = file->pathname_len;
+    
+    while(rest_len > 0) {
+        unsigned int pos;
+        int i = findChild(node, rest[0], &pos);
+        if(i < 0) {
+            // Nessun figlio condivide il prefisso: aggiunge una foglia con il resto del nome
+            struct fsp_files_index_node* leaf;
+            if((leaf = newNode(rest, rest_len)) == NULL) return -1;
+            if(addChild(node, leaf, pos) != 0) {
+                freeNode(leaf);
+                return -1;
+            }
+            leaf->file = file;
+            index->nodes_num++;
+            index->files_num++;
+            return 0;
+        }
+        
+        struct fsp_files_index_node* child = node->children[i];
+        size_t len = commonPrefix(child->label, child->label_len, rest, rest_len);
+        if(len < child->label_len) {
+            // Divide l'etichetta del figlio: il prefisso comune diventa un nuovo nodo intermedio
+            struct fsp_files_index_node* mid;
+            if((mid = newNode(child->label, len)) == NULL) return -1;
+            if(addChild(mid, child, 0) != 0) {
+                freeNode(mid);
+                return -1;
+            }
+            memmove(child->label, child->label + len, child->label_len - len);
+            child->label_len -= len;
+            node->children[i] = mid;
+            index->nodes_num++;
+            child = mid;
+        }
+        node = child;
+        rest += len;
+        rest_len -= len;
+    }
+    
+    if(node->file != NULL) return -2;
+    node->file = file;
+    index->files_num++;
+    
+    return 0;
+}
+
+struct fsp_file* fsp_files_index_delete(struct fsp_files_index* index, const char* pathname) {
+    if(index == NULL || pathname == NULL) return NULL;
+    
+    // Nodo del file, suo padre e padre del padre (con le rispettive posizioni)
+    struct fsp_files_index_node* node = index->root;
+    struct fsp_files_index_node* parent = NULL;
+    struct fsp_files_index_node* grandparent = NULL;
+    unsigned int node_pos = 0;
+    unsigned int parent_pos = 0;
+    
+    const char* rest = pathname;
+    size_t rest_len = strlen(pathname);
+    while(rest_len > 0) {
+        int i = findChild(node, rest[0], NULL);
+        if(i < 0) return NULL;
+        struct fsp_files_index_node* child = node->children[i];
+        if(child->label_len > rest_len || memcmp(child->label, rest, child->label_len) != 0) return NULL;
+        
+        grandparent = parent;
+        parent_pos = node_pos;
+        parent = node;
+        node_pos = (unsigned int) i;
+        node = child;
+        rest += child->label_len;
+        rest_len -= child->label_len;
+    }
+    
+    struct fsp_file* file = node->file;
+    if(file == NULL) return NULL;
+    node->file = NULL;
+    index->files_num--;
+    
+    if(parent == NULL) return file;
+    if(node->children_num == 0) {
+        // Rimuove la foglia e unisce il padre all'unico figlio rimasto (se possibile)
+        memmove(parent->children + node_pos, parent->children + node_pos + 1,
+                sizeof(struct fsp_files_index_node*)*(parent->children_num - node_pos - 1));
+        parent->children_num--;
+        freeNode(node);
+        index->nodes_num--;
+        if(grandparent != NULL) compress(index, &(grandparent->children[parent_pos]));
+    } else {
+        compress(index, &(parent->children[node_pos]));
+    }
+    
+    return file;
+}
+
+struct fsp_file* fsp_files_index_replace(struct fsp_files_index* index, struct fsp_file* file) {
+    if(index == NULL || file == NULL) return NULL;
+    
+    struct fsp_files_index_node* node = index->root;
+    const char* rest = file->pathname;
+    size_t rest_len = file->pathname_len;
+    while(rest_len > 0) {
+        int i = findChild(node, rest[0], NULL);
+        if(i < 0) return NULL;
+        struct fsp_files_index_node* child = node->children[i];
+        if(child->label_len > rest_len || memcmp(child->label, rest, child->label_len) != 0) return NULL;
+        node = child;
+        rest += child->label_len;
+        rest_len -= child->label_len;
+    }
+    
+    struct fsp_file* replaced = node->file;
+    if(replaced != NULL) node->file = file;
+    
+    return replaced;
+}
+
+int fsp_files_index_scan(const struct fsp_files_index* index, const char* prefix, const char* after,
+                         int (*visit) (struct fsp_file*, void*), void* arg) {
+    if(index == NULL || visit == NULL) return -1;
+    if(prefix == NULL) prefix = "";
+    
+    // Cerca il nodo node da cui inizia il sottoalbero dei nomi con prefisso prefix:
+    // il nome (chiave) del nodo è prefix seguito dagli ultimi tail_len caratteri dell'etichetta (tail)
+    const struct fsp_files_index_node* node = index->root;
+    size_t prefix_len = strlen(prefix);
+    const char* rest = prefix;
+    size_t rest_len = prefix_len;
+    const char* tail = NULL;
+    size_t tail_len = 0;
+    while(rest_len > 0) {
+        int i = findChild(node, rest[0], NULL);
+        if(i < 0) return 0;
+        node = node->children[i];
+        size_t len = commonPrefix(node->label, node->label_len, rest, rest_len);
+        if(len == rest_len) {
+            // Il prefisso termina nell'etichetta del nodo
+            tail = node->label + len;
+            tail_len = node->label_len - len;
+            break;
+        } else if(len < node->label_len) {
+            // Nessun nome inizia con prefix
+            return 0;
+        }
+        rest += len;
+        rest_len -= len;
+    }
+    
+    struct fsp_files_index_stack stack = {NULL, 0, 0};
+    int stop = 0;
+    int err = 0;
+    
+    if(after == NULL) {
+        // Visita l'intero sottoalbero
+        if(node->file != NULL) stop = visit(node->file, arg);
+        if(!stop && push(&stack, node, 0) != 0) return -1;
+    } else {
+        // Confronta la chiave del nodo con after
+        size_t after_len = strlen(after);
+        size_t key_len = prefix_len + tail_len;
+        size_t len = commonPrefix(prefix, prefix_len, after, after_len);
+        if(len == prefix_len) len += commonPrefix(tail, tail_len, after + prefix_len, after_len - prefix_len);
+        
+        if(len < key_len && len < after_len) {
+            unsigned char key_c = (unsigned char) (len < prefix_len ? prefix[len] : tail[len - prefix_len]);
+            if(key_c < (unsigned char) after[len]) {
+                // Tutti i nomi del sottoalbero precedono after
+                return 0;
+            }
+        }
+        
+        if(len < key_len) {
+            // Tutti i nomi del sottoalbero seguono after
+            if(node->file != NULL) stop = visit(node->file, arg);
+            if(!stop && push(&stack, node, 0) != 0) return -1;
+        } else {
+            // La chiave del nodo è un prefisso di after: scende lungo il cammino di after
+            // visitando in seguito solo i figli che seguono after
+            size_t pos = key_len;
+            while(1) {
+                unsigned int next;
+                if(pos == after_len) {
+                    if(push(&stack, node, 0) != 0) err = -1;
+                    break;
+                }
+                int i = findChild(node, after[pos], &next);
+                if(i < 0) {
+                    if(push(&stack, node, next) != 0) err = -1;
+                    break;
+                }
+                const struct fsp_files_index_node* child = node->children[i];
+                size_t label_len = commonPrefix(child->label, child->label_len, after + pos, after_len - pos);
+                if(label_len == child->label_len) {
+                    if(push(&stack, node, next + 1) != 0) {
+                        err = -1;
+                        break;
+                    }
+                    node = child;
+                    pos += label_len;
+                    continue;
+                }
+                if(label_len == after_len - pos || (unsigned char) child->label[label_len] > (unsigned char) after[pos + label_len]) {
+                    // Tutti i nomi del figlio seguono after
+                    if(push(&stack, node, next) != 0) err = -1;
+                } else if(push(&stack, node, next + 1) != 0) {
+                    err = -1;
+                }
+                break;
+            }
+        }
+    }
+    
+    // Visita in profondità (in ordine) i figli ancora da visitare
+    while(!err && !stop && stack.num > 0) {
+        struct fsp_files_index_frame* frame = &(stack.frames[stack.num - 1]);
+        if(frame->next >= frame->node->children_num) {
+            stack.num--;
+            continue;
+        }
+        const struct fsp_files_index_node* child = frame->node->children[frame->next];
+        frame->next++;
+        if(child->file != NULL && (stop = visit(child->file, arg)) != 0) break;
+        if(child->children_num > 0 && push(&stack, child, 0) != 0) {
+            err = -1;
+            break;
+        }
+    }
+    free(stack.frames);
+    
+    return err;
+}
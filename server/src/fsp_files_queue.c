@@ -4,7 +4,6 @@
  */
 
 #include <stdlib.h>
-#include <string.h>
 
 #include <fsp_files_queue.h>
 
@@ -14,6 +13,7 @@ struct fsp_files_queue* fsp_files_queue_new() {
     
     queue->head = NULL;
     queue->tail = NULL;
+    queue->files_num = 0;
     
     return queue;
 }
@@ -26,14 +26,31 @@ void fsp_files_queue_free(struct fsp_files_queue* queue) {
 int fsp_files_queue_enqueue(struct fsp_files_queue* queue, struct fsp_file* file) {
     if(queue == NULL || file == NULL) return -1;
     
+    file->queue_prev = queue->tail;
+    file->queue_next = NULL;
     if(queue->head == NULL) {
         queue->head = file;
-        queue->tail = file;
     } else {
         (queue->tail)->queue_next = file;
+    }
+    queue->tail = file;
+    queue->files_num++;
+    
+    return 0;
+}
+
+int fsp_files_queue_push(struct fsp_files_queue* queue, struct fsp_file* file) {
+    if(queue == NULL || file == NULL) return -1;
+    
+    file->queue_prev = NULL;
+    file->queue_next = queue->head;
+    if(queue->tail == NULL) {
         queue->tail = file;
+    } else {
+        (queue->head)->queue_prev = file;
     }
-    file->queue_next = NULL;
+    queue->head = file;
+    queue->files_num++;
     
     return 0;
 }
@@ -41,41 +58,38 @@ int fsp_files_queue_enqueue(struct fsp_files_queue* queue, struct fsp_file* file
 struct fsp_file* fsp_files_queue_dequeue(struct fsp_files_queue* queue) {
     if(queue == NULL || queue->head == NULL) return NULL;
     
-    struct fsp_file* _file = queue->head;
-    if(queue->head == queue->tail) {
-        queue->head = NULL;
-        queue->tail = NULL;
-    } else {
-        queue->head = (queue->head)->queue_next;
-    }
-    _file->queue_next = NULL;
+    return fsp_files_queue_remove(queue, queue->head);
+}
+
+int fsp_files_queue_contains(const struct fsp_files_queue* queue, const struct fsp_file* file) {
+    if(queue == NULL || file == NULL) return 0;
     
-    return _file;
+    // Solo la testa della coda non ha un file precedente
+    return file->queue_prev != NULL || queue->head == file;
 }
 
-struct fsp_file* fsp_files_queue_remove(struct fsp_files_queue* queue, const char* pathname) {
-    if(queue == NULL || pathname == NULL) return NULL;
+struct fsp_file* fsp_files_queue_remove(struct fsp_files_queue* queue, struct fsp_file* file) {
+    if(!fsp_files_queue_contains(queue, file)) return NULL;
     
-    struct fsp_file* _file = queue->head;
-    struct fsp_file* _file_prev = NULL;
-    while(_file != NULL && strcmp(_file->pathname, pathname) != 0) {
-        _file_prev = _file;
-        _file = _file->queue_next;
+    if(file->queue_prev != NULL) {
+        file->queue_prev->queue_next = file->queue_next;
+    } else {
+        queue->head = file->queue_next;
     }
-    if(_file == NULL) return NULL;
-    
-    if(queue->head == queue->tail) {
-        queue->head = NULL;
-        queue->tail = NULL;
-    } else if(_file == queue->head) {
-        queue->head = (queue->head)->queue_next;
-    } else if(_file == queue->tail) {
-        _file_prev->queue_next = NULL;
-        queue->tail = _file_prev;
+    if(file->queue_next != NULL) {
+        file->queue_next->queue_prev = file->queue_prev;
     } else {
-        _file_prev->queue_next = _file->queue_next;
+        queue->tail = file->queue_prev;
     }
-    _file->queue_next = NULL;
+    file->queue_prev = NULL;
+    file->queue_next = NULL;
+    queue->files_num--;
+    
+    return file;
+}
+
+int fsp_files_queue_moveToTail(struct fsp_files_queue* queue, struct fsp_file* file) {
+    if(fsp_files_queue_remove(queue, file) == NULL) return -1;
     
-    return _file;
+    return fsp_files_queue_enqueue(queue, file);
 }
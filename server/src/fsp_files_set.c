@@ -0,0 +1,235 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <fsp_files_set.h>
+
+/**
+ * \brief Funzione hash che, dato il puntatore file, restituisce l'indice all'interno
+ *        della tabella di dimensione size (potenza di 2).
+ *
+ * \return L'indice all'interno della tabella.
+ */
+static inline size_t hash_function(size_t size, const struct fsp_file* file);
+
+/**
+ * \brief Restituisce l'indice della tabella di set che contiene file.
+ *
+ * \return L'indice,
+ *         -1 se il file non è presente.
+ */
+static long int search(const struct fsp_files_set* set, const struct fsp_file* file);
+
+/**
+ * \brief Inserisce entry nella tabella table di dimensione size (file non presente e tabella non piena).
+ */
+static void insert(struct fsp_files_set_entry* table, size_t size, struct fsp_files_set_entry entry);
+
+/**
+ * \brief Libera la posizione index della tabella di set spostando indietro i file successivi della stessa sequenza.
+ */
+static void erase(struct fsp_files_set* set, size_t index);
+
+/**
+ * \brief Raddoppia la dimensione della tabella di set (e del vettore dei descrittori).
+ *
+ * \return 0 in caso di successo,
+ *         -1 se non è stato possibile allocare la memoria.
+ */
+static int grow(struct fsp_files_set* set);
+
+static inline size_t hash_function(size_t size, const struct fsp_file* file) {
+    // Hashing di Fibonacci (i file sono allineati, i bit meno significativi sono sempre 0)
+    unsigned long long int key = (uintptr_t) file;
+    key = (key ^ (key >> 32))*11400714819323198485ull;
+    return (size_t) (key >> 32) & (size - 1);
+}
+
+static long int search(const struct fsp_files_set* set, const struct fsp_file* file) {
+    if(set->files_num == 0) return -1;
+    
+    size_t index = hash_function(set->size, file);
+    while((set->table)[index].file != NULL) {
+        if((set->table)[index].file == file) return index;
+        index = (index + 1) & (set->size - 1);
+    }
+    
+    return -1;
+}
+
+static void insert(struct fsp_files_set_entry* table, size_t size, struct fsp_files_set_entry entry) {
+    size_t index = hash_function(size, entry.file);
+    while(table[index].file != NULL) {
+        index = (index + 1) & (size - 1);
+    }
+    table[index] = entry;
+}
+
+static void erase(struct fsp_files_set* set, size_t index) {
+    // Sposta indietro i file successivi della stessa sequenza che non si trovano
+    // nella loro posizione iniziale (evita l'uso di marcatori per le posizioni rimosse)
+    size_t mask = set->size - 1;
+    size_t hole = index;
+    index = (hole + 1) & mask;
+    while((set->table)[index].file != NULL) {
+        size_t home = hash_function(set->size, (set->table)[index].file);
+        if(((index - home) & mask) >= ((index - hole) & mask)) {
+            (set->table)[hole] = (set->table)[index];
+            hole = index;
+        }
+        index = (index + 1) & mask;
+    }
+    (set->table)[hole].file = NULL;
+}
+
+static int grow(struct fsp_files_set* set) {
+    size_t size = set->size == 0 ? FSP_FILES_SET_INITIAL_SIZE : 2*set->size;
+    struct fsp_files_set_entry* table = NULL;
+    struct fsp_file** handles = NULL;
+    unsigned int* free_handles = NULL;
+    if((table = calloc(size, sizeof(struct fsp_files_set_entry))) == NULL) return -1;
+    if((handles = realloc(set->handles, sizeof(struct fsp_file*)*(size/2))) == NULL) {
+        free(table);
+        return -1;
+    }
+    set->handles = handles;
+    if((free_handles = realloc(set->free_handles, sizeof(unsigned int)*(size/2))) == NULL) {
+        free(table);
+        return -1;
+    }
+    set->free_handles = free_handles;
+    
+    for(size_t i = 0; i < set->size; i++) {
+        if((set->table)[i].file != NULL) insert(table, size, (set->table)[i]);
+    }
+    for(size_t i = set->size/2; i < size/2; i++) {
+        handles[i] = NULL;
+    }
+    
+    free(set->table);
+    set->table = table;
+    set->size = size;
+    
+    return 0;
+}
+
+struct fsp_files_set* fsp_files_set_new(void) {
+    struct fsp_files_set* set = NULL;
+    if((set = malloc(sizeof(struct fsp_files_set))) == NULL) return NULL;
+    
+    set->size = 0;
+    set->files_num = 0;
+    set->table = NULL;
+    set->handles = NULL;
+    set->free_handles = NULL;
+    set->free_handles_num = 0;
+    set->handles_next = 0;
+    
+    return set;
+}
+
+void fsp_files_set_free(struct fsp_files_set* set) {
+    if(set == NULL) return;
+    if(set->table != NULL) free(set->table);
+    if(set->handles != NULL) free(set->handles);
+    if(set->free_handles != NULL) free(set->free_handles);
+    free(set);
+}
+
+int fsp_files_set_add(struct fsp_files_set* set, struct fsp_file* file) {
+    if(set == NULL || file == NULL) return -1;
+    if(search(set, file) >= 0) return -3;
+    if(2*(set->files_num + 1) > set->size && grow(set) != 0) return -2;
+    
+    // Descrittore (handles_next < size/2 in quanto files_num < size/2)
+    struct fsp_files_set_entry entry;
+    entry.file = file;
+    if(set->free_handles_num > 0) {
+        entry.handle = (set->free_handles)[--(set->free_handles_num)];
+    } else {
+        entry.handle = (set->handles_next)++;
+    }
+    (set->handles)[entry.handle] = file;
+    
+    insert(set->table, set->size, entry);
+    (set->files_num)++;
+    
+    return 0;
+}
+
+int fsp_files_set_contains(const struct fsp_files_set* set, const struct fsp_file* file) {
+    if(set == NULL || file == NULL) return 0;
+    
+    return search(set, file) >= 0;
+}
+
+long int fsp_files_set_getHandle(const struct fsp_files_set* set, const struct fsp_file* file) {
+    if(set == NULL || file == NULL) return -1;
+    
+    long int index = search(set, file);
+    if(index < 0) return -1;
+    
+    return (set->table)[index].handle;
+}
+
+struct fsp_file* fsp_files_set_getFile(const struct fsp_files_set* set, unsigned long int handle) {
+    if(set == NULL || handle >= set->handles_next) return NULL;
+    
+    return (set->handles)[handle];
+}
+
+struct fsp_file* fsp_files_set_remove(struct fsp_files_set* set, struct fsp_file* file) {
+    if(set == NULL || file == NULL) return NULL;
+    
+    long int _index = search(set, file);
+    if(_index < 0) return NULL;
+    
+    // Rilascia il descrittore
+    unsigned int handle = (set->table)[_index].handle;
+    (set->handles)[handle] = NULL;
+    (set->free_handles)[(set->free_handles_num)++] = handle;
+    
+    erase(set, _index);
+    (set->files_num)--;
+    
+    return file;
+}
+
+int fsp_files_set_replace(struct fsp_files_set* set, struct fsp_file* file, struct fsp_file* new_file) {
+    if(set == NULL || file == NULL || new_file == NULL) return -1;
+    
+    long int index = search(set, file);
+    if(index < 0) return -1;
+    if(search(set, new_file) >= 0) return -3;
+    
+    // Il descrittore passa a new_file (il numero dei file non cambia)
+    struct fsp_files_set_entry entry = (set->table)[index];
+    entry.file = new_file;
+    (set->handles)[entry.handle] = new_file;
+    erase(set, index);
+    insert(set->table, set->size, entry);
+    
+    return 0;
+}
+
+void fsp_files_set_removeAll(struct fsp_files_set* set, void (*completionHandler) (struct fsp_file*, void*), void* arg) {
+    if(set == NULL) return;
+    
+    struct fsp_file* _file;
+    for(size_t i = 0; i < set->size && set->files_num > 0; i++) {
+        if((_file = (set->table)[i].file) != NULL) {
+            (set->table)[i].file = NULL;
+            (set->files_num)--;
+            if(completionHandler != NULL) completionHandler(_file, arg);
+        }
+    }
+    for(size_t i = 0; i < set->handles_next; i++) {
+        (set->handles)[i] = NULL;
+    }
+    set->free_handles_num = 0;
+    set->handles_next = 0;
+}
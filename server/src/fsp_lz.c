@@ -0,0 +1,209 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <fsp_lz.h>
+
+/**
+ * \brief Legge 4 byte da p (anche non allineati).
+ */
+static uint32_t read32(const unsigned char* p);
+
+/**
+ * \brief Restituisce l'indice della tabella hash per la sequenza seq.
+ */
+static uint32_t hash(uint32_t seq);
+
+/**
+ * \brief Scrive in *op l'estensione della lunghezza len (byte da 255 seguiti dal resto).
+ */
+static void writeLength(unsigned char** op, size_t len);
+
+/**
+ * \brief Scrive in *op una sequenza con lit_len letterali presi da lit e una corrispondenza
+ *        di match_len byte a distanza offset (match_len == 0 per l'ultima sequenza).
+ *
+ * \return 0 in caso di successo,
+ *         -1 se la sequenza non entra in oend - *op byte.
+ */
+static int writeSequence(unsigned char** op, const unsigned char* oend, const unsigned char* lit, size_t lit_len, size_t offset, size_t match_len);
+
+/**
+ * \brief Legge da *ip l'estensione di una lunghezza e la somma a *len.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se l'estensione supera iend.
+ */
+static int readLength(const unsigned char** ip, const unsigned char* iend, size_t* len);
+
+long int fsp_lz_compress(const void* src, size_t src_len, void* dst, size_t dst_cap) {
+    if(src == NULL || dst == NULL || src_len > UINT32_MAX) return -1;
+
+    const unsigned char* base = src;
+    const unsigned char* ip = base;
+    const unsigned char* iend = base + src_len;
+    // Inizio dei letterali non ancora scritti
+    const unsigned char* anchor = base;
+    unsigned char* op = dst;
+    const unsigned char* oend = op + dst_cap;
+
+    // Ultima posizione della sequenza (posizione relativa a base) con un dato valore hash
+    uint32_t table[1 << FSP_LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    if(src_len > FSP_LZ_MIN_MATCH) {
+        const unsigned char* ilimit = iend - FSP_LZ_MIN_MATCH;
+        while(ip <= ilimit) {
+            uint32_t seq = read32(ip);
+            uint32_t h = hash(seq);
+            const unsigned char* ref = base + table[h];
+            table[h] = (uint32_t) (ip - base);
+
+            if(ref >= ip || ip - ref > FSP_LZ_MAX_OFFSET || read32(ref) != seq) {
+                // Nessuna corrispondenza: il passo cresce con la distanza dall'ultima corrispondenza
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            // Estende la corrispondenza
+            const unsigned char* match = ip;
+            size_t offset = ip - ref;
+            ip += FSP_LZ_MIN_MATCH;
+            ref += FSP_LZ_MIN_MATCH;
+            while(ip < iend && *ip == *ref) {
+                ip++;
+                ref++;
+            }
+
+            if(writeSequence(&op, oend, anchor, match - anchor, offset, ip - match) != 0) return -1;
+            anchor = ip;
+        }
+    }
+
+    // Ultimi letterali
+    if(writeSequence(&op, oend, anchor, iend - anchor, 0, 0) != 0) return -1;
+
+    return op - (unsigned char*) dst;
+}
+
+long int fsp_lz_decompress(const void* src, size_t src_len, void* dst, size_t dst_len) {
+    if(src == NULL || dst == NULL) return -1;
+
+    const unsigned char* ip = src;
+    const unsigned char* iend = ip + src_len;
+    unsigned char* op = dst;
+    unsigned char* oend = op + dst_len;
+
+    while(ip < iend) {
+        unsigned char token = *ip++;
+
+        // Letterali
+        size_t len = token >> 4;
+        if(len == 15 && readLength(&ip, iend, &len) != 0) return -1;
+        if(len > iend - ip || len > oend - op) return -1;
+        memcpy(op, ip, len);
+        op += len;
+        ip += len;
+
+        // L'ultima sequenza contiene solo i letterali
+        if(ip == iend) break;
+
+        // Corrispondenza
+        if(iend - ip < 2) return -1;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if(offset == 0 && (token & 15) == 0) {
+            // Sequenza senza corrispondenza (letterali aggiunti in coda)
+            continue;
+        }
+        if(offset == 0 || offset > op - (unsigned char*) dst) return -1;
+        len = token & 15;
+        if(len == 15 && readLength(&ip, iend, &len) != 0) return -1;
+        len += FSP_LZ_MIN_MATCH;
+        if(len > oend - op) return -1;
+
+        const unsigned char* ref = op - offset;
+        if(offset >= len) {
+            memcpy(op, ref, len);
+            op += len;
+        } else {
+            // La corrispondenza si sovrappone ai byte che sta generando
+            while(len-- > 0) *op++ = *ref++;
+        }
+    }
+
+    return op - (unsigned char*) dst;
+}
+
+size_t fsp_lz_appendBound(size_t src_len) {
+    // Distanza nulla della sequenza precedente e sequenza con i soli letterali
+    return 2 + 1 + src_len/255 + 1 + src_len + 3;
+}
+
+long int fsp_lz_appendLiterals(const void* src, size_t src_len, void* dst, size_t dst_cap) {
+    if(src == NULL || dst == NULL || dst_cap < 2) return -1;
+
+    // L'ultima sequenza del risultato precedente diventa una sequenza senza corrispondenza
+    unsigned char* op = dst;
+    const unsigned char* oend = op + dst_cap;
+    *op++ = 0;
+    *op++ = 0;
+    if(writeSequence(&op, oend, src, src_len, 0, 0) != 0) return -1;
+
+    return op - (unsigned char*) dst;
+}
+
+static uint32_t read32(const unsigned char* p) {
+    uint32_t val;
+    memcpy(&val, p, sizeof(val));
+    return val;
+}
+
+static uint32_t hash(uint32_t seq) {
+    return (seq*2654435761U) >> (32 - FSP_LZ_HASH_BITS);
+}
+
+static void writeLength(unsigned char** op, size_t len) {
+    while(len >= 255) {
+        *(*op)++ = 255;
+        len -= 255;
+    }
+    *(*op)++ = (unsigned char) len;
+}
+
+static int writeSequence(unsigned char** op, const unsigned char* oend, const unsigned char* lit, size_t lit_len, size_t offset, size_t match_len) {
+    // Dimensione massima della sequenza
+    size_t max_len = 1 + lit_len/255 + 1 + lit_len + 2 + match_len/255 + 1;
+    if(max_len > oend - *op) return -1;
+
+    size_t ml = match_len > 0 ? match_len - FSP_LZ_MIN_MATCH : 0;
+    unsigned char* token = (*op)++;
+    *token = (lit_len < 15 ? lit_len : 15) << 4;
+    if(lit_len >= 15) writeLength(op, lit_len - 15);
+    memcpy(*op, lit, lit_len);
+    *op += lit_len;
+
+    if(match_len == 0) return 0;
+
+    *(*op)++ = offset & 0xFF;
+    *(*op)++ = (offset >> 8) & 0xFF;
+    *token |= ml < 15 ? ml : 15;
+    if(ml >= 15) writeLength(op, ml - 15);
+
+    return 0;
+}
+
+static int readLength(const unsigned char** ip, const unsigned char* iend, size_t* len) {
+    unsigned char b;
+    do {
+        if(*ip >= iend) return -1;
+        b = *(*ip)++;
+        *len += b;
+    } while(b == 255);
+
+    return 0;
+}
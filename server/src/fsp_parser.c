@@ -10,12 +10,21 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <stdint.h>
+#include <arpa/inet.h>
+
+// Comandi nell'ordine dei codici del protocollo binario (il codice di commands[i] è i+1)
+static const enum fsp_command commands[] = { APPEND, CLOSE, LIST, LOCK, OPEN, OPENC, OPENCL, OPENL, QUIT, READ, READN, REMOVE, TOUCH, UNLOCK, WRITE };
+#define COMMANDS_NUM (sizeof(commands)/sizeof(commands[0]))
 
 int fsp_parser_parseRequest(void* buf, size_t size, struct fsp_request* req) {
     if(buf == NULL || req == NULL) {
         return -1;
     }
     
+    req->version = FSP_PARSER_V1;
+    req->id = 0;
+    
     char* buf_start = (char*) buf;
     char *start, *end;
     
@@ -31,6 +40,8 @@ int fsp_parser_parseRequest(void* buf, size_t size, struct fsp_request* req) {
             req->cmd = APPEND;
         } else if(strcmp(start, "CLOSE") == 0) {
             req->cmd = CLOSE;
+        } else if(strcmp(start, "LIST") == 0) {
+            req->cmd = LIST;
         } else if(strcmp(start, "LOCK") == 0) {
             req->cmd = LOCK;
         } else if(strcmp(start, "OPEN") == 0) {
@@ -49,6 +60,8 @@ int fsp_parser_parseRequest(void* buf, size_t size, struct fsp_request* req) {
             req->cmd = READN;
         } else if(strcmp(start, "REMOVE") == 0) {
             req->cmd = REMOVE;
+        } else if(strcmp(start, "TOUCH") == 0) {
+            req->cmd = TOUCH;
         } else if(strcmp(start, "UNLOCK") == 0) {
             req->cmd = UNLOCK;
         } else if(strcmp(start, "WRITE") == 0) {
@@ -144,6 +157,9 @@ long int fsp_parser_makeRequest(void** buf, size_t* size, enum fsp_command cmd,
         case CLOSE:
             _cmd = "CLOSE";
             break;
+        case LIST:
+            _cmd = "LIST";
+            break;
         case LOCK:
             _cmd = "LOCK";
             break;
@@ -171,6 +187,9 @@ long int fsp_parser_makeRequest(void** buf, size_t* size, enum fsp_command cmd,
         case REMOVE:
             _cmd = "REMOVE";
             break;
+        case TOUCH:
+            _cmd = "TOUCH";
+            break;
         case UNLOCK:
             _cmd = "UNLOCK";
             break;
@@ -234,6 +253,9 @@ int fsp_parser_parseResponse(void* buf, size_t size, struct fsp_response* resp)
         return -1;
     }
     
+    resp->version = FSP_PARSER_V1;
+    resp->id = 0;
+    
     char* buf_start = (char*) buf;
     char *start, *end;
     
@@ -378,102 +400,352 @@ long int fsp_parser_makeResponse(void** buf, size_t* size, int code, const char*
     return tot_len;
 }
 
-int fsp_parser_parseData(size_t data_len, void* data, struct fsp_data** parsed_data) {
-    if(data_len <= 0 || data == NULL || parsed_data == NULL) {
+/**
+ * \brief Legge un intero di 16 bit (n == 2) o di 32 bit (n == 4) in network byte order da buf.
+ */
+static unsigned long int readUint(const unsigned char* buf, int n);
+
+static unsigned long int readUint(const unsigned char* buf, int n) {
+    if(n == 2) {
+        uint16_t value;
+        memcpy(&value, buf, 2);
+        return ntohs(value);
+    } else {
+        uint32_t value;
+        memcpy(&value, buf, 4);
+        return ntohl(value);
+    }
+}
+
+long int fsp_parser_binaryLength(const void* buf, size_t size) {
+    if(buf == NULL) {
         return -1;
     }
+    if(size < FSP_PARSER_V2_HEADER_LEN) {
+        return -2;
+    }
     
-    *parsed_data = NULL;
+    const unsigned char* header = (const unsigned char*) buf;
+    if(header[0] != FSP_PARSER_V2_MAGIC || header[1] != FSP_PARSER_V2 || readUint(header+4, 4) != 0) {
+        return -3;
+    }
+    unsigned long int arg_len = readUint(header+12, 4);
+    unsigned long int data_len = readUint(header+16, 4);
+    if(arg_len == 0 || arg_len > FSP_PARSER_BUF_MAX_SIZE || data_len > FSP_PARSER_BUF_MAX_SIZE
+       || FSP_PARSER_V2_HEADER_LEN + arg_len + data_len > FSP_PARSER_BUF_MAX_SIZE) {
+        return -3;
+    }
     
-    char* buf_start = (char*) data;
-    char *start, *end;
+    return FSP_PARSER_V2_HEADER_LEN + arg_len + data_len;
+}
+
+unsigned int fsp_parser_binaryId(const void* buf, size_t size) {
+    if(buf == NULL || size < FSP_PARSER_V2_HEADER_LEN) {
+        return 0;
+    }
     
-    start = buf_start;
-    end = start;
+    return (unsigned int) readUint((const unsigned char*) buf + 8, 4);
+}
+
+void fsp_parser_makeBinaryHeader(void* buf, unsigned int opcode, unsigned int id, size_t arg_len, size_t data_len) {
+    unsigned char* header = (unsigned char*) buf;
+    uint16_t value16;
+    uint32_t value32;
+    
+    header[0] = FSP_PARSER_V2_MAGIC;
+    header[1] = FSP_PARSER_V2;
+    value16 = htons((uint16_t) opcode);
+    memcpy(header+2, &value16, 2);
+    value32 = 0;
+    memcpy(header+4, &value32, 4);
+    value32 = htonl((uint32_t) id);
+    memcpy(header+8, &value32, 4);
+    value32 = htonl((uint32_t) arg_len);
+    memcpy(header+12, &value32, 4);
+    value32 = htonl((uint32_t) data_len);
+    memcpy(header+16, &value32, 4);
+}
+
+/**
+ * \brief Legge il messaggio binario di lunghezza size contenuto in buf: salva in *version, *id e *opcode i campi
+ *        dell'intestazione (se completa) e in *arg, *data_len e *data l'argomento (o la descrizione) e i dati.
+ *
+ * \return 0 in caso di successo,
+ *         -2 se il messaggio è incompleto,
+ *         -3 se il messaggio contiene errori sintattici.
+ */
+static int parseBinary(void* buf, size_t size, int* version, unsigned int* id, unsigned int* opcode, char** arg, size_t* data_len, void** data);
+
+static int parseBinary(void* buf, size_t size, int* version, unsigned int* id, unsigned int* opcode, char** arg, size_t* data_len, void** data) {
+    long int tot_len = fsp_parser_binaryLength(buf, size);
+    if(tot_len < 0) {
+        return (int) tot_len;
+    }
     
-    // Crea il primo nodo della lista
-    if((*parsed_data = malloc(sizeof(struct fsp_data))) == NULL) {
-        return -4;
+    unsigned char* header = (unsigned char*) buf;
+    *version = FSP_PARSER_V2;
+    *id = (unsigned int) readUint(header+8, 4);
+    *opcode = (unsigned int) readUint(header+2, 2);
+    
+    if(size < tot_len) {
+        return -2;
+    } else if(size > tot_len) {
+        return -3;
+    }
+    
+    // L'argomento termina con '\0' (ultimo byte dell'argomento)
+    size_t arg_len = readUint(header+12, 4);
+    *arg = (char*) (header + FSP_PARSER_V2_HEADER_LEN);
+    if((*arg)[arg_len-1] != '\0') {
+        return -3;
+    }
+    *data_len = readUint(header+16, 4);
+    *data = (void*) (*arg + arg_len);
+    
+    return 0;
+}
+
+/**
+ * \brief Genera il messaggio binario con codice opcode, identificativo id, argomento (o descrizione) arg e dati data
+ *        e lo salva in *buf (come fsp_parser_makeRequest).
+ */
+static long int makeBinary(void** buf, size_t* size, unsigned int opcode, unsigned int id, const char* arg, size_t data_len, void* data);
+
+static long int makeBinary(void** buf, size_t* size, unsigned int opcode, unsigned int id, const char* arg, size_t data_len, void* data) {
+    if(buf == NULL || *buf == NULL || size == NULL || (data_len > 0 && data == NULL) || *size > FSP_PARSER_BUF_MAX_SIZE) {
+        return -1;
+    }
+    
+    size_t arg_len, tot_len;
+    arg_len = (arg == NULL ? 0 : strlen(arg)) + 1;
+    tot_len = FSP_PARSER_V2_HEADER_LEN + arg_len + data_len;
+    
+    // Rialloca il buffer per contenere l'intero messaggio se necessario
+    if(*size < tot_len) {
+        void* buf_tmp;
+        if(tot_len > FSP_PARSER_BUF_MAX_SIZE || (buf_tmp = realloc(*buf, tot_len)) == NULL) {
+            return -2;
+        } else {
+            *buf = buf_tmp;
+            *size = tot_len;
+        }
+    }
+    
+    // Scrive nel buffer
+    char* _buf = (char*) (*buf);
+    fsp_parser_makeBinaryHeader(_buf, opcode, id, arg_len, data_len);
+    _buf += FSP_PARSER_V2_HEADER_LEN;
+    if(arg != NULL) {
+        memcpy(_buf, arg, arg_len);
+    } else {
+        *_buf = '\0';
+    }
+    _buf += arg_len;
+    if(data != NULL) memcpy(_buf, data, data_len);
+    
+    return tot_len;
+}
+
+int fsp_parser_parseBinaryRequest(void* buf, size_t size, struct fsp_request* req) {
+    if(buf == NULL || req == NULL) {
+        return -1;
+    }
+    
+    unsigned int opcode;
+    int ret_val = parseBinary(buf, size, &(req->version), &(req->id), &opcode, &(req->arg), &(req->data_len), &(req->data));
+    if(ret_val != 0) {
+        return ret_val;
+    }
+    
+    if(opcode == 0 || opcode > COMMANDS_NUM) {
+        return -3;
+    }
+    req->cmd = commands[opcode-1];
+    if(req->cmd == QUIT && *(req->arg) != '\0') {
+        return -3;
+    }
+    
+    return 0;
+}
+
+long int fsp_parser_makeBinaryRequest(void** buf, size_t* size, enum fsp_command cmd, unsigned int id, const char* arg, size_t data_len, void* data) {
+    unsigned int opcode = 0;
+    while(opcode < COMMANDS_NUM && commands[opcode] != cmd) opcode++;
+    if(opcode == COMMANDS_NUM) {
+        return -1;
+    }
+    
+    return makeBinary(buf, size, opcode+1, id, arg, data_len, data);
+}
+
+int fsp_parser_parseBinaryResponse(void* buf, size_t size, struct fsp_response* resp) {
+    if(buf == NULL || resp == NULL) {
+        return -1;
+    }
+    
+    unsigned int code;
+    int ret_val = parseBinary(buf, size, &(resp->version), &(resp->id), &code, &(resp->description), &(resp->data_len), &(resp->data));
+    if(ret_val != 0) {
+        return ret_val;
     }
-    struct fsp_data* _parsed_data = *parsed_data;
-    _parsed_data->next = NULL;
+    resp->code = (int) code;
+    
+    return 0;
+}
+
+long int fsp_parser_makeBinaryResponse(void** buf, size_t* size, int code, unsigned int id, const char* description, size_t data_len, void* data) {
+    if(code < 0 || code > UINT16_MAX) {
+        return -1;
+    }
+    
+    return makeBinary(buf, size, (unsigned int) code, id, description, data_len, data);
+}
+
+/**
+ * \brief Scorre gli elementi del campo data di lunghezza data_len (elementi di un elenco, senza dati, se list != 0).
+ *        Se nodes == NULL, controlla soltanto la sintassi senza modificare data e conta gli elementi,
+ *        altrimenti salva nel vettore nodes gli elementi (collegandoli tra loro con il campo next)
+ *        terminando con '\0' i nomi e i dati in data.
+ *
+ * \return Il numero degli elementi (maggiore di zero) in caso di successo,
+ *         -2 se il campo data del messaggio è incompleto,
+ *         -3 se il campo data del messaggio contiene errori sintattici.
+ */
+static long int parseDataItems(size_t data_len, char* data, int list, struct fsp_data* nodes);
+
+static long int parseDataItems(size_t data_len, char* data, int list, struct fsp_data* nodes) {
+    char* buf_start = data;
+    char *start, *end, *pathname;
+    long int size;
+    long int items = 0;
+    
+    start = buf_start;
+    end = start;
     
     while(end - buf_start != data_len) {
-        // Legge il pathname
-        while(end - buf_start < data_len && *end != ' ') end++;
-        if(*end == ' ') {
+        if(list) {
+            // Legge la lunghezza del pathname (il pathname può contenere spazi)
+            while(end - buf_start < data_len && *end != ' ') end++;
+            if(end - buf_start == data_len) {
+                return -2;
+            }
+            long int pathname_len;
             *end = '\0';
-            _parsed_data->pathname = start;
+            if(!isNumber(start, &pathname_len) || pathname_len < 0) {
+                *end = ' ';
+                return -3;
+            }
+            *end = ' ';
+            start = end + 1;
+            if(pathname_len >= data_len - (start - buf_start)) {
+                return -2;
+            }
+            end = start + pathname_len;
+            if(*end != ' ') {
+                return -3;
+            }
         } else {
-            fsp_parser_freeData(*parsed_data);
-            *parsed_data = NULL;
-            return -2;
+            // Legge il pathname
+            while(end - buf_start < data_len && *end != ' ') end++;
+            if(end - buf_start == data_len) {
+                return -2;
+            }
         }
+        pathname = start;
+        if(nodes != NULL) *end = '\0';
         
         // Legge la dimensione
         start = end + 1;
         end = start;
         while(end - buf_start < data_len && *end != ' ') end++;
-        if(*end == ' ') {
-            *end = '\0';
-            long int size;
-            if(!isNumber(start, &size) || size < 0) {
-                fsp_parser_freeData(*parsed_data);
-                *parsed_data = NULL;
-                return -3;
-            }
-            _parsed_data->size = (size_t) size;
-        } else {
-            fsp_parser_freeData(*parsed_data);
-            *parsed_data = NULL;
+        if(end - buf_start == data_len) {
             return -2;
         }
+        *end = '\0';
+        if(!isNumber(start, &size) || size < 0) {
+            *end = ' ';
+            return -3;
+        }
+        if(nodes == NULL) *end = ' ';
+        
+        if(list) {
+            // Gli elementi di un elenco non contengono il dato
+            if(nodes != NULL) {
+                nodes[items].pathname = pathname;
+                nodes[items].size = (size_t) size;
+                nodes[items].data = NULL;
+                nodes[items].next = NULL;
+                if(items > 0) nodes[items-1].next = &(nodes[items]);
+            }
+            items++;
+            
+            start = end + 1;
+            end = start;
+            continue;
+        }
         
         // Legge il dato
         start = end + 1;
-        end = start + _parsed_data->size;
-        if(end - buf_start < data_len) {
-            if(*end == ' ') {
-                *end = '\0';
-                _parsed_data->data = (void*) start;
-            } else {
-                fsp_parser_freeData(*parsed_data);
-                *parsed_data = NULL;
-                return -3;
-            }
-        } else {
-            fsp_parser_freeData(*parsed_data);
-            *parsed_data = NULL;
+        end = start + size;
+        if(end - buf_start >= data_len) {
             return -2;
+        } else if(*end != ' ') {
+            return -3;
+        }
+        if(nodes != NULL) {
+            *end = '\0';
+            nodes[items].pathname = pathname;
+            nodes[items].size = (size_t) size;
+            nodes[items].data = (void*) start;
+            nodes[items].next = NULL;
+            if(items > 0) nodes[items-1].next = &(nodes[items]);
         }
+        items++;
         
         start = end + 1;
         end = start;
-        if((end - buf_start) == data_len) {
-            break;
-        } else if((end - buf_start) > data_len) {
-            fsp_parser_freeData(*parsed_data);
-            *parsed_data = NULL;
-            return -3;
-        } else {
-            // Crea il prossimo nodo
-            struct fsp_data* newData = NULL;
-            if((newData = malloc(sizeof(struct fsp_data))) == NULL) {
-                fsp_parser_freeData(*parsed_data);
-                *parsed_data = NULL;
-                return -4;
-            }
-            newData->next = NULL;
-            _parsed_data->next = newData;
-            _parsed_data = newData;
-        }
     }
     
+    return items;
+}
+
+/**
+ * \brief Implementa fsp_parser_parseData (list == 0) e fsp_parser_parseList (list != 0).
+ */
+static int parseItems(size_t data_len, void* data, int list, struct fsp_data** parsed_data);
+
+static int parseItems(size_t data_len, void* data, int list, struct fsp_data** parsed_data) {
+    if(data_len <= 0 || data == NULL || parsed_data == NULL) {
+        return -1;
+    }
+    
+    *parsed_data = NULL;
+    
+    // Controlla la sintassi e conta gli elementi
+    long int items = parseDataItems(data_len, (char*) data, list, NULL);
+    if(items < 0) {
+        return (int) items;
+    }
+    
+    // Alloca con una sola malloc tutti i nodi della lista
+    if((*parsed_data = malloc(sizeof(struct fsp_data)*items)) == NULL) {
+        return -4;
+    }
+    parseDataItems(data_len, (char*) data, list, *parsed_data);
+    
     return 0;
 }
 
+int fsp_parser_parseData(size_t data_len, void* data, struct fsp_data** parsed_data) {
+    return parseItems(data_len, data, 0, parsed_data);
+}
+
+int fsp_parser_parseList(size_t data_len, void* data, struct fsp_data** parsed_data) {
+    return parseItems(data_len, data, 1, parsed_data);
+}
+
 long int fsp_parser_makeData(void** buf, size_t* size, unsigned long int offset, const char* pathname, size_t data_size, void* data) {
-    if(buf == NULL || *buf == NULL || size == NULL || offset < 0 || pathname == NULL || data_size < 0 || (data_size > 0 && data == NULL) || *size > FSP_PARSER_BUF_MAX_SIZE) {
+    if(buf == NULL || *buf == NULL || size == NULL || offset < 0 || pathname == NULL || data_size < 0 || *size > FSP_PARSER_BUF_MAX_SIZE) {
         return -1;
     }
     
@@ -514,20 +786,65 @@ long int fsp_parser_makeData(void** buf, size_t* size, unsigned long int offset,
     _buf += data_size_str_len;
     *_buf = ' ';
     _buf++;
-    if(data != NULL) {
-        memcpy(_buf, data, data_size);
-        _buf += data_size;
+    if(data != NULL) memcpy(_buf, data, data_size);
+    _buf += data_size;
+    *_buf = ' ';
+    
+    return tot_len;
+}
+
+long int fsp_parser_makeListItem(void** buf, size_t* size, unsigned long int offset, const char* pathname, size_t file_size) {
+    if(buf == NULL || *buf == NULL || size == NULL || pathname == NULL || *size > FSP_PARSER_BUF_MAX_SIZE) {
+        return -1;
+    }
+    
+    // Lunghezza del nome e file_size
+    long int pathname_len = strlen(pathname);
+    char pathname_len_str[24];
+    snprintf(pathname_len_str, 24, "%ld", pathname_len);
+    char file_size_str[24];
+    snprintf(file_size_str, 24, "%lu", (unsigned long int) file_size);
+    
+    long int pathname_len_str_len, file_size_str_len, tot_len;
+    pathname_len_str_len = strlen(pathname_len_str);
+    file_size_str_len = strlen(file_size_str);
+    tot_len = pathname_len_str_len + pathname_len + file_size_str_len + 3;
+    
+    // Rialloca il buffer per contenere l'elemento se necessario
+    unsigned long int remaining = *size - offset;
+    if(remaining < tot_len) {
+        void* buf_tmp;
+        // Raddoppia la dimensione per ammortizzare le riallocazioni (gli elementi sono piccoli)
+        size_t buf_tmp_size = *size*2 > *size + tot_len - remaining ? *size*2 : *size + tot_len - remaining;
+        if(buf_tmp_size > FSP_PARSER_BUF_MAX_SIZE) buf_tmp_size = *size + tot_len - remaining;
+        if(buf_tmp_size > FSP_PARSER_BUF_MAX_SIZE || (buf_tmp = realloc(*buf, buf_tmp_size)) == NULL) {
+            return -2;
+        } else {
+            *buf = buf_tmp;
+            *size = buf_tmp_size;
+        }
     }
+    
+    // Scrive nel buffer
+    char* _buf = (char*) (*buf);
+    _buf += offset;
+    
+    memcpy(_buf, pathname_len_str, pathname_len_str_len);
+    _buf += pathname_len_str_len;
+    *_buf = ' ';
+    _buf++;
+    memcpy(_buf, pathname, pathname_len);
+    _buf += pathname_len;
+    *_buf = ' ';
+    _buf++;
+    memcpy(_buf, file_size_str, file_size_str_len);
+    _buf += file_size_str_len;
     *_buf = ' ';
     
     return tot_len;
 }
 
 void fsp_parser_freeData(struct fsp_data* parsed_data) {
-    struct fsp_data* _parsed_data;
-    while(parsed_data != NULL) {
-        _parsed_data = parsed_data->next;
-        free(parsed_data);
-        parsed_data = _parsed_data;
-    }
+    // I nodi della lista sono stati allocati con una sola malloc da fsp_parser_parseData
+    free(parsed_data);
 }
@@ -0,0 +1,128 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+
+#include <fsp_pool.h>
+
+// Dimensione dell'intestazione di ogni blocco (contiene il puntatore al blocco successivo)
+// Mantiene allineati gli oggetti contenuti nel blocco
+#define FSP_POOL_BLOCK_HEADER_SIZE FSP_POOL_ALIGNMENT
+
+struct fsp_pool* fsp_pool_new(size_t obj_size, size_t block_len) {
+    if(obj_size == 0 || block_len == 0) return NULL;
+
+    struct fsp_pool* pool = NULL;
+    if((pool = malloc(sizeof(struct fsp_pool))) == NULL) return NULL;
+
+    // Ogni oggetto libero contiene il puntatore all'oggetto libero successivo
+    if(obj_size < sizeof(void*)) obj_size = sizeof(void*);
+    pool->obj_size = (obj_size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+    pool->block_len = block_len;
+    pool->free_list = NULL;
+    pool->blocks = NULL;
+    pool->used = 0;
+
+    return pool;
+}
+
+void fsp_pool_free(struct fsp_pool* pool) {
+    if(pool == NULL) return;
+
+    void* block = pool->blocks;
+    void* block_next;
+    while(block != NULL) {
+        block_next = *((void**) block);
+        free(block);
+        block = block_next;
+    }
+    free(pool);
+}
+
+void* fsp_pool_alloc(struct fsp_pool* pool, size_t obj_size) {
+    if(pool == NULL) return malloc(obj_size);
+
+    if(pool->free_list == NULL) {
+        // Alloca un nuovo blocco e inserisce i suoi oggetti nella lista degli oggetti liberi
+        void* _block = NULL;
+        if(posix_memalign(&_block, FSP_POOL_ALIGNMENT, FSP_POOL_BLOCK_HEADER_SIZE + pool->obj_size*pool->block_len) != 0) return NULL;
+        char* block = (char*) _block;
+        *((void**) block) = pool->blocks;
+        pool->blocks = block;
+
+        char* obj = block + FSP_POOL_BLOCK_HEADER_SIZE;
+        for(size_t i = 0; i < pool->block_len; i++) {
+            *((void**) obj) = pool->free_list;
+            pool->free_list = obj;
+            obj += pool->obj_size;
+        }
+    }
+
+    void* obj = pool->free_list;
+    pool->free_list = *((void**) obj);
+    (pool->used)++;
+
+    return obj;
+}
+
+void fsp_pool_release(struct fsp_pool* pool, void* obj) {
+    if(obj == NULL) return;
+    if(pool == NULL) {
+        free(obj);
+        return;
+    }
+
+    *((void**) obj) = pool->free_list;
+    pool->free_list = obj;
+    (pool->used)--;
+}
+
+struct fsp_pools* fsp_pools_new(size_t block_len) {
+    if(block_len == 0) return NULL;
+
+    struct fsp_pools* pools = NULL;
+    if((pools = malloc(sizeof(struct fsp_pools))) == NULL) return NULL;
+
+    pools->block_len = block_len;
+    for(int i = 0; i < FSP_POOLS_CLASSES_NUM; i++) {
+        (pools->classes)[i] = NULL;
+    }
+
+    return pools;
+}
+
+void fsp_pools_free(struct fsp_pools* pools) {
+    if(pools == NULL) return;
+
+    for(int i = 0; i < FSP_POOLS_CLASSES_NUM; i++) {
+        fsp_pool_free((pools->classes)[i]);
+    }
+    free(pools);
+}
+
+void* fsp_pools_alloc(struct fsp_pools* pools, size_t size) {
+    if(pools == NULL || size == 0 || size > FSP_POOLS_OBJ_MAX_SIZE) return malloc(size);
+
+    // Classe di dimensione
+    size_t index = (size - 1)/FSP_POOL_ALIGNMENT;
+    if((pools->classes)[index] == NULL &&
+       ((pools->classes)[index] = fsp_pool_new((index + 1)*FSP_POOL_ALIGNMENT, pools->block_len)) == NULL) {
+        return NULL;
+    }
+
+    return fsp_pool_alloc((pools->classes)[index], size);
+}
+
+void fsp_pools_release(struct fsp_pools* pools, void* obj, size_t size) {
+    if(obj == NULL) return;
+    if(pools == NULL || size == 0 || size > FSP_POOLS_OBJ_MAX_SIZE) {
+        free(obj);
+        return;
+    }
+
+    fsp_pool_release((pools->classes)[(size - 1)/FSP_POOL_ALIGNMENT], obj);
+}
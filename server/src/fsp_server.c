@@ -14,18 +14,30 @@
 #include <sys/select.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <limits.h>
 #include <pthread.h>
 #include <string.h>
 #include <signal.h>
 #include <errno.h>
 
 #include <fsp_file.h>
+#include <fsp_blob.h>
+#include <fsp_blobs_hash_table.h>
+#include <fsp_arena.h>
+#include <fsp_tier.h>
+#include <fsp_wal.h>
 #include <fsp_files_hash_table.h>
-#include <fsp_files_queue.h>
-#include <fsp_files_list.h>
+#include <fsp_files_index.h>
+#include <fsp_eviction.h>
+#include <fsp_expiry.h>
+#include <fsp_files_set.h>
 #include <fsp_client.h>
 #include <fsp_clients_hash_table.h>
 #include <fsp_sfd_queue.h>
+#include <fsp_pool.h>
 #include <fsp_parser.h>
 #include <fsp_reader.h>
 #include <utils.h>
@@ -38,41 +50,114 @@
 #define FSP_CLIENT_DEF_BUF_SIZE 4194304
 // Dimensioni delle tabelle hash
 #define FSP_FILES_HASH_TABLE_SIZE 49157
+#define FSP_BLOBS_HASH_TABLE_SIZE 49157
 #define FSP_CLIENTS_HASH_TABLE_SIZE 97
+// Numero di oggetti allocati in un singolo blocco dai pool
+#define FSP_POOL_BLOCK_LEN 1024
+// Spazio riservato nell'arena per il record di ogni file
+#define FSP_ARENA_FILE_RECORD_SIZE 256
 // Lunghezza di un messaggio di log
 #define LOG_FILE_MSG_LEN 512
+// Intervallo di default tra due snapshot dei file (in secondi)
+#define SNAPSHOT_DEF_INTERVAL 60
+// Dimensione massima di default dei contenuti incorporati nell'allocazione dei file
+#define INLINE_DEF_MAX_SIZE 256
+// Soglia inferiore di default dell'espulsione in background (in percentuale di FILES_MAX_NUM e STORAGE_MAX_SIZE)
+#define EVICTION_DEF_LOW_WATERMARK 80
+// Intervallo di default tra due scansioni dei file scaduti (in millisecondi)
+#define EXPIRY_DEF_SWEEP_INTERVAL 100
+// Numero dei file con una scadenza scelti a caso da ogni campione della scansione dei file scaduti
+#define EXPIRY_SAMPLE_SIZE 20
+// Numero massimo dei campioni di una scansione (un nuovo campione viene scelto se più di un quarto
+// dei file del campione precedente era scaduto)
+#define EXPIRY_SAMPLES_MAX 16
+// Dimensione minima dei contenuti allocati nel pool dei contenuti di grandi dimensioni
+#define LARGE_POOL_MIN_SIZE 65536
+// Numero degli elementi dell'insieme dei nomi dei file espulsi dal server (usato per contare i miss)
+#define REJECTED_SLOTS_NUM 65536
 // Tempo massimo di attesa per la lock (in secondi)
 #define LOCK_WAIT_MAX_TIME 4
+// Numero massimo delle richieste di un client (inviate in pipeline) eseguite consecutivamente da un thread worker
+#define PIPELINE_MAX_REQUESTS 16
+// Numero massimo delle parti inviate con una sola chiamata a writev (se il sistema non lo definisce)
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
 
 // File
 typedef struct fsp_file* FSP_FILE;
 // Tabella hash contenente tutti i file presenti nel server
 typedef struct fsp_files_hash_table* FILES;
-// Coda usata per l'espulsione dei file dal server
-typedef struct fsp_files_queue* FILES_QUEUE;
-// Lista dei file aperti (una per ogni client)
-typedef struct fsp_files_list* OPENED_FILES;
+// Indice ordinato dei nomi dei file (usato dal comando LIST)
+typedef struct fsp_files_index* FILES_INDEX;
+// Contenuto di un file
+typedef struct fsp_blob* BLOB;
+// Tabella hash contenente i contenuti dei file (usata per la deduplicazione)
+typedef struct fsp_blobs_hash_table* BLOBS;
+// Politica di rimpiazzamento usata per l'espulsione dei file dal server
+typedef struct fsp_eviction* EVICTION;
+// Insieme dei file con una scadenza
+typedef struct fsp_expiry* EXPIRY;
+// Insieme dei file aperti (uno per ogni client)
+typedef struct fsp_files_set* OPENED_FILES;
 // Client
 typedef struct fsp_client* CLIENT;
 // Tabella hash contenente tutti i client connessi al server
 typedef struct fsp_clients_hash_table* CLIENTS;
 // Coda in cui vengono inseriti i sfd per la comunicazione dal thread master ai thread worker
 typedef struct fsp_sfd_queue* SFD_QUEUE;
+// Pool (per classi di dimensione) da cui vengono presi i file
+typedef struct fsp_pools* POOLS;
+// Arena persistente in cui vengono memorizzati i contenuti e i record dei file
+typedef struct fsp_arena* ARENA;
+// Tier su disco in cui vengono espulsi i contenuti dei file
+typedef struct fsp_tier* TIER;
+// Log delle modifiche ai file (con snapshot periodici)
+typedef struct fsp_wal* WAL;
 
 // Strutture dati condivise tra i thread
 static FILES files = NULL;
-static FILES_QUEUE files_queue = NULL;
+static FILES_INDEX files_index = NULL;
+static BLOBS blobs = NULL;
+// Politica di rimpiazzamento dei file con un contenuto in memoria (un file creato viene aggiunto
+// quando riceve il contenuto)
+static EVICTION eviction = NULL;
+// File (creati o con un contenuto) con una scadenza
+static EXPIRY expiring = NULL;
 static CLIENTS clients = NULL;
 static SFD_QUEUE sfd_queue = NULL;
+static POOLS files_pool = NULL;
+// NULL se l'arena non è stata configurata
+static ARENA arena = NULL;
+// Pool (arena anonima) dei contenuti di grandi dimensioni, mappato con huge page e/o caricato all'avvio
+// NULL se non è stato configurato o se il server usa l'arena persistente
+static ARENA large_pool = NULL;
+// NULL se il tier su disco non è stato configurato
+static TIER tier = NULL;
+// NULL se il log delle modifiche non è stato configurato
+static WAL wal = NULL;
 
 // Il file di log
 static int log_file = -1;
 
 // Pipe per la comunicazione dei sfd dai thread worker al thread master
 static int pfd[2] = {-1, -1};
+// Pipe per la comunicazione al thread master dei sfd dei client con richieste differite completate (scrittura non bloccante)
+static int dfd[2] = {-1, -1};
+// Client le cui notifiche non sono state scritte sulla pipe dfd piena (files_mutex): il master thread li gestisce
+// alla successiva lettura dalla pipe, che non è vuota
+static fd_set dfd_missed;
+static int dfd_missed_max = -1;
+
+// Richieste LOCK differite in attesa della lock, in ordine di arrivo (lista, files_mutex)
+static struct fsp_client_deferred* lock_waiters = NULL;
+static struct fsp_client_deferred* lock_waiters_tail = NULL;
+// Numero delle richieste LOCK differite
+static unsigned long int deferred_locks = 0;
 
 // Mutex
-// files_mutex viene usato per l'accesso alle strutture dati files e files_queue
+// files_mutex viene usato per l'accesso alle strutture dati files, blobs, eviction, expiring, files_pool, agli insiemi dei file aperti
+// dai client e ai contatori dei riferimenti dei contenuti dei file
 // clients_mutex viene usato per l'accesso alle strutture dati clients e sfd_queue
 static pthread_mutex_t files_mutex;
 static pthread_mutex_t clients_mutex;
@@ -80,6 +165,10 @@ static pthread_mutex_t clients_mutex;
 // Variabili di condizione
 static pthread_cond_t sfd_queue_isNotEmpty;
 static pthread_cond_t lock_cmd_isNotLocked;
+// Segnalata (con files_mutex) quando l'occupazione della memoria supera la soglia superiore dell'espulsione in background
+static pthread_cond_t evictor_isNeeded;
+// Segnalata (con files_mutex) al termine di una promozione dal tier su disco (promoteFile)
+static pthread_cond_t promotion_isDone;
 
 // Struttura contenente i valori letti dal file di configurazione
 // Dopo la lettura del file di configurazione, l'accesso a questa struttura avviene in sola lettura
@@ -97,7 +186,49 @@ static struct {
     unsigned int max_conn;
     // Numero dei thread worker
     unsigned int worker_threads_num;
-} config_file = {"/tmp/file_storage.sk", "", 1000, 67108864, 16, 4};
+    // Indica se il contenuto dei file deve essere compresso (compression == 1) o meno (compression == 0)
+    // La capacità del server viene calcolata sulla dimensione dei file compressi
+    int compression;
+    // Nome del file contenente l'arena persistente (stringa vuota se i file non devono essere persistenti)
+    // I file memorizzati nell'arena vengono ripristinati al riavvio del server
+    char arena_file_name[UNIX_PATH_MAX];
+    // Directory del tier su disco (stringa vuota se i file espulsi non devono essere mantenuti su disco)
+    // I file espulsi dalla memoria vengono scritti nel tier e riportati in memoria quando vengono richiesti
+    char tier_dir_name[UNIX_PATH_MAX];
+    // Capacità massima del tier su disco in byte
+    // Di default è 1073741824 (1 GB)
+    unsigned long int tier_max_size;
+    // Directory del log delle modifiche e degli snapshot (stringa vuota se i file non devono essere persistenti)
+    // I file vengono ricostruiti dall'ultimo snapshot e dal log al riavvio del server
+    char wal_dir_name[UNIX_PATH_MAX];
+    // Livello di durabilità delle modifiche (FSP_WAL_DURABILITY_NONE, FSP_WAL_DURABILITY_ASYNC o FSP_WAL_DURABILITY_FSYNC)
+    int durability;
+    // Intervallo tra due snapshot dei file in secondi (0 se gli snapshot vengono eseguiti solo all'avvio e alla chiusura)
+    unsigned int snapshot_interval;
+    // Dimensione massima in byte (dopo l'eventuale compressione) dei contenuti incorporati nell'allocazione dei file
+    // (0 se i contenuti non devono essere incorporati)
+    // I contenuti non vengono incorporati se il server usa un'arena persistente
+    unsigned int inline_max_size;
+    // Tipo delle huge page del pool dei contenuti di grandi dimensioni (0, FSP_ARENA_THP o FSP_ARENA_HUGETLB)
+    int huge_pages;
+    // Indica se le pagine del pool dei contenuti di grandi dimensioni devono essere caricate all'avvio (prefault == 1) o meno (prefault == 0)
+    // Il pool viene creato (con capacità pari a STORAGE_MAX_SIZE) se huge_pages != 0 o prefault == 1
+    int prefault;
+    // Politica di rimpiazzamento dei file (FSP_EVICTION_FIFO, FSP_EVICTION_LRU, FSP_EVICTION_LFU, FSP_EVICTION_CLOCK, FSP_EVICTION_ARC, FSP_EVICTION_TINYLFU,
+    // FSP_EVICTION_GDSF o FSP_EVICTION_GDSF_BYTES)
+    int eviction_policy;
+    // Soglie superiore e inferiore dell'espulsione in background, in percentuale di FILES_MAX_NUM e STORAGE_MAX_SIZE
+    // (soglia superiore 0 se i file devono essere espulsi solo al raggiungimento dei limiti)
+    // Quando il numero dei file o la memoria occupata supera la soglia superiore, un thread dedicato espelle
+    // i contenuti nel tier su disco finché entrambi non scendono sotto la soglia inferiore
+    // L'espulsione in background avviene solo se il server usa un tier su disco
+    unsigned int eviction_high_watermark;
+    unsigned int eviction_low_watermark;
+    // Intervallo tra due scansioni dei file scaduti in millisecondi (0 se i file scaduti vengono rimossi solo quando
+    // vengono usati dai client o scelti come vittima dalla politica di rimpiazzamento)
+    unsigned int expiry_sweep_interval;
+} config_file = {"/tmp/file_storage.sk", "", 1000, 67108864, 16, 4, 0, "", "", 1073741824, "", FSP_WAL_DURABILITY_ASYNC, SNAPSHOT_DEF_INTERVAL, INLINE_DEF_MAX_SIZE, 0, 0, FSP_EVICTION_FIFO,
+                 0, EVICTION_DEF_LOW_WATERMARK, EXPIRY_DEF_SWEEP_INTERVAL};
 
 // Variabile che indica se il programma deve terminare (quit == 1) o meno (quit == 0)
 static volatile sig_atomic_t quit = 0;
@@ -105,12 +236,22 @@ static volatile sig_atomic_t quit = 0;
 static volatile sig_atomic_t accept_connections = 1;
 
 // Quando i thread worker sono in esecuzione, viene usato files_mutex per l'accesso alle variabili
-// files_num, storage_size, files_max_reached_num, storage_max_reached_size, e capacity_misses
+// files_num, storage_size, files_max_reached_num, storage_max_reached_size, capacity_misses e
+// alle variabili relative al tier su disco, ai file scaduti e ai file da rimuovere
 
-// Numero dei file presenti
+// Numero dei file presenti in memoria
 static unsigned int files_num = 0;
+// Numero dei file il cui contenuto viene riportato in memoria dal tier su disco (promoteFile)
+static unsigned int promotions_num = 0;
+// Numero dei file il cui contenuto si trova nel tier su disco
+static unsigned int spilled_files_num = 0;
 // Dimensione della memoria in bytes occupata dai file
+// I contenuti condivisi da più file (deduplicazione) vengono contati una sola volta
 static unsigned long int storage_size = 0;
+// Dimensione in bytes (compresa in storage_size) dei contenuti che restano allocati nei file da rimuovere
+// (file->remove == 1) finché non vengono chiusi da tutti i client: il contenuto di un file rimosso viene
+// rilasciato subito, tranne quando è incorporato nell'allocazione del file
+static unsigned long int pending_size = 0;
 
 // Numero di file massimo memorizzato nel server
 static unsigned int files_max_reached_num = 0;
@@ -118,19 +259,62 @@ static unsigned int files_max_reached_num = 0;
 static unsigned long int storage_max_reached_size = 0;
 // Numero di volte in cui l'algoritmo di rimpiazzamento della cache è stato eseguito per selezionare uno o più file vittima
 static unsigned int capacity_misses = 0;
+// Numero dei file rimossi mentre erano aperti da almeno un client e dimensione massima raggiunta da pending_size
+static unsigned int pending_removals = 0;
+static unsigned long int pending_max_reached_size = 0;
+// Numero dei file espulsi nel tier su disco (in totale e dal thread che esegue l'espulsione in background)
+static unsigned int tier_spills = 0;
+static unsigned int background_spills = 0;
+// Accessi ai file (OPEN*, READ e APPEND su file esistenti) serviti dalla memoria e dal tier su disco (hit)
+// Il rapporto tra gli accessi serviti dalla memoria e tutti gli accessi è la hit ratio della politica di rimpiazzamento
+static unsigned int memory_hits = 0;
+static unsigned int tier_hits = 0;
+// Accessi a file espulsi dal server in seguito a capacity miss (miss): sono gli accessi che il server
+// avrebbe potuto servire con una memoria o un tier su disco più grandi
+static unsigned int tier_misses = 0;
+// Valori hash dei nomi dei file espulsi dal server (0 se l'elemento è vuoto): insieme di dimensione limitata
+// indicizzato dal valore hash, un nome può essere sostituito da un altro
+static unsigned int rejected[REJECTED_SLOTS_NUM];
+// Byte dei file acceduti serviti dalla memoria e dal tier su disco
+// Il rapporto tra i byte serviti dalla memoria e tutti i byte dei file acceduti è la byte hit ratio (con il tier su disco)
+static unsigned long int memory_hit_bytes = 0;
+static unsigned long int tier_hit_bytes = 0;
+// Numero dei file scaduti rimossi durante i comandi dei client (all'uso o da un capacity miss)
+// e in background (dal thread che esegue la scansione dei file scaduti e da quello che esegue l'espulsione)
+static unsigned int lazy_expirations = 0;
+static unsigned int active_expirations = 0;
+
+// Variabili relative agli snapshot (usate solo dal thread che esegue gli snapshot)
+// Numero degli snapshot eseguiti
+static unsigned int snapshots_num = 0;
+// Tempo totale impiegato per eseguire gli snapshot e tempo totale in cui i file sono rimasti bloccati (in secondi)
+static double snapshots_time = 0;
+static double snapshots_lock_time = 0;
+// Numero totale delle pagine copiate (copy-on-write) durante gli snapshot
+static unsigned long int snapshots_cow_pages = 0;
+
+// Esito di uno snapshot (comunicato dal processo figlio che lo scrive)
+struct snapshot_result {
+    // 0 in caso di successo, -1 altrimenti
+    int err;
+    // Numero dei file contenuti nello snapshot
+    unsigned long int files_num;
+    // Pagine copiate (copy-on-write) durante la scrittura dello snapshot
+    unsigned long int cow_pages;
+};
 
 // Numero dei thread worker attivi (usata con clients_mutex quando i worker thread sono in esecuzione)
 static unsigned int active_workers = 0;
 
 /**
- * \brief Libera dalla memoria ogni struttura dati condivisa (files, files_queue, clients, sfd_queue)
+ * \brief Libera dalla memoria ogni struttura dati condivisa (files, eviction, expiring, clients, sfd_queue, files_pool)
  *        assieme ai suoi elementi e chiude tutte le connessioni attive con i client.
  */
 static void freeAll(void);
 
 /**
  * \brief Distrugge tutti i mutex (files_mutex, clients_mutex) e
- *        tutte le variabili di condizione (sfd_queue_isNotEmpty, lock_cmd_isNotLocked).
+ *        tutte le variabili di condizione (sfd_queue_isNotEmpty, lock_cmd_isNotLocked, evictor_isNeeded).
  */
 static void destroyAll(void);
 
@@ -141,10 +325,195 @@ static void destroyAll(void);
 static void closeLogFile(void);
 
 /**
- * \brief Chiude la pipe pfd.
+ * \brief Ripristina i file contenuti nell'arena (contenuti e record dei file) e, se necessario,
+ *        espelle i file che non rispettano i limiti della configurazione corrente.
+ */
+static void restoreFiles(void);
+
+/**
+ * \brief Inizializza i campi non persistenti del contenuto obj dell'arena.
+ */
+static void restoreBlob(void* obj, void* arg);
+
+/**
+ * \brief Ricostruisce il file dal record obj dell'arena e lo inserisce nelle strutture dati del server.
+ */
+static void restoreFile(void* obj, void* arg);
+
+/**
+ * \brief Rimuove dall'arena il contenuto obj se non è referenziato da alcun file.
+ */
+static void removeUnreferencedBlob(void* obj, void* arg);
+
+/**
+ * \brief Ricostruisce i file dall'ultimo snapshot e dal log delle modifiche (usando config_file.worker_threads_num thread)
+ *        e, se necessario, espelle i file che non rispettano i limiti della configurazione corrente.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se non è stato possibile leggere il log o allocare la memoria.
+ */
+static int recoverFiles(void);
+
+/**
+ * \brief Funzione eseguita dai thread che ricostruiscono i file: applica i record del log
+ *        relativi ai file della propria partizione (struct recovery_arg).
+ */
+static void* recoveryWorker(void* arg);
+
+/**
+ * \brief Restituisce il valore hash del nome pathname (usato per partizionare i file tra i thread di ricostruzione).
+ */
+static unsigned int pathnameHash(const char* pathname);
+
+/**
+ * \brief Libera file, ricostruito dal log (non preso da files_pool), dalla memoria.
+ */
+static void freeRecoveredFile(FSP_FILE file);
+
+/**
+ * \brief Aggiunge al log delle modifiche (se configurato) un record di tipo type relativo a file.
+ *        I record FSP_WAL_WRITE contengono il contenuto di file, i record FSP_WAL_EXPIRE la scadenza di file,
+ *        i record FSP_WAL_APPEND i data_len byte di data.
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ */
+static void logFileChange(unsigned int type, const FSP_FILE file, const void* data, size_t data_len);
+
+/**
+ * \brief Esegue lo snapshot dei file: in mutua esclusione (files_mutex) passa a un nuovo segmento del log,
+ *        alloca lo snapshot e l'iteratore dei file e crea con fork() un processo figlio che scrive lo snapshot
+ *        su disco (writeSnapshot), quindi attende l'esito dello snapshot senza bloccare l'accesso ai file.
+ *
+ * \return 0 in caso di successo,
+ *         -1 altrimenti.
+ */
+static int takeSnapshot(void);
+
+/**
+ * \brief Funzione eseguita dal processo figlio creato da takeSnapshot: scrive in snapshot i file restituiti
+ *        da iterator, scrive l'esito (struct snapshot_result) in fd e termina il processo.
+ *        Il processo padre è multithread: il processo figlio non alloca memoria e non usa stdio né mutex
+ *        (potrebbero essere stati acquisiti da altri thread al momento della fork()).
+ */
+static void writeSnapshot(struct fsp_wal_snapshot* snapshot, struct fsp_files_hash_table_iterator* iterator, int fd);
+
+/**
+ * \brief Restituisce il numero delle pagine di memoria del processo non più condivise con il processo padre
+ *        (copiate in seguito a copy-on-write o allocate dopo la fork()). Non alloca memoria e non usa stdio.
+ */
+static unsigned long int cowPages(void);
+
+/**
+ * \brief Esegue uno snapshot dei file ogni config_file.snapshot_interval secondi.
+ */
+static void* snapshotter(void* arg);
+
+/**
+ * \brief Espelle nel tier su disco i contenuti dei file scelti dalla politica di rimpiazzamento quando il numero dei file
+ *        o la memoria occupata supera la soglia superiore, finché entrambi non scendono sotto la soglia inferiore.
+ *        files_mutex viene rilasciato dopo ogni file espulso, in modo che i thread worker non attendano l'intera espulsione.
+ */
+static void* evictor(void* arg);
+
+/**
+ * \brief Rimuove ogni config_file.expiry_sweep_interval millisecondi i file scaduti scelti a caso tra i file
+ *        con una scadenza (sweepExpired).
+ */
+static void* expirer(void* arg);
+
+/**
+ * \brief Sceglie a caso EXPIRY_SAMPLE_SIZE file con una scadenza e rimuove quelli scaduti (expireFile), ripetendo la scelta
+ *        (al massimo EXPIRY_SAMPLES_MAX volte) finché più di un quarto dei file scelti è scaduto.
+ *        Se unused_only == 1, allora i file aperti da almeno un client non vengono rimossi (il chiamante può usarli).
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ *
+ * \return Il numero dei file scaduti rimossi.
+ */
+static unsigned int sweepExpired(int unused_only);
+
+/**
+ * \brief Restituisce 1 se file è scaduto all'istante now (secondi dall'epoch), 0 altrimenti.
+ */
+static int isExpired(const FSP_FILE file, time_t now);
+
+/**
+ * \brief Rimuove il file scaduto file dal server (come il comando REMOVE) e scrive il messaggio EXPIRED_FILE
+ *        nel file di log. Se file non è aperto da alcun client, allora viene liberato dalla memoria, altrimenti
+ *        viene rimosso alla chiusura (file->remove == 1).
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ *
+ * \return file se non è stato liberato,
+ *         NULL altrimenti.
+ */
+static FSP_FILE expireFile(FSP_FILE file);
+
+/**
+ * \brief Se file è scaduto, allora lo rimuove dal server (expireFile).
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ *
+ * \return file se non è scaduto o non è stato liberato,
+ *         NULL se file == NULL || file è stato liberato.
+ */
+static FSP_FILE checkExpiry(FSP_FILE file);
+
+/**
+ * \brief Imposta la scadenza di file a expires (secondi dall'epoch, 0 se il file non scade), aggiornando l'insieme
+ *        dei file con una scadenza e il record del file nell'arena.
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ *
+ * \return 0 in caso di successo,
+ *         -1 se non è stato possibile allocare la memoria (la scadenza non viene cambiata).
+ */
+static int setFileExpiry(FSP_FILE file, unsigned int expires);
+
+/**
+ * \brief Separa dall'argomento arg dei comandi OPENC, OPENCL, WRITE e TOUCH il TTL (" TTL" alla fine, terminando arg
+ *        prima dello spazio) e salva in *expires la scadenza corrispondente (0 se il TTL è 0).
+ *        Il TTL è l'ultimo campo di arg composto solo da cifre: il nome del file può contenere spazi.
+ *
+ * \return 1 se arg contiene un TTL valido,
+ *         0 se arg == NULL || arg non contiene un TTL (*expires non viene modificato),
+ *         -1 se il TTL non è valido.
+ */
+static int parseTTL(char* arg, unsigned int* expires);
+
+/**
+ * \brief Chiude le pipe pfd e dfd.
  */
 static void closePipe(void);
 
+/**
+ * \brief Aggiunge file alla tabella hash dei file e all'indice dei nomi.
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ *
+ * \return 0 in caso di successo,
+ *         -1 se il file è già presente || non è stato possibile allocare la memoria (file non viene aggiunto).
+ */
+static int insertFile(FSP_FILE file);
+
+/**
+ * \brief Rimuove file dalla tabella hash dei file, dall'indice dei nomi e dall'insieme dei file con una scadenza.
+ *        Se file è da rimuovere (file->remove == 1), allora sottrae da storage_size e pending_size il suo contenuto
+ *        incorporato (setRemovePending): il chiamante deve liberarlo dalla memoria.
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ */
+static void deleteFile(FSP_FILE file);
+
+/**
+ * \brief Segna file, aperto da almeno un client e privo di contenuto, come da rimuovere quando verrà chiuso
+ *        da tutti i client (file->remove == 1). Il contenuto incorporato nell'allocazione del file resta in memoria
+ *        fino ad allora e viene contato in storage_size e pending_size (deleteFile lo sottrae).
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ */
+static void setRemovePending(FSP_FILE file);
+
+/**
+ * \brief Sostituisce file con new_file (con lo stesso nome) nella tabella hash dei file, nell'indice dei nomi,
+ *        nell'insieme dei file con una scadenza e nell'insieme dei file aperti da client (new_file riceve il descrittore di file).
+ *        file non deve trovarsi nella coda né essere aperto da altri client.
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ */
+static void replaceFile(CLIENT client, FSP_FILE file, FSP_FILE new_file);
+
 /**
  * \brief Libera file dalla memoria.
  */
@@ -160,6 +529,12 @@ static void printAndRemoveFile(FSP_FILE file);
  */
 static void removeClient(CLIENT client);
 
+/**
+ * \brief Chiude opened_file, rimosso dall'insieme dei file aperti del client arg
+ *        (rilascia la lock e rimuove il file se necessario).
+ */
+static void closeFile(FSP_FILE opened_file, void* arg);
+
 /**
  * \brief Chiude la connessione con il socket file descriptor di client e chiude i file aperti da client.
  *        Stampa nel file di log l'avvenuta chiusura della connessione.
@@ -167,6 +542,47 @@ static void removeClient(CLIENT client);
  */
 static void closeConnection(CLIENT client, const char* error_descr);
 
+/**
+ * \brief Notifica il rilascio della lock di file o la sua rimozione (file->remove == 1): risveglia i thread in attesa
+ *        della lock e completa, in ordine di arrivo, le richieste LOCK differite su file finché la lock è libera
+ *        o appartiene al client della richiesta (con codice 550 se file deve essere rimosso).
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ */
+static void lockReleased(FSP_FILE file);
+
+/**
+ * \brief Completa con codice 556 le richieste LOCK differite di client su file (su tutti i file se file == NULL).
+ *        Deve essere chiamata in mutua esclusione (files_mutex) prima che client chiuda file.
+ */
+static void cancelDeferredLocks(CLIENT client, FSP_FILE file);
+
+/**
+ * \brief Completa con codice 556 le richieste LOCK differite in attesa da almeno LOCK_WAIT_MAX_TIME secondi
+ *        (tutte se all != 0). Deve essere chiamata in mutua esclusione (files_mutex).
+ */
+static void expireDeferredLocks(int all);
+
+/**
+ * \brief Rimuove waiter (preceduto da prev, NULL se waiter è il primo) dalla lista delle richieste LOCK differite,
+ *        lo aggiunge con codice code alle richieste completate del suo client e comunica al master thread il client
+ *        (pipe dfd: se la pipe è piena, allora il client viene aggiunto a dfd_missed).
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ */
+static void completeDeferredLock(struct fsp_client_deferred* prev, struct fsp_client_deferred* waiter, int code);
+
+/**
+ * \brief Invia a client le risposte alle sue richieste differite completate e le scrive nel file di log.
+ *
+ * \return 0 in caso di successo,
+ *         -1 altrimenti.
+ */
+static int sendDeferredResps(int thread_id, CLIENT client);
+
+/**
+ * \brief Restituisce 1 se fd ha dati da leggere (o ha raggiunto EOF) senza bloccarsi, 0 altrimenti.
+ */
+static int isReadable(int fd);
+
 /**
  * \brief Gestore dei segnali.
  */
@@ -187,10 +603,21 @@ static int parseConfigFile(char* path);
  * L'esito del comando viene determinato in base al codice di risposta fsp resp_code.
  * Se il comando di richiesta è APPEND, READ, READN, REMOVE o WRITE e il codice di risposta è 200,
  * allora stampa tra parentesi anche il numero di byte letti/scritti/rimossi.
+ * L'argomento req->arg deve contenere il nome del file e non il suo descrittore (logArg).
+ * Se req->arg == NULL (messaggio di richiesta non letto) stampa UNKNOWN al posto del comando.
  * Non stampa nulla se client == NULL || req == NULL.
  */
 static void updateLogFile(int thread_id, const CLIENT client, const struct fsp_request* req, int resp_code, unsigned long int bytes);
 
+/**
+ * \brief Restituisce l'argomento arg della richiesta di client da stampare nel file di log: se arg è il descrittore
+ *        di un file aperto dal client (seguito eventualmente dal TTL), allora copia in buf (di lunghezza LOG_FILE_MSG_LEN)
+ *        il nome del file e restituisce buf, altrimenti restituisce arg. I descrittori sono propri di ogni client
+ *        e vengono riusati, quindi non identificano il file nel log.
+ *        Deve essere chiamata prima di eseguire il comando (CLOSE rilascia il descrittore).
+ */
+static const char* logArg(const CLIENT client, const char* arg, char* buf);
+
 /**
  * \brief Risveglia ogni 2 secondi i thread che si trovano in stato di attesa sulla variabile di condizione lock_cmd_isNotLocked.
  */
@@ -211,12 +638,16 @@ static void* worker(void* arg);
  *         -2 in caso di errori durante la lettura (read() setta errno appropriatamente),
  *         -3 se sfd ha raggiunto EOF senza aver letto un messaggio di richiesta,
  *         -4 se il messaggio contiene errori sintattici,
- *         -5 se è stato impossibile riallocare il buffer (memoria insufficiente).
+ *         -5 se è stato impossibile riallocare il buffer (memoria insufficiente),
+ *         -6 se l'intestazione di un messaggio binario non è valida (i messaggi successivi non possono essere delimitati).
  */
 static int receiveFspReq(CLIENT client, struct fsp_request* req);
 
 /**
  * \brief Scrive su sfd un messaggio di risposta fsp con i campi code, description, data_len e data.
+ *        Se client ha delle parti del campo data (file espulsi da capacityMiss), allora data_len e data
+ *        vengono ignorati: il campo data è formato dalle parti, inviate con writev senza copiarle in client->buf
+ *        (i contenuti compressi vengono decompressi qui, senza mutua esclusione).
  *
  * \return 0 in caso di successo,
  *         -1 altrimenti.
@@ -224,34 +655,263 @@ static int receiveFspReq(CLIENT client, struct fsp_request* req);
 static int sendFspResp(CLIENT client, int code, const char* description, size_t data_len, void* data);
 
 /**
- * \brief Rimuove i file dal server in seguito a capacity miss e li salva nel formato fsp del campo data in *data.
- *        Se data_len != NULL, allora salva in *data_len la lunghezza di *data.
+ * \brief Scrive su sfd un messaggio di risposta fsp con i campi code e description e con le parti di client come campo data.
+ *
+ * \return 0 in caso di successo,
+ *         -1 altrimenti.
+ */
+static int sendFspParts(CLIENT client, int code, const char* description);
+
+/**
+ * \brief Libera le parti del campo data della risposta a client dopo l'invio
+ *        (i riferimenti ai contenuti vengono rilasciati in mutua esclusione).
+ */
+static void releaseParts(CLIENT client);
+
+/**
+ * \brief Rimuove i file dal server in seguito a capacity miss e li aggiunge nel formato fsp del campo data
+ *        alle parti della risposta a client (addEvictedFile). Se client == NULL, allora i file rimossi non vengono restituiti.
  *
  * \return 0 in caso di successo,
  *         -1 altrimenti.
  */
-static int capacityMiss(void** data, size_t* data_len);
+static int capacityMiss(CLIENT client);
+
+/**
+ * \brief Aggiunge file nel formato fsp del campo data alle parti della risposta a client.
+ *        Se il contenuto di file non è condiviso con altri file né incorporato, allora viene staccato da file
+ *        (come releaseFileData) e passato alla risposta per riferimento: il costo non dipende dalla dimensione del file.
+ *        Altrimenti il contenuto viene copiato (come makeFileData).
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ *
+ * \return 0 in caso di successo,
+ *         -1 se non è stato possibile allocare la memoria.
+ */
+static int addEvictedFile(CLIENT client, FSP_FILE file);
+
+/**
+ * \brief Aggiunge alle parti della risposta a client i len byte di data; buf e blob (se diversi da NULL)
+ *        vengono liberati dopo l'invio (releaseParts).
+ *
+ * \return 0 in caso di successo,
+ *         -1 se non è stato possibile allocare la memoria.
+ */
+static int addPart(CLIENT client, const void* data, size_t len, void* buf, BLOB blob);
+
+/**
+ * \brief Espelle il contenuto di file nel tier su disco (file->spilled == 1 dopo la chiamata).
+ *        Se il contenuto è condiviso con altri file, allora il tier ne riceve una copia.
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ *
+ * \return 0 in caso di successo,
+ *         -1 se il tier non è configurato || file non ha un contenuto || il tier non ha spazio sufficiente ||
+ *               non è stato possibile allocare la memoria,
+ *         -2 se troppi contenuti sono in attesa di essere scritti su disco (fsp_tier_spill non attende).
+ */
+static int spillFile(FSP_FILE file);
+
+/**
+ * \brief Espelle nel tier su disco il contenuto del file vittima file (già rimosso dalla politica di rimpiazzamento),
+ *        aggiorna i contatori dei file e scrive il messaggio SPILLED_FILE nel file di log.
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ *
+ * \return 0 in caso di successo,
+ *         -1 se non è stato possibile espellere il contenuto,
+ *         -2 se troppi contenuti sono in attesa di essere scritti su disco (spillFile).
+ */
+static int spillVictim(FSP_FILE file);
+
+/**
+ * \brief Restituisce 1 se il numero dei file in memoria o la memoria occupata supera percent per cento
+ *        del proprio limite, 0 altrimenti.
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ */
+static int aboveWatermark(unsigned int percent);
+
+/**
+ * \brief Registra un accesso a file, aperto da client, e, se il suo contenuto si trova nel tier su disco, lo riporta
+ *        in memoria espellendo altri file se necessario (capacityMiss: i file espulsi vengono restituiti a client).
+ *        Il contenuto viene letto dal tier senza mutua esclusione (files_mutex viene rilasciato durante la lettura,
+ *        come durante la decompressione in sendFspParts): al ritorno il chiamante deve controllare di nuovo lo stato
+ *        di file che può essere cambiato nel frattempo (lock). file non viene liberato perché è aperto da client.
+ *        Deve essere chiamata in mutua esclusione (files_mutex acquisito una sola volta).
+ *
+ * \return 0 in caso di successo,
+ *         -1 se non è stato possibile leggere il contenuto dal tier,
+ *         -2 se l'algoritmo di rimpiazzamento della cache (capacityMiss) ha riscontrato errori,
+ *         -3 se file è stato rimosso durante la lettura (file->remove == 1).
+ */
+static int promoteFile(CLIENT client, FSP_FILE file);
+
+/**
+ * \brief Lettura del contenuto di un file espulso nel tier su disco aggiunto alla risposta di un comando READ o READN
+ *        (readSpilled).
+ */
+struct spilled_read {
+    // File letto
+    FSP_FILE file;
+    // Posizione e lunghezza del file nel formato fsp nel buffer della risposta (makeFileData)
+    size_t start;
+    size_t len;
+    // Dimensione del contenuto
+    size_t size;
+    // Esito della lettura: 0 se il contenuto è stato letto, 1 se non è stato possibile leggerlo,
+    // 2 se il file è stato rimosso durante la lettura
+    int err;
+};
+
+/**
+ * \brief Legge dal tier su disco i contenuti dei reads_num file di reads, per i quali makeFileData ha riservato lo spazio
+ *        in buf (di lunghezza len). files_mutex viene rilasciato durante le letture: i file vengono collegati (links)
+ *        per non essere liberati. Se un contenuto è stato riportato in memoria durante la lettura, allora viene letto
+ *        dalla memoria; un file il cui contenuto non è stato letto viene tolto da buf (reads[i].err != 0).
+ *        Deve essere chiamata in mutua esclusione (files_mutex acquisito una sola volta).
+ *
+ * \return La lunghezza di buf dopo la rimozione dei file non letti.
+ */
+static size_t readSpilled(void* buf, size_t len, struct spilled_read* reads, size_t reads_num);
+
+/**
+ * \brief Aggiunge pathname, nome di un file espulso dal server in seguito a capacity miss, all'insieme rejected.
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ */
+static void rememberRejected(const char* pathname);
+
+/**
+ * \brief Rimuove pathname dall'insieme rejected.
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ *
+ * \return 1 se pathname si trovava nell'insieme,
+ *         0 altrimenti.
+ */
+static int forgetRejected(const char* pathname);
+
+/**
+ * \brief Conta un miss se arg è il nome di un file espulso dal server in seguito a capacity miss (forgetRejected):
+ *        gli accessi a file inesistenti o rimossi dai client non sono miss.
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ */
+static void countMiss(const char* arg);
+
+/**
+ * \brief Cerca il file identificato da arg per il client client: arg è il nome del file oppure,
+ *        se inizia con FSP_PARSER_HANDLE_PREFIX, il descrittore restituito al client da un comando OPEN*
+ *        (risolto in tempo costante mediante l'insieme dei file aperti dal client).
+ *        Se il file è scaduto, allora viene rimosso (checkExpiry).
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ *
+ * \return Il file,
+ *         NULL se il file non è stato trovato || il descrittore non è valido.
+ */
+static FSP_FILE searchFile(const CLIENT client, const char* arg);
+
+/**
+ * \brief Salva in resp la risposta (codice 200) dei comandi OPEN* terminati con successo
+ *        aggiungendo alla descrizione il descrittore handle del file aperto (se handle >= 0).
+ */
+static void openSucceeded(struct fsp_response* resp, long int handle, const size_t descr_max_len);
+
+/**
+ * \brief Associa a file il contenuto data, condividendo un contenuto uguale già presente sul server (deduplicazione).
+ *        Se il contenuto viene condiviso, allora data non viene usato e deve essere liberato dal chiamante
+ *        (*unused == data), altrimenti *unused == NULL. Aggiorna storage_size.
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ */
+static void setFileData(FSP_FILE file, BLOB data, BLOB* unused);
+
+/**
+ * \brief Se il contenuto data può essere incorporato (data->stored_size <= config_file.inline_max_size e
+ *        il server non usa un'arena), restituisce una copia di file con una copia di data incorporata nella
+ *        propria allocazione (fsp_file_embed) e aggiorna storage_size. Il contenuto incorporato non viene
+ *        condiviso con altri file. file (privo di contenuto) e data non vengono modificati.
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ *
+ * \return La copia di file,
+ *         NULL se il contenuto non può essere incorporato || non è stato possibile allocare la memoria.
+ */
+static FSP_FILE embedFileData(FSP_FILE file, BLOB data);
+
+/**
+ * \brief Restituisce l'arena in cui allocare un contenuto di size byte: l'arena persistente (se configurata),
+ *        il pool dei contenuti di grandi dimensioni se size >= LARGE_POOL_MIN_SIZE, altrimenti NULL (malloc()).
+ */
+static ARENA blobArena(size_t size);
+
+/**
+ * \brief Rilascia il contenuto di file (file->data == NULL dopo la chiamata). Se il contenuto non è più
+ *        referenziato da altri file, allora lo rimuove dal server e aggiorna storage_size.
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ */
+static void releaseFileData(FSP_FILE file);
+
+/**
+ * \brief Come releaseFileData, ma restituisce il contenuto di file senza rilasciarne il riferimento
+ *        (NULL se file->data == NULL). Deve essere chiamata in mutua esclusione (files_mutex).
+ */
+static BLOB takeFileData(FSP_FILE file);
+
+/**
+ * \brief Aggiunge file a *buf nel formato fsp del campo data (come fsp_parser_makeData),
+ *        decomprimendo il suo contenuto direttamente in *buf se necessario. Se il contenuto di file è stato
+ *        espulso nel tier su disco, allora il suo spazio viene riservato ma non scritto (readSpilled).
+ *        Deve essere chiamata in mutua esclusione (files_mutex).
+ *
+ * \return Il numero di byte scritti in *buf,
+ *         valore negativo in caso di errore.
+ */
+static long int makeFileData(void** buf, size_t* size, unsigned long int offset, const FSP_FILE file);
+
+/**
+ * \brief Argomento della funzione listFile (elenco generato dal comando LIST).
+ */
+struct list_arg {
+    // Istante dell'elenco (i file scaduti non vengono elencati)
+    time_t now;
+    // Buffer in cui viene scritto l'elenco
+    void* buf;
+    size_t size;
+    size_t len;
+    // Numero massimo dei file da elencare e numero dei file elencati
+    long int limit;
+    long int listed;
+    // Indica se non è stato possibile scrivere l'elenco
+    int err;
+};
+
+/**
+ * \brief Aggiunge il nome e la dimensione di file all'elenco arg (struct list_arg), a meno che il file non debba essere rimosso
+ *        o sia scaduto.
+ *
+ * \return 0 se la visita dell'indice deve continuare,
+ *         1 se l'elenco è completo o in caso di errore.
+ */
+static int listFile(FSP_FILE file, void* arg);
 
 /* Funzioni che eseguono i comandi richiesti dai client e restituiscono un messaggio di risposta.
  * Prendono in input le informazioni del client (client), la request req, la response resp
  * in cui salvano i campi del messaggio di risposta fsp e la lunghezza massima del campo descrizione in resp descr_max_len.
  * append_cmd, read_cmd, readn_cmd e write_cmd possono allocare memoria per il campo data in resp (resp->data). In tal caso
- * il valore restituito dalla funzione sarà maggiore di zero. Liberare resp->data dalla memoria con free().
+ * il valore restituito dalla funzione sarà maggiore di zero. Anche list_cmd può allocare memoria per il campo data in resp
+ * (restituendo zero). Liberare resp->data dalla memoria con free().
  * Se non viene allocata memoria per il campo data, allora resp->data sarà uguale a NULL.
  * Stampa nel file di log l'avvenuto capacity miss.
  *
- * Le funzioni close_cmd, lock_cmd, open_cmd, openc_cmd, opencl_cmd, openl_cmd e unlock_cmd restituiscono zero in caso di successo.
+ * Le funzioni close_cmd, list_cmd, lock_cmd, open_cmd, openc_cmd, opencl_cmd, openl_cmd, touch_cmd e unlock_cmd restituiscono zero in caso di successo.
+ * La funzione lock_cmd restituisce 1 se la richiesta (protocollo versione 2) è stata differita perché la lock è detenuta da
+ * un altro client: la risposta, con l'identificativo della richiesta, verrà inviata da sendDeferredResps.
  * Le funzioni append_cmd, read_cmd, readn_cmd, remove_cmd e write_cmd restituiscono un valore maggiore o uguale a zero che indica
  * il numero di byte letti/scritti/rimossi.
  * Se restituiscono -1 (errore), allora il relativo comando non è stato eseguito e
  * i valori salvati in resp non sono significativi.
- * Le funzioni append_cmd, openc_cmd, opencl_cmd e write_cmd restituiscono -2 se l'algoritmo di rimpiazzamento della cache
- * (capacityMiss) ha riscontrato errori.
+ * Le funzioni append_cmd, open_cmd, openc_cmd, opencl_cmd, openl_cmd, read_cmd e write_cmd restituiscono -2 se l'algoritmo
+ * di rimpiazzamento della cache (capacityMiss) ha riscontrato errori.
  */
 static unsigned long int append_cmd(CLIENT client, const struct fsp_request* req, struct fsp_response* resp, const size_t descr_max_len);
 
 static int close_cmd(CLIENT client, const struct fsp_request* req, struct fsp_response* resp, const size_t descr_max_len);
 
+static int list_cmd(CLIENT client, const struct fsp_request* req, struct fsp_response* resp, const size_t descr_max_len);
+
 static int lock_cmd(CLIENT client, const struct fsp_request* req, struct fsp_response* resp, const size_t descr_max_len);
 
 static int open_cmd(CLIENT client, const struct fsp_request* req, struct fsp_response* resp, const size_t descr_max_len);
@@ -268,6 +928,8 @@ static unsigned long int readn_cmd(CLIENT client, const struct fsp_request* req,
 
 static unsigned long int remove_cmd(CLIENT client, const struct fsp_request* req, struct fsp_response* resp, const size_t descr_max_len);
 
+static int touch_cmd(CLIENT client, const struct fsp_request* req, struct fsp_response* resp, const size_t descr_max_len);
+
 static int unlock_cmd(CLIENT client, const struct fsp_request* req, struct fsp_response* resp, const size_t descr_max_len);
 
 static unsigned long int write_cmd(CLIENT client, const struct fsp_request* req, struct fsp_response* resp, const size_t descr_max_len);
@@ -316,6 +978,20 @@ int main(int argc, const char* argv[]) {
             printf("\tSTORAGE_MAX_SIZE=%lu\n", config_file.storage_max_size/1048576);
             printf("\tMAX_CONN=%d\n", config_file.max_conn);
             printf("\tWORKER_THREADS_NUM=%d\n", config_file.worker_threads_num);
+            printf("\tCOMPRESSION=%d\n", config_file.compression);
+            printf("\tARENA_FILE_NAME=%s\n", config_file.arena_file_name);
+            printf("\tTIER_DIR_NAME=%s\n", config_file.tier_dir_name);
+            printf("\tTIER_MAX_SIZE=%lu\n", config_file.tier_max_size/1048576);
+            printf("\tWAL_DIR_NAME=%s\n", config_file.wal_dir_name);
+            printf("\tDURABILITY=%s\n", config_file.durability == FSP_WAL_DURABILITY_NONE ? "none" : (config_file.durability == FSP_WAL_DURABILITY_ASYNC ? "async" : "fsync"));
+            printf("\tSNAPSHOT_INTERVAL=%u\n", config_file.snapshot_interval);
+            printf("\tINLINE_MAX_SIZE=%u\n", config_file.inline_max_size);
+            printf("\tHUGE_PAGES=%s\n", config_file.huge_pages == 0 ? "none" : (config_file.huge_pages == FSP_ARENA_THP ? "thp" : "hugetlb"));
+            printf("\tPREFAULT=%d\n", config_file.prefault);
+            printf("\tEVICTION_POLICY=%s\n", fsp_eviction_name(config_file.eviction_policy));
+            printf("\tEVICTION_HIGH_WATERMARK=%u\n", config_file.eviction_high_watermark);
+            printf("\tEVICTION_LOW_WATERMARK=%u\n", config_file.eviction_low_watermark);
+            printf("\tEXPIRY_SWEEP_INTERVAL=%u\n", config_file.expiry_sweep_interval);
             break;
         case -2:
             // Errore di sintassi
@@ -343,7 +1019,11 @@ int main(int argc, const char* argv[]) {
     
     // Inizializza le strutture dati
     if((files = fsp_files_hash_table_new(FSP_FILES_HASH_TABLE_SIZE)) == NULL ||
-       (files_queue = fsp_files_queue_new()) == NULL ||
+       (files_index = fsp_files_index_new()) == NULL ||
+       (blobs = fsp_blobs_hash_table_new(FSP_BLOBS_HASH_TABLE_SIZE)) == NULL ||
+       (eviction = fsp_eviction_new(config_file.eviction_policy, config_file.files_max_num + 1)) == NULL ||
+       (expiring = fsp_expiry_new(0)) == NULL ||
+       (files_pool = fsp_pools_new(FSP_POOL_BLOCK_LEN)) == NULL ||
        (clients = fsp_clients_hash_table_new(FSP_CLIENTS_HASH_TABLE_SIZE)) == NULL ||
        (sfd_queue = fsp_sfd_queue_new(config_file.max_conn)) == NULL) {
         fprintf(stderr, "Errore: memoria insufficiente.\n");
@@ -388,52 +1068,162 @@ int main(int argc, const char* argv[]) {
         closeLogFile();
         return -1;
     }
-    // Pipe senza nome per la comunicazione tra i thread worker e il thread master
-    if(pipe(pfd) != 0) {
-        fprintf(stderr, "Errore: pipe non creata.\n");
-        destroyAll();
+    if(pthread_cond_init(&evictor_isNeeded, NULL) != 0) {
+        fprintf(stderr, "Errore: variabile di condizione non creata.\n");
+        pthread_mutex_destroy(&files_mutex);
+        pthread_mutex_destroy(&clients_mutex);
+        pthread_cond_destroy(&sfd_queue_isNotEmpty);
+        pthread_cond_destroy(&lock_cmd_isNotLocked);
         freeAll();
         closeLogFile();
         return -1;
     }
-    printf("Strutture dati inizializzate.\n");
-    
-    // Imposta la gestione dei segnali
-    struct sigaction sa;
-    sigset_t mask;
-    memset(&sa, 0, sizeof(sa));
-    sa.sa_handler = signalHandler;
-    sigfillset(&mask);
-    sa.sa_mask = mask;
-    if(sigaction(SIGINT, &sa, NULL) != 0 ||
-       sigaction(SIGQUIT, &sa, NULL) != 0 ||
-       sigaction(SIGHUP, &sa, NULL) != 0) {
-        perror(NULL);
-        destroyAll();
+    if(pthread_cond_init(&promotion_isDone, NULL) != 0) {
+        fprintf(stderr, "Errore: variabile di condizione non creata.\n");
+        pthread_mutex_destroy(&files_mutex);
+        pthread_mutex_destroy(&clients_mutex);
+        pthread_cond_destroy(&sfd_queue_isNotEmpty);
+        pthread_cond_destroy(&lock_cmd_isNotLocked);
+        pthread_cond_destroy(&evictor_isNeeded);
+        fprintf(stderr, "Errore: variabile di condizione non creata.\n");
+        pthread_mutex_destroy(&files_mutex);
+        pthread_mutex_destroy(&clients_mutex);
+        pthread_cond_destroy(&sfd_queue_isNotEmpty);
+        pthread_cond_destroy(&lock_cmd_isNotLocked);
         freeAll();
-        closePipe();
         closeLogFile();
         return -1;
     }
-    printf("Gestione dei segnali impostata.\n");
-    
-    // socket
-    int sfd;
-    if((sfd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
-        perror(NULL);
+    // Pipe senza nome per la comunicazione tra i thread worker e il thread master
+    if(pipe(pfd) != 0 || pipe(dfd) != 0 || fcntl(dfd[1], F_SETFL, O_NONBLOCK) != 0) {
+        fprintf(stderr, "Errore: pipe non creata.\n");
         destroyAll();
         freeAll();
-        closePipe();
         closeLogFile();
         return -1;
     }
-    printf("Socket di tipo SOCK_STREAM creato.\n");
-    // bind
-    struct sockaddr_un sockaddr;
-    sockaddr.sun_family = AF_UNIX;
-    strncpy(sockaddr.sun_path, config_file.socket_file_name, UNIX_PATH_MAX);
-    sockaddr.sun_path[UNIX_PATH_MAX-1] = '\0';
-    if(bind(sfd, (struct sockaddr*) &sockaddr, sizeof(sockaddr)) == -1) {
+    FD_ZERO(&dfd_missed);
+    printf("Strutture dati inizializzate.\n");
+    
+    // Crea il tier su disco per i file espulsi dalla memoria
+    // Crea il pool dei contenuti di grandi dimensioni (i contenuti dell'arena persistente sono allocati nell'arena)
+    if((config_file.huge_pages != 0 || config_file.prefault) && config_file.arena_file_name[0] == '\0') {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int flags = config_file.huge_pages | (config_file.prefault ? FSP_ARENA_PREFAULT : 0);
+        // Spazio aggiuntivo per l'arrotondamento dei blocchi alla loro classe di dimensione (al più il 25%)
+        if((large_pool = fsp_arena_new(config_file.storage_max_size + config_file.storage_max_size/4, flags)) == NULL) {
+            fprintf(stderr, "Errore: impossibile creare il pool dei contenuti di grandi dimensioni.\n");
+            destroyAll();
+            freeAll();
+            closePipe();
+            closeLogFile();
+            return -1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        printf("Pool dei contenuti di grandi dimensioni creato (%lu MB, prefault in %.3f s).\n", large_pool->capacity/1048576,
+               config_file.prefault ? (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)/1e9 : 0.0);
+    }
+    
+    if(config_file.tier_dir_name[0] != '\0') {
+        if((tier = fsp_tier_new(config_file.tier_dir_name, config_file.tier_max_size)) == NULL) {
+            fprintf(stderr, "Errore: impossibile creare il tier su disco %s.\n", config_file.tier_dir_name);
+            destroyAll();
+            freeAll();
+            closePipe();
+            closeLogFile();
+            return -1;
+        }
+        printf("Tier su disco %s creato.\n", config_file.tier_dir_name);
+    }
+    
+    // L'arena persistente e il log delle modifiche sono alternativi
+    if(config_file.arena_file_name[0] != '\0' && config_file.wal_dir_name[0] != '\0') {
+        fprintf(stderr, "Errore: ARENA_FILE_NAME e WAL_DIR_NAME non possono essere usati contemporaneamente.\n");
+        destroyAll();
+        freeAll();
+        closePipe();
+        closeLogFile();
+        return -1;
+    }
+    
+    // Apre il log delle modifiche e ricostruisce i file memorizzati durante l'esecuzione precedente
+    if(config_file.wal_dir_name[0] != '\0') {
+        if((wal = fsp_wal_open(config_file.wal_dir_name, config_file.durability)) == NULL) {
+            fprintf(stderr, "Errore: impossibile aprire il log %s.\n", config_file.wal_dir_name);
+            destroyAll();
+            freeAll();
+            closePipe();
+            closeLogFile();
+            return -1;
+        }
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if(recoverFiles() != 0 || takeSnapshot() != 0) {
+            fprintf(stderr, "Errore: impossibile ricostruire i file dal log %s.\n", config_file.wal_dir_name);
+            destroyAll();
+            freeAll();
+            closePipe();
+            closeLogFile();
+            return -1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        printf("Log %s aperto (%u file ricostruiti in %.3f s).\n", config_file.wal_dir_name, files_num + spilled_files_num,
+               (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)/1e9);
+    }
+    
+    // Apre l'arena persistente e ripristina i file memorizzati durante l'esecuzione precedente
+    if(config_file.arena_file_name[0] != '\0') {
+        int restored = 0;
+        size_t arena_capacity = config_file.storage_max_size*2 + (size_t) config_file.files_max_num*FSP_ARENA_FILE_RECORD_SIZE;
+        if((arena = fsp_arena_open(config_file.arena_file_name, arena_capacity, &restored)) == NULL) {
+            fprintf(stderr, "Errore: impossibile aprire l'arena %s.\n", config_file.arena_file_name);
+            destroyAll();
+            freeAll();
+            closePipe();
+            closeLogFile();
+            return -1;
+        }
+        if(restored) restoreFiles();
+        printf("Arena %s aperta (%u file ripristinati).\n", config_file.arena_file_name, files_num);
+    }
+    
+    // Imposta la gestione dei segnali
+    struct sigaction sa;
+    sigset_t mask;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = signalHandler;
+    sigfillset(&mask);
+    sa.sa_mask = mask;
+    if(sigaction(SIGINT, &sa, NULL) != 0 ||
+       sigaction(SIGQUIT, &sa, NULL) != 0 ||
+       sigaction(SIGHUP, &sa, NULL) != 0) {
+        perror(NULL);
+        destroyAll();
+        freeAll();
+        closePipe();
+        closeLogFile();
+        return -1;
+    }
+    printf("Gestione dei segnali impostata.\n");
+    
+    // socket
+    int sfd;
+    if((sfd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+        perror(NULL);
+        destroyAll();
+        freeAll();
+        closePipe();
+        closeLogFile();
+        return -1;
+    }
+    printf("Socket di tipo SOCK_STREAM creato.\n");
+    // bind
+    struct sockaddr_un sockaddr;
+    sockaddr.sun_family = AF_UNIX;
+    strncpy(sockaddr.sun_path, config_file.socket_file_name, UNIX_PATH_MAX);
+    sockaddr.sun_path[UNIX_PATH_MAX-1] = '\0';
+    if(bind(sfd, (struct sockaddr*) &sockaddr, sizeof(sockaddr)) == -1) {
         perror(NULL);
         destroyAll();
         freeAll();
@@ -501,6 +1291,61 @@ int main(int argc, const char* argv[]) {
         return -1;
     }
     
+    // Crea il thread che esegue periodicamente gli snapshot dei file
+    pthread_t snapshot_thread;
+    if(wal != NULL && pthread_create(&snapshot_thread, NULL, snapshotter, NULL) != 0) {
+        fprintf(stderr, "Errore: impossibile creare un nuovo thread.\n");
+        for(int i = 0; i < config_file.worker_threads_num; i++) {
+            pthread_detach(threads[i]);
+        }
+        pthread_detach(lock_cmd_broadcast_thread);
+        destroyAll();
+        freeAll();
+        close(sfd);
+        closePipe();
+        free(threads);
+        closeLogFile();
+        return -1;
+    }
+    
+    // Crea il thread che esegue l'espulsione in background
+    pthread_t evictor_thread;
+    int background_eviction = tier != NULL && config_file.eviction_high_watermark > 0;
+    if(background_eviction && pthread_create(&evictor_thread, NULL, evictor, NULL) != 0) {
+        fprintf(stderr, "Errore: impossibile creare un nuovo thread.\n");
+        for(int i = 0; i < config_file.worker_threads_num; i++) {
+            pthread_detach(threads[i]);
+        }
+        pthread_detach(lock_cmd_broadcast_thread);
+        if(wal != NULL) pthread_detach(snapshot_thread);
+        destroyAll();
+        freeAll();
+        close(sfd);
+        closePipe();
+        free(threads);
+        closeLogFile();
+        return -1;
+    }
+    
+    // Crea il thread che rimuove i file scaduti
+    pthread_t expirer_thread;
+    if(config_file.expiry_sweep_interval > 0 && pthread_create(&expirer_thread, NULL, expirer, NULL) != 0) {
+        fprintf(stderr, "Errore: impossibile creare un nuovo thread.\n");
+        for(int i = 0; i < config_file.worker_threads_num; i++) {
+            pthread_detach(threads[i]);
+        }
+        pthread_detach(lock_cmd_broadcast_thread);
+        if(wal != NULL) pthread_detach(snapshot_thread);
+        if(background_eviction) pthread_detach(evictor_thread);
+        destroyAll();
+        freeAll();
+        close(sfd);
+        closePipe();
+        free(threads);
+        closeLogFile();
+        return -1;
+    }
+    
     // select
     int ready_descriptors_num;
     struct timeval timeout;
@@ -510,8 +1355,13 @@ int main(int argc, const char* argv[]) {
     FD_ZERO(&set);
     FD_SET(sfd, &set);
     FD_SET(pfd[0], &set);
+    FD_SET(dfd[0], &set);
     int fd_max = 0;
     if(pfd[0] > fd_max) fd_max = pfd[0];
+    if(dfd[0] > fd_max) fd_max = dfd[0];
+    // Client gestiti da un thread worker quando sono state completate delle loro richieste differite
+    fd_set notified;
+    FD_ZERO(&notified);
     if(sfd > fd_max) fd_max = sfd;
     int loop = 1;
     while(loop) {
@@ -535,6 +1385,9 @@ int main(int argc, const char* argv[]) {
                     pthread_detach(threads[i]);
                 }
                 pthread_detach(lock_cmd_broadcast_thread);
+                if(wal != NULL) pthread_detach(snapshot_thread);
+                if(background_eviction) pthread_detach(evictor_thread);
+                if(config_file.expiry_sweep_interval > 0) pthread_detach(expirer_thread);
                 destroyAll();
                 freeAll();
                 close(sfd);
@@ -615,7 +1468,7 @@ int main(int argc, const char* argv[]) {
                             fsp_clients_hash_table_insert(clients, client);
 
                             // Invia il messaggio di risposta fsp con codice 220
-                            if(sendFspResp(client, 220, "Service ready.", 0, NULL) != 0) {
+                            if(sendFspResp(client, 220, "Service ready. " FSP_PARSER_V2_TOKEN, 0, NULL) != 0) {
                                 close(fd_c);
                                 fsp_clients_hash_table_delete(clients, fd_c);
                                 fsp_client_free(client);
@@ -630,6 +1483,7 @@ int main(int argc, const char* argv[]) {
                             }
                             
                             FD_SET(fd_c, &set);
+                            FD_CLR(fd_c, &notified);
                             if(fd_c > fd_max) fd_max = fd_c;
                         }
                         pthread_mutex_unlock(&clients_mutex);
@@ -643,10 +1497,61 @@ int main(int argc, const char* argv[]) {
                             close(sfd);
                             loop = 0;
                             break;
+                        } else if(FD_ISSET(fd_c, &notified)) {
+                            // Il client ha richieste differite completate: lo affida subito a un thread worker
+                            // (sfd negativo: il client potrebbe non avere dati da leggere)
+                            FD_CLR(fd_c, &notified);
+                            pthread_mutex_lock(&clients_mutex);
+                            fsp_sfd_queue_enqueue(sfd_queue, -fd_c-1);
+                            pthread_cond_signal(&sfd_queue_isNotEmpty);
+                            pthread_mutex_unlock(&clients_mutex);
                         } else {
                             FD_SET(fd_c, &set);
                             if(fd_c > fd_max) fd_max = fd_c;
                         }
+                    } else if(fd == dfd[0]) {
+                        // Client con richieste differite completate: quello letto dalla pipe e quelli le cui notifiche
+                        // non sono state scritte sulla pipe piena
+                        fd_set woken;
+                        FD_ZERO(&woken);
+                        int woken_max = -1;
+                        int fd_c;
+                        if(read(dfd[0], &fd_c, sizeof(int)) == sizeof(int) && fd_c >= 0 && fd_c < FD_SETSIZE) {
+                            FD_SET(fd_c, &woken);
+                            woken_max = fd_c;
+                        }
+                        pthread_mutex_lock(&files_mutex);
+                        for(int _fd = 0; _fd <= dfd_missed_max; _fd++) {
+                            if(FD_ISSET(_fd, &dfd_missed)) FD_SET(_fd, &woken);
+                        }
+                        if(dfd_missed_max > woken_max) woken_max = dfd_missed_max;
+                        FD_ZERO(&dfd_missed);
+                        dfd_missed_max = -1;
+                        pthread_mutex_unlock(&files_mutex);
+                        
+                        for(fd_c = 0; fd_c <= woken_max; fd_c++) {
+                            if(!FD_ISSET(fd_c, &woken) || fd_c == sfd || fd_c == pfd[0] || fd_c == dfd[0]) continue;
+                            if(FD_ISSET(fd_c, &set)) {
+                                // Il client attende nuove richieste: lo affida a un thread worker (sfd negativo)
+                                pthread_mutex_lock(&clients_mutex);
+                                fsp_sfd_queue_enqueue(sfd_queue, -fd_c-1);
+                                pthread_cond_signal(&sfd_queue_isNotEmpty);
+                                pthread_mutex_unlock(&clients_mutex);
+                            
+                                FD_CLR(fd_c, &set);
+                                if(fd_c == fd_max) {
+                                    // Determina il nuovo fd_max
+                                    int _fd = fd_c;
+                                    // È sempre presente almeno il file descriptor della pipe
+                                    while(!FD_ISSET(_fd, &set)) _fd--;
+                                    fd_max = _fd;
+                                }
+                            } else {
+                                // Il client è gestito da un thread worker: verrà affidato nuovamente a un thread worker
+                                // quando sarà restituito al master thread
+                                FD_SET(fd_c, &notified);
+                            }
+                        }
                     } else {
                         // lettura request fsp
                         pthread_mutex_lock(&clients_mutex);
@@ -676,6 +1581,20 @@ int main(int argc, const char* argv[]) {
     printf("Esecuzione dei thread worker terminata.\n");
     
     pthread_join(lock_cmd_broadcast_thread, NULL);
+    if(background_eviction) pthread_join(evictor_thread, NULL);
+    if(config_file.expiry_sweep_interval > 0) pthread_join(expirer_thread, NULL);
+    // Nessun thread completa più richieste differite
+    close(dfd[0]);
+    close(dfd[1]);
+    
+    // Esegue lo snapshot finale (il log riparte vuoto al riavvio)
+    if(wal != NULL) {
+        pthread_join(snapshot_thread, NULL);
+        if(takeSnapshot() != 0) fprintf(stderr, "Errore: impossibile scrivere lo snapshot dei file.\n");
+    }
+    
+    // Preserva il contenuto dell'arena prima di liberare i file dalla memoria
+    if(arena != NULL) fsp_arena_detach(arena);
     
     destroyAll();
     
@@ -684,7 +1603,47 @@ int main(int argc, const char* argv[]) {
     printf("Numero massimo di file memorizzati sul server: %d\n", files_max_reached_num);
     printf("Dimensione massima raggiunta dal file storage: %.2f MB\n", (float) storage_max_reached_size/1048576.0);
     printf("Numero di volte in cui la cache è stata rimpiazzata: %d\n", capacity_misses);
-    printf("File contenuti nello storage al momento della chiusura del server: %d\n", files_num);
+    if(pending_removals > 0) {
+        printf("File rimossi mentre erano aperti: %u (memoria massima occupata in attesa della chiusura: %lu bytes)\n",
+               pending_removals, pending_max_reached_size);
+    }
+    if(deferred_locks > 0) {
+        printf("Richieste LOCK differite (in attesa della lock senza occupare un thread worker): %lu\n", deferred_locks);
+    }
+    unsigned int accesses = memory_hits + tier_hits + tier_misses;
+    printf("Politica di rimpiazzamento: %s, hit ratio: %.2f%% (accessi serviti dalla memoria: %u su %u)\n", eviction->policy->name,
+           accesses > 0 ? (double) memory_hits*100/accesses : 0, memory_hits, accesses);
+    if(config_file.eviction_policy == FSP_EVICTION_ARC) {
+        printf("ARC: parametro di adattamento p = %lu su c = %lu file, file in T1: %lu, in T2: %lu, nomi in B1: %lu, in B2: %lu, file reinseriti da B1: %lu, da B2: %lu\n",
+               eviction->p, eviction->capacity, eviction->queues[0]->files_num, eviction->queues[1]->files_num,
+               eviction->ghosts_num[0], eviction->ghosts_num[1], eviction->ghost_hits[0], eviction->ghost_hits[1]);
+    }
+    if(config_file.eviction_policy == FSP_EVICTION_TINYLFU) {
+        printf("TINYLFU: file espulsi dalla parte principale: %lu, file nuovi non ammessi: %lu (c = %lu file, file nella finestra: %lu)\n",
+               eviction->victims - eviction->rejections, eviction->rejections, eviction->capacity, eviction->queues[0]->files_num);
+    }
+    if(config_file.eviction_policy == FSP_EVICTION_GDSF || config_file.eviction_policy == FSP_EVICTION_GDSF_BYTES) {
+        printf("%s: valore di invecchiamento L = %.6f\n", eviction->policy->name, (double) eviction->inflation/4294967296.0);
+    }
+    if(tier != NULL) {
+        printf("Numero di file espulsi nel tier su disco: %u (in background: %u)\n", tier_spills, background_spills);
+        printf("Accessi ai file serviti dalla memoria: %u, dal tier su disco (hit): %u, file non trovati (miss): %u\n", memory_hits, tier_hits, tier_misses);
+        unsigned long int accessed_bytes = memory_hit_bytes + tier_hit_bytes;
+        printf("Byte dei file acceduti serviti dalla memoria: %lu su %lu (byte hit ratio: %.2f%%)\n", memory_hit_bytes, accessed_bytes,
+               accessed_bytes > 0 ? (double) memory_hit_bytes*100/accessed_bytes : 0);
+    }
+    if(wal != NULL) {
+        printf("Record aggiunti al log: %lu, scritture di gruppo: %lu\n", wal->records, wal->batches);
+        printf("Snapshot eseguiti: %u (durata media: %.3f ms, blocco medio dei file: %.3f ms, pagine copiate in media: %lu)\n", snapshots_num,
+               snapshots_num > 0 ? snapshots_time*1000/snapshots_num : 0, snapshots_num > 0 ? snapshots_lock_time*1000/snapshots_num : 0,
+               snapshots_num > 0 ? snapshots_cow_pages/snapshots_num : 0);
+    }
+    if(lazy_expirations + active_expirations > 0 || expiring->files_num > 0) {
+        printf("File scaduti rimossi: %u (all'uso: %u, in background: %u), file con una scadenza al momento della chiusura: %lu\n",
+               lazy_expirations + active_expirations, lazy_expirations, active_expirations, expiring->files_num);
+    }
+    printf("File contenuti nello storage al momento della chiusura del server: %d\n", files_num + spilled_files_num);
+    if(tier != NULL) printf("File contenuti nel tier su disco al momento della chiusura del server: %u\n", spilled_files_num);
     fsp_files_hash_table_deleteAll(files, printAndRemoveFile);
     fsp_files_hash_table_free(files);
     files = NULL;
@@ -696,16 +1655,39 @@ int main(int argc, const char* argv[]) {
 }
 
 static void freeAll() {
-    if(files_queue != NULL) fsp_files_queue_free(files_queue);
+    // I file contenuti nell'arena non devono essere rimossi dall'arena
+    if(arena != NULL) fsp_arena_detach(arena);
+    if(tier != NULL) {
+        fsp_tier_free(tier);
+        tier = NULL;
+    }
+    if(wal != NULL) {
+        fsp_wal_close(wal);
+        wal = NULL;
+    }
+    if(eviction != NULL) fsp_eviction_free(eviction);
+    if(expiring != NULL) fsp_expiry_free(expiring);
+    if(blobs != NULL) fsp_blobs_hash_table_free(blobs);
     if(files != NULL) {
         fsp_files_hash_table_deleteAll(files, removeFile);
         fsp_files_hash_table_free(files);
     }
+    if(files_index != NULL) fsp_files_index_free(files_index);
     if(clients != NULL) {
         fsp_clients_hash_table_deleteAll(clients, removeClient);
         fsp_clients_hash_table_free(clients);
     }
     if(sfd_queue != NULL) fsp_sfd_queue_free(sfd_queue);
+    if(files_pool != NULL) fsp_pools_free(files_pool);
+    if(arena != NULL) {
+        fsp_arena_close(arena);
+        arena = NULL;
+    }
+    // Dopo la liberazione dei file e del tier (che possono contenere contenuti allocati nel pool)
+    if(large_pool != NULL) {
+        fsp_arena_close(large_pool);
+        large_pool = NULL;
+    }
 }
 
 static void destroyAll() {
@@ -713,6 +1695,8 @@ static void destroyAll() {
     pthread_mutex_destroy(&clients_mutex);
     pthread_cond_destroy(&sfd_queue_isNotEmpty);
     pthread_cond_destroy(&lock_cmd_isNotLocked);
+    pthread_cond_destroy(&evictor_isNeeded);
+    pthread_cond_destroy(&promotion_isDone);
 }
 
 static void closeLogFile(void) {
@@ -727,100 +1711,961 @@ static void closeLogFile(void) {
     close(log_file);
 }
 
-static void closePipe() {
-    if(pfd[0] >= 0) close(pfd[0]);
-    if(pfd[1] >= 0) close(pfd[1]);
+static void restoreFiles() {
+    // I riferimenti ai contenuti vengono contati durante la ricostruzione dei file
+    fsp_arena_scan(arena, FSP_BLOB_ARENA_TYPE, restoreBlob, NULL);
+    fsp_arena_scan(arena, FSP_FILE_ARENA_TYPE, restoreFile, NULL);
+    fsp_arena_scan(arena, FSP_BLOB_ARENA_TYPE, removeUnreferencedBlob, NULL);
+    
+    // Espelle i file se i limiti sono stati ridotti
+    capacityMiss(NULL);
+    
+    // Aggiorna le statistiche
+    files_max_reached_num = files_num;
+    storage_max_reached_size = storage_size;
 }
 
-static void removeFile(FSP_FILE file) {
-    if(file != NULL) {
-        fsp_file_free(file);
+static void restoreBlob(void* obj, void* arg) {
+    BLOB data = obj;
+    // Un contenuto con intestazione non coerente viene scartato (i file che lo referenziano non vengono ripristinati)
+    size_t capacity = fsp_arena_capacity(arena, data);
+    if(capacity < sizeof(struct fsp_blob) || data->stored_size > capacity - sizeof(struct fsp_blob) ||
+       (!(data->compressed) && data->stored_size != data->size) || data->base_size > data->size) {
+        fsp_arena_free(arena, data);
+        return;
     }
+    // I puntatori memorizzati nell'arena non sono validi dopo la riapertura
+    data->hash_table_next = NULL;
+    data->arena = arena;
+    data->refs = 0;
 }
 
-static void printAndRemoveFile(FSP_FILE file) {
-    if(file != NULL) {
-        printf("%s\n", file->pathname);
-        fsp_file_free(file);
+static void restoreFile(void* obj, void* arg) {
+    struct fsp_file_record* record = obj;
+    BLOB data = fsp_arena_pointer(arena, record->data, FSP_BLOB_ARENA_TYPE);
+    FSP_FILE file = NULL;
+    // I record con un nome non terminato o senza un contenuto verificato da restoreBlob (data->arena == arena)
+    // e i file scaduti durante l'arresto del server non vengono ripristinati
+    size_t pathname_cap = fsp_arena_capacity(arena, record) - sizeof(struct fsp_file_record);
+    if(data == NULL || data->arena != arena || strnlen(record->pathname, pathname_cap) == pathname_cap ||
+       (record->expires != 0 && record->expires <= time(NULL)) ||
+       (file = fsp_file_new(files_pool, record->pathname, NULL, 0, 0, -1, 0)) == NULL) {
+        fsp_arena_free(arena, record);
+        return;
+    }
+    if(insertFile(file) != 0) {
+        // Record duplicato (o memoria insufficiente)
+        fsp_file_free(files_pool, file);
+        fsp_arena_free(arena, record);
+        return;
+    }
+    files_num++;
+    
+    file->record = record;
+    file->data = data;
+    file->size = data->size;
+    if(record->expires != 0 && setFileExpiry(file, record->expires) != 0) record->expires = 0;
+    if(++(data->refs) == 1) {
+        fsp_blobs_hash_table_insert(blobs, data);
+        storage_size += data->stored_size;
     }
+    // La politica di rimpiazzamento può usare la dimensione del contenuto
+    fsp_eviction_insert(eviction, file);
 }
 
-static void removeClient(CLIENT client) {
-    if(client != NULL) {
-        close(client->sfd);
-        fsp_client_free(client);
-    }
+static void removeUnreferencedBlob(void* obj, void* arg) {
+    BLOB data = obj;
+    if(data->refs == 0) fsp_arena_free(arena, data);
 }
 
-static void closeConnection(CLIENT client, const char* error_descr) {
-    if(client == NULL) return;
+// Argomento dei thread che ricostruiscono i file dal log
+struct recovery_arg {
+    // Record letti dal log
+    const unsigned char* records;
+    // Offset dei record (offsets[records_num] è la lunghezza dei record)
+    const size_t* offsets;
+    size_t records_num;
+    // Numero dei thread e partizione del thread
+    unsigned int threads_num;
+    unsigned int partition;
+    // File ricostruiti dal thread (contenuti non condivisi e non presi da files_pool)
+    FILES files;
+    // Indica se il thread ha riscontrato errori
+    int error;
+};
 
-    pthread_mutex_lock(&clients_mutex);
+static int recoverFiles() {
+    void* records = NULL;
+    size_t records_len = 0;
+    if(fsp_wal_load(wal, &records, &records_len) != 0) return -1;
+    if(records == NULL) return 0;
     
-    // Chiude i file aperti dal client
-    pthread_mutex_lock(&files_mutex);
-    while(client->openedFiles != NULL) {
-        FSP_FILE opened_file = (client->openedFiles)->file;
-        fsp_files_list_remove(&(client->openedFiles), opened_file->pathname);
-        if(opened_file->locked == client->sfd) {
-            opened_file->locked = -1;
-            pthread_cond_broadcast(&lock_cmd_isNotLocked);
+    // Indicizza i record (la validità dei record è stata verificata da fsp_wal_load)
+    size_t records_num = 0;
+    size_t offsets_size = 1024;
+    size_t* offsets = NULL;
+    if((offsets = malloc(sizeof(size_t)*offsets_size)) == NULL) {
+        free(records);
+        return -1;
+    }
+    size_t offset = 0;
+    size_t record_len;
+    struct fsp_wal_record record;
+    while((record_len = fsp_wal_parseRecord((unsigned char*) records + offset, records_len - offset, &record)) > 0) {
+        if(records_num + 1 == offsets_size) {
+            size_t* new_offsets = realloc(offsets, sizeof(size_t)*offsets_size*2);
+            if(new_offsets == NULL) {
+                free(offsets);
+                free(records);
+                return -1;
+            }
+            offsets = new_offsets;
+            offsets_size *= 2;
+        }
+        offsets[records_num++] = offset;
+        offset += record_len;
+    }
+    offsets[records_num] = offset;
+    
+    // I record vengono applicati in parallelo: ogni thread ricostruisce i file di una partizione
+    // (i record di un file vengono applicati da un solo thread nell'ordine del log)
+    unsigned int threads_num = config_file.worker_threads_num > 0 ? config_file.worker_threads_num : 1;
+    struct recovery_arg* args = NULL;
+    pthread_t* threads = NULL;
+    if((args = calloc(threads_num, sizeof(struct recovery_arg))) == NULL ||
+       (threads = malloc(sizeof(pthread_t)*threads_num)) == NULL) {
+        free(args);
+        free(offsets);
+        free(records);
+        return -1;
+    }
+    int err = 0;
+    unsigned int started = 0;
+    for(unsigned int i = 0; i < threads_num; i++) {
+        args[i].records = records;
+        args[i].offsets = offsets;
+        args[i].records_num = records_num;
+        args[i].threads_num = threads_num;
+        args[i].partition = i;
+        args[i].error = 0;
+        if((args[i].files = fsp_files_hash_table_new(FSP_FILES_HASH_TABLE_SIZE)) == NULL ||
+           pthread_create(&(threads[i]), NULL, recoveryWorker, &(args[i])) != 0) {
+            err = 1;
+            break;
         }
-        opened_file->links--;
-        if(opened_file->links == 0) {
-            if(opened_file->data == NULL) {
-                fsp_files_queue_remove(files_queue, opened_file->pathname);
-                files_num--;
+        started++;
+    }
+    for(unsigned int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        if(args[i].error) err = 1;
+    }
+    free(threads);
+    free(offsets);
+    free(records);
+    
+    // Inserisce i file ricostruiti nelle strutture dati del server (i file senza contenuto e i file scaduti
+    // durante l'arresto del server non vengono ripristinati)
+    time_t now = time(NULL);
+    for(unsigned int i = 0; i < threads_num; i++) {
+        if(args[i].files == NULL) continue;
+        struct fsp_files_hash_table_iterator* iterator = NULL;
+        if(!err && (iterator = fsp_files_hash_table_getIterator(args[i].files)) == NULL) err = 1;
+        FSP_FILE recovered;
+        while(!err && (recovered = fsp_files_hash_table_getNext(iterator)) != NULL) {
+            if(recovered->data == NULL || isExpired(recovered, now)) continue;
+            FSP_FILE file = NULL;
+            if((file = fsp_file_new(files_pool, recovered->pathname, NULL, 0, 0, -1, 0)) == NULL) {
+                err = 1;
+                break;
+            }
+            // Incorpora il contenuto nel file se possibile
+            FSP_FILE embedded = NULL;
+            if((embedded = embedFileData(file, recovered->data)) != NULL) {
+                fsp_file_free(files_pool, file);
+                file = embedded;
             }
-            if(opened_file->remove || opened_file->data == NULL) {
-                fsp_files_hash_table_delete(files, opened_file->pathname);
-                fsp_file_free(opened_file);
+            if(insertFile(file) != 0) {
+                if(file->embedded) storage_size -= file->data->stored_size;
+                fsp_file_free(files_pool, file);
+                err = 1;
+                break;
+            }
+            fsp_eviction_insert(eviction, file);
+            files_num++;
+            if(recovered->expires != 0) setFileExpiry(file, recovered->expires);
+            
+            if(!file->embedded) {
+                BLOB unused;
+                setFileData(file, recovered->data, &unused);
+                fsp_blob_free(unused);
+                recovered->data = NULL;
             }
         }
+        free(iterator);
+        fsp_files_hash_table_deleteAll(args[i].files, freeRecoveredFile);
+        fsp_files_hash_table_free(args[i].files);
     }
-    pthread_mutex_unlock(&files_mutex);
+    free(args);
+    if(err) return -1;
+    
+    // Espelle i file se i limiti sono stati ridotti
+    capacityMiss(NULL);
+    
+    // Aggiorna le statistiche
+    files_max_reached_num = files_num;
+    storage_max_reached_size = storage_size;
+    
+    return 0;
+}
 
-    close(client->sfd);
-    fsp_clients_hash_table_delete(clients, client->sfd);
+static void* recoveryWorker(void* arg) {
+    struct recovery_arg* rec = arg;
+    
+    struct fsp_wal_record record;
+    for(size_t i = 0; i < rec->records_num; i++) {
+        fsp_wal_parseRecord(rec->records + rec->offsets[i], rec->offsets[i+1] - rec->offsets[i], &record);
+        if(pathnameHash(record.pathname) % rec->threads_num != rec->partition) continue;
+        
+        FSP_FILE file = fsp_files_hash_table_search(rec->files, record.pathname);
+        BLOB data = NULL;
+        switch(record.type) {
+            case FSP_WAL_CREATE:
+            case FSP_WAL_WRITE:
+                if(file == NULL) {
+                    // Lo snapshot contiene solo record FSP_WAL_WRITE (seguiti da FSP_WAL_EXPIRE per i file con una scadenza)
+                    if((file = fsp_file_new(NULL, record.pathname, NULL, 0, 0, -1, 0)) == NULL) {
+                        rec->error = 1;
+                        return 0;
+                    }
+                    fsp_files_hash_table_insert(rec->files, file);
+                }
+                if(record.type == FSP_WAL_CREATE) break;
+                
+                if((data = fsp_blob_alloc(blobArena(record.size), record.size, record.data_len, record.compressed, record.hash)) == NULL) {
+                    rec->error = 1;
+                    return 0;
+                }
+                memcpy(data->data, record.data, record.data_len);
+                fsp_blob_free(file->data);
+                file->data = data;
+                file->size = data->size;
+                break;
+            case FSP_WAL_APPEND:
+                // Un file senza contenuto non può essere modificato con APPEND
+                if(file == NULL || file->data == NULL) break;
+                if((data = fsp_blob_append(blobArena(file->size + record.size), file->data, record.data, record.data_len, config_file.compression)) == NULL) {
+                    rec->error = 1;
+                    return 0;
+                }
+                file->data = data;
+                file->size = data->size;
+                break;
+            case FSP_WAL_REMOVE:
+                if(file != NULL) {
+                    fsp_files_hash_table_delete(rec->files, record.pathname);
+                    freeRecoveredFile(file);
+                }
+                break;
+            case FSP_WAL_EXPIRE:
+                if(file != NULL && record.data_len == sizeof(file->expires)) memcpy(&(file->expires), record.data, record.data_len);
+                break;
+            default:
+                break;
+        }
+    }
+    
+    return 0;
+}
 
-    // Scrive nel file di log e su stdout
-    time_t t = time(NULL);
-    struct tm* current_time = localtime(&t);
-    char msg[LOG_FILE_MSG_LEN] = {0};
-    if(error_descr != NULL) {
-        snprintf(msg, LOG_FILE_MSG_LEN, "%d:%d:%d CONNECTION_CLOSED: %d (%s)\n", current_time->tm_hour, current_time->tm_min, current_time->tm_sec, client->sfd, error_descr);
-        write(log_file, msg, strlen(msg));
-        write(1, msg, strlen(msg));
-    } else {
-        snprintf(msg, LOG_FILE_MSG_LEN, "%d:%d:%d CONNECTION_CLOSED: %d\n", current_time->tm_hour, current_time->tm_min, current_time->tm_sec, client->sfd);
-        write(log_file, msg, strlen(msg));
-        write(1, msg, strlen(msg));
+static unsigned int pathnameHash(const char* pathname) {
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    for(const unsigned char* c = (const unsigned char*) pathname; *c != '\0'; c++) {
+        hash ^= *c;
+        hash *= 16777619u;
     }
+    return hash;
+}
 
-    fsp_client_free(client);
-    pthread_mutex_unlock(&clients_mutex);
+static void freeRecoveredFile(FSP_FILE file) {
+    fsp_file_free(NULL, file);
 }
 
-static void signalHandler(int signal) {
-    if(signal == SIGINT || signal == SIGQUIT) {
-        quit = 1;
-    } else if(signal == SIGHUP) {
-        accept_connections = 0;
+static void logFileChange(unsigned int type, const FSP_FILE file, const void* data, size_t data_len) {
+    if(wal == NULL) return;
+    
+    // Un errore viene segnalato da fsp_wal_commit
+    if(type == FSP_WAL_WRITE) {
+        fsp_wal_append(wal, type, file->pathname, file->data->size, file->data->hash, file->data->compressed, file->data->data, file->data->stored_size);
+    } else if(type == FSP_WAL_EXPIRE) {
+        fsp_wal_append(wal, type, file->pathname, 0, 0, 0, &(file->expires), sizeof(file->expires));
+    } else {
+        fsp_wal_append(wal, type, file->pathname, 0, 0, 0, data, data_len);
     }
 }
 
-static int parseConfigFile(char* path) {
-    FILE* file = NULL;
-    if(path == NULL || ((file = fopen(path, "r")) == NULL)) {
-        // File non aperto
+static int takeSnapshot() {
+    struct timespec start, forked, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    // Pipe per la comunicazione dell'esito dal processo figlio
+    int rfd[2];
+    if(pipe(rfd) != 0) return -1;
+    
+    unsigned long int segment;
+    pthread_mutex_lock(&files_mutex);
+    // Durante una promozione il contenuto del file può non trovarsi né in memoria né nel tier
+    while(promotions_num > 0) pthread_cond_wait(&promotion_isDone, &files_mutex);
+    // I record aggiunti da questo momento fanno parte del segmento successivo allo snapshot
+    struct fsp_wal_snapshot* snapshot = NULL;
+    struct fsp_files_hash_table_iterator* iterator = NULL;
+    if(fsp_wal_rotate(wal, &segment) != 0 || (snapshot = fsp_wal_beginSnapshot(wal, segment)) == NULL ||
+       (iterator = fsp_files_hash_table_getIterator(files)) == NULL) {
+        pthread_mutex_unlock(&files_mutex);
+        fsp_wal_endSnapshot(snapshot, 0);
+        close(rfd[0]);
+        close(rfd[1]);
         return -1;
     }
+    // Il processo figlio vede i file così come si trovano in questo momento (copy-on-write)
+    // e li scrive nello snapshot mentre i thread worker continuano a modificarli
+    fsp_tier_forkPrepare(tier);
+    pid_t pid = fork();
+    if(pid == 0) {
+        close(rfd[0]);
+        writeSnapshot(snapshot, iterator, rfd[1]);
+    }
+    fsp_tier_forkParent(tier);
+    pthread_mutex_unlock(&files_mutex);
+    free(iterator);
+    clock_gettime(CLOCK_MONOTONIC, &forked);
+    close(rfd[1]);
     
-    const size_t buf_size = 256;
-    char buf[buf_size];
-    long int val;
-    
-    while(fgets(buf, buf_size, file) != NULL) {
+    // Attende l'esito dello snapshot
+    struct snapshot_result result = {-1, 0, 0};
+    if(pid != -1) {
+        char* buf = (char*) &result;
+        size_t left = sizeof(result);
+        while(left > 0) {
+            ssize_t r_bytes = read(rfd[0], buf, left);
+            if(r_bytes == -1 && errno == EINTR) continue;
+            if(r_bytes <= 0) {
+                // Il processo figlio è terminato senza comunicare l'esito
+                result.err = -1;
+                break;
+            }
+            buf += r_bytes;
+            left -= r_bytes;
+        }
+        while(waitpid(pid, NULL, 0) == -1 && errno == EINTR);
+    }
+    close(rfd[0]);
+    fsp_tier_forkDone(tier);
+    // Rimuove i segmenti contenuti nello snapshot (o il file temporaneo)
+    fsp_wal_endSnapshot(snapshot, pid != -1 && result.err == 0);
+    if(pid == -1 || result.err != 0) return -1;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    
+    // Aggiorna le statistiche
+    double lock_time = (forked.tv_sec - start.tv_sec) + (forked.tv_nsec - start.tv_nsec)/1e9;
+    double total_time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)/1e9;
+    snapshots_num++;
+    snapshots_lock_time += lock_time;
+    snapshots_time += total_time;
+    snapshots_cow_pages += result.cow_pages;
+    
+    // Scrive nel file di log
+    time_t t = time(NULL);
+    struct tm* current_time = localtime(&t);
+    char msg[LOG_FILE_MSG_LEN] = {0};
+    snprintf(msg, LOG_FILE_MSG_LEN, "%d:%d:%d SNAPSHOT: %lu (%.3f ms, %.3f ms locked, %lu COW pages)\n", current_time->tm_hour, current_time->tm_min, current_time->tm_sec,
+             result.files_num, total_time*1000, lock_time*1000, result.cow_pages);
+    write(log_file, msg, strlen(msg));
+    write(1, msg, strlen(msg));
+    
+    return 0;
+}
+
+static void writeSnapshot(struct fsp_wal_snapshot* snapshot, struct fsp_files_hash_table_iterator* iterator, int fd) {
+    struct snapshot_result result = {-1, 0, 0};
+    
+    fsp_tier_forkChild(tier);
+    int err = 0;
+    FSP_FILE file;
+    while(!err && (file = fsp_files_hash_table_getNext(iterator)) != NULL) {
+        // I file rimossi e i file senza contenuto non fanno parte dello snapshot
+        if(file->remove || (file->data == NULL && !file->spilled)) continue;
+        
+        if(file->spilled) {
+            // Il contenuto memorizzato nel tier viene copiato così com'è (eventualmente compresso)
+            struct fsp_tier_view view;
+            if(fsp_tier_forkOpen(tier, file, &view) != 0) {
+                err = 1;
+                break;
+            }
+            if(view.blob != NULL) {
+                err = fsp_wal_addToSnapshot(snapshot, FSP_WAL_WRITE, file->pathname, view.size, view.hash, view.compressed, view.blob->data, view.stored_size) != 0;
+            } else {
+                err = fsp_wal_addFileToSnapshot(snapshot, file->pathname, view.size, view.hash, view.compressed, view.fd, view.stored_size) != 0;
+                close(view.fd);
+            }
+        } else {
+            BLOB data = file->data;
+            err = fsp_wal_addToSnapshot(snapshot, FSP_WAL_WRITE, file->pathname, data->size, data->hash, data->compressed, data->data, data->stored_size) != 0;
+        }
+        if(!err && file->expires != 0) {
+            err = fsp_wal_addToSnapshot(snapshot, FSP_WAL_EXPIRE, file->pathname, 0, 0, 0, &(file->expires), sizeof(file->expires)) != 0;
+        }
+        result.files_num++;
+    }
+    if(err) {
+        fsp_wal_abortSnapshot(snapshot);
+    } else {
+        err = fsp_wal_commitSnapshot(snapshot) != 0;
+    }
+    result.err = err ? -1 : 0;
+    result.cow_pages = cowPages();
+    
+    write(fd, &result, sizeof(result));
+    close(fd);
+    // Termina senza eseguire i gestori di uscita del processo padre (snapshot e iterator vengono liberati dal processo padre)
+    _exit(err ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+static unsigned long int cowPages() {
+    int fd;
+    if((fd = open("/proc/self/smaps_rollup", O_RDONLY)) == -1 && (fd = open("/proc/self/smaps", O_RDONLY)) == -1) return 0;
+    
+    // Le pagine private modificate non sono più condivise con il processo padre (righe "Private_Dirty: <n> kB")
+    char buf[4096];
+    size_t len = 0;
+    unsigned long int tot_kb = 0;
+    ssize_t r_bytes;
+    while((r_bytes = read(fd, buf + len, sizeof(buf) - len)) != 0) {
+        if(r_bytes == -1) {
+            if(errno == EINTR) continue;
+            break;
+        }
+        len += r_bytes;
+        // Analizza le righe complete e conserva l'ultima riga incompleta
+        char* line = buf;
+        char* end;
+        while((end = memchr(line, '\n', buf + len - line)) != NULL) {
+            if(end - line > 14 && memcmp(line, "Private_Dirty:", 14) == 0) {
+                unsigned long int kb = 0;
+                for(char* c = line + 14; c < end; c++) {
+                    if(*c >= '0' && *c <= '9') kb = kb*10 + (*c - '0');
+                }
+                tot_kb += kb;
+            }
+            line = end + 1;
+        }
+        len = buf + len - line;
+        // Una riga più lunga del buffer viene ignorata
+        if(len == sizeof(buf)) len = 0;
+        memmove(buf, line, len);
+    }
+    close(fd);
+    
+    return tot_kb*1024/sysconf(_SC_PAGESIZE);
+}
+
+static void* snapshotter(void* arg) {
+    // Maschera i segnali
+    sigset_t mask;
+    sigfillset(&mask);
+    if(pthread_sigmask(SIG_SETMASK, &mask, NULL) != 0) {
+        fprintf(stderr, "Errore: signal mask del thread che esegue gli snapshot non modificata.\n");
+        return 0;
+    }
+    
+    struct timespec timeout;
+    memset(&timeout, 0, sizeof(timeout));
+    timeout.tv_sec = 1;
+    
+    unsigned int elapsed = 0;
+    while(1) {
+        nanosleep(&timeout, NULL);
+        
+        pthread_mutex_lock(&clients_mutex);
+        if(quit || (!accept_connections && clients->clients_num == 0)) {
+            pthread_mutex_unlock(&clients_mutex);
+            break;
+        }
+        pthread_mutex_unlock(&clients_mutex);
+        
+        if(config_file.snapshot_interval == 0 || ++elapsed < config_file.snapshot_interval) continue;
+        elapsed = 0;
+        if(takeSnapshot() != 0) fprintf(stderr, "Errore: impossibile scrivere lo snapshot dei file.\n");
+    }
+    
+    return 0;
+}
+
+static void* evictor(void* arg) {
+    // Maschera i segnali
+    sigset_t mask;
+    sigfillset(&mask);
+    if(pthread_sigmask(SIG_SETMASK, &mask, NULL) != 0) {
+        fprintf(stderr, "Errore: signal mask del thread che esegue l'espulsione in background non modificata.\n");
+        return 0;
+    }
+    
+    struct timespec timeout;
+    int failed = 0;
+    while(1) {
+        pthread_mutex_lock(&clients_mutex);
+        if(quit || (!accept_connections && clients->clients_num == 0)) {
+            pthread_mutex_unlock(&clients_mutex);
+            break;
+        }
+        pthread_mutex_unlock(&clients_mutex);
+        
+        // Attende al più un secondo che l'occupazione superi la soglia superiore (capacityMiss)
+        // Se l'ultima espulsione non è riuscita (tier pieno), allora attende in ogni caso
+        pthread_mutex_lock(&files_mutex);
+        if(failed || !aboveWatermark(config_file.eviction_high_watermark)) {
+            clock_gettime(CLOCK_REALTIME, &timeout);
+            timeout.tv_sec += 1;
+            pthread_cond_timedwait(&evictor_isNeeded, &files_mutex, &timeout);
+        }
+        int above = aboveWatermark(config_file.eviction_high_watermark);
+        pthread_mutex_unlock(&files_mutex);
+        failed = 0;
+        if(!above) continue;
+        
+        // Espelle un file alla volta: tra due espulsioni i thread worker possono eseguire i comandi
+        while(!failed) {
+            pthread_mutex_lock(&files_mutex);
+            if(eviction->files_num == 0 || !aboveWatermark(config_file.eviction_low_watermark)) {
+                pthread_mutex_unlock(&files_mutex);
+                break;
+            }
+            FSP_FILE file = fsp_eviction_victim(eviction);
+            int err = 0;
+            if(isExpired(file, time(NULL))) {
+                // Un file scaduto viene rimosso invece di essere espulso nel tier (rimozione in background)
+                expireFile(file);
+                active_expirations++;
+            } else if((err = spillVictim(file)) == 0) {
+                background_spills++;
+            } else {
+                // Il file rimane in memoria nella posizione da cui è stato scelto (senza contare un inserimento
+                // o un accesso): verrà espulso da capacityMiss al raggiungimento dei limiti
+                fsp_eviction_restore(eviction, file);
+                failed = err != -2;
+            }
+            pthread_mutex_unlock(&files_mutex);
+            
+            // Attende il thread di scrittura del tier senza mutua esclusione
+            if(err == -2) fsp_tier_wait(tier);
+        }
+    }
+    
+    return 0;
+}
+
+static void* expirer(void* arg) {
+    // Maschera i segnali
+    sigset_t mask;
+    sigfillset(&mask);
+    if(pthread_sigmask(SIG_SETMASK, &mask, NULL) != 0) {
+        fprintf(stderr, "Errore: signal mask del thread che rimuove i file scaduti non modificata.\n");
+        return 0;
+    }
+    
+    struct timespec timeout;
+    memset(&timeout, 0, sizeof(timeout));
+    timeout.tv_sec = config_file.expiry_sweep_interval/1000;
+    timeout.tv_nsec = (long int) (config_file.expiry_sweep_interval%1000)*1000000;
+    
+    while(1) {
+        nanosleep(&timeout, NULL);
+        
+        pthread_mutex_lock(&clients_mutex);
+        if(quit || (!accept_connections && clients->clients_num == 0)) {
+            pthread_mutex_unlock(&clients_mutex);
+            break;
+        }
+        pthread_mutex_unlock(&clients_mutex);
+        
+        pthread_mutex_lock(&files_mutex);
+        active_expirations += sweepExpired(0);
+        pthread_mutex_unlock(&files_mutex);
+    }
+    
+    return 0;
+}
+
+static unsigned int sweepExpired(int unused_only) {
+    unsigned int expired_tot = 0;
+    time_t now = time(NULL);
+    
+    // Campionamento casuale (come in Redis): la scansione costa O(EXPIRY_SAMPLE_SIZE) se pochi file sono scaduti
+    // e continua finché la frazione dei file scaduti tra quelli con una scadenza è alta
+    for(int i = 0; i < EXPIRY_SAMPLES_MAX && expiring->files_num > 0; i++) {
+        unsigned int sampled = 0, expired = 0;
+        size_t sample_size = expiring->files_num < EXPIRY_SAMPLE_SIZE ? expiring->files_num : EXPIRY_SAMPLE_SIZE;
+        while(sampled < sample_size) {
+            FSP_FILE file = fsp_expiry_sample(expiring);
+            if(file == NULL) break;
+            sampled++;
+            if(!isExpired(file, now) || (unused_only && file->links > 0)) continue;
+            expireFile(file);
+            expired++;
+        }
+        expired_tot += expired;
+        if(expired*4 <= sampled) break;
+    }
+    
+    return expired_tot;
+}
+
+static int isExpired(const FSP_FILE file, time_t now) {
+    return file->expires != 0 && file->expires <= now;
+}
+
+static FSP_FILE expireFile(FSP_FILE file) {
+    // Messaggio per il file di log
+    char msg[LOG_FILE_MSG_LEN] = {0};
+    time_t t = time(NULL);
+    struct tm* current_time = localtime(&t);
+    snprintf(msg, LOG_FILE_MSG_LEN, "%d:%d:%d EXPIRED_FILE: %s (%lu)\n", current_time->tm_hour, current_time->tm_min, current_time->tm_sec, file->pathname, file->size);
+    // Scrive nel file di log e su stdout
+    write(log_file, msg, strlen(msg));
+    write(1, msg, strlen(msg));
+    
+    // Rimuove il file come il comando REMOVE
+    fsp_expiry_remove(expiring, file);
+    file->expires = 0;
+    logFileChange(FSP_WAL_REMOVE, file, NULL, 0);
+    if(file->spilled) {
+        fsp_tier_remove(tier, file);
+        file->spilled = 0;
+        spilled_files_num--;
+    } else {
+        // Un file creato senza contenuto non si trova nella politica di rimpiazzamento
+        if(file->data != NULL) fsp_eviction_remove(eviction, file);
+        files_num--;
+    }
+    releaseFileData(file);
+    
+    if(file->links == 0) {
+        deleteFile(file);
+        fsp_file_free(files_pool, file);
+        return NULL;
+    }
+    // File da rimuovere quando verrà chiuso da tutti i client
+    setRemovePending(file);
+    lockReleased(file);
+    
+    return file;
+}
+
+static FSP_FILE checkExpiry(FSP_FILE file) {
+    if(file == NULL || !isExpired(file, time(NULL))) return file;
+    
+    lazy_expirations++;
+    return expireFile(file);
+}
+
+static int setFileExpiry(FSP_FILE file, unsigned int expires) {
+    if(expires != 0) {
+        if(fsp_expiry_insert(expiring, file) != 0) return -1;
+    } else {
+        fsp_expiry_remove(expiring, file);
+    }
+    file->expires = expires;
+    if(file->record != NULL) file->record->expires = expires;
+    
+    return 0;
+}
+
+static int parseTTL(char* arg, unsigned int* expires) {
+    char* ttl_str = NULL;
+    if(arg == NULL || (ttl_str = strrchr(arg, ' ')) == NULL) return 0;
+    // Un ultimo campo che non è un numero fa parte del nome del file
+    if(ttl_str[1] == '\0' || strspn(ttl_str + 1, "0123456789") != strlen(ttl_str + 1)) return 0;
+    
+    long int ttl;
+    if(!isNumber(ttl_str + 1, &ttl) || ttl < 0 || ttl > FSP_PARSER_TTL_MAX) return -1;
+    *ttl_str = '\0';
+    *expires = ttl == 0 ? 0 : (unsigned int) time(NULL) + ttl;
+    
+    return 1;
+}
+
+static void closePipe() {
+    if(pfd[0] >= 0) close(pfd[0]);
+    if(pfd[1] >= 0) close(pfd[1]);
+    if(dfd[0] >= 0) close(dfd[0]);
+    if(dfd[1] >= 0) close(dfd[1]);
+}
+
+static int insertFile(FSP_FILE file) {
+    // Un file creato di nuovo non è più un file espulso
+    forgetRejected(file->pathname);
+    if(fsp_files_index_insert(files_index, file) != 0) return -1;
+    if(fsp_files_hash_table_insert(files, file) != 0) {
+        fsp_files_index_delete(files_index, file->pathname);
+        return -1;
+    }
+    return 0;
+}
+
+static void deleteFile(FSP_FILE file) {
+    fsp_expiry_remove(expiring, file);
+    fsp_files_hash_table_delete(files, file->pathname);
+    fsp_files_index_delete(files_index, file->pathname);
+    if(file->remove) {
+        size_t embedded_size = fsp_file_embeddedSize(file);
+        storage_size -= embedded_size;
+        pending_size -= embedded_size;
+    }
+}
+
+static void setRemovePending(FSP_FILE file) {
+    file->remove = 1;
+    pending_removals++;
+    
+    size_t embedded_size = fsp_file_embeddedSize(file);
+    storage_size += embedded_size;
+    pending_size += embedded_size;
+    if(pending_size > pending_max_reached_size) pending_max_reached_size = pending_size;
+}
+
+static void replaceFile(CLIENT client, FSP_FILE file, FSP_FILE new_file) {
+    // Le sostituzioni non allocano memoria e non possono fallire
+    fsp_files_hash_table_delete(files, file->pathname);
+    fsp_files_hash_table_insert(files, new_file);
+    fsp_files_index_replace(files_index, new_file);
+    fsp_expiry_replace(expiring, file, new_file);
+    if(client != NULL) fsp_files_set_replace(client->openedFiles, file, new_file);
+}
+
+static void removeFile(FSP_FILE file) {
+    if(file != NULL) {
+        fsp_file_free(files_pool, file);
+    }
+}
+
+static void printAndRemoveFile(FSP_FILE file) {
+    if(file != NULL) {
+        printf("%s\n", file->pathname);
+        fsp_file_free(files_pool, file);
+    }
+}
+
+static void removeClient(CLIENT client) {
+    if(client != NULL) {
+        close(client->sfd);
+        fsp_client_free(client);
+    }
+}
+
+static void closeFile(FSP_FILE opened_file, void* arg) {
+    CLIENT client = arg;
+    if(opened_file->locked == client->sfd) {
+        opened_file->locked = -1;
+        lockReleased(opened_file);
+    }
+    opened_file->links--;
+    if(opened_file->links == 0) {
+        if(opened_file->data == NULL && !opened_file->spilled && !opened_file->remove) {
+            // File creato senza contenuto (non si trova nella coda)
+            files_num--;
+        }
+        if(opened_file->remove || (opened_file->data == NULL && !opened_file->spilled)) {
+            deleteFile(opened_file);
+            fsp_file_free(files_pool, opened_file);
+        }
+    }
+}
+
+static void closeConnection(CLIENT client, const char* error_descr) {
+    if(client == NULL) return;
+
+    pthread_mutex_lock(&clients_mutex);
+    
+    // Chiude i file aperti dal client (dopo aver annullato le richieste LOCK differite)
+    pthread_mutex_lock(&files_mutex);
+    cancelDeferredLocks(client, NULL);
+    fsp_files_set_removeAll(client->openedFiles, closeFile, client);
+    // Rilascia i contenuti dei file espulsi non inviati
+    for(size_t i = 0; i < client->parts_num; i++) {
+        if(client->parts[i].blob != NULL) {
+            fsp_blob_free(client->parts[i].blob);
+            client->parts[i].blob = NULL;
+        }
+    }
+    pthread_mutex_unlock(&files_mutex);
+
+    close(client->sfd);
+    fsp_clients_hash_table_delete(clients, client->sfd);
+
+    // Scrive nel file di log e su stdout
+    time_t t = time(NULL);
+    struct tm* current_time = localtime(&t);
+    char msg[LOG_FILE_MSG_LEN] = {0};
+    if(error_descr != NULL) {
+        snprintf(msg, LOG_FILE_MSG_LEN, "%d:%d:%d CONNECTION_CLOSED: %d (%s)\n", current_time->tm_hour, current_time->tm_min, current_time->tm_sec, client->sfd, error_descr);
+        write(log_file, msg, strlen(msg));
+        write(1, msg, strlen(msg));
+    } else {
+        snprintf(msg, LOG_FILE_MSG_LEN, "%d:%d:%d CONNECTION_CLOSED: %d\n", current_time->tm_hour, current_time->tm_min, current_time->tm_sec, client->sfd);
+        write(log_file, msg, strlen(msg));
+        write(1, msg, strlen(msg));
+    }
+
+    fsp_client_free(client);
+    pthread_mutex_unlock(&clients_mutex);
+}
+
+static void lockReleased(FSP_FILE file) {
+    pthread_cond_broadcast(&lock_cmd_isNotLocked);
+    
+    struct fsp_client_deferred *prev = NULL, *waiter = lock_waiters, *next;
+    while(waiter != NULL) {
+        next = waiter->next;
+        if(waiter->file == file && file->remove) {
+            // File da rimuovere
+            completeDeferredLock(prev, waiter, 550);
+        } else if(waiter->file == file && (file->locked < 0 || file->locked == waiter->client->sfd)) {
+            // Setta la lock
+            file->locked = waiter->client->sfd;
+            completeDeferredLock(prev, waiter, 200);
+        } else {
+            prev = waiter;
+        }
+        waiter = next;
+    }
+}
+
+static void cancelDeferredLocks(CLIENT client, FSP_FILE file) {
+    if(client->deferred_num == 0) return;
+    
+    struct fsp_client_deferred *prev = NULL, *waiter = lock_waiters, *next;
+    while(waiter != NULL) {
+        next = waiter->next;
+        if(waiter->client == client && (file == NULL || waiter->file == file)) {
+            completeDeferredLock(prev, waiter, 556);
+        } else {
+            prev = waiter;
+        }
+        waiter = next;
+    }
+}
+
+static void expireDeferredLocks(int all) {
+    time_t now = time(NULL);
+    struct fsp_client_deferred *prev = NULL, *waiter = lock_waiters, *next;
+    while(waiter != NULL) {
+        next = waiter->next;
+        if(all || now - waiter->start >= LOCK_WAIT_MAX_TIME) {
+            // Non attende la lock per più di LOCK_WAIT_MAX_TIME secondi
+            completeDeferredLock(prev, waiter, 556);
+        } else {
+            prev = waiter;
+        }
+        waiter = next;
+    }
+}
+
+static void completeDeferredLock(struct fsp_client_deferred* prev, struct fsp_client_deferred* waiter, int code) {
+    // Rimuove la richiesta dalla lista delle richieste in attesa
+    if(prev == NULL) {
+        lock_waiters = waiter->next;
+    } else {
+        prev->next = waiter->next;
+    }
+    if(lock_waiters_tail == waiter) lock_waiters_tail = prev;
+    
+    // Aggiunge la richiesta alle richieste completate del client
+    CLIENT client = waiter->client;
+    waiter->code = code;
+    waiter->next = NULL;
+    if(client->completed_tail == NULL) {
+        client->completed = waiter;
+    } else {
+        client->completed_tail->next = waiter;
+    }
+    client->completed_tail = waiter;
+    
+    // Comunica al master thread il client (scrittura non bloccante): se la pipe è piena, allora la notifica non viene
+    // persa perché il master thread legge dfd_missed alla successiva lettura dalla pipe
+    if(write(dfd[1], &(client->sfd), sizeof(int)) != sizeof(int) && client->sfd < FD_SETSIZE) {
+        FD_SET(client->sfd, &dfd_missed);
+        if(client->sfd > dfd_missed_max) dfd_missed_max = client->sfd;
+    }
+}
+
+static int sendDeferredResps(int thread_id, CLIENT client) {
+    if(client->deferred_num == 0) return 0;
+    
+    pthread_mutex_lock(&files_mutex);
+    struct fsp_client_deferred* completed = client->completed;
+    client->completed = NULL;
+    client->completed_tail = NULL;
+    pthread_mutex_unlock(&files_mutex);
+    
+    int ret_val = 0;
+    while(completed != NULL) {
+        struct fsp_client_deferred* next = completed->next;
+        if(ret_val == 0) {
+            char* description;
+            switch(completed->code) {
+                case 200:
+                    description = "The requested action has been successfully completed.";
+                    break;
+                case 550:
+                    description = "Requested action not taken. File not found.";
+                    break;
+                default:
+                    description = "Cannot perform the operation.";
+                    break;
+            }
+            struct fsp_request req = {LOCK, completed->arg, 0, NULL, FSP_PARSER_V2, completed->id};
+            struct fsp_response resp = {completed->code, description, 0, NULL, FSP_PARSER_V2, completed->id};
+            updateLogFile(thread_id, client, &req, resp.code, 0);
+            
+            // Risponde con l'identificativo della richiesta differita
+            client->version = FSP_PARSER_V2;
+            client->req_id = completed->id;
+            if(sendFspResp(client, resp.code, resp.description, 0, NULL) != 0) ret_val = -1;
+        }
+        free(completed);
+        client->deferred_num--;
+        completed = next;
+    }
+    
+    return ret_val;
+}
+
+static int isReadable(int fd) {
+    struct pollfd poll_fd = {fd, POLLIN, 0};
+    return poll(&poll_fd, 1, 0) > 0;
+}
+
+static void signalHandler(int signal) {
+    if(signal == SIGINT || signal == SIGQUIT) {
+        quit = 1;
+    } else if(signal == SIGHUP) {
+        accept_connections = 0;
+    }
+}
+
+static int parseConfigFile(char* path) {
+    FILE* file = NULL;
+    if(path == NULL || ((file = fopen(path, "r")) == NULL)) {
+        // File non aperto
+        return -1;
+    }
+    
+    const size_t buf_size = 256;
+    char buf[buf_size];
+    long int val;
+    
+    while(fgets(buf, buf_size, file) != NULL) {
         char* param_start = buf;
         char* end = param_start;
         while(*end != '\0' && *end != '=') end++;
@@ -878,6 +2723,102 @@ static int parseConfigFile(char* path) {
                 return -2;
             }
             config_file.worker_threads_num = (unsigned int) val;
+        } else if(strcmp("COMPRESSION", param_start) == 0) {
+            if(!isNumber(val_start, &val) || (val != 0 && val != 1)) {
+                // Errore di sintassi
+                fclose(file);
+                return -2;
+            }
+            config_file.compression = (int) val;
+        } else if(strcmp("ARENA_FILE_NAME", param_start) == 0) {
+            strncpy(config_file.arena_file_name, val_start, UNIX_PATH_MAX);
+            config_file.arena_file_name[UNIX_PATH_MAX-1] = '\0';
+        } else if(strcmp("TIER_DIR_NAME", param_start) == 0) {
+            strncpy(config_file.tier_dir_name, val_start, UNIX_PATH_MAX);
+            config_file.tier_dir_name[UNIX_PATH_MAX-1] = '\0';
+        } else if(strcmp("TIER_MAX_SIZE", param_start) == 0) {
+            if(!isNumber(val_start, &val) || val < 0) {
+                // Errore di sintassi
+                fclose(file);
+                return -2;
+            }
+            // Converte da MByte a Byte (1 MByte = 1048576 Byte)
+            config_file.tier_max_size = (unsigned long int) val*1048576;
+        } else if(strcmp("WAL_DIR_NAME", param_start) == 0) {
+            strncpy(config_file.wal_dir_name, val_start, UNIX_PATH_MAX);
+            config_file.wal_dir_name[UNIX_PATH_MAX-1] = '\0';
+        } else if(strcmp("DURABILITY", param_start) == 0) {
+            if(strcmp("none", val_start) == 0) {
+                config_file.durability = FSP_WAL_DURABILITY_NONE;
+            } else if(strcmp("async", val_start) == 0) {
+                config_file.durability = FSP_WAL_DURABILITY_ASYNC;
+            } else if(strcmp("fsync", val_start) == 0) {
+                config_file.durability = FSP_WAL_DURABILITY_FSYNC;
+            } else {
+                // Errore di sintassi
+                fclose(file);
+                return -2;
+            }
+        } else if(strcmp("SNAPSHOT_INTERVAL", param_start) == 0) {
+            if(!isNumber(val_start, &val) || val < 0) {
+                // Errore di sintassi
+                fclose(file);
+                return -2;
+            }
+            config_file.snapshot_interval = (unsigned int) val;
+        } else if(strcmp("INLINE_MAX_SIZE", param_start) == 0) {
+            if(!isNumber(val_start, &val) || val < 0 || val > FSP_FILE_EMBED_MAX_SIZE) {
+                // Errore di sintassi
+                fclose(file);
+                return -2;
+            }
+            config_file.inline_max_size = (unsigned int) val;
+        } else if(strcmp("HUGE_PAGES", param_start) == 0) {
+            if(strcmp("none", val_start) == 0) {
+                config_file.huge_pages = 0;
+            } else if(strcmp("thp", val_start) == 0) {
+                config_file.huge_pages = FSP_ARENA_THP;
+            } else if(strcmp("hugetlb", val_start) == 0) {
+                config_file.huge_pages = FSP_ARENA_HUGETLB;
+            } else {
+                // Errore di sintassi
+                fclose(file);
+                return -2;
+            }
+        } else if(strcmp("PREFAULT", param_start) == 0) {
+            if(!isNumber(val_start, &val) || (val != 0 && val != 1)) {
+                // Errore di sintassi
+                fclose(file);
+                return -2;
+            }
+            config_file.prefault = (int) val;
+        } else if(strcmp("EVICTION_POLICY", param_start) == 0) {
+            if((config_file.eviction_policy = fsp_eviction_parsePolicy(val_start)) < 0) {
+                // Errore di sintassi
+                fclose(file);
+                return -2;
+            }
+        } else if(strcmp("EVICTION_HIGH_WATERMARK", param_start) == 0) {
+            if(!isNumber(val_start, &val) || val < 0 || val > 100) {
+                // Errore di sintassi
+                fclose(file);
+                return -2;
+            }
+            config_file.eviction_high_watermark = (unsigned int) val;
+        } else if(strcmp("EVICTION_LOW_WATERMARK", param_start) == 0) {
+            if(!isNumber(val_start, &val) || val < 0 || val > 100) {
+                // Errore di sintassi
+                fclose(file);
+                return -2;
+            }
+            config_file.eviction_low_watermark = (unsigned int) val;
+        } else if(strcmp("EXPIRY_SWEEP_INTERVAL", param_start) == 0) {
+            if(!isNumber(val_start, &val) || val < 0 || val > 3600000) {
+                // Errore di sintassi
+                fclose(file);
+                return -2;
+            }
+            config_file.expiry_sweep_interval = (unsigned int) val;
         } else {
             // Parametro non riconosciuto
             fclose(file);
@@ -887,6 +2828,9 @@ static int parseConfigFile(char* path) {
     
     fclose(file);
     
+    // La soglia inferiore dell'espulsione in background deve essere minore di quella superiore
+    if(config_file.eviction_high_watermark > 0 && config_file.eviction_low_watermark >= config_file.eviction_high_watermark) return -2;
+    
     return 0;
 }
 
@@ -899,53 +2843,64 @@ static void updateLogFile(int thread_id, const CLIENT client, const struct fsp_r
     
     snprintf(msg, LOG_FILE_MSG_LEN, "%d:%d:%d %d: %d", current_time->tm_hour, current_time->tm_min, current_time->tm_sec, thread_id, client->sfd);
     
-    switch(req->cmd) {
-        case APPEND:
-            strncat(msg, " APPEND ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
-            break;
-        case CLOSE:
-            strncat(msg, " CLOSE ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
-            break;
-        case LOCK:
-            strncat(msg, " LOCK ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
-            break;
-        case OPEN:
-            strncat(msg, " OPEN ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
-            break;
-        case OPENC:
-            strncat(msg, " OPENC ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
-            break;
-        case OPENCL:
-            strncat(msg, " OPENCL ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
-            break;
-        case OPENL:
-            strncat(msg, " OPENL ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
-            break;
-        case QUIT:
-            strncat(msg, " QUIT", LOG_FILE_MSG_LEN - strlen(msg) - 1);
-            break;
-        case READ:
-            strncat(msg, " READ ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
-            break;
-        case READN:
-            strncat(msg, " READN ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
-            break;
-        case REMOVE:
-            strncat(msg, " REMOVE ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
-            break;
-        case UNLOCK:
-            strncat(msg, " UNLOCK ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
-            break;
-        case WRITE:
-            strncat(msg, " WRITE ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
-            break;
-        default:
-            // Mai eseguito
-            break;
-    }
+    // Il messaggio di richiesta non è stato letto (req->arg == NULL): comando e argomento non sono noti
+    if(req->arg == NULL) {
+        strncat(msg, " UNKNOWN", LOG_FILE_MSG_LEN - strlen(msg) - 1);
+    } else {
+        switch(req->cmd) {
+            case APPEND:
+                strncat(msg, " APPEND ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
+                break;
+            case CLOSE:
+                strncat(msg, " CLOSE ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
+                break;
+            case LIST:
+                strncat(msg, " LIST ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
+                break;
+            case LOCK:
+                strncat(msg, " LOCK ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
+                break;
+            case OPEN:
+                strncat(msg, " OPEN ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
+                break;
+            case OPENC:
+                strncat(msg, " OPENC ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
+                break;
+            case OPENCL:
+                strncat(msg, " OPENCL ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
+                break;
+            case OPENL:
+                strncat(msg, " OPENL ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
+                break;
+            case QUIT:
+                strncat(msg, " QUIT", LOG_FILE_MSG_LEN - strlen(msg) - 1);
+                break;
+            case READ:
+                strncat(msg, " READ ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
+                break;
+            case READN:
+                strncat(msg, " READN ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
+                break;
+            case REMOVE:
+                strncat(msg, " REMOVE ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
+                break;
+            case TOUCH:
+                strncat(msg, " TOUCH ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
+                break;
+            case UNLOCK:
+                strncat(msg, " UNLOCK ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
+                break;
+            case WRITE:
+                strncat(msg, " WRITE ", LOG_FILE_MSG_LEN - strlen(msg) - 1);
+                break;
+            default:
+                // Mai eseguito
+                break;
+        }
     
-    if(req->cmd != QUIT) {
-        strncat(msg, req->arg, LOG_FILE_MSG_LEN - strlen(msg) - 1);
+        if(req->cmd != QUIT) {
+            strncat(msg, req->arg, LOG_FILE_MSG_LEN - strlen(msg) - 1);
+        }
     }
     
     switch(resp_code) {
@@ -989,6 +2944,25 @@ static void updateLogFile(int thread_id, const CLIENT client, const struct fsp_r
     write(1, msg, strlen(msg));
 }
 
+static const char* logArg(const CLIENT client, const char* arg, char* buf) {
+    if(arg == NULL || *arg != FSP_PARSER_HANDLE_PREFIX) return arg;
+    
+    // Il descrittore può essere seguito dal TTL
+    char* end = NULL;
+    long int handle = strtol(arg+1, &end, 10);
+    if(end == arg+1 || (*end != '\0' && *end != ' ') || handle < 0) return arg;
+    
+    pthread_mutex_lock(&files_mutex);
+    FSP_FILE file = fsp_files_set_getFile(client->openedFiles, handle);
+    if(file != NULL) {
+        strncpy(buf, file->pathname, LOG_FILE_MSG_LEN);
+        buf[LOG_FILE_MSG_LEN-1] = '\0';
+    }
+    pthread_mutex_unlock(&files_mutex);
+    
+    return file != NULL ? buf : arg;
+}
+
 static void* lock_cmd_broadcast(void* arg) {
     // Maschera i segnali
     sigset_t mask;
@@ -1010,6 +2984,7 @@ static void* lock_cmd_broadcast(void* arg) {
             pthread_mutex_unlock(&clients_mutex);
             
             pthread_mutex_lock(&files_mutex);
+            expireDeferredLocks(1);
             pthread_cond_broadcast(&lock_cmd_isNotLocked);
             pthread_mutex_unlock(&files_mutex);
             break;
@@ -1017,6 +2992,7 @@ static void* lock_cmd_broadcast(void* arg) {
         pthread_mutex_unlock(&clients_mutex);
         
         pthread_mutex_lock(&files_mutex);
+        expireDeferredLocks(quit);
         pthread_cond_broadcast(&lock_cmd_isNotLocked);
         pthread_mutex_unlock(&files_mutex);
     }
@@ -1035,28 +3011,50 @@ static void* worker(void* arg) {
         return 0;
     }
     
+    // Client che ha già inviato la richiesta successiva (pipelining), gestito senza restituirlo al master thread
+    CLIENT pipelined = NULL;
+    // Numero delle richieste del client eseguite consecutivamente
+    int requests = 0;
+    
     while(1) {
         
         int sfd;
         CLIENT client = NULL;
+        // Indica se il client è stato affidato al thread per inviare le risposte alle richieste differite completate
+        // (il client potrebbe non avere dati da leggere)
+        int notified = 0;
         
         // Determina il client
-        pthread_mutex_lock(&clients_mutex);
-        while(fsp_sfd_queue_isEmpty(sfd_queue) && !quit && (accept_connections || clients->clients_num != 0)) {
-            pthread_cond_wait(&sfd_queue_isNotEmpty, &clients_mutex);
-        }
-        if(quit || (!accept_connections && clients->clients_num == 0)) {
-            if(active_workers == 1) close(pfd[1]);
-            active_workers--;
-            pthread_cond_signal(&sfd_queue_isNotEmpty);
+        if(pipelined != NULL) {
+            client = pipelined;
+            sfd = client->sfd;
+            pipelined = NULL;
+        } else {
+            pthread_mutex_lock(&clients_mutex);
+            while(fsp_sfd_queue_isEmpty(sfd_queue) && !quit && (accept_connections || clients->clients_num != 0)) {
+                pthread_cond_wait(&sfd_queue_isNotEmpty, &clients_mutex);
+            }
+            if(quit || (!accept_connections && clients->clients_num == 0)) {
+                if(active_workers == 1) close(pfd[1]);
+                active_workers--;
+                pthread_cond_signal(&sfd_queue_isNotEmpty);
+                pthread_mutex_unlock(&clients_mutex);
+                return 0;
+            }
+            sfd = fsp_sfd_queue_dequeue(sfd_queue);
+            if(sfd < 0) {
+                notified = 1;
+                sfd = -sfd-1;
+            }
+            client = fsp_clients_hash_table_search(clients, sfd);
             pthread_mutex_unlock(&clients_mutex);
-            return 0;
+            requests = 0;
         }
-        sfd = fsp_sfd_queue_dequeue(sfd_queue);
-        client = fsp_clients_hash_table_search(clients, sfd);
-        pthread_mutex_unlock(&clients_mutex);
         
-        if(client == NULL) {
+        if(client == NULL && notified) {
+            // Client già chiuso
+            continue;
+        } else if(client == NULL) {
             // Client non trovato
             close(sfd);
             
@@ -1071,13 +3069,28 @@ static void* worker(void* arg) {
             continue;
         }
         
+        // Invia le risposte alle richieste differite completate
+        if(sendDeferredResps(thread_id, client) != 0) {
+            closeConnection(client, "internal error");
+            continue;
+        }
+        if(notified && !isReadable(sfd)) {
+            // Restituisce il client al master thread
+            write(pfd[1], &sfd, sizeof(int));
+            continue;
+        }
+        
         // Il messaggio di risposta
         const size_t descr_max_len = 128;
         char description[descr_max_len];
         struct fsp_response resp = {200, description, 0, NULL};
         
         // Legge il messaggio di richiesta
+        // Se il messaggio non viene letto req.arg resta NULL e il log non accede a comando e argomento
         struct fsp_request req;
+        req.arg = NULL;
+        // Indica se i messaggi successivi del client non possono essere delimitati
+        int unframed = 0;
         switch(receiveFspReq(client, &req)) {
             case -1:
                 // client->buf == NULL || client->size == NULL
@@ -1106,6 +3119,13 @@ static void* worker(void* arg) {
                 strncpy(resp.description, "Service not available, closing connection.", descr_max_len);
                 description[descr_max_len-1] = '\0';
                 break;
+            case -6:
+                // L'intestazione binaria non è valida: dopo la risposta chiude la connessione
+                resp.code = 501;
+                strncpy(resp.description, "Syntax error, message unrecognised.", descr_max_len);
+                description[descr_max_len-1] = '\0';
+                unframed = 1;
+                break;
             default:
                 break;
         }
@@ -1113,7 +3133,13 @@ static void* worker(void* arg) {
         // Esegue il comando
         // Valore di ritorno delle funzioni che eseguono i comandi
         unsigned long int ret_val = 0;
+        // Indica se la risposta è differita (sendDeferredResps)
+        int deferred = 0;
+        // Argomento da stampare nel file di log (nome del file anche se la richiesta usa il descrittore)
+        char log_buf[LOG_FILE_MSG_LEN];
+        const char* log_arg = NULL;
         if(resp.code != 421 && resp.code != 501) {
+            log_arg = logArg(client, req.arg, log_buf);
             switch(req.cmd) {
                 case APPEND:
                     ret_val = append_cmd(client, &req, &resp, descr_max_len);
@@ -1121,8 +3147,12 @@ static void* worker(void* arg) {
                 case CLOSE:
                     ret_val = close_cmd(client, &req, &resp, descr_max_len);
                     break;
+                case LIST:
+                    ret_val = list_cmd(client, &req, &resp, descr_max_len);
+                    break;
                 case LOCK:
                     ret_val = lock_cmd(client, &req, &resp, descr_max_len);
+                    deferred = ret_val == 1;
                     break;
                 case OPEN:
                     ret_val = open_cmd(client, &req, &resp, descr_max_len);
@@ -1150,6 +3180,9 @@ static void* worker(void* arg) {
                 case REMOVE:
                     ret_val = remove_cmd(client, &req, &resp, descr_max_len);
                     break;
+                case TOUCH:
+                    ret_val = touch_cmd(client, &req, &resp, descr_max_len);
+                    break;
                 case UNLOCK:
                     ret_val = unlock_cmd(client, &req, &resp, descr_max_len);
                     break;
@@ -1172,13 +3205,23 @@ static void* worker(void* arg) {
                 closeConnection(client, "internal error");
                 continue;
             }
+            
+            // Attende che le modifiche eseguite dal comando siano persistenti (se richiesto dal livello di durabilità)
+            if(wal != NULL && resp.code == 200 &&
+               (req.cmd == APPEND || req.cmd == OPENC || req.cmd == OPENCL || req.cmd == REMOVE || req.cmd == TOUCH || req.cmd == WRITE) &&
+               fsp_wal_commit(wal) != 0) {
+                if(resp.data != NULL) free(resp.data);
+                closeConnection(client, "internal error");
+                continue;
+            }
         }
         
         // Scrive nel file di log
-        updateLogFile(thread_id, client, &req, resp.code, ret_val);
+        if(log_arg != NULL) req.arg = (char*) log_arg;
+        if(!deferred) updateLogFile(thread_id, client, &req, resp.code, ret_val);
         
         // Invia il messaggio di risposta
-        if(sendFspResp(client, resp.code, resp.description, resp.data_len, resp.data) != 0) {
+        if(!deferred && sendFspResp(client, resp.code, resp.description, resp.data_len, resp.data) != 0) {
             // Chiude immediatamente la connessione
             if(resp.data != NULL) free(resp.data);
             closeConnection(client, "internal error");
@@ -1188,15 +3231,24 @@ static void* worker(void* arg) {
         if(resp.data != NULL) {
             free(resp.data);
         }
+        releaseParts(client);
         
-        if(resp.code == 221 || resp.code == 421 || quit) {
+        if(resp.code == 221 || resp.code == 421 || unframed || quit) {
             // Chiude la connessione
-            closeConnection(client, NULL);
+            closeConnection(client, unframed ? "invalid message header" : NULL);
+            continue;
+        }
+        
+        // Esegue subito la richiesta successiva se il client (protocollo versione 2) l'ha già inviata,
+        // senza restituirlo al master thread (al più PIPELINE_MAX_REQUESTS richieste consecutive)
+        if(client->version == FSP_PARSER_V2 && ++requests < PIPELINE_MAX_REQUESTS && isReadable(sfd)) {
+            pipelined = client;
             continue;
         }
         
         // Comunica al master thread il valore sfd (attraverso una pipe senza nome)
-        write(pfd[1], &(client->sfd), sizeof(int));
+        // Da questo momento client può essere gestito (e liberato) da un altro thread worker
+        write(pfd[1], &sfd, sizeof(int));
     }
     
     return 0;
@@ -1207,7 +3259,17 @@ static int receiveFspReq(CLIENT client, struct fsp_request* req) {
     
     int ret_val;
     struct fsp_request _req;
-    if ((ret_val = fsp_reader_readRequest(client->sfd, &(client->buf), &(client->size), &_req)) != 0) {
+    _req.version = FSP_PARSER_V1;
+    _req.id = 0;
+    ret_val = fsp_reader_readRequest(client->sfd, &(client->buf), &(client->size), &_req);
+    
+    // La risposta (anche a un messaggio con errori sintattici) usa il formato e l'identificativo della richiesta
+    client->version = _req.version;
+    client->req_id = _req.id;
+    if(ret_val == -4 && _req.version == FSP_PARSER_V2 && fsp_parser_binaryLength(client->buf, FSP_PARSER_V2_HEADER_LEN) == -3) {
+        return -6;
+    }
+    if(ret_val != 0) {
         return ret_val;
     }
     
@@ -1218,10 +3280,16 @@ static int receiveFspReq(CLIENT client, struct fsp_request* req) {
 
 static int sendFspResp(const CLIENT client, int code, const char* description, size_t data_len, void* data) {
     if(client == NULL) return -1;
+    if(client->parts_num > 0) return sendFspParts(client, code, description);
     
     // Genera il messaggio di risposta
     long int bytes;
-    switch(bytes = fsp_parser_makeResponse(&(client->buf), &(client->size), code, description, data_len, data)) {
+    if(client->version == FSP_PARSER_V2) {
+        bytes = fsp_parser_makeBinaryResponse(&(client->buf), &(client->size), code, client->req_id, description, data_len, data);
+    } else {
+        bytes = fsp_parser_makeResponse(&(client->buf), &(client->size), code, description, data_len, data);
+    }
+    switch(bytes) {
         case -1:
             // buf == NULL || *buf == NULL || size == NULL || data_len < 0 ||
             // (data_len > 0 && data == NULL) || client->size > FSP_PARSER_BUF_MAX_SIZE
@@ -1233,96 +3301,538 @@ static int sendFspResp(const CLIENT client, int code, const char* description, s
             break;
     }
     
-    // Invia il messaggio di risposta
-    char* _buf = (char*) client->buf;
-    ssize_t w_bytes;
-    while(bytes > 0) {
-        if((w_bytes = write(client->sfd, _buf, bytes)) == -1) {
-            // Errore durante la scrittura
-            return -1;
-        } else {
-            bytes -= w_bytes;
-            _buf += w_bytes;
+    // Invia il messaggio di risposta
+    char* _buf = (char*) client->buf;
+    ssize_t w_bytes;
+    while(bytes > 0) {
+        if((w_bytes = write(client->sfd, _buf, bytes)) == -1) {
+            // Errore durante la scrittura
+            return -1;
+        } else {
+            bytes -= w_bytes;
+            _buf += w_bytes;
+        }
+    }
+    
+    return 0;
+}
+
+static int sendFspParts(const CLIENT client, int code, const char* description) {
+    // Decomprime i contenuti compressi (senza mutua esclusione) e calcola la lunghezza del campo data
+    size_t data_len = 0;
+    for(size_t i = 0; i < client->parts_num; i++) {
+        struct fsp_client_part* part = &(client->parts[i]);
+        if(part->data == NULL) {
+            if((part->buf = malloc(part->len > 0 ? part->len : 1)) == NULL) return -1;
+            if(fsp_blob_read(part->blob, part->buf) != 0) return -1;
+            part->data = part->buf;
+        }
+        data_len += part->len;
+    }
+    
+    // Genera l'intestazione del messaggio di risposta (come fsp_parser_makeResponse o fsp_parser_makeBinaryResponse)
+    size_t descr_len = strlen(description);
+    size_t header_size = descr_len + (client->version == FSP_PARSER_V2 ? FSP_PARSER_V2_HEADER_LEN + 1 : 32);
+    if(client->size < header_size) {
+        void* buf_tmp;
+        if((buf_tmp = realloc(client->buf, header_size)) == NULL) return -1;
+        client->buf = buf_tmp;
+        client->size = header_size;
+    }
+    size_t header_len;
+    if(client->version == FSP_PARSER_V2) {
+        // Intestazione binaria e descrizione terminata da '\0' (nessun terminatore dopo i dati)
+        fsp_parser_makeBinaryHeader(client->buf, code, client->req_id, descr_len + 1, data_len);
+        memcpy((char*) client->buf + FSP_PARSER_V2_HEADER_LEN, description, descr_len + 1);
+        header_len = header_size;
+    } else {
+        header_len = snprintf((char*) client->buf, client->size, "%d %s\r\n%lu ", code, description, (unsigned long int) data_len);
+    }
+    if(header_len + data_len + 2 > FSP_PARSER_BUF_MAX_SIZE) return -1;
+    
+    // Intestazione, parti e terminatore
+    struct iovec* iov = NULL;
+    if((iov = malloc((client->parts_num + 2) * sizeof(struct iovec))) == NULL) return -1;
+    int iov_num = 0;
+    iov[iov_num].iov_base = client->buf;
+    iov[iov_num++].iov_len = header_len;
+    for(size_t i = 0; i < client->parts_num; i++) {
+        iov[iov_num].iov_base = (void*) client->parts[i].data;
+        iov[iov_num++].iov_len = client->parts[i].len;
+    }
+    if(client->version != FSP_PARSER_V2) {
+        iov[iov_num].iov_base = "\r\n";
+        iov[iov_num++].iov_len = 2;
+    }
+    
+    // Invia il messaggio di risposta
+    struct iovec* _iov = iov;
+    ssize_t w_bytes;
+    while(iov_num > 0) {
+        if((w_bytes = writev(client->sfd, _iov, iov_num < IOV_MAX ? iov_num : IOV_MAX)) == -1) {
+            // Errore durante la scrittura
+            free(iov);
+            return -1;
+        }
+        // Salta le parti inviate completamente
+        while(iov_num > 0 && (size_t) w_bytes >= _iov->iov_len) {
+            w_bytes -= _iov->iov_len;
+            _iov++;
+            iov_num--;
+        }
+        if(iov_num > 0) {
+            _iov->iov_base = (char*) _iov->iov_base + w_bytes;
+            _iov->iov_len -= w_bytes;
+        }
+    }
+    free(iov);
+    
+    return 0;
+}
+
+static void releaseParts(CLIENT client) {
+    if(client->parts_num == 0) return;
+    
+    // I contenuti possono essere allocati in un'arena (non thread-safe)
+    pthread_mutex_lock(&files_mutex);
+    for(size_t i = 0; i < client->parts_num; i++) {
+        if(client->parts[i].blob != NULL) fsp_blob_free(client->parts[i].blob);
+    }
+    pthread_mutex_unlock(&files_mutex);
+    
+    for(size_t i = 0; i < client->parts_num; i++) {
+        if(client->parts[i].buf != NULL) free(client->parts[i].buf);
+    }
+    client->parts_num = 0;
+}
+
+static int capacityMiss(CLIENT client) {
+    pthread_mutex_lock(&files_mutex);
+    
+    FSP_FILE file = NULL;
+    
+    // Il thread che esegue l'espulsione in background riporta l'occupazione sotto la soglia inferiore
+    if(config_file.eviction_high_watermark > 0 && aboveWatermark(config_file.eviction_high_watermark)) pthread_cond_signal(&evictor_isNeeded);
+    
+    if(eviction->files_num == 0 || (files_num <= config_file.files_max_num && storage_size <= config_file.storage_max_size)) {
+        pthread_mutex_unlock(&files_mutex);
+        return 0;
+    }
+    
+    // Messaggio per il file di log
+    char msg[LOG_FILE_MSG_LEN] = {0};
+    time_t t = time(NULL);
+    struct tm* current_time = localtime(&t);
+    snprintf(msg, LOG_FILE_MSG_LEN, "%d:%d:%d CAPACITY_MISS\n", current_time->tm_hour, current_time->tm_min, current_time->tm_sec);
+    // Scrive nel file di log e su stdout
+    write(log_file, msg, strlen(msg));
+    write(1, msg, strlen(msg));
+    
+    // I file scaduti non usati dai client liberano spazio prima che venga espulso un file valido
+    lazy_expirations += sweepExpired(1);
+    
+    // I file creati senza contenuto non si trovano nella politica di rimpiazzamento e non vengono espulsi
+    t = time(NULL);
+    while((files_num > config_file.files_max_num || storage_size > config_file.storage_max_size) && eviction->files_num > 0) {
+        file = fsp_eviction_victim(eviction);
+        
+        // Un file scaduto viene rimosso senza essere restituito al client
+        if(isExpired(file, t)) {
+            expireFile(file);
+            lazy_expirations++;
+            continue;
+        }
+        
+        // Se possibile mantiene il file sul server espellendo il suo contenuto nel tier su disco
+        if(spillVictim(file) == 0) continue;
+        
+        // Restituisce il file al client
+        if(client != NULL && addEvictedFile(client, file) != 0) {
+            pthread_mutex_unlock(&files_mutex);
+            return -1;
+        }
+        
+        // Messaggio per il file di log
+        t = time(NULL);
+        current_time = localtime(&t);
+        snprintf(msg, LOG_FILE_MSG_LEN, "%d:%d:%d REJECTED_FILE: %s (%lu)\n", current_time->tm_hour, current_time->tm_min, current_time->tm_sec, file->pathname, file->size);
+        // Scrive nel file di log e su stdout
+        write(log_file, msg, strlen(msg));
+        write(1, msg, strlen(msg));
+        
+        // Aggiorna il numero dei file e la dimensione dello spazio utilizzato dal server
+        files_num--;
+        releaseFileData(file);
+        fsp_expiry_remove(expiring, file);
+        logFileChange(FSP_WAL_REMOVE, file, NULL, 0);
+        rememberRejected(file->pathname);
+        
+        // Rimuove il file
+        if(file->links == 0) {
+            deleteFile(file);
+            fsp_file_free(files_pool, file);
+        } else {
+            // File da rimuovere quando verrà chiuso da tutti i client
+            setRemovePending(file);
+            lockReleased(file);
+        }
+    }
+    
+    // Aggiorna la statistica
+    capacity_misses++;
+    pthread_mutex_unlock(&files_mutex);
+    
+    return 0;
+}
+
+static int addEvictedFile(CLIENT client, FSP_FILE file) {
+    BLOB data = file->data;
+    
+    if(data != NULL && data->refs == 1 && !data->embedded) {
+        // Intestazione del file nel formato fsp del campo data (come fsp_parser_makeData)
+        size_t header_size = file->pathname_len + 24;
+        char* header = NULL;
+        if((header = malloc(header_size)) == NULL) return -1;
+        int header_len = snprintf(header, header_size, "%s %lu ", file->pathname, file->size);
+        if(addPart(client, header, header_len, header, NULL) != 0) {
+            free(header);
+            return -1;
+        }
+        
+        // Il contenuto passa alla risposta per riferimento (decompresso durante l'invio se necessario)
+        data = takeFileData(file);
+        if(addPart(client, data->compressed ? NULL : data->data, data->size, NULL, data) != 0) {
+            fsp_blob_free(data);
+            return -1;
+        }
+        
+        return addPart(client, " ", 1, NULL, NULL);
+    }
+    
+    // Contenuto condiviso o incorporato: viene copiato
+    size_t size = file->pathname_len + 24 + file->size;
+    void* buf = NULL;
+    if((buf = malloc(size)) == NULL) return -1;
+    long int wrote_bytes = makeFileData(&buf, &size, 0, file);
+    if(wrote_bytes < 0 || addPart(client, buf, wrote_bytes, buf, NULL) != 0) {
+        free(buf);
+        return -1;
+    }
+    
+    return 0;
+}
+
+static int addPart(CLIENT client, const void* data, size_t len, void* buf, BLOB blob) {
+    // Ingrandisce il vettore delle parti se necessario
+    if(client->parts_num == client->parts_size) {
+        size_t parts_size = client->parts_size > 0 ? client->parts_size*2 : 16;
+        struct fsp_client_part* parts_tmp = NULL;
+        if((parts_tmp = realloc(client->parts, parts_size * sizeof(struct fsp_client_part))) == NULL) return -1;
+        client->parts = parts_tmp;
+        client->parts_size = parts_size;
+    }
+    
+    struct fsp_client_part* part = &(client->parts[(client->parts_num)++]);
+    part->data = data;
+    part->len = len;
+    part->buf = buf;
+    part->blob = blob;
+    
+    return 0;
+}
+
+static int spillVictim(FSP_FILE file) {
+    int err;
+    if((err = spillFile(file)) != 0) return err;
+    
+    // Messaggio per il file di log
+    char msg[LOG_FILE_MSG_LEN] = {0};
+    time_t t = time(NULL);
+    struct tm* current_time = localtime(&t);
+    snprintf(msg, LOG_FILE_MSG_LEN, "%d:%d:%d SPILLED_FILE: %s (%lu)\n", current_time->tm_hour, current_time->tm_min, current_time->tm_sec, file->pathname, file->size);
+    // Scrive nel file di log e su stdout
+    write(log_file, msg, strlen(msg));
+    write(1, msg, strlen(msg));
+    
+    files_num--;
+    spilled_files_num++;
+    tier_spills++;
+    
+    return 0;
+}
+
+static int aboveWatermark(unsigned int percent) {
+    return (unsigned long int) files_num*100 > (unsigned long int) config_file.files_max_num*percent ||
+           storage_size > config_file.storage_max_size/100*percent;
+}
+
+static int spillFile(FSP_FILE file) {
+    if(tier == NULL || file->data == NULL) return -1;
+    
+    BLOB data = file->data;
+    if(data->refs > 1 || data->embedded) {
+        // Contenuto condiviso o incorporato nel file: il tier deve esserne l'unico proprietario
+        BLOB copy = NULL;
+        if((copy = fsp_blob_alloc(NULL, data->size, data->stored_size, data->compressed, data->hash)) == NULL) return -1;
+        memcpy(copy->data, data->data, data->stored_size);
+        int err;
+        if((err = fsp_tier_spill(tier, file, copy)) != 0) {
+            fsp_blob_free(copy);
+            return err;
+        }
+        releaseFileData(file);
+    } else {
+        // Il riferimento del file passa al tier: dopo fsp_tier_spill il contenuto può essere
+        // liberato in qualsiasi momento dal thread di scrittura del tier
+        fsp_blobs_hash_table_delete(blobs, data);
+        storage_size -= data->stored_size;
+        int err;
+        if((err = fsp_tier_spill(tier, file, data)) != 0) {
+            fsp_blobs_hash_table_insert(blobs, data);
+            storage_size += data->stored_size;
+            return err;
+        }
+        file->data = NULL;
+        if(file->record != NULL) {
+            fsp_arena_free(arena, file->record);
+            file->record = NULL;
+        }
+    }
+    file->spilled = 1;
+    
+    return 0;
+}
+
+static int promoteFile(CLIENT client, FSP_FILE file) {
+    // Attende la promozione dello stesso file da parte di un altro thread
+    while(file->promoting) pthread_cond_wait(&promotion_isDone, &files_mutex);
+    if(file->remove) return -3;
+    if(!file->spilled) {
+        memory_hits++;
+        memory_hit_bytes += file->size;
+        return 0;
+    }
+    
+    // Legge il contenuto dal tier senza mutua esclusione
+    size_t size = file->size;
+    file->promoting = 1;
+    promotions_num++;
+    pthread_mutex_unlock(&files_mutex);
+    BLOB data = fsp_tier_promote(tier, file, blobArena(size));
+    pthread_mutex_lock(&files_mutex);
+    file->promoting = 0;
+    promotions_num--;
+    pthread_cond_broadcast(&promotion_isDone);
+    if(file->remove) {
+        // File rimosso durante la lettura (il contenuto non si trova più nel tier)
+        fsp_blob_free(data);
+        return -3;
+    }
+    if(data == NULL) return -1;
+    file->spilled = 0;
+    spilled_files_num--;
+    tier_hits++;
+    tier_hit_bytes += file->size;
+    
+    BLOB unused;
+    setFileData(file, data, &unused);
+    fsp_blob_free(unused);
+    files_num++;
+    
+    // Messaggio per il file di log
+    char msg[LOG_FILE_MSG_LEN] = {0};
+    time_t t = time(NULL);
+    struct tm* current_time = localtime(&t);
+    snprintf(msg, LOG_FILE_MSG_LEN, "%d:%d:%d PROMOTED_FILE: %s (%lu)\n", current_time->tm_hour, current_time->tm_min, current_time->tm_sec, file->pathname, file->size);
+    // Scrive nel file di log e su stdout
+    write(log_file, msg, strlen(msg));
+    write(1, msg, strlen(msg));
+    
+    // Espelle i file dalla memoria se necessario: file viene aggiunto alla politica di rimpiazzamento solo dopo,
+    // perché non deve essere scelto come vittima (il chiamante lo legge o lo modifica)
+    int err = 0;
+    if(files_num > config_file.files_max_num || storage_size > config_file.storage_max_size) {
+        err = capacityMiss(client) != 0;
+    }
+    fsp_eviction_insert(eviction, file);
+    if(err) return -2;
+    
+    // Aggiorna le statistiche
+    if(files_num > files_max_reached_num) files_max_reached_num = files_num;
+    if(storage_size > storage_max_reached_size) storage_max_reached_size = storage_size;
+    
+    return 0;
+}
+
+static size_t readSpilled(void* buf, size_t len, struct spilled_read* reads, size_t reads_num) {
+    if(reads_num == 0) return len;
+    
+    // I file collegati non vengono liberati mentre files_mutex è rilasciato
+    for(size_t i = 0; i < reads_num; i++) reads[i].file->links++;
+    pthread_mutex_unlock(&files_mutex);
+    for(size_t i = 0; i < reads_num; i++) {
+        struct spilled_read* read = &(reads[i]);
+        // Il contenuto precede l'ultimo byte del file (separatore)
+        char* dst = (char*) buf + read->start + read->len - 1 - read->size;
+        read->err = fsp_tier_read(tier, read->file, dst, read->size) != 0;
+    }
+    pthread_mutex_lock(&files_mutex);
+    
+    // Scorre le letture a ritroso: la rimozione di un file da buf non sposta i file precedenti
+    for(size_t i = reads_num; i-- > 0; ) {
+        struct spilled_read* read = &(reads[i]);
+        FSP_FILE file = read->file;
+        if(read->err && file->remove) {
+            read->err = 2;
+        } else if(read->err && !file->spilled && file->data != NULL && file->size == read->size) {
+            // Contenuto riportato in memoria durante la lettura
+            read->err = fsp_blob_read(file->data, (char*) buf + read->start + read->len - 1 - read->size) != 0;
+        }
+        if(read->err) {
+            memmove((char*) buf + read->start, (char*) buf + read->start + read->len, len - read->start - read->len);
+            len -= read->len;
+        }
+        // Rimuove il file se è stato rimosso durante la lettura (come closeFile)
+        if(--(file->links) == 0 && file->remove) {
+            deleteFile(file);
+            fsp_file_free(files_pool, file);
+        }
+    }
+    
+    return len;
+}
+
+static void rememberRejected(const char* pathname) {
+    unsigned int hash = pathnameHash(pathname) | 1;
+    rejected[hash % REJECTED_SLOTS_NUM] = hash;
+}
+
+static int forgetRejected(const char* pathname) {
+    unsigned int hash = pathnameHash(pathname) | 1;
+    if(rejected[hash % REJECTED_SLOTS_NUM] != hash) return 0;
+    rejected[hash % REJECTED_SLOTS_NUM] = 0;
+    return 1;
+}
+
+static void countMiss(const char* arg) {
+    if(arg != NULL && *arg != FSP_PARSER_HANDLE_PREFIX && forgetRejected(arg)) tier_misses++;
+}
+
+static FSP_FILE searchFile(const CLIENT client, const char* arg) {
+    if(arg == NULL) return NULL;
+    
+    if(*arg == FSP_PARSER_HANDLE_PREFIX) {
+        long int handle;
+        if(!isNumber(arg+1, &handle) || handle < 0) return NULL;
+        return checkExpiry(fsp_files_set_getFile(client->openedFiles, handle));
+    }
+    
+    return checkExpiry(fsp_files_hash_table_search(files, arg));
+}
+
+static void openSucceeded(struct fsp_response* resp, long int handle, const size_t descr_max_len) {
+    resp->code = 200;
+    if(handle >= 0) {
+        snprintf(resp->description, descr_max_len, "The requested action has been successfully completed. %c%ld", FSP_PARSER_HANDLE_PREFIX, handle);
+    } else {
+        strncpy(resp->description, "The requested action has been successfully completed.", descr_max_len);
+        resp->description[descr_max_len-1] = '\0';
+    }
+}
+
+static void setFileData(FSP_FILE file, BLOB data, BLOB* unused) {
+    BLOB shared = fsp_blobs_hash_table_search(blobs, data);
+    if(shared != NULL) {
+        // Condivide il contenuto già presente (già contato in storage_size)
+        (shared->refs)++;
+        file->data = shared;
+        *unused = data;
+    } else {
+        fsp_blobs_hash_table_insert(blobs, data);
+        storage_size += data->stored_size;
+        file->data = data;
+        *unused = NULL;
+    }
+    file->size = file->data->size;
+    
+    // Aggiorna il record persistente del file
+    if(arena != NULL && file->data->arena == arena) {
+        if(file->record == NULL && (file->record = fsp_arena_alloc(arena, sizeof(struct fsp_file_record) + file->pathname_len + 1, FSP_FILE_ARENA_TYPE)) != NULL) {
+            memcpy(file->record->pathname, file->pathname, file->pathname_len + 1);
+            file->record->expires = file->expires;
         }
+        if(file->record != NULL) file->record->data = fsp_arena_offset(arena, file->data);
+    } else if(file->record != NULL) {
+        // Il contenuto non è nell'arena (arena piena): il file non è persistente
+        fsp_arena_free(arena, file->record);
+        file->record = NULL;
     }
+}
+
+static ARENA blobArena(size_t size) {
+    if(arena != NULL) return arena;
     
-    return 0;
+    return size >= LARGE_POOL_MIN_SIZE ? large_pool : NULL;
 }
 
-static int capacityMiss(void** data, size_t* data_len) {
-    if(data == NULL) return -1;
+static FSP_FILE embedFileData(FSP_FILE file, BLOB data) {
+    // I contenuti incorporati non sono allocati nell'arena e non sopravviverebbero al riavvio
+    if(arena != NULL || data->stored_size > config_file.inline_max_size) return NULL;
     
-    pthread_mutex_lock(&files_mutex);
+    FSP_FILE embedded = NULL;
+    if((embedded = fsp_file_embed(files_pool, file, data)) == NULL) return NULL;
+    storage_size += data->stored_size;
     
-    FSP_FILE file = files_queue->head;
+    return embedded;
+}
+
+static void releaseFileData(FSP_FILE file) {
+    fsp_blob_free(takeFileData(file));
+}
+
+static BLOB takeFileData(FSP_FILE file) {
+    BLOB data = file->data;
+    if(data == NULL) return NULL;
     
-    if(file == NULL || (files_num <= config_file.files_max_num && storage_size <= config_file.storage_max_size)) {
-        pthread_mutex_unlock(&files_mutex);
-        return 0;
+    file->data = NULL;
+    if(file->record != NULL) {
+        fsp_arena_free(arena, file->record);
+        file->record = NULL;
+    }
+    if(data->refs == 1) {
+        fsp_blobs_hash_table_delete(blobs, data);
+        storage_size -= data->stored_size;
     }
     
-    size_t tot_size = storage_size > config_file.storage_max_size ? (storage_size - config_file.storage_max_size) + 512 : file->size + strlen(file->pathname) + 32;
+    return data;
+}
+
+static long int makeFileData(void** buf, size_t* size, unsigned long int offset, const FSP_FILE file) {
+    // Riserva lo spazio per il contenuto del file
+    long int wrote_bytes = fsp_parser_makeData(buf, size, offset, file->pathname, file->size, NULL);
+    if(wrote_bytes < 0 || (file->data == NULL && !file->spilled)) return wrote_bytes;
     
-    // Alloca la memoria per *data
-    if((*data = malloc(tot_size)) == NULL) {
-        pthread_mutex_unlock(&files_mutex);
-        return -1;
-    }
+    // Il contenuto precede l'ultimo byte scritto (separatore)
+    // Il contenuto di un file espulso nel tier su disco viene letto senza mutua esclusione (readSpilled)
+    char* dst = (char*) (*buf) + offset + wrote_bytes - 1 - file->size;
+    if(!file->spilled && fsp_blob_read(file->data, dst) != 0) return -1;
     
-    // Messaggio per il file di log
-    char msg[LOG_FILE_MSG_LEN] = {0};
-    time_t t = time(NULL);
-    struct tm* current_time = localtime(&t);
-    snprintf(msg, LOG_FILE_MSG_LEN, "%d:%d:%d CAPACITY_MISS\n", current_time->tm_hour, current_time->tm_min, current_time->tm_sec);
-    // Scrive nel file di log e su stdout
-    write(log_file, msg, strlen(msg));
-    write(1, msg, strlen(msg));
+    return wrote_bytes;
+}
+
+static int listFile(FSP_FILE file, void* arg) {
+    struct list_arg* list = arg;
+    if(file->remove || isExpired(file, list->now)) return 0;
     
-    long int wrote_bytes_tot = 0;
-    long int wrote_bytes = 0;
-    while(files_num > config_file.files_max_num || storage_size > config_file.storage_max_size) {
-        // Scrive in *data
-        file = fsp_files_queue_dequeue(files_queue);
-        
-        wrote_bytes = fsp_parser_makeData(data, &tot_size, wrote_bytes_tot, file->pathname, file->size, file->data);
-        if(wrote_bytes < 0) {
-            free(*data);
-            *data = NULL;
-            pthread_mutex_unlock(&files_mutex);
-            return -1;
-        }
-        wrote_bytes_tot += wrote_bytes;
-        
-        // Messaggio per il file di log
-        time_t t = time(NULL);
-        struct tm* current_time = localtime(&t);
-        snprintf(msg, LOG_FILE_MSG_LEN, "%d:%d:%d REJECTED_FILE: %s (%lu)\n", current_time->tm_hour, current_time->tm_min, current_time->tm_sec, file->pathname, file->size);
-        // Scrive nel file di log e su stdout
-        write(log_file, msg, strlen(msg));
-        write(1, msg, strlen(msg));
-        
-        // Aggiorna il numero dei file e la dimensione dello spazio utilizzato dal server
-        files_num--;
-        storage_size -= file->size;
-        
-        // Rimuove il file
-        fsp_files_queue_remove(files_queue, file->pathname);
-        if(file->links == 0) {
-            fsp_files_hash_table_delete(files, file->pathname);
-            fsp_file_free(file);
-        } else {
-            // File da rimuovere quando verrà chiuso da tutti i client
-            file->remove = 1;
-            pthread_cond_broadcast(&lock_cmd_isNotLocked);
-        }
+    long int wrote_bytes = fsp_parser_makeListItem(&(list->buf), &(list->size), list->len, file->pathname, file->size);
+    if(wrote_bytes < 0) {
+        list->err = 1;
+        return 1;
     }
-    if(data_len != NULL) *data_len = wrote_bytes_tot;
+    list->len += wrote_bytes;
+    list->listed++;
     
-    // Aggiorna la statistica
-    capacity_misses++;
-    pthread_mutex_unlock(&files_mutex);
-    
-    return 0;
+    return list->listed >= list->limit;
 }
 
 static unsigned long int append_cmd(CLIENT client, const struct fsp_request* req, struct fsp_response* resp, const size_t descr_max_len) {
@@ -1367,34 +3877,71 @@ static unsigned long int append_cmd(CLIENT client, const struct fsp_request* req
     int notOpened = 0;
     int locked = 0;
     int noMemory = 0;
+    int promoted = 0;
     
     pthread_mutex_lock(&files_mutex);
     // Cerca il file
-    file = fsp_files_hash_table_search(files, req->arg);
+    file = searchFile(client, req->arg);
+    if(file == NULL || file->remove) countMiss(file != NULL ? file->pathname : req->arg);
     // Se il file esiste ma deve essere rimosso, allora non esegue il comando
     if(file != NULL && file->remove) file = NULL;
+    if(file != NULL && fsp_files_set_contains(client->openedFiles, file) && file->spilled && (file->locked < 0 || file->locked == client->sfd)) {
+        // Riporta in memoria il contenuto del file: files_mutex viene rilasciato durante la lettura dal tier
+        // e lo stato del file viene controllato dopo
+        int err;
+        if((err = promoteFile(client, file)) == -3) {
+            file = NULL;
+        } else if(err != 0) {
+            fsp_parser_freeData(parsed_data);
+            pthread_mutex_unlock(&files_mutex);
+            return err;
+        }
+        promoted = 1;
+    }
     if(file != NULL) {
         if(file->size + parsed_data->size <= config_file.storage_max_size) {
-            if(fsp_files_list_contains(client->openedFiles, req->arg) && file->data != NULL) {
+            if(fsp_files_set_contains(client->openedFiles, file) && (file->data != NULL || file->spilled)) {
                 // Il file è stato aperto dal client senza flag O_CREATE
                 if(file->locked < 0 || file->locked == client->sfd) {
                     // Nessuno detiene la lock sul file oppure la detiene il client
+                    // Registra l'accesso se il contenuto non è appena stato riportato in memoria
+                    int err;
+                    if(!promoted && (err = promoteFile(client, file)) != 0) {
+                        fsp_parser_freeData(parsed_data);
+                        pthread_mutex_unlock(&files_mutex);
+                        return err;
+                    }
+                    // Solo la lettura e la modifica del contenuto sono accessi per la politica di rimpiazzamento
+                    // (l'apertura e la successiva lettura di un file contano come un solo accesso)
+                    fsp_eviction_access(eviction, file);
                     if(parsed_data->size > 0) {
-                        void* _data = file->data;
-                        if((file->data = realloc(file->data, file->size + parsed_data->size)) == NULL) {
-                            file->data = _data;
+                        // Il contenuto viene modificato: se è condiviso, allora il file ne riceve una copia
+                        BLOB data = file->data;
+                        int shared = data->refs > 1;
+                        if(!shared) {
+                            fsp_blobs_hash_table_delete(blobs, data);
+                            storage_size -= data->stored_size;
+                        }
+                        if((data = fsp_blob_append(blobArena(file->size + parsed_data->size), file->data, parsed_data->data, parsed_data->size, config_file.compression)) == NULL) {
+                            if(!shared) {
+                                // Un contenuto incorporato non si trova nella tabella dei contenuti
+                                if(!file->data->embedded) fsp_blobs_hash_table_insert(blobs, file->data);
+                                storage_size += file->data->stored_size;
+                            }
                             fsp_parser_freeData(parsed_data);
                             pthread_mutex_unlock(&files_mutex);
                             return -1;
                         }
-                        memcpy((file->data) + file->size, parsed_data->data, parsed_data->size);
-                        file->size += parsed_data->size;
-                        storage_size += parsed_data->size;
+                        file->data = NULL;
+                        BLOB unused;
+                        setFileData(file, data, &unused);
+                        fsp_blob_free(unused);
+                        logFileChange(FSP_WAL_APPEND, file, parsed_data->data, parsed_data->size);
                     }
                     
                     // Espelle i file dalla memoria se necessario
                     if(storage_size > config_file.storage_max_size) {
-                        if(capacityMiss(&(resp->data), &(resp->data_len)) != 0) {
+                        if(capacityMiss(client) != 0) {
                             fsp_parser_freeData(parsed_data);
                             pthread_mutex_unlock(&files_mutex);
                             return -2;
@@ -1463,27 +4010,28 @@ static int close_cmd(CLIENT client, const struct fsp_request* req, struct fsp_re
     
     pthread_mutex_lock(&files_mutex);
     // Cerca il file
-    file = fsp_files_hash_table_search(files, req->arg);
+    file = searchFile(client, req->arg);
     if(file != NULL) {
-        if(fsp_files_list_contains(client->openedFiles, req->arg)) {
+        if(fsp_files_set_contains(client->openedFiles, file)) {
             // Rimuove il file dalla lista dei file aperti del client
-            fsp_files_list_remove(&(client->openedFiles), req->arg);
+            fsp_files_set_remove(client->openedFiles, file);
+            cancelDeferredLocks(client, file);
             // Rimuove la lock se la detiene
             if(file->locked == client->sfd) {
                 file->locked = -1;
-                pthread_cond_broadcast(&lock_cmd_isNotLocked);
+                lockReleased(file);
             }
             // Rimuove il link dal file
             file->links--;
             // Rimuove il file se links == 0
             if(file->links == 0) {
-                if(file->data == NULL) {
-                    fsp_files_queue_remove(files_queue, req->arg);
+                if(file->data == NULL && !file->spilled && !file->remove) {
+                    // File creato senza contenuto (non si trova nella coda)
                     files_num--;
                 }
-                if(file->remove || file->data == NULL) {
-                    fsp_files_hash_table_delete(files, req->arg);
-                    fsp_file_free(file);
+                if(file->remove || (file->data == NULL && !file->spilled)) {
+                    deleteFile(file);
+                    fsp_file_free(files_pool, file);
                 }
             }
         } else {
@@ -1513,6 +4061,72 @@ static int close_cmd(CLIENT client, const struct fsp_request* req, struct fsp_re
     return 0;
 }
 
+static int list_cmd(CLIENT client, const struct fsp_request* req, struct fsp_response* resp, const size_t descr_max_len) {
+    if(client == NULL || req == NULL || resp == NULL) return -1;
+    
+    resp->data_len = 0;
+    resp->data = NULL;
+    
+    // Argomento: LIMIT PREFIX_LEN PREFIX[ CURSOR] (PREFIX e CURSOR possono contenere spazi)
+    char* limit_str = req->arg;
+    char* prefix_len_str = NULL;
+    char* prefix = NULL;
+    char* cursor = NULL;
+    long int limit = 0;
+    long int prefix_len = 0;
+    int valid = 0;
+    if((prefix_len_str = strchr(limit_str, ' ')) != NULL && (prefix = strchr(prefix_len_str + 1, ' ')) != NULL) {
+        *(prefix_len_str++) = '\0';
+        *(prefix++) = '\0';
+        if(isNumber(limit_str, &limit) && isNumber(prefix_len_str, &prefix_len) && prefix_len >= 0 && (size_t) prefix_len <= strlen(prefix)) {
+            // Il prefisso è seguito dalla fine dell'argomento o da uno spazio e dal cursore (non vuoto)
+            if(prefix[prefix_len] == '\0') {
+                valid = 1;
+            } else if(prefix[prefix_len] == ' ' && prefix[prefix_len + 1] != '\0') {
+                prefix[prefix_len] = '\0';
+                cursor = prefix + prefix_len + 1;
+                valid = 1;
+            }
+        }
+    }
+    if(!valid) {
+        resp->code = 501;
+        strncpy(resp->description, "Syntax error, message unrecognised.", descr_max_len);
+        resp->description[descr_max_len-1] = '\0';
+        return 0;
+    }
+    if(limit <= 0 || limit > FSP_PARSER_LIST_MAX_LIMIT) limit = FSP_PARSER_LIST_MAX_LIMIT;
+    // Sposta il prefisso all'inizio dell'argomento, stampato nel file di log (il cursore non viene sovrascritto)
+    memmove(req->arg, prefix, prefix_len + 1);
+    prefix = req->arg;
+    
+    struct list_arg list = {time(NULL), NULL, 0, 0, limit, 0, 0};
+    // Dimensione iniziale del buffer (raddoppiata da fsp_parser_makeListItem se necessario)
+    list.size = limit < 64 ? 4096 : 64*limit;
+    if((list.buf = malloc(list.size)) == NULL) return -1;
+    
+    // Visita i file in ordine lessicografico senza leggerne i contenuti
+    pthread_mutex_lock(&files_mutex);
+    int err = fsp_files_index_scan(files_index, prefix, cursor, listFile, &list);
+    pthread_mutex_unlock(&files_mutex);
+    if(err != 0 || list.err) {
+        free(list.buf);
+        return -1;
+    }
+    
+    if(list.len > 0) {
+        resp->data = list.buf;
+        resp->data_len = list.len;
+    } else {
+        free(list.buf);
+    }
+    
+    resp->code = 200;
+    strncpy(resp->description, "The requested action has been successfully completed.", descr_max_len);
+    resp->description[descr_max_len-1] = '\0';
+    return 0;
+}
+
 static int lock_cmd(CLIENT client, const struct fsp_request* req, struct fsp_response* resp, const size_t descr_max_len) {
     if(client == NULL || req == NULL || resp == NULL) return -1;
     
@@ -1522,20 +4136,46 @@ static int lock_cmd(CLIENT client, const struct fsp_request* req, struct fsp_res
     FSP_FILE file;
     int notOpened = 0;
     int cannotLock = 0;
+    int deferred = 0;
     
     pthread_mutex_lock(&files_mutex);
     // Cerca il file
-    file = fsp_files_hash_table_search(files, req->arg);
+    file = searchFile(client, req->arg);
     // Se il file esiste ma deve essere rimosso, allora non esegue il comando
     if(file != NULL && file->remove) file = NULL;
     if(file != NULL) {
         // File trovato
-        if(!fsp_files_list_contains(client->openedFiles, req->arg)) {
+        if(!fsp_files_set_contains(client->openedFiles, file)) {
             // Il client non ha aperto il file
             notOpened = 1;
         } else if(file->locked < 0 || file->locked == client->sfd) {
             // Setta la lock
             file->locked = client->sfd;
+        } else if(req->version == FSP_PARSER_V2) {
+            // Differisce la richiesta: il thread worker non attende la lock e può eseguire le richieste successive del client
+            // Il nome del file viene stampato nel file di log al completamento della richiesta
+            size_t arg_len = strlen(file->pathname);
+            struct fsp_client_deferred* waiter;
+            if((waiter = malloc(sizeof(struct fsp_client_deferred) + arg_len + 1)) == NULL) {
+                pthread_mutex_unlock(&files_mutex);
+                return -1;
+            }
+            waiter->client = client;
+            waiter->file = file;
+            waiter->id = req->id;
+            waiter->code = 0;
+            waiter->start = time(NULL);
+            waiter->next = NULL;
+            memcpy(waiter->arg, file->pathname, arg_len + 1);
+            if(lock_waiters_tail == NULL) {
+                lock_waiters = waiter;
+            } else {
+                lock_waiters_tail->next = waiter;
+            }
+            lock_waiters_tail = waiter;
+            client->deferred_num++;
+            deferred_locks++;
+            deferred = 1;
         } else {
             struct timespec start, end;
             clock_gettime(CLOCK_REALTIME, &start);
@@ -1551,8 +4191,8 @@ static int lock_cmd(CLIENT client, const struct fsp_request* req, struct fsp_res
             }
             
             if(file->remove) {
+                lockReleased(file);
                 file = NULL;
-                pthread_cond_broadcast(&lock_cmd_isNotLocked);
             } else if(!quit && !cannotLock){
                 file->locked = client->sfd;
             }
@@ -1560,6 +4200,10 @@ static int lock_cmd(CLIENT client, const struct fsp_request* req, struct fsp_res
     }
     pthread_mutex_unlock(&files_mutex);
     
+    if(deferred) {
+        // La risposta verrà inviata da sendDeferredResps
+        return 1;
+    }
     if(file == NULL) {
         // File non trovato
         resp->code = 550;
@@ -1589,22 +4233,39 @@ static int open_cmd(CLIENT client, const struct fsp_request* req, struct fsp_res
     resp->data = NULL;
     
     FSP_FILE file;
+    long int handle = -1;
     
     pthread_mutex_lock(&files_mutex);
-    // Cerca il file
-    file = fsp_files_hash_table_search(files, req->arg);
+    // Cerca il file (un file scaduto viene rimosso)
+    file = checkExpiry(fsp_files_hash_table_search(files, req->arg));
     // Se il file esiste ma deve essere rimosso, allora non esegue il comando
     if(file != NULL && file->remove) file = NULL;
+    if(file == NULL) countMiss(req->arg);
     if(file != NULL) {
-        if(!fsp_files_list_contains(client->openedFiles, req->arg)) {
+        if(!fsp_files_set_contains(client->openedFiles, file)) {
             // File non ancora aperto dal client
             // Aggiunge un nuovo collegamento al file
             file->links++;
             // Aggiunge il file nella lista dei file aperti dal client
-            fsp_files_list_add(&(client->openedFiles), file);
+            fsp_files_set_add(client->openedFiles, file);
         }
         // Se il file era già aperto dal client, allora non fa niente
+        
+        // Riporta in memoria il contenuto del file se necessario
+        int err;
+        if((err = promoteFile(client, file)) == -3) {
+            // File rimosso durante la lettura dal tier: viene chiuso
+            fsp_files_set_remove(client->openedFiles, file);
+            cancelDeferredLocks(client, file);
+            closeFile(file, client);
+            file = NULL;
+        } else if(err != 0) {
+            pthread_mutex_unlock(&files_mutex);
+            return err;
+        }
     }
+    // Descrittore del file (se aperto dal client)
+    handle = fsp_files_set_getHandle(client->openedFiles, file);
     pthread_mutex_unlock(&files_mutex);
     
     if(file == NULL) {
@@ -1615,9 +4276,7 @@ static int open_cmd(CLIENT client, const struct fsp_request* req, struct fsp_res
         return 0;
     }
     
-    resp->code = 200;
-    strncpy(resp->description, "The requested action has been successfully completed.", descr_max_len);
-    resp->description[descr_max_len-1] = '\0';
+    openSucceeded(resp, handle, descr_max_len);
     return 0;
 }
 
@@ -1627,39 +4286,68 @@ static int openc_cmd(CLIENT client, const struct fsp_request* req, struct fsp_re
     resp->data_len = 0;
     resp->data = NULL;
     
+    // Scadenza del file (TTL alla fine dell'argomento)
+    unsigned int expires = 0;
+    if(req->arg == NULL || *(req->arg) == FSP_PARSER_HANDLE_PREFIX || parseTTL(req->arg, &expires) < 0) {
+        // Il nome del file non può iniziare con il prefisso dei descrittori
+        resp->code = 501;
+        strncpy(resp->description, "Syntax error, message unrecognised.", descr_max_len);
+        resp->description[descr_max_len-1] = '\0';
+        return 0;
+    }
     if(config_file.files_max_num == 0) {
         resp->code = 552;
         strncpy(resp->description, "Requested file action aborted. Exceeded storage allocation.", descr_max_len);
         resp->description[descr_max_len-1] = '\0';
         return 0;
     }
+    if(strlen(req->arg) > FSP_FILE_PATHNAME_MAX_LEN) {
+        // Nome del file troppo lungo (fsp_file_new)
+        resp->code = 501;
+        strncpy(resp->description, "Syntax error, message unrecognised.", descr_max_len);
+        resp->description[descr_max_len-1] = '\0';
+        return 0;
+    }
     
     int alreadyExists = 0;
     int notRemoved = 0;
     
     FSP_FILE file;
+    long int handle = -1;
     
     pthread_mutex_lock(&files_mutex);
-    // Controlla se il file esiste
-    file = fsp_files_hash_table_search(files, req->arg);
+    // Controlla se il file esiste (un file scaduto viene rimosso)
+    file = checkExpiry(fsp_files_hash_table_search(files, req->arg));
     if(file == NULL) {
         // Il file non esiste
         // Crea il file
-        if((file = fsp_file_new(req->arg, NULL, 0, 1, 0, 0)) == NULL) {
+        if((file = fsp_file_new(files_pool, req->arg, NULL, 0, 1, 0, 0)) == NULL) {
             pthread_mutex_unlock(&files_mutex);
             return -1;
         }
         
-        // Aggiunge il file alla tabella hash, alla coda e alla lista dei file aperti dal client
-        fsp_files_hash_table_insert(files, file);
-        fsp_files_queue_enqueue(files_queue, file);
-        fsp_files_list_add(&(client->openedFiles), file);
+        // Aggiunge il file alla tabella hash (e all'indice dei nomi) e alla lista dei file aperti dal client
+        // Il file viene aggiunto alla coda quando riceve il contenuto (write_cmd)
+        if(insertFile(file) != 0) {
+            fsp_file_free(files_pool, file);
+            pthread_mutex_unlock(&files_mutex);
+            return -1;
+        }
+        if(expires != 0 && setFileExpiry(file, expires) != 0) {
+            deleteFile(file);
+            fsp_file_free(files_pool, file);
+            pthread_mutex_unlock(&files_mutex);
+            return -1;
+        }
+        fsp_files_set_add(client->openedFiles, file);
         
         files_num++;
+        logFileChange(FSP_WAL_CREATE, file, NULL, 0);
+        if(expires != 0) logFileChange(FSP_WAL_EXPIRE, file, NULL, 0);
         
         // Espelle un file dalla memoria se necessario
         if(files_num > config_file.files_max_num) {
-            if(capacityMiss(&(resp->data), &(resp->data_len)) != 0) {
+            if(capacityMiss(client) != 0) {
                 pthread_mutex_unlock(&files_mutex);
                 return -2;
             }
@@ -1674,6 +4362,8 @@ static int openc_cmd(CLIENT client, const struct fsp_request* req, struct fsp_re
             alreadyExists = 1;
         }
     }
+    // Descrittore del file (se aperto dal client)
+    handle = fsp_files_set_getHandle(client->openedFiles, file);
     pthread_mutex_unlock(&files_mutex);
     
     if(alreadyExists) {
@@ -1691,9 +4381,7 @@ static int openc_cmd(CLIENT client, const struct fsp_request* req, struct fsp_re
         return 0;
     }
     
-    resp->code = 200;
-    strncpy(resp->description, "The requested action has been successfully completed.", descr_max_len);
-    resp->description[descr_max_len-1] = '\0';
+    openSucceeded(resp, handle, descr_max_len);
     return 0;
 }
 
@@ -1703,39 +4391,68 @@ static int opencl_cmd(CLIENT client, const struct fsp_request* req, struct fsp_r
     resp->data_len = 0;
     resp->data = NULL;
     
+    // Scadenza del file (TTL alla fine dell'argomento)
+    unsigned int expires = 0;
+    if(req->arg == NULL || *(req->arg) == FSP_PARSER_HANDLE_PREFIX || parseTTL(req->arg, &expires) < 0) {
+        // Il nome del file non può iniziare con il prefisso dei descrittori
+        resp->code = 501;
+        strncpy(resp->description, "Syntax error, message unrecognised.", descr_max_len);
+        resp->description[descr_max_len-1] = '\0';
+        return 0;
+    }
     if(config_file.files_max_num == 0) {
         resp->code = 552;
         strncpy(resp->description, "Requested file action aborted. Exceeded storage allocation.", descr_max_len);
         resp->description[descr_max_len-1] = '\0';
         return 0;
     }
+    if(strlen(req->arg) > FSP_FILE_PATHNAME_MAX_LEN) {
+        // Nome del file troppo lungo (fsp_file_new)
+        resp->code = 501;
+        strncpy(resp->description, "Syntax error, message unrecognised.", descr_max_len);
+        resp->description[descr_max_len-1] = '\0';
+        return 0;
+    }
     
     int alreadyExists = 0;
     int notRemoved = 0;
     
     FSP_FILE file;
+    long int handle = -1;
     
     pthread_mutex_lock(&files_mutex);
-    // Controlla se il file esiste
-    file = fsp_files_hash_table_search(files, req->arg);
+    // Controlla se il file esiste (un file scaduto viene rimosso)
+    file = checkExpiry(fsp_files_hash_table_search(files, req->arg));
     if(file == NULL) {
         // Il file non esiste
         // Crea il file
-        if((file = fsp_file_new(req->arg, NULL, 0, 1, client->sfd, 0)) == NULL) {
+        if((file = fsp_file_new(files_pool, req->arg, NULL, 0, 1, client->sfd, 0)) == NULL) {
             pthread_mutex_unlock(&files_mutex);
             return -1;
         }
         
-        // Aggiunge il file alla tabella hash, alla coda e alla lista dei file aperti dal client
-        fsp_files_hash_table_insert(files, file);
-        fsp_files_queue_enqueue(files_queue, file);
-        fsp_files_list_add(&(client->openedFiles), file);
+        // Aggiunge il file alla tabella hash (e all'indice dei nomi) e alla lista dei file aperti dal client
+        // Il file viene aggiunto alla coda quando riceve il contenuto (write_cmd)
+        if(insertFile(file) != 0) {
+            fsp_file_free(files_pool, file);
+            pthread_mutex_unlock(&files_mutex);
+            return -1;
+        }
+        if(expires != 0 && setFileExpiry(file, expires) != 0) {
+            deleteFile(file);
+            fsp_file_free(files_pool, file);
+            pthread_mutex_unlock(&files_mutex);
+            return -1;
+        }
+        fsp_files_set_add(client->openedFiles, file);
         
         files_num++;
+        logFileChange(FSP_WAL_CREATE, file, NULL, 0);
+        if(expires != 0) logFileChange(FSP_WAL_EXPIRE, file, NULL, 0);
         
         // Espelle un file dalla memoria se necessario
         if(files_num > config_file.files_max_num) {
-            if(capacityMiss(&(resp->data), &(resp->data_len)) != 0) {
+            if(capacityMiss(client) != 0) {
                 pthread_mutex_unlock(&files_mutex);
                 return -2;
             }
@@ -1750,6 +4467,8 @@ static int opencl_cmd(CLIENT client, const struct fsp_request* req, struct fsp_r
             alreadyExists = 1;
         }
     }
+    // Descrittore del file (se aperto dal client)
+    handle = fsp_files_set_getHandle(client->openedFiles, file);
     pthread_mutex_unlock(&files_mutex);
     
     if(alreadyExists) {
@@ -1767,9 +4486,7 @@ static int opencl_cmd(CLIENT client, const struct fsp_request* req, struct fsp_r
         return 0;
     }
     
-    resp->code = 200;
-    strncpy(resp->description, "The requested action has been successfully completed.", descr_max_len);
-    resp->description[descr_max_len-1] = '\0';
+    openSucceeded(resp, handle, descr_max_len);
     return 0;
 }
 
@@ -1782,20 +4499,22 @@ static int openl_cmd(CLIENT client, const struct fsp_request* req, struct fsp_re
     int cannotLock = 0;
     
     FSP_FILE file;
+    long int handle = -1;
     
     pthread_mutex_lock(&files_mutex);
-    // Cerca il file
-    file = fsp_files_hash_table_search(files, req->arg);
+    // Cerca il file (un file scaduto viene rimosso)
+    file = checkExpiry(fsp_files_hash_table_search(files, req->arg));
     // Se il file esiste ma deve essere rimosso, allora non esegue il comando
     if(file != NULL && file->remove) file = NULL;
+    if(file == NULL) countMiss(req->arg);
     if(file != NULL) {
         // Apre il file se necessario
-        if(!fsp_files_list_contains(client->openedFiles, req->arg)) {
+        if(!fsp_files_set_contains(client->openedFiles, file)) {
             // File non ancora aperto dal client
             // Aggiunge un nuovo collegamento al file
             file->links++;
             // Aggiunge il file nella lista dei file aperti dal client
-            fsp_files_list_add(&(client->openedFiles), file);
+            fsp_files_set_add(client->openedFiles, file);
         }
         
         if(file->locked < 0) {
@@ -1819,23 +4538,41 @@ static int openl_cmd(CLIENT client, const struct fsp_request* req, struct fsp_re
             }
             
             if(file->remove) {
+                lockReleased(file);
+                cancelDeferredLocks(client, file);
                 file->links--;
-                fsp_files_list_remove(&(client->openedFiles), req->arg);
+                fsp_files_set_remove(client->openedFiles, file);
                 // Rimuove il file se links == 0
                 if(file->links == 0) {
-                    fsp_files_hash_table_delete(files, req->arg);
-                    fsp_file_free(file);
+                    deleteFile(file);
+                    fsp_file_free(files_pool, file);
                 }
                 file = NULL;
-                pthread_cond_broadcast(&lock_cmd_isNotLocked);
             } else if(quit || cannotLock){
+                cancelDeferredLocks(client, file);
                 file->links--;
-                fsp_files_list_remove(&(client->openedFiles), req->arg);
+                fsp_files_set_remove(client->openedFiles, file);
             } else {
                 file->locked = client->sfd;
             }
         }
+        
+        // Riporta in memoria il contenuto del file se necessario
+        int err;
+        if(file != NULL && !quit && !cannotLock && (err = promoteFile(client, file)) != 0) {
+            if(err != -3) {
+                pthread_mutex_unlock(&files_mutex);
+                return err;
+            }
+            // File rimosso durante la lettura dal tier: viene chiuso (rilasciando la lock)
+            fsp_files_set_remove(client->openedFiles, file);
+            cancelDeferredLocks(client, file);
+            closeFile(file, client);
+            file = NULL;
+        }
     }
+    // Descrittore del file (se aperto dal client)
+    handle = fsp_files_set_getHandle(client->openedFiles, file);
     pthread_mutex_unlock(&files_mutex);
     
     if(file == NULL) {
@@ -1853,9 +4590,7 @@ static int openl_cmd(CLIENT client, const struct fsp_request* req, struct fsp_re
         return 0;
     }
     
-    resp->code = 200;
-    strncpy(resp->description, "The requested action has been successfully completed.", descr_max_len);
-    resp->description[descr_max_len-1] = '\0';
+    openSucceeded(resp, handle, descr_max_len);
     return 0;
 }
 
@@ -1872,28 +4607,60 @@ static unsigned long int read_cmd(CLIENT client, const struct fsp_request* req,
     
     pthread_mutex_lock(&files_mutex);
     // Cerca il file
-    file = fsp_files_hash_table_search(files, req->arg);
+    file = searchFile(client, req->arg);
+    if(file == NULL || file->remove) countMiss(file != NULL ? file->pathname : req->arg);
     // Se il file esiste ma deve essere rimosso, allora non esegue il comando
     if(file != NULL && file->remove) file = NULL;
     if(file != NULL) {
-        if(fsp_files_list_contains(client->openedFiles, req->arg)) {
+        if(fsp_files_set_contains(client->openedFiles, file)) {
             // Il file è stato aperto dal client
             if(file->locked < 0 || (file->locked >= 0 && file->locked == client->sfd)) {
                 // Il file si può leggere
-                size_t buf_size = file->size + strlen(file->pathname) + 32;
-                if((resp->data = malloc(buf_size)) == NULL) {
-                    pthread_mutex_unlock(&files_mutex);
-                    return -1;
+                // Il contenuto di un file espulso nel tier su disco viene letto dal tier senza riportarlo in memoria
+                // (la risposta non può contenere i file espulsi da una promozione)
+                if(file->spilled) {
+                    tier_hits++;
+                    tier_hit_bytes += file->size;
+                } else {
+                    memory_hits++;
+                    memory_hit_bytes += file->size;
+                    fsp_eviction_access(eviction, file);
                 }
-                long int wrote_bytes = 0;
-                wrote_bytes = fsp_parser_makeData(&(resp->data), &buf_size, 0, file->pathname, file->size, file->data);
-                if(wrote_bytes < 0) {
-                    free(resp->data);
+                struct spilled_read read;
+                do {
+                    size_t buf_size = file->size + strlen(file->pathname) + 32;
+                    if((resp->data = malloc(buf_size)) == NULL) {
+                        pthread_mutex_unlock(&files_mutex);
+                        return -1;
+                    }
+                    long int wrote_bytes = 0;
+                    wrote_bytes = makeFileData(&(resp->data), &buf_size, 0, file);
+                    if(wrote_bytes < 0) {
+                        free(resp->data);
+                        pthread_mutex_unlock(&files_mutex);
+                        return -1;
+                    }
+                    resp->data_len = wrote_bytes;
+                    bytes = file->size;
+                    
+                    // Il contenuto di un file espulso viene letto senza mutua esclusione (file è aperto dal client
+                    // e non viene liberato)
+                    read = (struct spilled_read) {file, 0, wrote_bytes, file->size, 0};
+                    if(file->spilled) resp->data_len = readSpilled(resp->data, wrote_bytes, &read, 1);
+                    if(read.err) {
+                        free(resp->data);
+                        resp->data = NULL;
+                        resp->data_len = 0;
+                        bytes = 0;
+                    }
+                    // Se il contenuto è stato riportato in memoria (e modificato) durante la lettura, allora lo legge dalla memoria
+                } while(read.err == 1 && !file->remove && !file->spilled);
+                if(read.err == 1) {
                     pthread_mutex_unlock(&files_mutex);
                     return -1;
                 }
-                resp->data_len = wrote_bytes;
-                bytes = file->size;
+                // File rimosso durante la lettura
+                if(read.err == 2) file = NULL;
             } else {
                 locked = 1;
             }
@@ -1947,7 +4714,9 @@ static unsigned long int readn_cmd(CLIENT client, const struct fsp_request* req,
     }
     
     pthread_mutex_lock(&files_mutex);
-    if(files_num == 0) {
+    // I file espulsi nel tier su disco vengono letti dal tier senza essere riportati in memoria
+    unsigned int tot_files_num = files_num + spilled_files_num;
+    if(tot_files_num == 0) {
         resp->code = 200;
         strncpy(resp->description, "The requested action has been successfully completed.", descr_max_len);
         resp->description[descr_max_len-1] = '\0';
@@ -1955,16 +4724,25 @@ static unsigned long int readn_cmd(CLIENT client, const struct fsp_request* req,
         return bytes;
     }
     
-    if(n <= 0) n = files_num;
+    if(n <= 0) n = tot_files_num;
     
     // Stima la dimensione del buffer
-    size_t buf_size = (storage_size*n)/(files_num) + n*256;
+    size_t buf_size = (storage_size*n)/(tot_files_num) + n*256;
     
     // Alloca la memoria
     if((resp->data = malloc(buf_size)) == NULL) {
         pthread_mutex_unlock(&files_mutex);
         return -1;
     }
+    // Letture dal tier su disco (eseguite dopo la scansione senza mutua esclusione)
+    struct spilled_read* reads = NULL;
+    size_t reads_num = 0;
+    if(spilled_files_num > 0 && (reads = malloc((n < spilled_files_num ? n : spilled_files_num) * sizeof(struct spilled_read))) == NULL) {
+        free(resp->data);
+        resp->data = NULL;
+        pthread_mutex_unlock(&files_mutex);
+        return -1;
+    }
     
     // Prepara l'iteratore
     struct fsp_files_hash_table_iterator* iterator = fsp_files_hash_table_getIterator(files);
@@ -1973,11 +4751,12 @@ static unsigned long int readn_cmd(CLIENT client, const struct fsp_request* req,
     // Legge i file
     long int wrote_bytes = 0;
     long int wrote_bytes_tot = 0;
+    time_t now = time(NULL);
     while(n > 0) {
         
-        // Non legge un file da rimuovere o un file in stato locked di cui il client non detiene la lock
+        // Non legge un file da rimuovere, un file scaduto o un file in stato locked di cui il client non detiene la lock
         while((file = fsp_files_hash_table_getNext(iterator)) != NULL) {
-            if(file->remove || (file->locked >=0 && file->locked != client->sfd)) {
+            if(file->remove || isExpired(file, now) || (file->locked >=0 && file->locked != client->sfd)) {
                 continue;
             }
             break;
@@ -1985,20 +4764,25 @@ static unsigned long int readn_cmd(CLIENT client, const struct fsp_request* req,
         if(file == NULL) break;
         
         // Legge il file
-        wrote_bytes = fsp_parser_makeData(&(resp->data), &buf_size, wrote_bytes_tot, file->pathname, file->size, file->data);
+        wrote_bytes = makeFileData(&(resp->data), &buf_size, wrote_bytes_tot, file);
         if(wrote_bytes < 0) {
             free(resp->data);
             resp->data = NULL;
+            free(reads);
             free(iterator);
             pthread_mutex_unlock(&files_mutex);
             return -1;
         }
+        if(file->spilled) reads[reads_num++] = (struct spilled_read) {file, wrote_bytes_tot, wrote_bytes, file->size, 0};
         wrote_bytes_tot += wrote_bytes;
         n--;
     }
+    free(iterator);
+    // I file rimossi durante la lettura dal tier non vengono restituiti
+    wrote_bytes_tot = readSpilled(resp->data, wrote_bytes_tot, reads, reads_num);
+    free(reads);
     resp->data_len = wrote_bytes_tot;
     bytes = wrote_bytes_tot;
-    free(iterator);
     pthread_mutex_unlock(&files_mutex);
     
     resp->code = 200;
@@ -2020,18 +4804,28 @@ static unsigned long int remove_cmd(CLIENT client, const struct fsp_request* req
     
     pthread_mutex_lock(&files_mutex);
     // Cerca il file
-    file = fsp_files_hash_table_search(files, req->arg);
+    file = searchFile(client, req->arg);
     if(file != NULL && file->remove) file = NULL;
     if(file != NULL) {
-        if(fsp_files_list_contains(client->openedFiles, req->arg)) {
+        if(fsp_files_set_contains(client->openedFiles, file)) {
             if(file->locked == client->sfd) {
                 // Il file viene rimosso dal server solo quando file->links == 0
-                file->remove = 1;
-                fsp_files_queue_remove(files_queue, req->arg);
-                files_num--;
-                storage_size -= file->size;
+                fsp_expiry_remove(expiring, file);
+                logFileChange(FSP_WAL_REMOVE, file, NULL, 0);
+                if(file->spilled) {
+                    // Rimuove il contenuto dal tier su disco
+                    fsp_tier_remove(tier, file);
+                    file->spilled = 0;
+                    spilled_files_num--;
+                } else {
+                    // Un file creato senza contenuto non si trova nella politica di rimpiazzamento
+                    if(file->data != NULL) fsp_eviction_remove(eviction, file);
+                    files_num--;
+                }
                 bytes = file->size;
-                pthread_cond_broadcast(&lock_cmd_isNotLocked);
+                releaseFileData(file);
+                setRemovePending(file);
+                lockReleased(file);
             } else {
                 notLocked = 1;
             }
@@ -2069,6 +4863,76 @@ static unsigned long int remove_cmd(CLIENT client, const struct fsp_request* req
     return bytes;
 }
 
+static int touch_cmd(CLIENT client, const struct fsp_request* req, struct fsp_response* resp, const size_t descr_max_len) {
+    if(client == NULL || req == NULL || resp == NULL) return -1;
+    
+    resp->data_len = 0;
+    resp->data = NULL;
+    
+    // Argomento: PATHNAME TTL
+    unsigned int expires = 0;
+    if(parseTTL(req->arg, &expires) != 1) {
+        resp->code = 501;
+        strncpy(resp->description, "Syntax error, message unrecognised.", descr_max_len);
+        resp->description[descr_max_len-1] = '\0';
+        return 0;
+    }
+    
+    FSP_FILE file;
+    int notOpened = 0;
+    int locked = 0;
+    
+    pthread_mutex_lock(&files_mutex);
+    // Cerca il file (un file già scaduto viene rimosso e non può essere rinnovato)
+    file = searchFile(client, req->arg);
+    // Se il file esiste ma deve essere rimosso, allora non esegue il comando
+    if(file != NULL && file->remove) file = NULL;
+    if(file != NULL) {
+        if(!fsp_files_set_contains(client->openedFiles, file)) {
+            // Il file non è stato aperto dal client
+            notOpened = 1;
+        } else if(file->locked >= 0 && file->locked != client->sfd) {
+            // Un altro client detiene la lock sul file
+            locked = 1;
+        } else {
+            // Imposta la nuova scadenza
+            if(setFileExpiry(file, expires) != 0) {
+                pthread_mutex_unlock(&files_mutex);
+                return -1;
+            }
+            logFileChange(FSP_WAL_EXPIRE, file, NULL, 0);
+        }
+    }
+    pthread_mutex_unlock(&files_mutex);
+    
+    if(file == NULL) {
+        // File non trovato o file da rimuovere
+        resp->code = 550;
+        strncpy(resp->description, "Requested action not taken. File not found.", descr_max_len);
+        resp->description[descr_max_len-1] = '\0';
+        return 0;
+    }
+    if(notOpened) {
+        // Il client non ha aperto il file
+        resp->code = 556;
+        strncpy(resp->description, "Cannot perform the operation.", descr_max_len);
+        resp->description[descr_max_len-1] = '\0';
+        return 0;
+    }
+    if(locked) {
+        // Il client non detiene la lock sul file
+        resp->code = 554;
+        strncpy(resp->description, "Requested action not taken. No access.", descr_max_len);
+        resp->description[descr_max_len-1] = '\0';
+        return 0;
+    }
+    
+    resp->code = 200;
+    strncpy(resp->description, "The requested action has been successfully completed.", descr_max_len);
+    resp->description[descr_max_len-1] = '\0';
+    return 0;
+}
+
 static int unlock_cmd(CLIENT client, const struct fsp_request* req, struct fsp_response* resp, const size_t descr_max_len) {
     if(client == NULL || req == NULL || resp == NULL) return -1;
     
@@ -2081,11 +4945,11 @@ static int unlock_cmd(CLIENT client, const struct fsp_request* req, struct fsp_r
     
     pthread_mutex_lock(&files_mutex);
     // Cerca il file
-    file = fsp_files_hash_table_search(files, req->arg);
+    file = searchFile(client, req->arg);
     // Se il file esiste ma deve essere rimosso, allora non esegue il comando
     if(file != NULL && file->remove) file = NULL;
     if(file != NULL) {
-        if(!fsp_files_list_contains(client->openedFiles, req->arg)) {
+        if(!fsp_files_set_contains(client->openedFiles, file)) {
             // Il file non è stato aperto dal client
             notOpened = 1;
         } else if(file->locked != client->sfd) {
@@ -2094,7 +4958,7 @@ static int unlock_cmd(CLIENT client, const struct fsp_request* req, struct fsp_r
         } else {
             // Rilascia la lock
             file->locked = -1;
-            pthread_cond_broadcast(&lock_cmd_isNotLocked);
+            lockReleased(file);
         }
     }
     pthread_mutex_unlock(&files_mutex);
@@ -2134,6 +4998,16 @@ static unsigned long int write_cmd(CLIENT client, const struct fsp_request* req,
     resp->data_len = 0;
     resp->data = NULL;
     
+    // Scadenza del file (TTL alla fine dell'argomento, se presente)
+    unsigned int expires = 0;
+    int ttl;
+    if((ttl = parseTTL(req->arg, &expires)) < 0) {
+        resp->code = 501;
+        strncpy(resp->description, "Syntax error, message unrecognised.", descr_max_len);
+        resp->description[descr_max_len-1] = '\0';
+        return 0;
+    }
+    
     // Dati contenuti nel campo data
     struct fsp_data* parsed_data;
     
@@ -2172,36 +5046,59 @@ static unsigned long int write_cmd(CLIENT client, const struct fsp_request* req,
     }
     bytes = parsed_data->size;
     
+    // Prepara il contenuto del file (l'eventuale compressione e il calcolo del valore hash
+    // avvengono senza detenere la lock)
+    BLOB data = NULL;
+    if(parsed_data->size > 0 && (data = fsp_blob_new(blobArena(parsed_data->size), parsed_data->data, parsed_data->size, config_file.compression)) == NULL) {
+        fsp_parser_freeData(parsed_data);
+        return -1;
+    }
+    
     FSP_FILE file;
     int notOpened = 0;
     int notLocked = 0;
     
     pthread_mutex_lock(&files_mutex);
     // Cerca il file
-    file = fsp_files_hash_table_search(files, req->arg);
+    file = searchFile(client, req->arg);
     // Se il file esiste ma deve essere rimosso, allora non esegue il comando
     if(file != NULL && file->remove) file = NULL;
     if(file != NULL) {
-        if(fsp_files_list_contains(client->openedFiles, req->arg) && file->data == NULL) {
+        if(fsp_files_set_contains(client->openedFiles, file) && file->data == NULL && !file->spilled) {
             // Il file è stato aperto dal client con flag O_CREATE
             if(file->locked >= 0 && file->locked == client->sfd) {
                 // Il client detiene la lock sul file
-                if(parsed_data->size > 0) {
-                    if((file->data = malloc(parsed_data->size)) == NULL) {
+                if(ttl) {
+                    if(setFileExpiry(file, expires) != 0) {
                         fsp_parser_freeData(parsed_data);
                         pthread_mutex_unlock(&files_mutex);
+                        fsp_blob_free(data);
                         return -1;
                     }
-                    memcpy(file->data, parsed_data->data, parsed_data->size);
-                    file->size = parsed_data->size;
-                    storage_size += parsed_data->size;
+                    logFileChange(FSP_WAL_EXPIRE, file, NULL, 0);
+                }
+                if(data != NULL) {
+                    // Se il file è aperto solo dal client, allora un contenuto piccolo viene incorporato nel file:
+                    // il file viene sostituito da una sua copia (nessun altro riferimento al file oltre a quelli
+                    // delle strutture dati aggiornate da replaceFile)
+                    FSP_FILE embedded = NULL;
+                    if(file->links == 1 && (embedded = embedFileData(file, data)) != NULL) {
+                        replaceFile(client, file, embedded);
+                        fsp_file_free(files_pool, file);
+                        file = embedded;
+                    } else {
+                        setFileData(file, data, &data);
+                    }
+                    fsp_eviction_insert(eviction, file);
+                    logFileChange(FSP_WAL_WRITE, file, NULL, 0);
                 }
                 
                 // Espelle i file dalla memoria se necessario
-                if(storage_size > config_file.storage_max_size) {
-                    if(capacityMiss(&(resp->data), &(resp->data_len)) != 0) {
+                if(files_num > config_file.files_max_num || storage_size > config_file.storage_max_size) {
+                    if(capacityMiss(client) != 0) {
                         fsp_parser_freeData(parsed_data);
                         pthread_mutex_unlock(&files_mutex);
+                        fsp_blob_free(data);
                         return -2;
                     }
                 }
@@ -2218,6 +5115,7 @@ static unsigned long int write_cmd(CLIENT client, const struct fsp_request* req,
     pthread_mutex_unlock(&files_mutex);
     
     fsp_parser_freeData(parsed_data);
+    fsp_blob_free(data);
     
     if(file == NULL) {
         // File inesistente o file da rimuovere
@@ -0,0 +1,626 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <fsp_tier.h>
+
+// Estensione dei file del tier
+#define FSP_TIER_FILE_EXT ".tier"
+// Lunghezza massima del nome di un file del tier (escluso il nome della directory)
+#define FSP_TIER_FILE_NAME_LEN 32
+
+// Stati di un contenuto
+// Contenuto in attesa di essere scritto su disco
+#define FSP_TIER_PENDING 0
+// Contenuto in fase di scrittura
+#define FSP_TIER_WRITING 1
+// Contenuto scritto su disco (o mantenuto in memoria se la scrittura è fallita)
+#define FSP_TIER_STORED 2
+
+struct fsp_tier_entry {
+    // Nodo successivo (usato per la gestione della tabella hash)
+    struct fsp_tier_entry* hash_table_next;
+    // Nodo successivo (usato per la gestione della coda delle scritture)
+    struct fsp_tier_entry* queue_next;
+    // Chiave del contenuto
+    const void* key;
+    // Identificativo del contenuto (determina il nome del file su disco)
+    unsigned long int id;
+    // Contenuto (NULL se si trova solo su disco)
+    struct fsp_blob* blob;
+    // Campi del contenuto (necessari per ricostruirlo dopo la lettura da disco)
+    size_t size;
+    size_t stored_size;
+    unsigned int hash;
+    unsigned char compressed;
+    // Numero dei thread che stanno leggendo il contenuto da disco (senza il mutex del tier)
+    unsigned int readers;
+    // Stato del contenuto
+    unsigned char state;
+    // Indica se il contenuto è stato rimosso durante la scrittura o la lettura
+    // (verrà liberato dal thread di scrittura o dall'ultimo thread che lo legge)
+    unsigned char removed;
+};
+
+/**
+ * \brief Restituisce l'indice della tabella hash per la chiave key.
+ */
+static size_t hash_function(const void* key);
+
+/**
+ * \brief Restituisce il contenuto con chiave key (senza rimuoverlo dalla tabella hash).
+ *
+ * \return Il contenuto,
+ *         NULL se non è presente.
+ */
+static struct fsp_tier_entry* search(const struct fsp_tier* tier, const void* key);
+
+/**
+ * \brief Rimuove entry dalla tabella hash e aggiorna i contatori del tier.
+ */
+static void detach(struct fsp_tier* tier, struct fsp_tier_entry* entry);
+
+/**
+ * \brief Rimuove entry (in stato FSP_TIER_PENDING) dalla coda delle scritture.
+ */
+static void dequeue(struct fsp_tier* tier, struct fsp_tier_entry* entry);
+
+/**
+ * \brief Scrive in path (di almeno FSP_TIER_FILE_NAME_LEN byte oltre al nome della directory) il nome del file di entry.
+ *        Non usa stdio (viene chiamata anche dal processo figlio di una fork()).
+ */
+static void entryPath(const struct fsp_tier* tier, const struct fsp_tier_entry* entry, char* path);
+
+/**
+ * \brief Scrive su disco i dati del contenuto di entry.
+ *
+ * \return 0 in caso di successo,
+ *         -1 altrimenti (il file viene rimosso).
+ */
+static int writeEntry(const struct fsp_tier* tier, const struct fsp_tier_entry* entry);
+
+/**
+ * \brief Legge da disco il contenuto di entry e lo restituisce (allocato in arena se arena != NULL).
+ *
+ * \return Il contenuto,
+ *         NULL se non è stato possibile leggerlo.
+ */
+static struct fsp_blob* readEntry(const struct fsp_tier* tier, const struct fsp_tier_entry* entry, struct fsp_arena* arena);
+
+/**
+ * \brief Legge da disco il contenuto di entry (entry->blob == NULL) come readEntry, ma senza il mutex di tier
+ *        (acquisito dal chiamante e rilasciato durante la lettura): entry non viene liberato durante la lettura.
+ *        Se entry è stato rimosso durante la lettura ed è l'ultimo a leggerlo, allora lo libera e restituisce NULL.
+ *
+ * \return Il contenuto,
+ *         NULL se non è stato possibile leggerlo || entry è stato rimosso durante la lettura.
+ */
+static struct fsp_blob* loadEntry(struct fsp_tier* tier, struct fsp_tier_entry* entry, struct fsp_arena* arena);
+
+/**
+ * \brief Libera entry, rimosso dalla tabella hash, assieme al suo contenuto e al suo file su disco.
+ *        Se il tier è condiviso con un processo figlio (fsp_tier_forkPrepare), allora la rimozione
+ *        del file viene rimandata a fsp_tier_forkDone.
+ */
+static void freeEntry(struct fsp_tier* tier, struct fsp_tier_entry* entry);
+
+/**
+ * \brief Rimuove i file e libera i contenuti la cui rimozione è stata rimandata.
+ */
+static void freeDeferred(struct fsp_tier* tier);
+
+/**
+ * \brief Rimuove dalla directory di tier i file con estensione FSP_TIER_FILE_EXT.
+ */
+static void clearDir(const struct fsp_tier* tier);
+
+/**
+ * \brief Funzione eseguita dal thread di scrittura.
+ */
+static void* writer(void* arg);
+
+static size_t hash_function(const void* key) {
+    return (size_t) ((((uint64_t) (uintptr_t) key)*11400714819323198485ull) >> (64 - FSP_TIER_HASH_BITS));
+}
+
+static struct fsp_tier_entry* search(const struct fsp_tier* tier, const void* key) {
+    struct fsp_tier_entry* entry = (tier->table)[hash_function(key)];
+    while(entry != NULL && entry->key != key) entry = entry->hash_table_next;
+    return entry;
+}
+
+static void detach(struct fsp_tier* tier, struct fsp_tier_entry* entry) {
+    struct fsp_tier_entry** p = &((tier->table)[hash_function(entry->key)]);
+    while(*p != entry) p = &((*p)->hash_table_next);
+    *p = entry->hash_table_next;
+    entry->hash_table_next = NULL;
+
+    tier->size -= entry->stored_size;
+    tier->entries_num--;
+}
+
+static void dequeue(struct fsp_tier* tier, struct fsp_tier_entry* entry) {
+    struct fsp_tier_entry* prev = NULL;
+    struct fsp_tier_entry* curr = tier->queue_head;
+    while(curr != entry) {
+        prev = curr;
+        curr = curr->queue_next;
+    }
+    if(prev == NULL) {
+        tier->queue_head = entry->queue_next;
+    } else {
+        prev->queue_next = entry->queue_next;
+    }
+    if(tier->queue_tail == entry) tier->queue_tail = prev;
+    entry->queue_next = NULL;
+
+    tier->pending_size -= entry->stored_size;
+    pthread_cond_broadcast(&(tier->written));
+}
+
+static void entryPath(const struct fsp_tier* tier, const struct fsp_tier_entry* entry, char* path) {
+    // "<dir>/<id in 16 cifre esadecimali>.tier"
+    size_t dir_len = strlen(tier->dir);
+    memcpy(path, tier->dir, dir_len);
+    path[dir_len] = '/';
+    for(int i = 0; i < 16; i++) path[dir_len + 1 + i] = "0123456789abcdef"[(entry->id >> (4*(15 - i))) & 0xF];
+    memcpy(path + dir_len + 17, FSP_TIER_FILE_EXT, sizeof(FSP_TIER_FILE_EXT));
+}
+
+static int writeEntry(const struct fsp_tier* tier, const struct fsp_tier_entry* entry) {
+    char path[strlen(tier->dir) + FSP_TIER_FILE_NAME_LEN];
+    entryPath(tier, entry, path);
+
+    int fd;
+    if((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600)) == -1) return -1;
+
+    const unsigned char* buf = entry->blob->data;
+    size_t left = entry->stored_size;
+    while(left > 0) {
+        ssize_t w_bytes = write(fd, buf, left);
+        if(w_bytes == -1) {
+            if(errno == EINTR) continue;
+            close(fd);
+            unlink(path);
+            return -1;
+        }
+        buf += w_bytes;
+        left -= w_bytes;
+    }
+    if(close(fd) != 0) {
+        unlink(path);
+        return -1;
+    }
+
+    return 0;
+}
+
+static struct fsp_blob* readEntry(const struct fsp_tier* tier, const struct fsp_tier_entry* entry, struct fsp_arena* arena) {
+    char path[strlen(tier->dir) + FSP_TIER_FILE_NAME_LEN];
+    entryPath(tier, entry, path);
+
+    int fd;
+    if((fd = open(path, O_RDONLY)) == -1) return NULL;
+
+    struct fsp_blob* blob = NULL;
+    if((blob = fsp_blob_alloc(arena, entry->size, entry->stored_size, entry->compressed, entry->hash)) == NULL) {
+        close(fd);
+        return NULL;
+    }
+
+    unsigned char* buf = blob->data;
+    size_t left = entry->stored_size;
+    while(left > 0) {
+        ssize_t r_bytes = read(fd, buf, left);
+        if(r_bytes == -1 && errno == EINTR) continue;
+        if(r_bytes <= 0) {
+            // Errore o file troncato
+            close(fd);
+            fsp_blob_free(blob);
+            return NULL;
+        }
+        buf += r_bytes;
+        left -= r_bytes;
+    }
+    close(fd);
+
+    return blob;
+}
+
+static struct fsp_blob* loadEntry(struct fsp_tier* tier, struct fsp_tier_entry* entry, struct fsp_arena* arena) {
+    entry->readers++;
+    pthread_mutex_unlock(&(tier->mutex));
+    struct fsp_blob* blob = readEntry(tier, entry, arena);
+    pthread_mutex_lock(&(tier->mutex));
+    entry->readers--;
+
+    if(entry->removed) {
+        // Rimosso (o promosso da un altro thread) durante la lettura
+        if(blob != NULL) fsp_blob_free(blob);
+        if(entry->readers == 0) freeEntry(tier, entry);
+        return NULL;
+    }
+
+    return blob;
+}
+
+static void freeEntry(struct fsp_tier* tier, struct fsp_tier_entry* entry) {
+    if(entry->blob != NULL) {
+        fsp_blob_free(entry->blob);
+    } else if(tier->pins > 0) {
+        // Il file potrebbe essere letto da un processo figlio
+        entry->queue_next = tier->deferred;
+        tier->deferred = entry;
+        return;
+    } else {
+        char path[strlen(tier->dir) + FSP_TIER_FILE_NAME_LEN];
+        entryPath(tier, entry, path);
+        unlink(path);
+    }
+    free(entry);
+}
+
+static void freeDeferred(struct fsp_tier* tier) {
+    while(tier->deferred != NULL) {
+        struct fsp_tier_entry* entry = tier->deferred;
+        tier->deferred = entry->queue_next;
+        char path[strlen(tier->dir) + FSP_TIER_FILE_NAME_LEN];
+        entryPath(tier, entry, path);
+        unlink(path);
+        free(entry);
+    }
+}
+
+static void clearDir(const struct fsp_tier* tier) {
+    DIR* dir = NULL;
+    if((dir = opendir(tier->dir)) == NULL) return;
+
+    size_t ext_len = strlen(FSP_TIER_FILE_EXT);
+    struct dirent* dirent;
+    while((dirent = readdir(dir)) != NULL) {
+        size_t len = strlen(dirent->d_name);
+        if(len <= ext_len || len >= FSP_TIER_FILE_NAME_LEN || strcmp(dirent->d_name + len - ext_len, FSP_TIER_FILE_EXT) != 0) continue;
+
+        char path[strlen(tier->dir) + FSP_TIER_FILE_NAME_LEN + 1];
+        sprintf(path, "%s/%s", tier->dir, dirent->d_name);
+        unlink(path);
+    }
+    closedir(dir);
+}
+
+static void* writer(void* arg) {
+    struct fsp_tier* tier = arg;
+
+    pthread_mutex_lock(&(tier->mutex));
+    while(1) {
+        while(tier->queue_head == NULL && !tier->quit) {
+            pthread_cond_wait(&(tier->queue_isNotEmpty), &(tier->mutex));
+        }
+        if(tier->quit) break;
+
+        struct fsp_tier_entry* entry = tier->queue_head;
+        tier->queue_head = entry->queue_next;
+        if(tier->queue_head == NULL) tier->queue_tail = NULL;
+        entry->queue_next = NULL;
+        entry->state = FSP_TIER_WRITING;
+
+        // Il contenuto non viene modificato durante la scrittura (il tier ne è l'unico proprietario)
+        pthread_mutex_unlock(&(tier->mutex));
+        int err = writeEntry(tier, entry);
+        pthread_mutex_lock(&(tier->mutex));
+
+        tier->pending_size -= entry->stored_size;
+        entry->state = FSP_TIER_STORED;
+        if(!err) {
+            // Il contenuto si trova solo su disco
+            fsp_blob_free(entry->blob);
+            entry->blob = NULL;
+        }
+        if(entry->removed) freeEntry(tier, entry);
+        pthread_cond_broadcast(&(tier->written));
+    }
+    pthread_mutex_unlock(&(tier->mutex));
+
+    return 0;
+}
+
+struct fsp_tier* fsp_tier_new(const char* dir, size_t max_size) {
+    if(dir == NULL) return NULL;
+
+    if(mkdir(dir, 0700) != 0 && errno != EEXIST) return NULL;
+
+    struct fsp_tier* tier = NULL;
+    if((tier = malloc(sizeof(struct fsp_tier))) == NULL) return NULL;
+    if((tier->dir = malloc(strlen(dir) + 1)) == NULL) {
+        free(tier);
+        return NULL;
+    }
+    strcpy(tier->dir, dir);
+    if((tier->table = calloc(((size_t) 1) << FSP_TIER_HASH_BITS, sizeof(struct fsp_tier_entry*))) == NULL) {
+        free(tier->dir);
+        free(tier);
+        return NULL;
+    }
+    tier->max_size = max_size;
+    tier->size = 0;
+    tier->pending_size = 0;
+    tier->entries_num = 0;
+    tier->next_id = 0;
+    tier->queue_head = NULL;
+    tier->queue_tail = NULL;
+    tier->pins = 0;
+    tier->deferred = NULL;
+    tier->quit = 0;
+    pthread_mutex_init(&(tier->mutex), NULL);
+    pthread_cond_init(&(tier->queue_isNotEmpty), NULL);
+    pthread_cond_init(&(tier->written), NULL);
+
+    clearDir(tier);
+
+    // Il thread di scrittura non riceve i segnali (gestiti dagli altri thread)
+    sigset_t mask, old_mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_SETMASK, &mask, &old_mask);
+    int err = pthread_create(&(tier->writer), NULL, writer, tier);
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+    if(err != 0) {
+        pthread_mutex_destroy(&(tier->mutex));
+        pthread_cond_destroy(&(tier->queue_isNotEmpty));
+        pthread_cond_destroy(&(tier->written));
+        free(tier->table);
+        free(tier->dir);
+        free(tier);
+        return NULL;
+    }
+
+    return tier;
+}
+
+void fsp_tier_free(struct fsp_tier* tier) {
+    if(tier == NULL) return;
+
+    pthread_mutex_lock(&(tier->mutex));
+    tier->quit = 1;
+    pthread_cond_signal(&(tier->queue_isNotEmpty));
+    pthread_mutex_unlock(&(tier->mutex));
+    pthread_join(tier->writer, NULL);
+
+    // Dopo la terminazione del thread di scrittura nessun contenuto è in fase di scrittura
+    tier->pins = 0;
+    freeDeferred(tier);
+    for(size_t i = 0; i < (((size_t) 1) << FSP_TIER_HASH_BITS); i++) {
+        struct fsp_tier_entry* entry = (tier->table)[i];
+        while(entry != NULL) {
+            struct fsp_tier_entry* next = entry->hash_table_next;
+            freeEntry(tier, entry);
+            entry = next;
+        }
+    }
+    clearDir(tier);
+
+    pthread_mutex_destroy(&(tier->mutex));
+    pthread_cond_destroy(&(tier->queue_isNotEmpty));
+    pthread_cond_destroy(&(tier->written));
+    free(tier->table);
+    free(tier->dir);
+    free(tier);
+}
+
+int fsp_tier_spill(struct fsp_tier* tier, const void* key, struct fsp_blob* blob) {
+    if(tier == NULL || key == NULL || blob == NULL) return -1;
+
+    pthread_mutex_lock(&(tier->mutex));
+    // Limita la memoria occupata dai contenuti in attesa di essere scritti (senza attendere il thread di scrittura)
+    if(tier->pending_size > 0 && tier->pending_size + blob->stored_size > FSP_TIER_MAX_PENDING_SIZE) {
+        pthread_mutex_unlock(&(tier->mutex));
+        return -2;
+    }
+    if(blob->stored_size > tier->max_size - tier->size) {
+        pthread_mutex_unlock(&(tier->mutex));
+        return -1;
+    }
+
+    struct fsp_tier_entry* entry = NULL;
+    if((entry = malloc(sizeof(struct fsp_tier_entry))) == NULL) {
+        pthread_mutex_unlock(&(tier->mutex));
+        return -1;
+    }
+
+    entry->key = key;
+    entry->id = (tier->next_id)++;
+    entry->blob = blob;
+    entry->size = blob->size;
+    entry->stored_size = blob->stored_size;
+    entry->hash = blob->hash;
+    entry->compressed = blob->compressed;
+    entry->readers = 0;
+    entry->state = FSP_TIER_PENDING;
+    entry->removed = 0;
+
+    // Inserisce il contenuto nella tabella hash
+    size_t index = hash_function(key);
+    entry->hash_table_next = (tier->table)[index];
+    (tier->table)[index] = entry;
+
+    // Inserisce il contenuto nella coda delle scritture
+    entry->queue_next = NULL;
+    if(tier->queue_tail == NULL) {
+        tier->queue_head = entry;
+    } else {
+        tier->queue_tail->queue_next = entry;
+    }
+    tier->queue_tail = entry;
+
+    tier->size += entry->stored_size;
+    tier->pending_size += entry->stored_size;
+    tier->entries_num++;
+    pthread_cond_signal(&(tier->queue_isNotEmpty));
+    pthread_mutex_unlock(&(tier->mutex));
+
+    return 0;
+}
+
+void fsp_tier_wait(struct fsp_tier* tier) {
+    if(tier == NULL) return;
+
+    pthread_mutex_lock(&(tier->mutex));
+    while(tier->pending_size > FSP_TIER_MAX_PENDING_SIZE/2 && !tier->quit) {
+        pthread_cond_wait(&(tier->written), &(tier->mutex));
+    }
+    pthread_mutex_unlock(&(tier->mutex));
+}
+
+struct fsp_blob* fsp_tier_promote(struct fsp_tier* tier, const void* key, struct fsp_arena* arena) {
+    if(tier == NULL) return NULL;
+
+    pthread_mutex_lock(&(tier->mutex));
+    struct fsp_tier_entry* entry = NULL;
+    // Attende il termine della scrittura (il contenuto potrebbe essere rimosso durante l'attesa)
+    while((entry = search(tier, key)) != NULL && entry->state == FSP_TIER_WRITING) {
+        pthread_cond_wait(&(tier->written), &(tier->mutex));
+    }
+    if(entry == NULL) {
+        pthread_mutex_unlock(&(tier->mutex));
+        return NULL;
+    }
+
+    struct fsp_blob* blob = entry->blob;
+    if(blob == NULL) {
+        if((blob = loadEntry(tier, entry, arena)) == NULL) {
+            pthread_mutex_unlock(&(tier->mutex));
+            return NULL;
+        }
+    } else if(entry->state == FSP_TIER_PENDING) {
+        // Il contenuto non è ancora stato scritto: nessuna lettura necessaria
+        dequeue(tier, entry);
+    }
+    detach(tier, entry);
+    // Il contenuto passa al chiamante (rimuove il file su disco se presente)
+    if(entry->blob != NULL) {
+        free(entry);
+    } else if(entry->readers > 0) {
+        // Verrà liberato dall'ultimo thread che lo legge
+        entry->removed = 1;
+    } else {
+        freeEntry(tier, entry);
+    }
+    pthread_mutex_unlock(&(tier->mutex));
+
+    return blob;
+}
+
+int fsp_tier_read(struct fsp_tier* tier, const void* key, void* buf, size_t size) {
+    if(tier == NULL || buf == NULL) return -1;
+
+    pthread_mutex_lock(&(tier->mutex));
+    struct fsp_tier_entry* entry = search(tier, key);
+    if(entry == NULL || entry->size != size) {
+        pthread_mutex_unlock(&(tier->mutex));
+        return -1;
+    }
+
+    int ret_val = 0;
+    if(entry->blob != NULL) {
+        // Il contenuto si trova ancora in memoria (la scrittura in corso lo legge soltanto)
+        ret_val = fsp_blob_read(entry->blob, buf);
+    } else {
+        // Il contenuto letto è valido anche se viene rimosso durante la lettura
+        entry->readers++;
+        pthread_mutex_unlock(&(tier->mutex));
+        struct fsp_blob* blob = NULL;
+        if((blob = readEntry(tier, entry, NULL)) == NULL) {
+            ret_val = -1;
+        } else {
+            ret_val = fsp_blob_read(blob, buf);
+            fsp_blob_free(blob);
+        }
+        pthread_mutex_lock(&(tier->mutex));
+        if(--(entry->readers) == 0 && entry->removed) freeEntry(tier, entry);
+    }
+    pthread_mutex_unlock(&(tier->mutex));
+
+    return ret_val;
+}
+
+void fsp_tier_remove(struct fsp_tier* tier, const void* key) {
+    if(tier == NULL) return;
+
+    pthread_mutex_lock(&(tier->mutex));
+    struct fsp_tier_entry* entry = search(tier, key);
+    if(entry != NULL) {
+        detach(tier, entry);
+        if(entry->state == FSP_TIER_WRITING || entry->readers > 0) {
+            // Il contenuto verrà liberato dal thread di scrittura o dall'ultimo thread che lo legge
+            entry->removed = 1;
+        } else {
+            if(entry->state == FSP_TIER_PENDING) dequeue(tier, entry);
+            freeEntry(tier, entry);
+        }
+    }
+    pthread_mutex_unlock(&(tier->mutex));
+}
+
+void fsp_tier_forkPrepare(struct fsp_tier* tier) {
+    if(tier == NULL) return;
+
+    pthread_mutex_lock(&(tier->mutex));
+    (tier->pins)++;
+}
+
+void fsp_tier_forkParent(struct fsp_tier* tier) {
+    if(tier == NULL) return;
+
+    pthread_mutex_unlock(&(tier->mutex));
+}
+
+void fsp_tier_forkChild(struct fsp_tier* tier) {
+    if(tier == NULL) return;
+
+    // Il processo figlio ha solo il thread che ha invocato fork(): il mutex viene reinizializzato
+    // e i contenuti in fase di scrittura vengono letti dalla memoria
+    pthread_mutex_init(&(tier->mutex), NULL);
+    pthread_cond_init(&(tier->queue_isNotEmpty), NULL);
+    pthread_cond_init(&(tier->written), NULL);
+}
+
+int fsp_tier_forkOpen(struct fsp_tier* tier, const void* key, struct fsp_tier_view* view) {
+    if(tier == NULL || view == NULL) return -1;
+
+    // Il processo figlio non modifica il tier: il contenuto viene cercato senza il mutex
+    const struct fsp_tier_entry* entry = search(tier, key);
+    if(entry == NULL) return -1;
+    view->blob = entry->blob;
+    view->fd = -1;
+    view->size = entry->size;
+    view->stored_size = entry->stored_size;
+    view->hash = entry->hash;
+    view->compressed = entry->compressed;
+    if(entry->blob == NULL) {
+        char path[strlen(tier->dir) + FSP_TIER_FILE_NAME_LEN];
+        entryPath(tier, entry, path);
+        if((view->fd = open(path, O_RDONLY)) == -1) return -1;
+    }
+
+    return 0;
+}
+
+void fsp_tier_forkDone(struct fsp_tier* tier) {
+    if(tier == NULL) return;
+
+    pthread_mutex_lock(&(tier->mutex));
+    if(tier->pins > 0 && --(tier->pins) == 0) freeDeferred(tier);
+    pthread_mutex_unlock(&(tier->mutex));
+}
@@ -0,0 +1,792 @@
+/*
+ * Autore: Francesco Gallicchio
+ * Matricola: 579131
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <fsp_wal.h>
+
+// Prefisso dei nomi dei segmenti
+#define FSP_WAL_SEGMENT_PREFIX "wal."
+// Nome dello snapshot e del file temporaneo usato per scriverlo
+#define FSP_WAL_SNAPSHOT_NAME "snapshot"
+#define FSP_WAL_SNAPSHOT_TMP_NAME "snapshot.tmp"
+// Lunghezza massima del nome di un file del log (escluso il nome della directory)
+#define FSP_WAL_FILE_NAME_LEN 32
+// Identificativo del formato dello snapshot
+#define FSP_WAL_SNAPSHOT_MAGIC "FSPSNAP1"
+// Dimensione iniziale dei buffer dei gruppi di record
+#define FSP_WAL_BUFFER_SIZE 65536
+
+// Intestazione di un record (seguita dal nome del file terminato da '\0' e dai dati)
+struct fsp_wal_header {
+    // CRC-32 del resto del record
+    uint32_t crc;
+    // Tipo del record
+    uint32_t type;
+    // Lunghezza del nome del file (escluso '\0')
+    uint32_t pathname_len;
+    // Valore hash del contenuto del file
+    uint32_t hash;
+    // Dimensione del contenuto del file
+    uint64_t size;
+    // Dimensione dei dati
+    uint64_t data_len;
+    // Indica se i dati sono compressi
+    uint32_t compressed;
+    uint32_t padding;
+};
+
+// Intestazione dello snapshot (seguita dai record)
+struct fsp_wal_snapshot_header {
+    // Identificativo del formato
+    char magic[8];
+    // Primo segmento non contenuto nello snapshot
+    uint64_t segment;
+};
+
+// Tabella per il calcolo del CRC-32 (polinomio 0xEDB88320)
+static uint32_t crc_table[256];
+static pthread_once_t crc_table_once = PTHREAD_ONCE_INIT;
+
+/**
+ * \brief Inizializza crc_table.
+ */
+static void crcTableInit(void);
+
+/**
+ * \brief Restituisce il CRC-32 di len byte di buf, a partire dal valore crc.
+ */
+static uint32_t crc32(uint32_t crc, const void* buf, size_t len);
+
+/**
+ * \brief Scrive in path (di almeno FSP_WAL_FILE_NAME_LEN byte oltre al nome della directory) il nome del file name di wal.
+ */
+static void filePath(const struct fsp_wal* wal, const char* name, char* path);
+
+/**
+ * \brief Scrive in path il nome del segmento segment di wal.
+ */
+static void segmentPath(const struct fsp_wal* wal, unsigned long int segment, char* path);
+
+/**
+ * \brief Restituisce il numero del segmento con nome name.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se name non è il nome di un segmento.
+ */
+static int segmentNumber(const char* name, unsigned long int* segment);
+
+/**
+ * \brief Scrive len byte di buf nel file fd.
+ *
+ * \return 0 in caso di successo,
+ *         -1 altrimenti.
+ */
+static int writeAll(int fd, const void* buf, size_t len);
+
+/**
+ * \brief Legge len byte dalla posizione offset del file fd in buf.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se non è stato possibile leggerli (errore o file troppo corto).
+ */
+static int readAll(int fd, void* buf, size_t len, off_t offset);
+
+/**
+ * \brief Scrive in header l'intestazione (senza il CRC) di un record di tipo type con i valori degli argomenti.
+ */
+static void makeHeader(struct fsp_wal_header* header, unsigned int type, size_t pathname_len,
+                       size_t file_size, unsigned int hash, int compressed, size_t data_len);
+
+/**
+ * \brief Scrive nel file temporaneo di snapshot i record accumulati nel suo buffer.
+ *
+ * \return 0 in caso di successo,
+ *         -1 altrimenti (snapshot->error viene settato).
+ */
+static int flushSnapshot(struct fsp_wal_snapshot* snapshot);
+
+/**
+ * \brief Legge il contenuto del file path e lo restituisce (allocato con malloc()), salvando in *len la sua lunghezza.
+ *
+ * \return Il contenuto,
+ *         NULL se il file non esiste (errno == ENOENT) o è vuoto (errno == 0) || non è stato possibile leggerlo.
+ */
+static void* readFile(const char* path, size_t* len);
+
+/**
+ * \brief Aggiunge a *buf (di *len byte utilizzati su *size) i record validi all'inizio dei len byte di records.
+ *
+ * \return 0 in caso di successo,
+ *         -1 se non è stato possibile riallocare *buf.
+ */
+static int appendRecords(void** buf, size_t* len, size_t* size, const void* records, size_t records_len);
+
+/**
+ * \brief Apre (creandolo) il segmento segment di wal.
+ *
+ * \return Il descrittore del segmento,
+ *         -1 in caso di errore.
+ */
+static int openSegment(const struct fsp_wal* wal, unsigned long int segment);
+
+/**
+ * \brief Funzione eseguita dal thread di scrittura.
+ */
+static void* writer(void* arg);
+
+static void crcTableInit(void) {
+    for(uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for(int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[i] = c;
+    }
+}
+
+static uint32_t crc32(uint32_t crc, const void* buf, size_t len) {
+    const unsigned char* p = buf;
+    crc = ~crc;
+    for(size_t i = 0; i < len; i++) crc = crc_table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void filePath(const struct fsp_wal* wal, const char* name, char* path) {
+    sprintf(path, "%s/%s", wal->dir, name);
+}
+
+static void segmentPath(const struct fsp_wal* wal, unsigned long int segment, char* path) {
+    sprintf(path, "%s/%s%08lu", wal->dir, FSP_WAL_SEGMENT_PREFIX, segment);
+}
+
+static int segmentNumber(const char* name, unsigned long int* segment) {
+    size_t prefix_len = strlen(FSP_WAL_SEGMENT_PREFIX);
+    if(strncmp(name, FSP_WAL_SEGMENT_PREFIX, prefix_len) != 0 || name[prefix_len] == '\0') return -1;
+    for(const char* c = name + prefix_len; *c != '\0'; c++) {
+        if(*c < '0' || *c > '9') return -1;
+    }
+    errno = 0;
+    *segment = strtoul(name + prefix_len, NULL, 10);
+    return errno == 0 ? 0 : -1;
+}
+
+static int writeAll(int fd, const void* buf, size_t len) {
+    const unsigned char* p = buf;
+    while(len > 0) {
+        ssize_t w_bytes = write(fd, p, len);
+        if(w_bytes == -1) {
+            if(errno == EINTR) continue;
+            return -1;
+        }
+        p += w_bytes;
+        len -= w_bytes;
+    }
+    return 0;
+}
+
+static int readAll(int fd, void* buf, size_t len, off_t offset) {
+    unsigned char* p = buf;
+    while(len > 0) {
+        ssize_t r_bytes = pread(fd, p, len, offset);
+        if(r_bytes == -1 && errno == EINTR) continue;
+        if(r_bytes <= 0) return -1;
+        p += r_bytes;
+        offset += r_bytes;
+        len -= r_bytes;
+    }
+    return 0;
+}
+
+static void makeHeader(struct fsp_wal_header* header, unsigned int type, size_t pathname_len,
+                       size_t file_size, unsigned int hash, int compressed, size_t data_len) {
+    memset(header, 0, sizeof(*header));
+    header->type = type;
+    header->pathname_len = pathname_len;
+    if(type == FSP_WAL_WRITE) {
+        header->size = file_size;
+        header->hash = hash;
+        header->compressed = compressed != 0;
+    } else {
+        header->size = data_len;
+    }
+    header->data_len = data_len;
+}
+
+static int flushSnapshot(struct fsp_wal_snapshot* snapshot) {
+    if(snapshot->len > 0 && writeAll(snapshot->fd, snapshot->buf, snapshot->len) != 0) {
+        snapshot->error = 1;
+        return -1;
+    }
+    snapshot->len = 0;
+    return 0;
+}
+
+static void* readFile(const char* path, size_t* len) {
+    int fd;
+    if((fd = open(path, O_RDONLY)) == -1) return NULL;
+
+    struct stat info;
+    if(fstat(fd, &info) == -1) {
+        close(fd);
+        return NULL;
+    }
+    if(info.st_size == 0) {
+        close(fd);
+        errno = 0;
+        return NULL;
+    }
+
+    unsigned char* buf = NULL;
+    if((buf = malloc(info.st_size)) == NULL) {
+        close(fd);
+        return NULL;
+    }
+    size_t r_len = 0;
+    while(r_len < info.st_size) {
+        ssize_t r_bytes = read(fd, buf + r_len, info.st_size - r_len);
+        if(r_bytes == -1 && errno == EINTR) continue;
+        if(r_bytes == -1) {
+            close(fd);
+            free(buf);
+            return NULL;
+        }
+        if(r_bytes == 0) break;
+        r_len += r_bytes;
+    }
+    close(fd);
+    *len = r_len;
+
+    return buf;
+}
+
+static int appendRecords(void** buf, size_t* len, size_t* size, const void* records, size_t records_len) {
+    // Lunghezza dei record validi (i record successivi a una scrittura interrotta vengono ignorati)
+    const unsigned char* p = records;
+    size_t valid_len = 0;
+    size_t record_len;
+    struct fsp_wal_record record;
+    while((record_len = fsp_wal_parseRecord(p + valid_len, records_len - valid_len, &record)) > 0) {
+        valid_len += record_len;
+    }
+    if(valid_len == 0) return 0;
+
+    if(valid_len > *size - *len) {
+        size_t new_size = *size*2 > *len + valid_len ? *size*2 : *len + valid_len;
+        void* new_buf = realloc(*buf, new_size);
+        if(new_buf == NULL) return -1;
+        *buf = new_buf;
+        *size = new_size;
+    }
+    memcpy((unsigned char*) *buf + *len, records, valid_len);
+    *len += valid_len;
+
+    return 0;
+}
+
+static int openSegment(const struct fsp_wal* wal, unsigned long int segment) {
+    char path[strlen(wal->dir) + FSP_WAL_FILE_NAME_LEN];
+    segmentPath(wal, segment, path);
+
+    return open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0600);
+}
+
+static void* writer(void* arg) {
+    struct fsp_wal* wal = arg;
+
+    pthread_mutex_lock(&(wal->mutex));
+    while(1) {
+        while(wal->len == 0 && !wal->quit) {
+            pthread_cond_wait(&(wal->batch_isNotEmpty), &(wal->mutex));
+        }
+        // I record in sospeso vengono scritti anche in fase di terminazione
+        if(wal->len == 0) break;
+
+        // Scambia i buffer: i record aggiunti durante la scrittura formano il gruppo successivo
+        void* batch = wal->buf;
+        size_t batch_len = wal->len;
+        size_t batch_size = wal->size;
+        wal->buf = wal->spare;
+        wal->size = wal->spare_size;
+        wal->len = 0;
+        wal->spare = batch;
+        wal->spare_size = batch_size;
+        unsigned long long int end = wal->appended;
+        int fd = wal->fd;
+        wal->writing = 1;
+
+        pthread_mutex_unlock(&(wal->mutex));
+        int err = writeAll(fd, batch, batch_len);
+        if(!err && wal->durability != FSP_WAL_DURABILITY_NONE) err = fdatasync(fd);
+        pthread_mutex_lock(&(wal->mutex));
+
+        wal->writing = 0;
+        if(err) wal->error = 1;
+        wal->written = end;
+        wal->batches++;
+        pthread_cond_broadcast(&(wal->batch_written));
+    }
+    pthread_mutex_unlock(&(wal->mutex));
+
+    return 0;
+}
+
+struct fsp_wal* fsp_wal_open(const char* dir, int durability) {
+    if(dir == NULL || durability < FSP_WAL_DURABILITY_NONE || durability > FSP_WAL_DURABILITY_FSYNC) return NULL;
+
+    if(mkdir(dir, 0700) != 0 && errno != EEXIST) return NULL;
+
+    pthread_once(&crc_table_once, crcTableInit);
+
+    struct fsp_wal* wal = NULL;
+    if((wal = malloc(sizeof(struct fsp_wal))) == NULL) return NULL;
+    if((wal->dir = malloc(strlen(dir) + 1)) == NULL) {
+        free(wal);
+        return NULL;
+    }
+    strcpy(wal->dir, dir);
+    wal->durability = durability;
+    wal->len = 0;
+    wal->size = FSP_WAL_BUFFER_SIZE;
+    wal->spare_size = FSP_WAL_BUFFER_SIZE;
+    wal->appended = 0;
+    wal->written = 0;
+    wal->writing = 0;
+    wal->error = 0;
+    wal->quit = 0;
+    wal->records = 0;
+    wal->batches = 0;
+    wal->buf = malloc(wal->size);
+    wal->spare = malloc(wal->spare_size);
+    if(wal->buf == NULL || wal->spare == NULL) {
+        free(wal->buf);
+        free(wal->spare);
+        free(wal->dir);
+        free(wal);
+        return NULL;
+    }
+
+    // Il nuovo segmento segue quelli presenti e quello associato allo snapshot
+    unsigned long int min = 0, max = 0;
+    int found = 0;
+    DIR* d = NULL;
+    if((d = opendir(dir)) != NULL) {
+        struct dirent* dirent;
+        unsigned long int segment;
+        while((dirent = readdir(d)) != NULL) {
+            if(segmentNumber(dirent->d_name, &segment) != 0) continue;
+            if(!found || segment < min) min = segment;
+            if(!found || segment > max) max = segment;
+            found = 1;
+        }
+        closedir(d);
+    }
+    wal->segment = found ? max + 1 : 0;
+    wal->first_segment = found ? min : 0;
+
+    char path[strlen(dir) + FSP_WAL_FILE_NAME_LEN];
+    filePath(wal, FSP_WAL_SNAPSHOT_NAME, path);
+    int fd;
+    if((fd = open(path, O_RDONLY)) != -1) {
+        struct fsp_wal_snapshot_header header;
+        if(read(fd, &header, sizeof(header)) == sizeof(header) &&
+           memcmp(header.magic, FSP_WAL_SNAPSHOT_MAGIC, sizeof(header.magic)) == 0 && header.segment > wal->segment) {
+            wal->segment = header.segment;
+        }
+        close(fd);
+    }
+
+    if((wal->fd = openSegment(wal, wal->segment)) == -1) {
+        free(wal->buf);
+        free(wal->spare);
+        free(wal->dir);
+        free(wal);
+        return NULL;
+    }
+    pthread_mutex_init(&(wal->mutex), NULL);
+    pthread_cond_init(&(wal->batch_isNotEmpty), NULL);
+    pthread_cond_init(&(wal->batch_written), NULL);
+
+    // Il thread di scrittura non riceve i segnali (gestiti dagli altri thread)
+    sigset_t mask, old_mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_SETMASK, &mask, &old_mask);
+    int err = pthread_create(&(wal->writer), NULL, writer, wal);
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+    if(err != 0) {
+        close(wal->fd);
+        pthread_mutex_destroy(&(wal->mutex));
+        pthread_cond_destroy(&(wal->batch_isNotEmpty));
+        pthread_cond_destroy(&(wal->batch_written));
+        free(wal->buf);
+        free(wal->spare);
+        free(wal->dir);
+        free(wal);
+        return NULL;
+    }
+
+    return wal;
+}
+
+void fsp_wal_close(struct fsp_wal* wal) {
+    if(wal == NULL) return;
+
+    pthread_mutex_lock(&(wal->mutex));
+    wal->quit = 1;
+    pthread_cond_signal(&(wal->batch_isNotEmpty));
+    pthread_mutex_unlock(&(wal->mutex));
+    pthread_join(wal->writer, NULL);
+
+    if(wal->durability != FSP_WAL_DURABILITY_NONE) fsync(wal->fd);
+    close(wal->fd);
+
+    pthread_mutex_destroy(&(wal->mutex));
+    pthread_cond_destroy(&(wal->batch_isNotEmpty));
+    pthread_cond_destroy(&(wal->batch_written));
+    free(wal->buf);
+    free(wal->spare);
+    free(wal->dir);
+    free(wal);
+}
+
+int fsp_wal_load(struct fsp_wal* wal, void** buf, size_t* len) {
+    if(wal == NULL || buf == NULL || len == NULL) return -1;
+
+    *buf = NULL;
+    *len = 0;
+    size_t size = 0;
+    char path[strlen(wal->dir) + FSP_WAL_FILE_NAME_LEN];
+
+    // Snapshot
+    unsigned long int first = wal->first_segment;
+    void* data = NULL;
+    size_t data_len = 0;
+    filePath(wal, FSP_WAL_SNAPSHOT_NAME, path);
+    if((data = readFile(path, &data_len)) == NULL && errno != ENOENT && errno != 0) return -1;
+    if(data != NULL) {
+        struct fsp_wal_snapshot_header header;
+        if(data_len >= sizeof(header)) {
+            memcpy(&header, data, sizeof(header));
+            if(memcmp(header.magic, FSP_WAL_SNAPSHOT_MAGIC, sizeof(header.magic)) == 0) {
+                if(header.segment > first) first = header.segment;
+                if(appendRecords(buf, len, &size, (unsigned char*) data + sizeof(header), data_len - sizeof(header)) != 0) {
+                    free(data);
+                    free(*buf);
+                    *buf = NULL;
+                    *len = 0;
+                    return -1;
+                }
+            }
+        }
+        free(data);
+    }
+
+    // Segmenti successivi allo snapshot (escluso quello creato all'apertura)
+    for(unsigned long int segment = first; segment < wal->segment; segment++) {
+        segmentPath(wal, segment, path);
+        if((data = readFile(path, &data_len)) == NULL) {
+            if(errno == ENOENT || errno == 0) continue;
+            free(*buf);
+            *buf = NULL;
+            *len = 0;
+            return -1;
+        }
+        int err = appendRecords(buf, len, &size, data, data_len);
+        free(data);
+        if(err) {
+            free(*buf);
+            *buf = NULL;
+            *len = 0;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+long int fsp_wal_makeRecord(void** buf, size_t* size, size_t offset, unsigned int type, const char* pathname,
+                            size_t file_size, unsigned int hash, int compressed, const void* data, size_t data_len) {
+    if(buf == NULL || size == NULL || pathname == NULL || (data_len > 0 && data == NULL)) return -1;
+
+    pthread_once(&crc_table_once, crcTableInit);
+
+    size_t pathname_len = strlen(pathname);
+    size_t record_len = sizeof(struct fsp_wal_header) + pathname_len + 1 + data_len;
+    if(*buf == NULL || record_len > *size - offset) {
+        size_t new_size = *size*2 > offset + record_len ? *size*2 : offset + record_len;
+        void* new_buf = realloc(*buf, new_size);
+        if(new_buf == NULL) return -2;
+        *buf = new_buf;
+        *size = new_size;
+    }
+
+    struct fsp_wal_header header;
+    makeHeader(&header, type, pathname_len, file_size, hash, compressed, data_len);
+
+    unsigned char* record = (unsigned char*) *buf + offset;
+    memcpy(record + sizeof(header), pathname, pathname_len + 1);
+    if(data_len > 0) memcpy(record + sizeof(header) + pathname_len + 1, data, data_len);
+    memcpy(record, &header, sizeof(header));
+    header.crc = crc32(0, record + sizeof(header.crc), record_len - sizeof(header.crc));
+    memcpy(record, &header, sizeof(header.crc));
+
+    return record_len;
+}
+
+size_t fsp_wal_parseRecord(const void* buf, size_t len, struct fsp_wal_record* record) {
+    if(buf == NULL || record == NULL || len < sizeof(struct fsp_wal_header)) return 0;
+
+    pthread_once(&crc_table_once, crcTableInit);
+
+    struct fsp_wal_header header;
+    memcpy(&header, buf, sizeof(header));
+    if(header.type < FSP_WAL_CREATE || header.type > FSP_WAL_EXPIRE) return 0;
+    if(header.pathname_len >= len - sizeof(header) || header.data_len > len - sizeof(header) - header.pathname_len - 1) return 0;
+
+    size_t record_len = sizeof(header) + header.pathname_len + 1 + header.data_len;
+    const unsigned char* p = buf;
+    if(p[sizeof(header) + header.pathname_len] != '\0') return 0;
+    if(crc32(0, p + sizeof(header.crc), record_len - sizeof(header.crc)) != header.crc) return 0;
+
+    record->type = header.type;
+    record->pathname = (const char*) (p + sizeof(header));
+    record->size = header.size;
+    record->hash = header.hash;
+    record->compressed = header.compressed;
+    record->data = p + sizeof(header) + header.pathname_len + 1;
+    record->data_len = header.data_len;
+
+    return record_len;
+}
+
+int fsp_wal_append(struct fsp_wal* wal, unsigned int type, const char* pathname,
+                   size_t file_size, unsigned int hash, int compressed, const void* data, size_t data_len) {
+    if(wal == NULL) return -1;
+
+    pthread_mutex_lock(&(wal->mutex));
+    long int record_len = fsp_wal_makeRecord(&(wal->buf), &(wal->size), wal->len, type, pathname,
+                                             file_size, hash, compressed, data, data_len);
+    if(record_len < 0) {
+        // Il record non fa parte del log: la durabilità delle modifiche non è più garantita
+        if(record_len == -2) wal->error = 1;
+        pthread_mutex_unlock(&(wal->mutex));
+        return -1;
+    }
+    wal->len += record_len;
+    wal->appended += record_len;
+    wal->records++;
+    pthread_cond_signal(&(wal->batch_isNotEmpty));
+    pthread_mutex_unlock(&(wal->mutex));
+
+    return 0;
+}
+
+int fsp_wal_commit(struct fsp_wal* wal) {
+    if(wal == NULL) return -1;
+
+    pthread_mutex_lock(&(wal->mutex));
+    if(wal->durability == FSP_WAL_DURABILITY_FSYNC) {
+        unsigned long long int end = wal->appended;
+        while(wal->written < end) pthread_cond_wait(&(wal->batch_written), &(wal->mutex));
+    }
+    int err = wal->error;
+    pthread_mutex_unlock(&(wal->mutex));
+
+    return err ? -1 : 0;
+}
+
+int fsp_wal_rotate(struct fsp_wal* wal, unsigned long int* segment) {
+    if(wal == NULL || segment == NULL) return -1;
+
+    pthread_mutex_lock(&(wal->mutex));
+    // Attende la scrittura dei record in sospeso nel segmento corrente
+    while(wal->len > 0 || wal->writing) {
+        pthread_cond_signal(&(wal->batch_isNotEmpty));
+        pthread_cond_wait(&(wal->batch_written), &(wal->mutex));
+    }
+    int fd;
+    if((fd = openSegment(wal, wal->segment + 1)) == -1) {
+        pthread_mutex_unlock(&(wal->mutex));
+        return -1;
+    }
+    close(wal->fd);
+    wal->fd = fd;
+    *segment = ++(wal->segment);
+    pthread_mutex_unlock(&(wal->mutex));
+
+    return 0;
+}
+
+struct fsp_wal_snapshot* fsp_wal_beginSnapshot(struct fsp_wal* wal, unsigned long int segment) {
+    if(wal == NULL) return NULL;
+
+    // Il CRC dei record viene calcolato anche da un processo figlio
+    pthread_once(&crc_table_once, crcTableInit);
+
+    struct fsp_wal_snapshot* snapshot = NULL;
+    if((snapshot = calloc(1, sizeof(struct fsp_wal_snapshot))) == NULL) return NULL;
+    snapshot->dir = wal->dir;
+    snapshot->fd = -1;
+    snapshot->segment = segment;
+    snapshot->size = FSP_WAL_SNAPSHOT_BLOCK_SIZE;
+    if((snapshot->buf = malloc(snapshot->size)) == NULL ||
+       (snapshot->tmp_path = malloc(strlen(wal->dir) + FSP_WAL_FILE_NAME_LEN)) == NULL ||
+       (snapshot->path = malloc(strlen(wal->dir) + FSP_WAL_FILE_NAME_LEN)) == NULL) {
+        fsp_wal_endSnapshot(snapshot, 0);
+        return NULL;
+    }
+    filePath(wal, FSP_WAL_SNAPSHOT_TMP_NAME, snapshot->tmp_path);
+    filePath(wal, FSP_WAL_SNAPSHOT_NAME, snapshot->path);
+    if((snapshot->fd = open(snapshot->tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600)) == -1) {
+        fsp_wal_endSnapshot(snapshot, 0);
+        return NULL;
+    }
+
+    struct fsp_wal_snapshot_header header;
+    memcpy(header.magic, FSP_WAL_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.segment = segment;
+    memcpy(snapshot->buf, &header, sizeof(header));
+    snapshot->len = sizeof(header);
+
+    return snapshot;
+}
+
+int fsp_wal_addToSnapshot(struct fsp_wal_snapshot* snapshot, unsigned int type, const char* pathname,
+                          size_t file_size, unsigned int hash, int compressed, const void* data, size_t data_len) {
+    if(snapshot == NULL || snapshot->error || pathname == NULL || (data_len > 0 && data == NULL) ||
+       (type != FSP_WAL_WRITE && type != FSP_WAL_EXPIRE)) return -1;
+
+    size_t pathname_len = strlen(pathname);
+    size_t record_len = sizeof(struct fsp_wal_header) + pathname_len + 1 + data_len;
+    if(record_len > snapshot->size - snapshot->len && flushSnapshot(snapshot) != 0) return -1;
+
+    if(record_len <= snapshot->size) {
+        // Il record entra nel buffer (fsp_wal_makeRecord non lo rialloca)
+        snapshot->len += fsp_wal_makeRecord(&(snapshot->buf), &(snapshot->size), snapshot->len, type, pathname,
+                                            file_size, hash, compressed, data, data_len);
+    } else {
+        // Intestazione e nome nel buffer (vuoto), dati scritti direttamente
+        struct fsp_wal_header header;
+        makeHeader(&header, type, pathname_len, file_size, hash, compressed, data_len);
+        uint32_t crc = crc32(0, (unsigned char*) &header + sizeof(header.crc), sizeof(header) - sizeof(header.crc));
+        crc = crc32(crc, pathname, pathname_len + 1);
+        header.crc = crc32(crc, data, data_len);
+        memcpy(snapshot->buf, &header, sizeof(header));
+        memcpy((unsigned char*) snapshot->buf + sizeof(header), pathname, pathname_len + 1);
+        snapshot->len = sizeof(header) + pathname_len + 1;
+        if(flushSnapshot(snapshot) != 0) return -1;
+        if(writeAll(snapshot->fd, data, data_len) != 0) {
+            snapshot->error = 1;
+            return -1;
+        }
+    }
+
+    // Scrive i record accumulati a blocchi
+    if(snapshot->len >= FSP_WAL_SNAPSHOT_BLOCK_SIZE && flushSnapshot(snapshot) != 0) return -1;
+
+    return 0;
+}
+
+int fsp_wal_addFileToSnapshot(struct fsp_wal_snapshot* snapshot, const char* pathname, size_t file_size,
+                              unsigned int hash, int compressed, int fd, size_t data_len) {
+    if(snapshot == NULL || snapshot->error || pathname == NULL || fd < 0) return -1;
+
+    size_t pathname_len = strlen(pathname);
+    if(sizeof(struct fsp_wal_header) + pathname_len + 1 > snapshot->size) return -1;
+    // Il buffer viene svuotato e usato per leggere i dati
+    if(flushSnapshot(snapshot) != 0) return -1;
+    unsigned char* buf = snapshot->buf;
+
+    struct fsp_wal_header header;
+    makeHeader(&header, FSP_WAL_WRITE, pathname_len, file_size, hash, compressed, data_len);
+    uint32_t crc = crc32(0, (unsigned char*) &header + sizeof(header.crc), sizeof(header) - sizeof(header.crc));
+    crc = crc32(crc, pathname, pathname_len + 1);
+    for(size_t offset = 0; offset < data_len; ) {
+        size_t len = data_len - offset < snapshot->size ? data_len - offset : snapshot->size;
+        if(readAll(fd, buf, len, offset) != 0) return -1;
+        crc = crc32(crc, buf, len);
+        offset += len;
+    }
+    header.crc = crc;
+
+    memcpy(buf, &header, sizeof(header));
+    memcpy(buf + sizeof(header), pathname, pathname_len + 1);
+    snapshot->len = sizeof(header) + pathname_len + 1;
+    for(size_t offset = 0; offset < data_len; ) {
+        if(snapshot->len == snapshot->size && flushSnapshot(snapshot) != 0) return -1;
+        size_t len = data_len - offset < snapshot->size - snapshot->len ? data_len - offset : snapshot->size - snapshot->len;
+        if(readAll(fd, buf + snapshot->len, len, offset) != 0) {
+            // Il record è incompleto: lo snapshot non è valido
+            snapshot->error = 1;
+            return -1;
+        }
+        snapshot->len += len;
+        offset += len;
+    }
+
+    if(snapshot->len >= FSP_WAL_SNAPSHOT_BLOCK_SIZE && flushSnapshot(snapshot) != 0) return -1;
+
+    return 0;
+}
+
+int fsp_wal_commitSnapshot(struct fsp_wal_snapshot* snapshot) {
+    if(snapshot == NULL) return -1;
+
+    // Lo snapshot deve essere su disco prima di sostituire quello precedente
+    if(snapshot->error || flushSnapshot(snapshot) != 0 || fsync(snapshot->fd) != 0 ||
+       rename(snapshot->tmp_path, snapshot->path) != 0) {
+        fsp_wal_abortSnapshot(snapshot);
+        return -1;
+    }
+    int fd;
+    if((fd = open(snapshot->dir, O_RDONLY)) != -1) {
+        fsync(fd);
+        close(fd);
+    }
+
+    return 0;
+}
+
+void fsp_wal_abortSnapshot(struct fsp_wal_snapshot* snapshot) {
+    if(snapshot == NULL) return;
+
+    snapshot->error = 1;
+    unlink(snapshot->tmp_path);
+}
+
+void fsp_wal_endSnapshot(struct fsp_wal_snapshot* snapshot, int committed) {
+    if(snapshot == NULL) return;
+
+    if(snapshot->fd != -1) close(snapshot->fd);
+    if(committed) {
+        // Rimuove i segmenti contenuti nello snapshot
+        DIR* d = NULL;
+        if((d = opendir(snapshot->dir)) != NULL) {
+            char path[strlen(snapshot->dir) + FSP_WAL_FILE_NAME_LEN];
+            struct dirent* dirent;
+            unsigned long int n;
+            while((dirent = readdir(d)) != NULL) {
+                if(segmentNumber(dirent->d_name, &n) != 0 || n >= snapshot->segment) continue;
+                sprintf(path, "%s/%s%08lu", snapshot->dir, FSP_WAL_SEGMENT_PREFIX, n);
+                unlink(path);
+            }
+            closedir(d);
+        }
+    } else if(snapshot->tmp_path != NULL) {
+        unlink(snapshot->tmp_path);
+    }
+    free(snapshot->buf);
+    free(snapshot->tmp_path);
+    free(snapshot->path);
+    free(snapshot);
+}
@@ -149,7 +149,7 @@ echo "CLOSE  falliti:" $(($n_tot-$n_succ))
 echo
 
 # Dimensione massima in Mbytes raggiunta dallo storage
-grep -e ' APPEND ' -e ' WRITE ' -e ' REMOVE ' -e ' REJECTED_FILE: ' $logfile |
+grep -e ' APPEND ' -e ' WRITE ' -e ' REMOVE ' -e ' REJECTED_FILE: ' -e ' EXPIRED_FILE: ' $logfile |
 {
     max_bytes=0
     bytes=0
@@ -176,7 +176,7 @@ grep -e ' APPEND ' -e ' WRITE ' -e ' REMOVE ' -e ' REJECTED_FILE: ' $logfile |
                 _bytes=${_bytes%)}
                 bytes=$(($bytes-$_bytes))
                 ;;
-            *REJECTED_FILE:*)
+            *REJECTED_FILE:*|*EXPIRED_FILE:*)
                 _bytes=${_bytes##*(}
                 _bytes=${_bytes%)}
                 bytes=$(($bytes-$_bytes))
@@ -196,7 +196,7 @@ echo
 # Il calcolo si basa sul comportamento del programma client:
 # per creare un nuovo file prima lo apre con OPENCL e poi lo scrive con WRITE
 # (se OPENCL non termina con successo, allora non scrive con WRITE)
-grep -e ' OPENCL ' -e ' WRITE ' -e ' REMOVE ' -e ' REJECTED_FILE: ' $logfile |
+grep -e ' OPENCL ' -e ' WRITE ' -e ' REMOVE ' -e ' REJECTED_FILE: ' -e ' EXPIRED_FILE: ' $logfile |
 {
     max_files_num=0
     files_num=0
@@ -214,7 +214,7 @@ grep -e ' OPENCL ' -e ' WRITE ' -e ' REMOVE ' -e ' REJECTED_FILE: ' $logfile |
             *REMOVE*SUCCESS*)
                 files_num=$(($files_num-1))
                 ;;
-            *REJECTED_FILE:*)
+            *REJECTED_FILE:*|*EXPIRED_FILE:*)
                 files_num=$(($files_num-1))
                 ;;
             *)
@@ -230,6 +230,9 @@ echo
 # Numero di volte in cui l'algoritmo di rimpiazzamento della cache è stato eseguito per selezionare uno o più file vittima
 echo "CAPACITY_MISS (numero totale):" $(grep ' CAPACITY_MISS' $logfile | wc -l)
 
+# Numero di file rimossi perché scaduti
+echo "EXPIRED_FILE (numero totale):" $(grep ' EXPIRED_FILE: ' $logfile | wc -l)
+
 echo
 
 # Numero di richieste servite da ogni worker thread
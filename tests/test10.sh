@@ -0,0 +1,91 @@
+#!/bin/bash
+
+client_dir=../client
+server_dir=../server
+
+# Controlla se sono state create tutte le directory necessarie
+if ! [ -d ~/.file_storage ] || ! [ -d clients_out ] || ! [ -d clients_err_out ] || \
+   ! [ -d server_out ] || ! [ -d server_err_out ] || ! [ -d downloaded_files ] || ! [ -d rejected_files ]; then
+    echo "Usare il comando make all prima di eseguire il test"
+    exit 1
+fi
+
+# Controlla che il file /tmp/file_storage.sk non sia già in uso
+if [ -a /tmp/file_storage.sk ]; then
+    echo "Impossibile eseguire il server in quanto il file /tmp/file_storage.sk è già in uso"
+    exit 1
+fi
+
+f_opt="-f /tmp/file_storage.sk"
+files_dir_01=files/dir_01
+files_dir_02=files/dir_02
+failed=0
+
+# Controlla che i file scaricati nella cartella $1 siano uguali agli originali ($2 descrive la fase del test)
+check_files() {
+    for file in ${PWD}/${files_dir_01}/* ${PWD}/${files_dir_02}/*; do
+        downloaded=$1/$(echo "${file#/}" | tr / _)
+        if [ -e $downloaded ] && ! cmp -s $file $downloaded; then
+            echo "Errore ($2): il file $file restituito dal server non è uguale all'originale"
+            failed=1
+        fi
+    done
+}
+
+# Esegue il test con il pool dei contenuti di grandi dimensioni su transparent huge page e su huge page
+# di hugetlbfs (se non ci sono huge page riservate il pool usa le pagine normali), toccato all'avvio
+for huge_pages in thp hugetlb; do
+    # Crea il file di configurazione (2MB in memoria: i file espulsi vengono restituiti al client)
+    config_file=~/.file_storage/config.txt
+    echo "SOCKET_FILE_NAME=/tmp/file_storage.sk" > $config_file
+    echo "LOG_FILE_NAME=$HOME/.file_storage/file_storage.log" >> $config_file
+    echo "FILES_MAX_NUM=100" >> $config_file
+    echo "STORAGE_MAX_SIZE=2" >> $config_file
+    echo "MAX_CONN=16" >> $config_file
+    echo "WORKER_THREADS_NUM=4" >> $config_file
+    echo "HUGE_PAGES=$huge_pages" >> $config_file
+    echo "PREFAULT=1" >> $config_file
+    
+    # Avvia in background il processo server
+    rm -f /tmp/file_storage.sk
+    ${server_dir}/fsp_server 1> server_out/s_$huge_pages.txt 2> server_err_out/s_$huge_pages.txt &
+    server_pid=$!
+    while ! [ -S /tmp/file_storage.sk ] && kill -0 $server_pid 2> /dev/null; do sleep 0.1; done
+    if ! kill -0 $server_pid 2> /dev/null; then
+        echo "Errore (HUGE_PAGES=$huge_pages): il server non è stato avviato"
+        failed=1
+        continue
+    fi
+    
+    # Scrive 3.5MB e poi 1.5MB di file: i file espulsi liberano lo spazio del pool riusato dai successivi
+    rm -fR rejected_files/* downloaded_files/*
+    ${client_dir}/fsp $f_opt -p \
+        -w ${files_dir_02} -D rejected_files \
+        -w ${files_dir_01} -D rejected_files \
+        -R 0 -d downloaded_files \
+        1> clients_out/c_$huge_pages.txt 2> clients_err_out/c_$huge_pages.txt
+    if [ -z "$(ls rejected_files)" ] || [ -z "$(ls downloaded_files)" ]; then
+        echo "Errore (HUGE_PAGES=$huge_pages): nessun file è stato espulso o letto"
+        failed=1
+    fi
+    check_files rejected_files "HUGE_PAGES=$huge_pages, file espulsi"
+    check_files downloaded_files "HUGE_PAGES=$huge_pages, file letti"
+    
+    # Invia il segnale SIGHUP al server
+    kill -s HUP $server_pid
+    wait $server_pid
+    
+    max_size=$(grep "Dimensione massima raggiunta dal file storage" server_out/s_$huge_pages.txt | awk '{print $(NF-1)}')
+    if [ -z "$max_size" ] || awk -v size="$max_size" 'BEGIN { exit !(size > 2) }'; then
+        echo "Errore (HUGE_PAGES=$huge_pages): la memoria occupata dai file ($max_size MB) ha superato STORAGE_MAX_SIZE"
+        failed=1
+    fi
+done
+
+rm -fR rejected_files/* downloaded_files/*
+if [ $failed -eq 0 ]; then
+    echo "Test superato"
+else
+    echo "Test fallito"
+    exit 1
+fi
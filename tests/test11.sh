@@ -0,0 +1,120 @@
+#!/bin/bash
+
+client_dir=../client
+server_dir=../server
+
+# Controlla se sono state create tutte le directory necessarie
+if ! [ -d ~/.file_storage ] || ! [ -d clients_out ] || ! [ -d clients_err_out ] || \
+   ! [ -d server_out ] || ! [ -d server_err_out ] || ! [ -d downloaded_files ] || ! [ -d rejected_files ]; then
+    echo "Usare il comando make all prima di eseguire il test"
+    exit 1
+fi
+
+# Controlla che il file /tmp/file_storage.sk non sia già in uso
+if [ -a /tmp/file_storage.sk ]; then
+    echo "Impossibile eseguire il server in quanto il file /tmp/file_storage.sk è già in uso"
+    exit 1
+fi
+
+f_opt="-f /tmp/file_storage.sk"
+files_dir_01=files/dir_01
+files_dir_02=files/dir_02
+files_dir_03=files/dir_03
+tier_dir=$HOME/.file_storage/tier
+failed=0
+
+# Esegue il server con la politica di rimpiazzamento $1 ($2 == tier: i file espulsi vengono scritti nel tier
+# da un thread in background, altrimenti vengono restituiti ai client) e controlla che:
+# - il numero dei file e la memoria occupata non superino mai i limiti,
+# - ogni file scritto sia presente sul server oppure sia stato restituito a un client (non entrambi), con i contenuti originali,
+# - il numero dei file presenti alla chiusura del server sia uguale a quello dei file letti.
+check_policy() {
+    rm -fR $tier_dir downloaded_files/* rejected_files/*
+    config_file=~/.file_storage/config.txt
+    echo "SOCKET_FILE_NAME=/tmp/file_storage.sk" > $config_file
+    echo "LOG_FILE_NAME=$HOME/.file_storage/file_storage.log" >> $config_file
+    echo "FILES_MAX_NUM=10" >> $config_file
+    echo "STORAGE_MAX_SIZE=1" >> $config_file
+    echo "MAX_CONN=16" >> $config_file
+    echo "WORKER_THREADS_NUM=4" >> $config_file
+    echo "EVICTION_POLICY=$1" >> $config_file
+    if [ "$2" == "tier" ]; then
+        echo "TIER_DIR_NAME=$tier_dir" >> $config_file
+        echo "TIER_MAX_SIZE=64" >> $config_file
+        echo "EVICTION_HIGH_WATERMARK=80" >> $config_file
+        echo "EVICTION_LOW_WATERMARK=60" >> $config_file
+    fi
+
+    # Avvia in background il processo server
+    ${server_dir}/fsp_server 1> server_out/s_$1_$2.txt 2> server_err_out/s_$1_$2.txt &
+    server_pid=$!
+    while ! [ -S /tmp/file_storage.sk ] && kill -0 $server_pid 2> /dev/null; do sleep 0.1; done
+
+    # Tre client scrivono file distinti mentre un quarto legge ripetutamente alcuni file (accessi per la politica)
+    writers=""
+    for dir in ${files_dir_01} ${files_dir_02} ${files_dir_03}; do
+        ${client_dir}/fsp $f_opt -w $dir -D rejected_files -t 10 \
+            1>> clients_out/c_$1_$2.txt 2>> clients_err_out/c_$1_$2.txt &
+        writers="$writers $!"
+    done
+    read_files=${PWD}/${files_dir_01}/us.png,${PWD}/${files_dir_02}/meow.jpg,${PWD}/${files_dir_03}/file_01.txt
+    for index in {1..5}; do
+        ${client_dir}/fsp $f_opt -r $read_files -t 10 -r $read_files 1> /dev/null 2> /dev/null
+    done
+    wait $writers
+
+    # Legge tutti i file presenti sul server
+    ${client_dir}/fsp $f_opt -R 0 -d downloaded_files 1>> clients_out/c_$1_$2.txt 2>> clients_err_out/c_$1_$2.txt
+    kill -s HUP $server_pid
+    wait $server_pid
+    # Il server non rimuove il file del socket
+    rm -f /tmp/file_storage.sk
+
+    for file in ${PWD}/${files_dir_01}/* ${PWD}/${files_dir_02}/* ${PWD}/${files_dir_03}/*; do
+        name=$(echo "${file#/}" | tr / _)
+        if [ -e downloaded_files/$name ] && [ -e rejected_files/$name ]; then
+            echo "Errore ($1 $2): il file $file è presente sul server ed è stato restituito a un client"
+            failed=1
+        elif [ -e downloaded_files/$name ]; then
+            cmp -s $file downloaded_files/$name || { echo "Errore ($1 $2): il contenuto del file $file è cambiato"; failed=1; }
+        elif [ -e rejected_files/$name ] && [ "$2" != "tier" ]; then
+            cmp -s $file rejected_files/$name || { echo "Errore ($1 $2): il contenuto del file espulso $file è cambiato"; failed=1; }
+        else
+            echo "Errore ($1 $2): il file $file è stato perso"
+            failed=1
+        fi
+    done
+
+    max_num=$(grep "Numero massimo di file memorizzati" server_out/s_$1_$2.txt | awk '{print $NF}')
+    max_size=$(grep "Dimensione massima raggiunta dal file storage" server_out/s_$1_$2.txt | awk '{print $(NF-1)}')
+    if [ "$2" != "tier" ] && [ "$max_num" -gt 10 ]; then
+        echo "Errore ($1 $2): il numero dei file memorizzati ($max_num) ha superato FILES_MAX_NUM"
+        failed=1
+    fi
+    if awk -v size="$max_size" 'BEGIN { exit !(size > 1) }'; then
+        echo "Errore ($1 $2): la memoria occupata dai file ($max_size MB) ha superato STORAGE_MAX_SIZE"
+        failed=1
+    fi
+    stored=$(grep "File contenuti nello storage al momento della chiusura" server_out/s_$1_$2.txt | awk '{print $NF}')
+    if [ "$stored" -ne $(ls downloaded_files | wc -l) ]; then
+        echo "Errore ($1 $2): i file presenti alla chiusura del server ($stored) non sono quelli letti"
+        failed=1
+    fi
+    if [ -s server_err_out/s_$1_$2.txt ]; then
+        echo "Errore ($1 $2): il server ha scritto sullo standard error"
+        failed=1
+    fi
+}
+
+for policy in FIFO LRU LFU CLOCK ARC TINYLFU GDSF GDSF_BYTES; do
+    check_policy $policy memory
+    check_policy $policy tier
+done
+
+rm -fR $tier_dir
+if [ $failed -eq 0 ]; then
+    echo "Test superato"
+else
+    echo "Test fallito"
+    exit 1
+fi
@@ -0,0 +1,100 @@
+#!/bin/bash
+
+client_dir=../client
+server_dir=../server
+
+# Controlla se sono state create tutte le directory necessarie
+if ! [ -d ~/.file_storage ] || ! [ -d clients_out ] || ! [ -d clients_err_out ] || \
+   ! [ -d server_out ] || ! [ -d server_err_out ] || ! [ -d downloaded_files ] || ! [ -d rejected_files ]; then
+    echo "Usare il comando make all prima di eseguire il test"
+    exit 1
+fi
+
+# Controlla che il file /tmp/file_storage.sk non sia già in uso
+if [ -a /tmp/file_storage.sk ]; then
+    echo "Impossibile eseguire il server in quanto il file /tmp/file_storage.sk è già in uso"
+    exit 1
+fi
+
+f_opt="-f /tmp/file_storage.sk"
+files_dir=$HOME/.file_storage/large_files
+failed=0
+
+# Scrive sullo standard output $1 blocchi da 8KB, ognuno con 4KB casuali e 4KB di zeri (compressi a circa metà)
+blocks() {
+    for ((i = 0; i < $1; i++)); do
+        head -c 4096 /dev/urandom
+        head -c 4096 /dev/zero
+    done
+}
+
+# Crea i file: 600 file da 5000 byte e 4 file da 8MB (big_1 e big_2 hanno lo stesso contenuto, condiviso sul server)
+rm -fR $files_dir
+mkdir -p $files_dir/small
+blocks 367 | head -c 3000000 > $files_dir/small.bin
+split -b 5000 -a 3 -d $files_dir/small.bin $files_dir/small/file_
+rm $files_dir/small.bin
+for big in big_1 big_3 big_4; do blocks 1024 > $files_dir/$big; done
+cp $files_dir/big_1 $files_dir/big_2
+
+# Esegue il test senza e con la compressione dei contenuti (decompressi durante l'invio della risposta)
+for compression in 0 1; do
+    # Crea il file di configurazione (16MB in memoria, 8MB con la compressione: i file espulsi vengono
+    # restituiti al client)
+    config_file=~/.file_storage/config.txt
+    echo "SOCKET_FILE_NAME=/tmp/file_storage.sk" > $config_file
+    echo "LOG_FILE_NAME=$HOME/.file_storage/file_storage.log" >> $config_file
+    echo "FILES_MAX_NUM=1000" >> $config_file
+    echo "STORAGE_MAX_SIZE=$((compression ? 8 : 16))" >> $config_file
+    echo "MAX_CONN=16" >> $config_file
+    echo "WORKER_THREADS_NUM=4" >> $config_file
+    echo "COMPRESSION=$compression" >> $config_file
+    
+    # Avvia in background il processo server
+    rm -f /tmp/file_storage.sk
+    ${server_dir}/fsp_server 1> server_out/s_$compression.txt 2> server_err_out/s_$compression.txt &
+    server_pid=$!
+    while ! [ -S /tmp/file_storage.sk ] && kill -0 $server_pid 2> /dev/null; do sleep 0.1; done
+    
+    # Le scritture dei file grandi espellono molti file piccoli e file da 8MB con una sola risposta (più parti
+    # di IOV_MAX e più byte del buffer del socket); alla fine vengono letti i file rimasti sul server
+    rm -fR rejected_files/* downloaded_files/*
+    ${client_dir}/fsp $f_opt -p \
+        -w $files_dir/small -D rejected_files \
+        -W $files_dir/big_1,$files_dir/big_2,$files_dir/big_3 -D rejected_files \
+        -r $files_dir/big_3 -d downloaded_files \
+        -W $files_dir/big_4 -D rejected_files \
+        -R 0 -d downloaded_files \
+        1> clients_out/c_$compression.txt 2> clients_err_out/c_$compression.txt
+    
+    # Ogni file è stato restituito dal server (espulso o letto) ed è uguale all'originale
+    for file in $(find $files_dir -type f); do
+        name=$(echo "${file#/}" | tr / _)
+        if ! [ -e rejected_files/$name ] && ! [ -e downloaded_files/$name ]; then
+            echo "Errore (COMPRESSION=$compression): il file $file non è stato restituito dal server"
+            failed=1
+        fi
+        for downloaded in rejected_files/$name downloaded_files/$name; do
+            if [ -e $downloaded ] && ! cmp -s $file $downloaded; then
+                echo "Errore (COMPRESSION=$compression): il file $downloaded non è uguale all'originale $file"
+                failed=1
+            fi
+        done
+    done
+    if [ $(ls rejected_files | grep -c small) -eq 0 ] || [ $(ls rejected_files | grep -c big) -eq 0 ]; then
+        echo "Errore (COMPRESSION=$compression): il server non ha espulso file piccoli e file grandi"
+        failed=1
+    fi
+    
+    # Invia il segnale SIGHUP al server
+    kill -s HUP $server_pid
+    wait $server_pid
+done
+
+rm -fR $files_dir rejected_files/* downloaded_files/*
+if [ $failed -eq 0 ]; then
+    echo "Test superato"
+else
+    echo "Test fallito"
+    exit 1
+fi
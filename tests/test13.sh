@@ -0,0 +1,102 @@
+#!/bin/bash
+
+client_dir=../client
+server_dir=../server
+
+# Controlla se sono state create tutte le directory necessarie
+if ! [ -d ~/.file_storage ] || ! [ -d clients_out ] || ! [ -d clients_err_out ] || \
+   ! [ -d server_out ] || ! [ -d server_err_out ] || ! [ -d downloaded_files ] || ! [ -d rejected_files ]; then
+    echo "Usare il comando make all prima di eseguire il test"
+    exit 1
+fi
+
+# Controlla che il file /tmp/file_storage.sk non sia già in uso
+if [ -a /tmp/file_storage.sk ]; then
+    echo "Impossibile eseguire il server in quanto il file /tmp/file_storage.sk è già in uso"
+    exit 1
+fi
+
+f_opt="-f /tmp/file_storage.sk"
+files_dir=files/dir_03
+failed=0
+
+# Avvia in background il processo server con scansione dei file scaduti ogni $1 millisecondi (0: nessuna scansione)
+# (l'output dell'avvio n-esimo viene scritto in s_$2.txt)
+start_server() {
+    config_file=~/.file_storage/config.txt
+    echo "SOCKET_FILE_NAME=/tmp/file_storage.sk" > $config_file
+    echo "LOG_FILE_NAME=$HOME/.file_storage/file_storage.log" >> $config_file
+    echo "FILES_MAX_NUM=100" >> $config_file
+    echo "STORAGE_MAX_SIZE=16" >> $config_file
+    echo "MAX_CONN=16" >> $config_file
+    echo "WORKER_THREADS_NUM=4" >> $config_file
+    echo "EXPIRY_SWEEP_INTERVAL=$1" >> $config_file
+    rm -f /tmp/file_storage.sk
+    ${server_dir}/fsp_server 1> server_out/s_$2.txt 2> server_err_out/s_$2.txt &
+    server_pid=$!
+    while ! [ -S /tmp/file_storage.sk ] && kill -0 $server_pid 2> /dev/null; do sleep 0.1; done
+}
+
+# Termina il server e controlla nell'output s_$4.txt il numero dei file scaduti rimossi all'uso ($1) e in background ($2)
+# e dei file con una scadenza al momento della chiusura ($3)
+stop_server() {
+    kill -s HUP $server_pid
+    wait $server_pid
+    rm -f /tmp/file_storage.sk
+    stats=$(grep "File scaduti rimossi" server_out/s_$4.txt | sed 's/.*all.uso: \([0-9]*\), in background: \([0-9]*\)).*chiusura: \([0-9]*\)/\1 \2 \3/')
+    if [ "$stats" != "$1 $2 $3" ]; then
+        echo "Errore ($4): file scaduti rimossi all'uso, in background e file con scadenza: $stats invece di $1 $2 $3"
+        failed=1
+    fi
+}
+
+# Controlla che i file in $1 siano presenti sul server (letti ed elencati) e quelli in $2 no ($3 descrive la fase del test)
+check_files() {
+    for file in $1; do
+        if ! ${client_dir}/fsp $f_opt -p -r ${PWD}/$file 2>> clients_err_out/c.txt | grep -q "letto dal server con successo" || \
+           ! ${client_dir}/fsp $f_opt -p -L ${PWD}/$file 2>> clients_err_out/c.txt | grep -q "^${PWD}/$file "; then
+            echo "Errore ($3): il file $file non è presente sul server"
+            failed=1
+        fi
+    done
+    for file in $2; do
+        if ${client_dir}/fsp $f_opt -p -L ${PWD}/$file 2>> clients_err_out/c.txt | grep -q "^${PWD}/$file " || \
+           ${client_dir}/fsp $f_opt -p -r ${PWD}/$file 2>> clients_err_out/c.txt | grep -q "letto dal server con successo"; then
+            echo "Errore ($3): il file scaduto $file è presente sul server"
+            failed=1
+        fi
+    done
+}
+
+# Scadenza attiva: file_01 e file_02 scadono dopo due secondi, la scadenza di file_03 viene prolungata,
+# quella di file_04 viene rimossa e file_05 non ha una scadenza
+start_server 100 1
+${client_dir}/fsp $f_opt \
+    -W ${files_dir}/file_01.txt,${files_dir}/file_02.txt,${files_dir}/file_03.txt,${files_dir}/file_04.txt -e 2 \
+    -W ${files_dir}/file_05.txt \
+    -T ${PWD}/${files_dir}/file_03.txt -e 30 \
+    -T ${PWD}/${files_dir}/file_04.txt -e 0 \
+    1>> clients_out/c.txt 2>> clients_err_out/c.txt
+check_files "${files_dir}/file_01.txt ${files_dir}/file_02.txt" "" "prima della scadenza"
+sleep 4
+# I file scaduti vengono rimossi dal thread in background senza essere usati
+check_files "${files_dir}/file_03.txt ${files_dir}/file_04.txt ${files_dir}/file_05.txt" \
+    "${files_dir}/file_01.txt ${files_dir}/file_02.txt" "scadenza in background"
+stop_server 0 2 1 1
+
+# Scadenza all'uso: senza scansione il file scaduto viene rimosso quando viene letto
+start_server 0 2
+${client_dir}/fsp $f_opt \
+    -W ${files_dir}/file_01.txt -e 2 \
+    -W ${files_dir}/file_02.txt -e 30 \
+    1>> clients_out/c.txt 2>> clients_err_out/c.txt
+sleep 4
+check_files "${files_dir}/file_02.txt" "${files_dir}/file_01.txt" "scadenza all'uso"
+stop_server 1 0 1 2
+
+if [ $failed -eq 0 ]; then
+    echo "Test superato"
+else
+    echo "Test fallito"
+    exit 1
+fi
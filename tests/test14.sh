@@ -0,0 +1,133 @@
+#!/bin/bash
+
+client_dir=../client
+server_dir=../server
+
+# Controlla se sono state create tutte le directory necessarie
+if ! [ -d ~/.file_storage ] || ! [ -d clients_out ] || ! [ -d clients_err_out ] || \
+   ! [ -d server_out ] || ! [ -d server_err_out ] || ! [ -d downloaded_files ] || ! [ -d rejected_files ]; then
+    echo "Usare il comando make all prima di eseguire il test"
+    exit 1
+fi
+
+# Controlla che il file /tmp/file_storage.sk non sia già in uso
+if [ -a /tmp/file_storage.sk ]; then
+    echo "Impossibile eseguire il server in quanto il file /tmp/file_storage.sk è già in uso"
+    exit 1
+fi
+
+# Il client che tiene aperti i file rimossi scrive le richieste direttamente sul socket con python3
+if ! command -v python3 &> /dev/null; then
+    echo "Python3 non disponibile: il test non verrà eseguito"
+    exit 0
+fi
+
+# Crea i file: 200 file da rimuovere e 100 file da scrivere dopo la rimozione, da 4000 byte (incorporati nei file)
+files_dir=$HOME/.file_storage/pending_files
+rm -fR $files_dir
+mkdir -p $files_dir/removed $files_dir/written
+head -c 800000 /dev/urandom | split -b 4000 -a 3 -d - $files_dir/removed/file_
+head -c 400000 /dev/urandom | split -b 4000 -a 3 -d - $files_dir/written/file_
+
+# Crea il file di configurazione (1MB in memoria)
+config_file=~/.file_storage/config.txt
+echo "SOCKET_FILE_NAME=/tmp/file_storage.sk" > $config_file
+echo "LOG_FILE_NAME=$HOME/.file_storage/file_storage.log" >> $config_file
+echo "FILES_MAX_NUM=1000" >> $config_file
+echo "STORAGE_MAX_SIZE=1" >> $config_file
+echo "MAX_CONN=16" >> $config_file
+echo "WORKER_THREADS_NUM=4" >> $config_file
+echo "INLINE_MAX_SIZE=4096" >> $config_file
+
+# Avvia in background il processo server
+${server_dir}/fsp_server 1> server_out/s.txt 2> server_err_out/s.txt &
+server_pid=$!
+while ! [ -S /tmp/file_storage.sk ] && kill -0 $server_pid 2> /dev/null; do sleep 0.1; done
+
+f_opt="-f /tmp/file_storage.sk"
+failed=0
+
+# Scrive i file da rimuovere, li apre con un altro client e li rimuove mentre sono aperti: il loro contenuto
+# resta in memoria fino alla chiusura, quindi la scrittura dei file successivi ne espelle alcuni
+rm -fR rejected_files/*
+${client_dir}/fsp $f_opt -w $files_dir/removed 1> clients_out/c.txt 2> clients_err_out/c.txt
+python3 - $files_dir <<'EOF' || failed=1
+import os, socket, subprocess, sys
+
+files_dir = sys.argv[1]
+failed = False
+
+def error(msg):
+    global failed
+    print("Errore: " + msg)
+    failed = True
+
+def response(f):
+    line = f.readline()
+    length = b""
+    while not length.endswith(b" "):
+        length += f.read(1)
+    f.read(int(length) + 2)
+    return int(line.split(b" ", 1)[0])
+
+def request(cmd, arg):
+    s.sendall(cmd.encode() + b" " + arg.encode() + b"\r\n0 \r\n")
+    return response(f)
+
+def fsp(*args):
+    with open("clients_out/c.txt", "a") as out, open("clients_err_out/c.txt", "a") as err:
+        subprocess.call(["../client/fsp", "-f", "/tmp/file_storage.sk"] + list(args), stdout=out, stderr=err)
+
+s = socket.socket(socket.AF_UNIX)
+s.settimeout(10)
+s.connect("/tmp/file_storage.sk")
+f = s.makefile("rb")
+response(f)
+
+removed = sorted(files_dir + "/removed/" + name for name in os.listdir(files_dir + "/removed"))
+for path in removed:
+    if request("OPEN", path) != 200:
+        error("impossibile aprire il file " + path)
+
+fsp("-c", ",".join(removed))
+fsp("-w", files_dir + "/written", "-D", "rejected_files")
+
+for path in removed:
+    request("CLOSE", path)
+request("QUIT", "")
+s.close()
+sys.exit(1 if failed else 0)
+EOF
+
+# Dopo la chiusura il contenuto dei file rimossi viene liberato: i file successivi possono essere scritti
+${client_dir}/fsp $f_opt -w $files_dir/written 1>> clients_out/c.txt 2>> clients_err_out/c.txt
+
+# Invia il segnale SIGHUP al server
+kill -s HUP $server_pid
+wait $server_pid
+
+if [ -z "$(ls rejected_files)" ]; then
+    echo "Errore: la scrittura dei file non ha espulso file nonostante il contenuto dei file rimossi ancora aperti"
+    failed=1
+fi
+max_size=$(grep "Dimensione massima raggiunta dal file storage" server_out/s.txt | awk '{print $(NF-1)}')
+if [ -z "$max_size" ] || awk -v size="$max_size" 'BEGIN { exit !(size > 1) }'; then
+    echo "Errore: la memoria occupata dai file ($max_size MB) ha superato STORAGE_MAX_SIZE"
+    failed=1
+fi
+if ! grep -q "File rimossi mentre erano aperti: 200 (memoria massima occupata in attesa della chiusura: 800000 bytes)" server_out/s.txt; then
+    echo "Errore: il server non ha contato i file rimossi mentre erano aperti"
+    failed=1
+fi
+if ! grep -q "File contenuti nello storage al momento della chiusura del server: 100$" server_out/s.txt; then
+    echo "Errore: i file scritti dopo la chiusura dei file rimossi non sono presenti sul server"
+    failed=1
+fi
+
+rm -fR $files_dir rejected_files/*
+if [ $failed -eq 0 ]; then
+    echo "Test superato"
+else
+    echo "Test fallito"
+    exit 1
+fi
@@ -0,0 +1,163 @@
+#!/bin/bash
+
+client_dir=../client
+server_dir=../server
+
+# Controlla se sono state create tutte le directory necessarie
+if ! [ -d ~/.file_storage ] || ! [ -d clients_out ] || ! [ -d clients_err_out ] || \
+   ! [ -d server_out ] || ! [ -d server_err_out ] || ! [ -d downloaded_files ] || ! [ -d rejected_files ]; then
+    echo "Usare il comando make all prima di eseguire il test"
+    exit 1
+fi
+
+# Controlla che il file /tmp/file_storage.sk non sia già in uso
+if [ -a /tmp/file_storage.sk ]; then
+    echo "Impossibile eseguire il server in quanto il file /tmp/file_storage.sk è già in uso"
+    exit 1
+fi
+
+# I messaggi binari vengono scritti direttamente sul socket con python3
+if ! command -v python3 &> /dev/null; then
+    echo "Python3 non disponibile: il test non verrà eseguito"
+    exit 0
+fi
+
+# Crea il file di configurazione
+config_file=~/.file_storage/config.txt
+echo "SOCKET_FILE_NAME=/tmp/file_storage.sk" > $config_file
+echo "LOG_FILE_NAME=$HOME/.file_storage/file_storage.log" >> $config_file
+echo "FILES_MAX_NUM=100" >> $config_file
+echo "STORAGE_MAX_SIZE=16" >> $config_file
+echo "MAX_CONN=16" >> $config_file
+echo "WORKER_THREADS_NUM=4" >> $config_file
+
+# Avvia in background il processo server
+${server_dir}/fsp_server 1> server_out/s.txt 2> server_err_out/s.txt &
+server_pid=$!
+while ! [ -S /tmp/file_storage.sk ] && kill -0 $server_pid 2> /dev/null; do sleep 0.1; done
+
+f_opt="-f /tmp/file_storage.sk"
+files_dir=files/dir_03
+
+# Scrive i file letti con i messaggi binari
+${client_dir}/fsp $f_opt -W ${files_dir}/file_01.txt,${files_dir}/file_02.txt 1> clients_out/c.txt 2> clients_err_out/c.txt
+
+python3 - ${PWD}/${files_dir} <<'EOF'
+import socket, struct, sys
+
+# Intestazione: magic, versione, codice, flags, identificativo, lunghezza dell'argomento ('\0' compreso) e dei dati
+HEADER = "!BBHIIII"
+CLOSE, LIST, OPEN, QUIT, READ = 2, 3, 5, 9, 10
+files_dir = sys.argv[1]
+failed = False
+
+def error(msg):
+    global failed
+    print("Errore: " + msg)
+    failed = True
+
+def connect():
+    s = socket.socket(socket.AF_UNIX)
+    s.settimeout(5)
+    s.connect("/tmp/file_storage.sk")
+    greeting = b""
+    while not greeting.endswith(b"\r\n0 \r\n"):
+        greeting += s.recv(256)
+    if b"FSP/2" not in greeting:
+        error("il server non annuncia la versione 2 del protocollo")
+    return s
+
+def request(opcode, id, arg, data=b""):
+    arg = arg.encode() + b"\0"
+    return struct.pack(HEADER, 0xF5, 2, opcode, 0, id, len(arg), len(data)) + arg + data
+
+def recv_exact(s, n):
+    buf = b""
+    while len(buf) < n:
+        chunk = s.recv(n - len(buf))
+        if not chunk:
+            return None
+        buf += chunk
+    return buf
+
+def response(s):
+    header = recv_exact(s, 20)
+    if header is None:
+        return None
+    magic, version, code, flags, id, descr_len, data_len = struct.unpack(HEADER, header)
+    if magic != 0xF5 or version != 2 or flags != 0:
+        error("intestazione della risposta non valida")
+    body = recv_exact(s, descr_len + data_len)
+    return code, id, body[descr_len:]
+
+def closed(s):
+    try:
+        return s.recv(1) == b""
+    except (ConnectionResetError, socket.timeout):
+        return True
+
+file_01 = files_dir + "/file_01.txt"
+file_02 = files_dir + "/file_02.txt"
+content_01 = open(file_01, "rb").read()
+
+# Richiesta e risposta binarie: la risposta usa l'identificativo della richiesta e contiene il file
+# nel formato del campo data ("PATHNAME SIZE DATA ")
+s = connect()
+s.sendall(request(OPEN, 7, file_01))
+if response(s)[:2] != (200, 7):
+    error("OPEN non eseguita con identificativo 7")
+s.sendall(request(READ, 8, file_01))
+code, id, data = response(s)
+if (code, id) != (200, 8) or data != b"%s %d %s " % (file_01.encode(), len(content_01), content_01):
+    error("READ non restituisce il contenuto del file con identificativo 8")
+
+# Una richiesta inviata un byte alla volta viene letta per intero
+for byte in request(CLOSE, 9, file_01):
+    s.send(bytes([byte]))
+if response(s)[:2] != (200, 9):
+    error("richiesta inviata un byte alla volta non eseguita")
+
+# Due richieste inviate con una sola scrittura vengono eseguite entrambe
+s.sendall(request(OPEN, 10, file_02) + request(LIST, 11, "0 %d %s" % (len(files_dir), files_dir)))
+first, second = response(s), response(s)
+if sorted([first[1], second[1]]) != [10, 11] or first[0] != 200 or second[0] != 200:
+    error("richieste inviate insieme non eseguite entrambe")
+
+# Un codice di comando sconosciuto e un argomento non terminato da '\0' vengono rifiutati con 501 e con
+# l'identificativo della richiesta, senza chiudere la connessione
+s.sendall(struct.pack(HEADER, 0xF5, 2, 99, 0, 12, 1, 0) + b"\0")
+if response(s)[:2] != (501, 12):
+    error("codice di comando sconosciuto non rifiutato con identificativo 12")
+s.sendall(struct.pack(HEADER, 0xF5, 2, OPEN, 0, 13, 3, 0) + b"abc")
+if response(s)[:2] != (501, 13):
+    error("argomento non terminato non rifiutato con identificativo 13")
+s.sendall(request(QUIT, 14, ""))
+if response(s)[:2] != (221, 14):
+    error("la connessione non resta utilizzabile dopo un messaggio rifiutato")
+s.close()
+
+# Una lunghezza oltre il massimo (o un argomento vuoto) rende impossibile delimitare i messaggi successivi:
+# il server risponde 501 con l'identificativo della richiesta e chiude la connessione
+for id, arg_len in ((15, 0x7FFFFFFF), (16, 0)):
+    s = connect()
+    s.sendall(struct.pack(HEADER, 0xF5, 2, OPEN, 0, id, arg_len, 0) + b"x" * 16)
+    if response(s)[:2] != (501, id):
+        error("lunghezza non valida (%d) non rifiutata con identificativo %d" % (arg_len, id))
+    if not closed(s):
+        error("connessione non chiusa dopo un'intestazione non valida")
+    s.close()
+
+sys.exit(1 if failed else 0)
+EOF
+failed=$?
+
+# Invia il segnale SIGHUP al server
+kill -s HUP $server_pid
+wait $server_pid
+
+if [ $failed -eq 0 ]; then
+    echo "Test superato"
+else
+    echo "Test fallito"
+    exit 1
+fi
@@ -0,0 +1,150 @@
+#!/bin/bash
+
+client_dir=../client
+server_dir=../server
+
+# Controlla se sono state create tutte le directory necessarie
+if ! [ -d ~/.file_storage ] || ! [ -d clients_out ] || ! [ -d clients_err_out ] || \
+   ! [ -d server_out ] || ! [ -d server_err_out ] || ! [ -d downloaded_files ] || ! [ -d rejected_files ]; then
+    echo "Usare il comando make all prima di eseguire il test"
+    exit 1
+fi
+
+# Controlla che il file /tmp/file_storage.sk non sia già in uso
+if [ -a /tmp/file_storage.sk ]; then
+    echo "Impossibile eseguire il server in quanto il file /tmp/file_storage.sk è già in uso"
+    exit 1
+fi
+
+# I messaggi binari vengono scritti direttamente sul socket con python3
+if ! command -v python3 &> /dev/null; then
+    echo "Python3 non disponibile: il test non verrà eseguito"
+    exit 0
+fi
+
+# Crea il file di configurazione
+config_file=~/.file_storage/config.txt
+echo "SOCKET_FILE_NAME=/tmp/file_storage.sk" > $config_file
+echo "LOG_FILE_NAME=$HOME/.file_storage/file_storage.log" >> $config_file
+echo "FILES_MAX_NUM=100" >> $config_file
+echo "STORAGE_MAX_SIZE=16" >> $config_file
+echo "MAX_CONN=16" >> $config_file
+echo "WORKER_THREADS_NUM=4" >> $config_file
+
+# Avvia in background il processo server
+${server_dir}/fsp_server 1> server_out/s.txt 2> server_err_out/s.txt &
+server_pid=$!
+while ! [ -S /tmp/file_storage.sk ] && kill -0 $server_pid 2> /dev/null; do sleep 0.1; done
+
+
+f_opt="-f /tmp/file_storage.sk"
+files_dir=files/dir_03
+
+# Scrive i file usati dai client
+${client_dir}/fsp $f_opt -W ${files_dir}/file_01.txt,${files_dir}/file_02.txt 1> clients_out/c.txt 2> clients_err_out/c.txt
+
+python3 - ${PWD}/${files_dir} <<'EOF'
+import socket, struct, sys, time
+
+HEADER = "!BBHIIII"
+CLOSE, LOCK, OPEN, OPENL, QUIT, READ, UNLOCK = 2, 4, 5, 8, 9, 10, 14
+files_dir = sys.argv[1]
+failed = False
+
+def error(msg):
+    global failed
+    print("Errore: " + msg)
+    failed = True
+
+def connect():
+    s = socket.socket(socket.AF_UNIX)
+    s.settimeout(10)
+    s.connect("/tmp/file_storage.sk")
+    greeting = b""
+    while not greeting.endswith(b"\r\n0 \r\n"):
+        greeting += s.recv(256)
+    return s
+
+def request(opcode, id, arg):
+    arg = arg.encode() + b"\0"
+    return struct.pack(HEADER, 0xF5, 2, opcode, 0, id, len(arg), 0) + arg
+
+def recv_exact(s, n):
+    buf = b""
+    while len(buf) < n:
+        chunk = s.recv(n - len(buf))
+        if not chunk:
+            raise ConnectionError
+        buf += chunk
+    return buf
+
+# Restituisce (identificativo, codice) della prossima risposta (None se non arriva entro il timeout)
+def response(s):
+    try:
+        magic, version, code, flags, id, descr_len, data_len = struct.unpack(HEADER, recv_exact(s, 20))
+        recv_exact(s, descr_len + data_len)
+    except socket.timeout:
+        return None
+    return id, code
+
+# Invia le richieste insieme e controlla il codice della risposta a ciascuna
+def call(s, *reqs):
+    s.sendall(b"".join(request(op, id, arg) for op, id, arg, code in reqs))
+    for op, id, arg, code in reqs:
+        if response(s) != (id, code):
+            error("risposta inattesa alla richiesta %d" % id)
+
+file_01 = files_dir + "/file_01.txt"
+file_02 = files_dir + "/file_02.txt"
+a, b = connect(), connect()
+call(a, (OPENL, 1, file_01, 200))
+call(b, (OPEN, 1, file_01, 200), (OPEN, 2, file_02, 200))
+
+# b attende la lock di file_01 detenuta da a: le letture inviate dopo la LOCK vengono eseguite e ricevono
+# risposta prima di essa, che viene completata quando a rilascia la lock
+b.sendall(request(LOCK, 10, file_01) + b"".join(request(READ, id, file_02) for id in range(11, 31)))
+resps = [response(b) for id in range(11, 31)]
+if resps != [(id, 200) for id in range(11, 31)]:
+    error("le letture successive alla LOCK in attesa non ricevono risposta (o non nell'ordine di invio)")
+call(a, (UNLOCK, 2, file_01, 200))
+if response(b) != (10, 200):
+    error("la LOCK in attesa non viene completata dopo il rilascio della lock")
+
+# a attende la lock detenuta da b e chiude il file: la LOCK in attesa viene annullata con codice 556
+a.sendall(request(LOCK, 3, file_01) + request(CLOSE, 4, file_01))
+if {response(a), response(a)} != {(3, 556), (4, 200)}:
+    error("la LOCK in attesa non viene annullata dalla chiusura del file")
+
+# a attende la lock detenuta da b che termina la connessione: la lock passa ad a
+call(a, (OPEN, 5, file_01, 200))
+a.sendall(request(LOCK, 6, file_01))
+time.sleep(0.5)
+call(b, (QUIT, 31, "", 221))
+if response(a) != (6, 200):
+    error("la LOCK in attesa non viene completata dopo la disconnessione del client che detiene la lock")
+b.close()
+
+# c non attende la lock per più di LOCK_WAIT_MAX_TIME secondi
+c = connect()
+call(c, (OPEN, 1, file_01, 200))
+start = time.time()
+c.sendall(request(LOCK, 2, file_01))
+if response(c) != (2, 556) or time.time() - start < 3:
+    error("la LOCK in attesa non scade")
+call(c, (QUIT, 3, "", 221))
+call(a, (QUIT, 7, "", 221))
+
+sys.exit(1 if failed else 0)
+EOF
+failed=$?
+
+# Invia il segnale SIGHUP al server
+kill -s HUP $server_pid
+wait $server_pid
+
+if [ $failed -eq 0 ]; then
+    echo "Test superato"
+else
+    echo "Test fallito"
+    exit 1
+fi
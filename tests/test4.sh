@@ -0,0 +1,155 @@
+#!/bin/bash
+
+client_dir=../client
+server_dir=../server
+
+# Controlla se sono state create tutte le directory necessarie
+if ! [ -d ~/.file_storage ] || ! [ -d clients_out ] || ! [ -d clients_err_out ] || \
+   ! [ -d server_out ] || ! [ -d server_err_out ] || ! [ -d downloaded_files ] || ! [ -d rejected_files ]; then
+    echo "Usare il comando make all prima di eseguire il test"
+    exit 1
+fi
+
+# Controlla che il file /tmp/file_storage.sk non sia già in uso
+if [ -a /tmp/file_storage.sk ]; then
+    echo "Impossibile eseguire il server in quanto il file /tmp/file_storage.sk è già in uso"
+    exit 1
+fi
+
+# Le richieste APPEND vengono scritte direttamente sul socket con python3 (il client fsp non le esegue)
+if ! command -v python3 &> /dev/null; then
+    echo "Python3 non disponibile: il test non verrà eseguito"
+    exit 0
+fi
+
+# Crea il file di configurazione (contenuti dei file compressi in memoria)
+config_file=~/.file_storage/config.txt
+echo "SOCKET_FILE_NAME=/tmp/file_storage.sk" > $config_file
+echo "LOG_FILE_NAME=$HOME/.file_storage/file_storage.log" >> $config_file
+echo "FILES_MAX_NUM=100" >> $config_file
+echo "STORAGE_MAX_SIZE=32" >> $config_file
+echo "MAX_CONN=16" >> $config_file
+echo "WORKER_THREADS_NUM=4" >> $config_file
+echo "COMPRESSION=1" >> $config_file
+
+# Avvia in background il processo server
+${server_dir}/fsp_server 1> server_out/s.txt 2> server_err_out/s.txt &
+server_pid=$!
+while ! [ -S /tmp/file_storage.sk ] && kill -0 $server_pid 2> /dev/null; do sleep 0.1; done
+
+f_opt="-f /tmp/file_storage.sk"
+files_dir=${PWD}/downloaded_files/compressed
+failed=0
+
+# Scrive i file e vi accoda i dati con messaggi di testo scritti sul socket; il contenuto atteso di ogni file
+# viene scritto in files_dir (la dimensione totale dei file viene stampata alla fine)
+rm -fR downloaded_files/*
+mkdir $files_dir
+raw_size=$(python3 - $files_dir <<'EOF'
+import os, socket, sys
+
+files_dir = sys.argv[1]
+failed = False
+
+def error(msg):
+    global failed
+    print("Errore: " + msg, file=sys.stderr)
+    failed = True
+
+def response(f):
+    line = f.readline()
+    length = b""
+    while not length.endswith(b" "):
+        length += f.read(1)
+    data = f.read(int(length) + 2)
+    return int(line.split(b" ", 1)[0]), data[:-2]
+
+# Il campo data delle richieste WRITE e APPEND contiene il nome del file, la dimensione e il contenuto
+def file_data(path, data):
+    return path.encode() + b" " + str(len(data)).encode() + b" " + data + b" "
+
+def request(s, f, cmd, arg, data=b""):
+    s.sendall(cmd.encode() + b" " + arg.encode() + b"\r\n" + str(len(data)).encode() + b" " + data + b"\r\n")
+    return response(f)
+
+s = socket.socket(socket.AF_UNIX)
+s.settimeout(10)
+s.connect("/tmp/file_storage.sk")
+f = s.makefile("rb")
+response(f)
+
+# Contenuto comprimibile (righe di testo simili) e non comprimibile (byte casuali)
+def text(n, start):
+    out = b""
+    i = start
+    while len(out) < n:
+        out += ("riga %06d del file di prova del server con la compressione attiva\n" % i).encode()
+        i += 1
+    return out[:n]
+
+# file_1: contenuto piccolo con molte APPEND (il contenuto viene ricompresso ogni volta che raddoppia)
+# file_2: contenuto grande con poche APPEND, anche di byte casuali
+# file_3: contenuto non comprimibile a cui vengono accodate righe di testo
+files = {
+    "file_1.txt": (text(4096, 0), [text(8192, 100*i) for i in range(96)]),
+    "file_2.txt": (text(2*1048576, 0), [text(65536, 7), os.urandom(4096), text(65536, 9)]),
+    "file_3.bin": (os.urandom(262144), [text(16384, i) for i in range(8)]),
+}
+total = 0
+for name, (data, appends) in files.items():
+    path = files_dir + "/" + name
+    if request(s, f, "OPENCL", path)[0] != 200 or request(s, f, "WRITE", path, file_data(path, data))[0] != 200:
+        error("impossibile scrivere il file " + path)
+        continue
+    for chunk in appends:
+        if request(s, f, "APPEND", path, file_data(path, chunk))[0] != 200:
+            error("impossibile accodare i dati al file " + path)
+        data += chunk
+    request(s, f, "CLOSE", path)
+    with open(path, "wb") as out:
+        out.write(data)
+    total += len(data)
+request(s, f, "QUIT", "")
+s.close()
+
+print(total)
+sys.exit(1 if failed else 0)
+EOF
+) || failed=1
+
+# Legge i file uno alla volta (READ) e tutti insieme (READN) e li confronta con i contenuti attesi
+files=$(ls -d ${files_dir}/* | paste -s -d ,)
+for cmd in r R; do
+    rm -fR downloaded_files/read
+    mkdir downloaded_files/read
+    if [ $cmd = r ]; then
+        ${client_dir}/fsp $f_opt -p -r $files -d downloaded_files/read 1>> clients_out/c.txt 2>> clients_err_out/c.txt
+    else
+        ${client_dir}/fsp $f_opt -p -R 0 -d downloaded_files/read 1>> clients_out/c.txt 2>> clients_err_out/c.txt
+    fi
+    for file in ${files_dir}/*; do
+        if ! cmp -s $file downloaded_files/read/$(echo "${file#/}" | tr / _); then
+            echo "Errore (-$cmd): il file $file letto dal server non è uguale al contenuto scritto"
+            failed=1
+        fi
+    done
+done
+
+# Invia il segnale SIGHUP al server
+kill -s HUP $server_pid
+wait $server_pid
+
+# I contenuti di testo vengono memorizzati compressi: la memoria occupata è inferiore alla dimensione dei file
+max_size=$(grep "Dimensione massima raggiunta dal file storage" server_out/s.txt | awk '{print $(NF-1)}')
+if [ -z "$raw_size" ] || awk -v size="$max_size" -v raw="$raw_size" 'BEGIN { exit !(size*1048576 > raw*0.75) }'; then
+    echo "Errore: la memoria occupata dai file ($max_size MB) non è inferiore alla loro dimensione ($raw_size byte)"
+    failed=1
+fi
+
+rm -fR downloaded_files/*
+if [ $failed -eq 0 ]; then
+    echo "Test superato"
+else
+    echo "Test fallito"
+    exit 1
+fi
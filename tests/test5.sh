@@ -0,0 +1,147 @@
+#!/bin/bash
+
+client_dir=../client
+server_dir=../server
+
+# Controlla se sono state create tutte le directory necessarie
+if ! [ -d ~/.file_storage ] || ! [ -d clients_out ] || ! [ -d clients_err_out ] || \
+   ! [ -d server_out ] || ! [ -d server_err_out ] || ! [ -d downloaded_files ] || ! [ -d rejected_files ]; then
+    echo "Usare il comando make all prima di eseguire il test"
+    exit 1
+fi
+
+# Controlla che il file /tmp/file_storage.sk non sia già in uso
+if [ -a /tmp/file_storage.sk ]; then
+    echo "Impossibile eseguire il server in quanto il file /tmp/file_storage.sk è già in uso"
+    exit 1
+fi
+
+# Le richieste APPEND vengono scritte direttamente sul socket con python3 (il client fsp non le esegue)
+if ! command -v python3 &> /dev/null; then
+    echo "Python3 non disponibile: il test non verrà eseguito"
+    exit 0
+fi
+
+failed=0
+
+# Esegue il test senza e con la compressione dei contenuti
+for compression in 0 1; do
+    # Crea il file di configurazione
+    config_file=~/.file_storage/config.txt
+    echo "SOCKET_FILE_NAME=/tmp/file_storage.sk" > $config_file
+    echo "LOG_FILE_NAME=$HOME/.file_storage/file_storage.log" >> $config_file
+    echo "FILES_MAX_NUM=100" >> $config_file
+    echo "STORAGE_MAX_SIZE=32" >> $config_file
+    echo "MAX_CONN=16" >> $config_file
+    echo "WORKER_THREADS_NUM=4" >> $config_file
+    echo "COMPRESSION=$compression" >> $config_file
+    
+    # Avvia in background il processo server
+    rm -f /tmp/file_storage.sk
+    ${server_dir}/fsp_server 1> server_out/s_$compression.txt 2> server_err_out/s_$compression.txt &
+    server_pid=$!
+    while ! [ -S /tmp/file_storage.sk ] && kill -0 $server_pid 2> /dev/null; do sleep 0.1; done
+    
+    # Scrive quattro file con lo stesso contenuto (condiviso sul server), poi rimuove alcuni file e accoda dati
+    # agli altri controllando dopo ogni passo che il contenuto dei file rimanenti non sia cambiato
+    python3 - $compression <<'EOF' || failed=1
+import os, socket, sys
+
+failed = False
+
+def error(msg):
+    global failed
+    print("Errore (COMPRESSION=%s): %s" % (sys.argv[1], msg))
+    failed = True
+
+def response(f):
+    line = f.readline()
+    length = b""
+    while not length.endswith(b" "):
+        length += f.read(1)
+    data = f.read(int(length) + 2)
+    return int(line.split(b" ", 1)[0]), data[:-2]
+
+# Il campo data delle richieste WRITE e APPEND e delle risposte a READ contiene il nome del file,
+# la dimensione e il contenuto
+def file_data(path, data):
+    return path.encode() + b" " + str(len(data)).encode() + b" " + data + b" "
+
+def request(cmd, arg, data=b""):
+    s.sendall(cmd.encode() + b" " + arg.encode() + b"\r\n" + str(len(data)).encode() + b" " + data + b"\r\n")
+    return response(f)
+
+def check(step):
+    for path, data in sorted(files.items()):
+        request("OPEN", path)
+        code, resp = request("READ", path)
+        request("CLOSE", path)
+        fields = resp.split(b" ", 2)
+        if code != 200 or len(fields) != 3 or fields[2][:int(fields[1])] != data:
+            error("%s: il contenuto del file %s non è quello atteso" % (step, path))
+
+s = socket.socket(socket.AF_UNIX)
+s.settimeout(10)
+s.connect("/tmp/file_storage.sk")
+f = s.makefile("rb")
+response(f)
+
+# Contenuto non comprimibile e contenuto di testo
+content = os.urandom(1048576) if sys.argv[1] == "0" else b"riga del file condiviso\n"*40000
+files = {}
+for name in ("a", "b", "c", "d"):
+    path = "/fsp_dedup/" + name
+    if request("OPENCL", path)[0] != 200 or request("WRITE", path, file_data(path, content))[0] != 200:
+        error("impossibile scrivere il file " + path)
+    request("CLOSE", path)
+    files[path] = content
+check("scrittura")
+
+def remove(path):
+    request("OPENL", path)
+    if request("REMOVE", path)[0] != 200:
+        error("impossibile rimuovere il file " + path)
+    del files[path]
+
+def append(path, data):
+    request("OPEN", path)
+    if request("APPEND", path, file_data(path, data))[0] != 200:
+        error("impossibile accodare i dati al file " + path)
+    request("CLOSE", path)
+    files[path] += data
+
+remove("/fsp_dedup/c")
+check("rimozione di c")
+append("/fsp_dedup/b", b"dati accodati a b\n"*64)
+check("APPEND su b")
+remove("/fsp_dedup/d")
+check("rimozione di d")
+append("/fsp_dedup/a", b"dati accodati ad a\n"*64)
+check("APPEND su a")
+remove("/fsp_dedup/b")
+check("rimozione di b")
+
+request("QUIT", "")
+s.close()
+sys.exit(1 if failed else 0)
+EOF
+    
+    # Invia il segnale SIGHUP al server
+    kill -s HUP $server_pid
+    wait $server_pid
+    
+    # Il contenuto condiviso viene memorizzato una sola volta (4MB senza deduplicazione)
+    max_size=$(grep "Dimensione massima raggiunta dal file storage" server_out/s_$compression.txt | awk '{print $(NF-1)}')
+    if awk -v size="$max_size" 'BEGIN { exit !(size >= 3) }'; then
+        echo "Errore (COMPRESSION=$compression): la memoria occupata dai file ($max_size MB) non tiene conto dei contenuti condivisi"
+        failed=1
+    fi
+done
+
+rm -f /tmp/file_storage.sk
+if [ $failed -eq 0 ]; then
+    echo "Test superato"
+else
+    echo "Test fallito"
+    exit 1
+fi
@@ -0,0 +1,117 @@
+#!/bin/bash
+
+client_dir=../client
+server_dir=../server
+
+# Controlla se sono state create tutte le directory necessarie
+if ! [ -d ~/.file_storage ] || ! [ -d clients_out ] || ! [ -d clients_err_out ] || \
+   ! [ -d server_out ] || ! [ -d server_err_out ] || ! [ -d downloaded_files ] || ! [ -d rejected_files ]; then
+    echo "Usare il comando make all prima di eseguire il test"
+    exit 1
+fi
+
+# Controlla che il file /tmp/file_storage.sk non sia già in uso
+if [ -a /tmp/file_storage.sk ]; then
+    echo "Impossibile eseguire il server in quanto il file /tmp/file_storage.sk è già in uso"
+    exit 1
+fi
+
+# Crea il file di configurazione (contenuti dei file e record nell'arena mappata dal file arena_file)
+arena_file=$HOME/.file_storage/arena
+rm -f $arena_file
+config_file=~/.file_storage/config.txt
+write_config() {
+    echo "SOCKET_FILE_NAME=/tmp/file_storage.sk" > $config_file
+    echo "LOG_FILE_NAME=$HOME/.file_storage/file_storage.log" >> $config_file
+    echo "FILES_MAX_NUM=100" >> $config_file
+    echo "STORAGE_MAX_SIZE=32" >> $config_file
+    echo "MAX_CONN=16" >> $config_file
+    echo "WORKER_THREADS_NUM=4" >> $config_file
+    echo "COMPRESSION=$1" >> $config_file
+    echo "ARENA_FILE_NAME=$arena_file" >> $config_file
+}
+
+f_opt="-f /tmp/file_storage.sk"
+files_dir_01=files/dir_01
+files_dir_02=files/dir_02
+files_dir_03=files/dir_03
+failed=0
+
+# Avvia in background il processo server (l'output dell'avvio n-esimo viene scritto in s_n.txt)
+start_server() {
+    rm -f /tmp/file_storage.sk
+    ${server_dir}/fsp_server 1> server_out/s_$1.txt 2> server_err_out/s_$1.txt &
+    server_pid=$!
+    while ! [ -S /tmp/file_storage.sk ] && kill -0 $server_pid 2> /dev/null; do sleep 0.1; done
+}
+
+# Termina il server (SIGHUP: l'arena viene chiusa correttamente, SIGKILL: l'arena resta aperta)
+stop_server() {
+    kill -s $1 $server_pid
+    wait $server_pid
+} 2> /dev/null
+
+# Legge tutti i file dal server e controlla che i file in $1 siano uguali agli originali e che non siano presenti
+# altri file ($2 descrive la fase del test)
+check_files() {
+    rm -fR downloaded_files/*
+    ${client_dir}/fsp $f_opt -R 0 -d downloaded_files 1>> clients_out/c.txt 2>> clients_err_out/c.txt
+    for file in $1; do
+        if ! cmp -s $file downloaded_files/$(echo "${file#/}" | tr / _); then
+            echo "Errore ($2): il file $file non è stato ripristinato correttamente"
+            failed=1
+        fi
+    done
+    if [ $(ls downloaded_files | wc -l) -ne $(echo $1 | wc -w) ]; then
+        echo "Errore ($2): il server contiene $(ls downloaded_files | wc -l) file invece di $(echo $1 | wc -w)"
+        failed=1
+    fi
+}
+
+# Scrive i file e ne rimuove uno, poi termina il server chiudendo l'arena
+write_config 0
+start_server 1
+${client_dir}/fsp $f_opt \
+    -w ${files_dir_01} -t 0 \
+    -w ${files_dir_03} -t 0 \
+    -c ${PWD}/${files_dir_01}/us.png \
+    1> clients_out/c.txt 2> clients_err_out/c.txt
+stop_server HUP
+
+written=$(ls -d ${PWD}/${files_dir_01}/* ${PWD}/${files_dir_03}/* | grep -v -x ${PWD}/${files_dir_01}/us.png)
+
+# I file vengono ripristinati dall'arena (anche con la compressione attiva), poi vengono scritti altri file
+write_config 1
+start_server 2
+check_files "$written" "primo riavvio"
+${client_dir}/fsp $f_opt \
+    -w ${files_dir_02} -t 0 \
+    -c ${PWD}/${files_dir_03}/file_02.txt \
+    1>> clients_out/c.txt 2>> clients_err_out/c.txt
+stop_server HUP
+
+written="$(echo "$written" | grep -v -x ${PWD}/${files_dir_03}/file_02.txt) $(ls -d ${PWD}/${files_dir_02}/*)"
+
+start_server 3
+check_files "$written" "secondo riavvio"
+
+# Un'arena non chiusa correttamente (SIGKILL) non viene ripristinata
+stop_server KILL
+start_server 4
+check_files "" "riavvio dopo SIGKILL"
+${client_dir}/fsp $f_opt -w ${files_dir_02} -t 0 1>> clients_out/c.txt 2>> clients_err_out/c.txt
+stop_server HUP
+
+# Un'arena troncata (i file scritti occupano più di 1MB) non viene ripristinata
+truncate -s 1M $arena_file
+start_server 5
+check_files "" "riavvio con l'arena troncata"
+stop_server HUP
+
+rm -f $arena_file
+if [ $failed -eq 0 ]; then
+    echo "Test superato"
+else
+    echo "Test fallito"
+    exit 1
+fi
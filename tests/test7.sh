@@ -0,0 +1,90 @@
+#!/bin/bash
+
+client_dir=../client
+server_dir=../server
+
+# Controlla se sono state create tutte le directory necessarie
+if ! [ -d ~/.file_storage ] || ! [ -d clients_out ] || ! [ -d clients_err_out ] || \
+   ! [ -d server_out ] || ! [ -d server_err_out ] || ! [ -d downloaded_files ] || ! [ -d rejected_files ]; then
+    echo "Usare il comando make all prima di eseguire il test"
+    exit 1
+fi
+
+# Controlla che il file /tmp/file_storage.sk non sia già in uso
+if [ -a /tmp/file_storage.sk ]; then
+    echo "Impossibile eseguire il server in quanto il file /tmp/file_storage.sk è già in uso"
+    exit 1
+fi
+
+# Crea il file di configurazione (1MB in memoria, i file espulsi vengono scritti nel tier su disco)
+tier_dir=$HOME/.file_storage/tier
+rm -fR $tier_dir
+config_file=~/.file_storage/config.txt
+echo "SOCKET_FILE_NAME=/tmp/file_storage.sk" > $config_file
+echo "LOG_FILE_NAME=$HOME/.file_storage/file_storage.log" >> $config_file
+echo "FILES_MAX_NUM=100" >> $config_file
+echo "STORAGE_MAX_SIZE=1" >> $config_file
+echo "MAX_CONN=16" >> $config_file
+echo "WORKER_THREADS_NUM=4" >> $config_file
+echo "TIER_DIR_NAME=$tier_dir" >> $config_file
+echo "TIER_MAX_SIZE=64" >> $config_file
+
+# Avvia in background il processo server
+${server_dir}/fsp_server 1> server_out/s.txt 2> server_err_out/s.txt &
+server_pid=$!
+while ! [ -S /tmp/file_storage.sk ] && kill -0 $server_pid 2> /dev/null; do sleep 0.1; done
+
+f_opt="-f /tmp/file_storage.sk"
+files_dir_02=files/dir_02
+failed=0
+
+# Scrive 3.5MB di file: quelli espulsi dalla memoria vengono scritti nel tier e non restituiti al client
+rm -fR rejected_files/*
+${client_dir}/fsp $f_opt -p \
+    -w ${files_dir_02} -D rejected_files \
+    1> clients_out/c.txt 2> clients_err_out/c.txt
+if [ -n "$(ls rejected_files)" ]; then
+    echo "Errore: i file espulsi sono stati restituiti al client invece di essere scritti nel tier"
+    failed=1
+fi
+
+# Legge due volte tutti i file (quelli nel tier vengono riportati in memoria) e li confronta con gli originali
+files=$(ls -d ${PWD}/${files_dir_02}/* | paste -s -d ,)
+for pass in 1 2; do
+    rm -fR downloaded_files/*
+    ${client_dir}/fsp $f_opt -p \
+        -r $files -d downloaded_files \
+        1>> clients_out/c.txt 2>> clients_err_out/c.txt
+    for file in ${PWD}/${files_dir_02}/*; do
+        if ! cmp -s $file downloaded_files/$(echo "${file#/}" | tr / _); then
+            echo "Errore (lettura $pass): il file $file letto dal server non è uguale all'originale"
+            failed=1
+        fi
+    done
+done
+
+# Invia il segnale SIGHUP al server
+kill -s HUP $server_pid
+wait $server_pid
+
+if [ $(grep -c SPILLED_FILE server_out/s.txt) -eq 0 ] || [ $(grep -c PROMOTED_FILE server_out/s.txt) -eq 0 ]; then
+    echo "Errore: nessun file è stato scritto nel tier o riportato in memoria"
+    failed=1
+fi
+if ! grep -q "file non trovati (miss): 0$" server_out/s.txt; then
+    echo "Errore: alcuni file scritti nel tier non sono stati trovati"
+    failed=1
+fi
+max_size=$(grep "Dimensione massima raggiunta dal file storage" server_out/s.txt | awk '{print $(NF-1)}')
+if awk -v size="$max_size" 'BEGIN { exit !(size > 1) }'; then
+    echo "Errore: la memoria occupata dai file ($max_size MB) ha superato STORAGE_MAX_SIZE"
+    failed=1
+fi
+
+rm -fR $tier_dir
+if [ $failed -eq 0 ]; then
+    echo "Test superato"
+else
+    echo "Test fallito"
+    exit 1
+fi
@@ -0,0 +1,121 @@
+#!/bin/bash
+
+client_dir=../client
+server_dir=../server
+
+# Controlla se sono state create tutte le directory necessarie
+if ! [ -d ~/.file_storage ] || ! [ -d clients_out ] || ! [ -d clients_err_out ] || \
+   ! [ -d server_out ] || ! [ -d server_err_out ] || ! [ -d downloaded_files ] || ! [ -d rejected_files ]; then
+    echo "Usare il comando make all prima di eseguire il test"
+    exit 1
+fi
+
+# Controlla che il file /tmp/file_storage.sk non sia già in uso
+if [ -a /tmp/file_storage.sk ]; then
+    echo "Impossibile eseguire il server in quanto il file /tmp/file_storage.sk è già in uso"
+    exit 1
+fi
+
+# Crea il file di configurazione (log delle modifiche con fsync prima di ogni risposta e snapshot ogni secondo)
+wal_dir=$HOME/.file_storage/wal
+rm -fR $wal_dir
+config_file=~/.file_storage/config.txt
+echo "SOCKET_FILE_NAME=/tmp/file_storage.sk" > $config_file
+echo "LOG_FILE_NAME=$HOME/.file_storage/file_storage.log" >> $config_file
+echo "FILES_MAX_NUM=100" >> $config_file
+echo "STORAGE_MAX_SIZE=32" >> $config_file
+echo "MAX_CONN=16" >> $config_file
+echo "WORKER_THREADS_NUM=4" >> $config_file
+echo "WAL_DIR_NAME=$wal_dir" >> $config_file
+echo "DURABILITY=fsync" >> $config_file
+echo "SNAPSHOT_INTERVAL=1" >> $config_file
+
+f_opt="-f /tmp/file_storage.sk"
+files_dir_01=files/dir_01
+files_dir_02=files/dir_02
+files_dir_03=files/dir_03
+failed=0
+
+# Avvia in background il processo server (l'output dell'avvio n-esimo viene scritto in s_n.txt)
+start_server() {
+    rm -f /tmp/file_storage.sk
+    ${server_dir}/fsp_server 1> server_out/s_$1.txt 2> server_err_out/s_$1.txt &
+    server_pid=$!
+    while ! [ -S /tmp/file_storage.sk ] && kill -0 $server_pid 2> /dev/null; do sleep 0.1; done
+}
+
+# Termina il server senza eseguire lo snapshot finale (SIGKILL)
+crash_server() {
+    kill -s KILL $server_pid
+    wait $server_pid
+} 2> /dev/null
+
+# Legge tutti i file dal server e controlla che i file in $1 siano uguali agli originali e che i file in $2
+# non siano presenti ($3 descrive la fase del test)
+check_files() {
+    rm -fR downloaded_files/*
+    ${client_dir}/fsp $f_opt -R 0 -d downloaded_files 1>> clients_out/c.txt 2>> clients_err_out/c.txt
+    for file in $1; do
+        if ! cmp -s $file downloaded_files/$(echo "${file#/}" | tr / _); then
+            echo "Errore ($3): il file $file non è stato ricostruito correttamente"
+            failed=1
+        fi
+    done
+    for file in $2; do
+        if [ -e downloaded_files/$(echo "${file#/}" | tr / _) ]; then
+            echo "Errore ($3): il file rimosso $file è presente sul server"
+            failed=1
+        fi
+    done
+}
+
+# Scrive i file e ne rimuove uno, poi termina il server senza eseguire lo snapshot finale
+start_server 1
+${client_dir}/fsp $f_opt \
+    -w ${files_dir_01} -t 0 \
+    -w ${files_dir_03} -t 0 \
+    -c ${PWD}/${files_dir_01}/us.png \
+    1>> clients_out/c.txt 2>> clients_err_out/c.txt
+crash_server
+
+removed="${PWD}/${files_dir_01}/us.png"
+written=$(ls -d ${PWD}/${files_dir_01}/* ${PWD}/${files_dir_03}/* | grep -v -x $removed)
+
+# I file vengono ricostruiti dal log delle modifiche
+start_server 2
+check_files "$written" "$removed" "ricostruzione dal log"
+
+# Scrive altri file e attende uno snapshot, poi termina il server senza eseguire lo snapshot finale
+${client_dir}/fsp $f_opt \
+    -w ${files_dir_02} -t 0 \
+    -c ${PWD}/${files_dir_03}/file_02.txt \
+    1>> clients_out/c.txt 2>> clients_err_out/c.txt
+sleep 2
+crash_server
+if ! [ -f $wal_dir/snapshot ]; then
+    echo "Errore: lo snapshot non è stato eseguito"
+    failed=1
+fi
+
+removed="$removed ${PWD}/${files_dir_03}/file_02.txt"
+written="$(echo "$written" | grep -v -x ${PWD}/${files_dir_03}/file_02.txt) $(ls -d ${PWD}/${files_dir_02}/*)"
+
+# I file vengono ricostruiti dallo snapshot e dai segmenti successivi del log
+start_server 3
+check_files "$written" "$removed" "ricostruzione dallo snapshot"
+
+# Termina il server con lo snapshot finale e lo riavvia
+kill -s HUP $server_pid
+wait $server_pid
+start_server 4
+check_files "$written" "$removed" "riavvio dopo lo snapshot finale"
+kill -s HUP $server_pid
+wait $server_pid
+
+rm -fR $wal_dir
+if [ $failed -eq 0 ]; then
+    echo "Test superato"
+else
+    echo "Test fallito"
+    exit 1
+fi
@@ -0,0 +1,79 @@
+#!/bin/bash
+
+client_dir=../client
+server_dir=../server
+
+# Controlla se sono state create tutte le directory necessarie
+if ! [ -d ~/.file_storage ] || ! [ -d clients_out ] || ! [ -d clients_err_out ] || \
+   ! [ -d server_out ] || ! [ -d server_err_out ] || ! [ -d downloaded_files ] || ! [ -d rejected_files ]; then
+    echo "Usare il comando make all prima di eseguire il test"
+    exit 1
+fi
+
+# Controlla che il file /tmp/file_storage.sk non sia già in uso
+if [ -a /tmp/file_storage.sk ]; then
+    echo "Impossibile eseguire il server in quanto il file /tmp/file_storage.sk è già in uso"
+    exit 1
+fi
+
+# Crea il file di configurazione
+config_file=~/.file_storage/config.txt
+echo "SOCKET_FILE_NAME=/tmp/file_storage.sk" > $config_file
+echo "LOG_FILE_NAME=$HOME/.file_storage/file_storage.log" >> $config_file
+echo "FILES_MAX_NUM=10000" >> $config_file
+echo "STORAGE_MAX_SIZE=16" >> $config_file
+echo "MAX_CONN=16" >> $config_file
+echo "WORKER_THREADS_NUM=4" >> $config_file
+
+# Crea 2100 piccoli file: l'elenco di ogni prefisso richiede più pagine (1000 file per richiesta LIST)
+list_dir=$(mktemp -d)
+for index in $(seq 1 1500); do printf "%${index}s" > $list_dir/a_$index; done
+for index in $(seq 1 600); do printf "%${index}s" > $list_dir/b_$index; done
+
+# Avvia in background il processo server
+${server_dir}/fsp_server 1> server_out/s.txt 2> server_err_out/s.txt &
+server_pid=$!
+while ! [ -S /tmp/file_storage.sk ] && kill -0 $server_pid 2> /dev/null; do sleep 0.1; done
+
+f_opt="-f /tmp/file_storage.sk"
+failed=0
+
+${client_dir}/fsp $f_opt -w $list_dir 1> clients_out/c.txt 2> clients_err_out/c.txt
+
+# Controlla che l'elenco dei file con prefisso $1 (al più $2 file, 0: tutti) contenga esattamente i primi file
+# in ordine lessicografico con le loro dimensioni
+check_list() {
+    expected=$(cd $list_dir && ls | LC_ALL=C sort | while read name; do
+                   [[ "$list_dir/$name" == "$1"* ]] && echo "$list_dir/$name $(stat -c %s $name)"
+               done)
+    [ $2 -gt 0 ] && expected=$(echo "$expected" | head -n $2)
+    listed=$(${client_dir}/fsp $f_opt -p -L "$1,$2" 2>> clients_err_out/c.txt | grep "^$list_dir/")
+    if [ "$listed" != "$expected" ]; then
+        echo "Errore: l'elenco dei file con prefisso $1 (n = $2) non è corretto ($(echo -n "$listed" | grep -c ^) file elencati)"
+        failed=1
+    fi
+}
+
+check_list "$list_dir/" 0
+check_list "$list_dir/a" 0
+check_list "$list_dir/a" 1234
+check_list "$list_dir/b_1" 0
+check_list "$list_dir/b" 600
+check_list "$list_dir/c" 0
+
+# Dopo la rimozione di alcuni file l'elenco non li contiene
+${client_dir}/fsp $f_opt -c $(ls -d $list_dir/a_1?? | paste -s -d ,) 1>> clients_out/c.txt 2>> clients_err_out/c.txt
+rm $list_dir/a_1??
+check_list "$list_dir/a" 0
+
+# Invia il segnale SIGHUP al server
+kill -s HUP $server_pid
+wait $server_pid
+
+rm -fR $list_dir
+if [ $failed -eq 0 ]; then
+    echo "Test superato"
+else
+    echo "Test fallito"
+    exit 1
+fi